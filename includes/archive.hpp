@@ -0,0 +1,67 @@
+#ifndef ARCHIVE_HPP
+#define ARCHIVE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mach-o.hpp"
+#include "mapped_file.hpp"
+#include "object_file.hpp"
+
+/// A BSD/Darwin static archive (.a file). The archive's ranlib table (the __.SYMDEF member) is
+/// read into a hash index when the archive is opened; the members themselves are parsed only
+/// when a symbol that they define is requested.
+class archive {
+public:
+    /// Maps the archive at \p path and indexes its symbol table. If the file is universal, the
+    /// slice for \p cputype is used. Throws format_error or std::system_error on failure.
+    archive (std::string path, mach_o::cpu_type cputype);
+    /// Indexes the archive whose contents are mapped by \p file. \p path names it in messages.
+    archive (std::string path, std::shared_ptr<mapped_file const> file, mach_o::cpu_type cputype);
+
+    std::string const & path () const noexcept { return path_; }
+    /// \returns The number of symbols in the archive's symbol table.
+    std::size_t symbol_count () const noexcept { return count_; }
+
+    /// \returns The offset of the header of the member defining the symbol \p name, or zero if
+    /// no member defines it.
+    std::uint64_t find (char const * name, std::size_t length) const noexcept;
+
+    /// Returns the member which defines \p name, parsing it the first time that it is
+    /// requested. May be called concurrently.
+    ///
+    /// \returns The member object file or nullptr if no member defines \p name.
+    object_file const * load_member_for (char const * name, std::size_t length);
+
+    /// \returns The number of members that have been parsed.
+    std::size_t loaded_members () const;
+
+private:
+    struct bucket {
+        std::uint64_t hash;
+        char const * name; ///< Points into the mapped string table. nullptr if unused.
+        std::uint32_t length;
+        std::uint64_t offset; ///< Offset of the member header.
+    };
+
+    void index_symbols (array_view<std::uint8_t> contents, bool is64);
+    void insert (char const * name, std::size_t length, std::uint64_t offset);
+    object_file const * load_member (std::uint64_t offset);
+
+    std::string path_;
+    std::shared_ptr<mapped_file const> file_;
+    mach_o::cpu_type cputype_;
+    array_view<std::uint8_t> bytes_; ///< The archive (or its slice of a universal file)
+
+    std::vector<bucket> buckets_; ///< Open-addressed, linear probing, size is a power of 2
+    std::size_t count_ = 0;
+
+    mutable std::mutex mut_;
+    std::unordered_map<std::uint64_t, std::unique_ptr<object_file>> members_;
+};
+
+#endif // ARCHIVE_HPP
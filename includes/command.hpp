@@ -5,12 +5,23 @@
 #include <cstdlib>
 #include <sys/types.h>
 
+#include "uuid.hpp"
+
+class output;
+
 class command {
 public:
     virtual ~command () noexcept = default;
     virtual std::uint32_t size_bytes () const noexcept = 0;
-    virtual std::uint64_t write_command (int fd, std::uint64_t offset) = 0;
-    virtual void write_payload (int fd);
+    /// \returns The size to which the command could grow if it were edited after the link:
+    ///   for example, by changing a path which it contains. Used to reserve header padding.
+    virtual std::uint32_t max_size_bytes () const noexcept { return this->size_bytes (); }
+    virtual std::uint64_t write_command (output & out, std::uint64_t offset) = 0;
+    virtual void write_payload (output & out);
+    /// Called once the whole image has been written. \p digest is derived from every byte
+    /// written by write_command() and write_payload(), so a command which records it (LC_UUID)
+    /// writes a placeholder there and patches it here.
+    virtual void write_digest (output & out, uuid const & digest);
 };
 
 #endif // COMMAND_HPP
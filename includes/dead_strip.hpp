@@ -0,0 +1,33 @@
+#ifndef DEAD_STRIP_HPP
+#define DEAD_STRIP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class thread_pool;
+
+/// The references between atoms, the pieces of input sections which dead stripping keeps or
+/// removes as a whole. The atoms referenced by atom a are refs[start[a]] up to refs[start[a + 1]].
+struct atom_graph {
+    std::vector<std::uint32_t> start;
+    std::vector<std::uint32_t> refs;
+};
+
+/// An edge of the atom graph: the first atom refers to the second.
+using atom_reference = std::pair<std::uint32_t, std::uint32_t>;
+
+/// Builds the graph of \p atoms atoms from \p edges: the references found in each input file.
+atom_graph make_atom_graph (std::size_t atoms,
+                            std::vector<std::vector<atom_reference>> const & edges);
+
+/// Finds the atoms which are reachable in \p graph from any of \p roots. The graph is traversed
+/// concurrently using the workers of \p pool.
+///
+/// \returns A vector indexed by atom holding 1 for an atom which is reachable and 0 for one which
+///   is not.
+std::vector<std::uint8_t> mark_live (atom_graph const & graph,
+                                     std::vector<std::uint32_t> const & roots, thread_pool & pool);
+
+#endif // DEAD_STRIP_HPP
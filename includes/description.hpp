@@ -0,0 +1,48 @@
+#ifndef DESCRIPTION_HPP
+#define DESCRIPTION_HPP
+
+#include <stdexcept>
+#include <string>
+
+class image_builder;
+
+/// Thrown when an image description is malformed. The message gives the name of the
+/// description and the number of the offending line.
+class description_error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/// Adds the segments, sections and commands of an image description to \p builder. The text is
+/// read in a single pass: each line is handled as it is reached, nothing but section contents
+/// is copied, and contents named with "file" are mapped rather than read.
+///
+/// A description is a sequence of lines, each holding a directive followed by its arguments.
+/// '#' starts a comment. A line may be prefixed with "x86_64:" or "arm64:" to apply to one
+/// architecture. Numbers are decimal or hexadecimal with a leading "0x".
+///
+///     page_zero [size]
+///     segment name address|follow prot [maxprot]    (prot is made from 'r', 'w', 'x' and '-')
+///     section name align [type] [attribute]...      (align is a power of 2)
+///     hex digits...                                 (appends bytes to the section's contents)
+///     fill size [byte]                              (appends size copies of byte)
+///     file path                                     (the section's contents are the file)
+///     zerofill size                                 (the section occupies memory only)
+///     data_in_code offset length kind               (kind is data, jump_table8 and so on)
+///     dylib path
+///     entry segment section [offset]
+///     build_version platform minos sdk | off
+///     uuid on|off
+///
+/// \param first  The start of the description's text.
+/// \param last  The end of the description's text.
+/// \param name  The name used for the description in error messages.
+/// \param arch  The name of the target architecture (as returned by Target::name()).
+/// \param builder  The builder to which the image's contents are added.
+void parse_description (char const * first, char const * last, std::string const & name,
+                        char const * arch, image_builder & builder);
+
+/// Maps the file at \p path and parses the image description that it contains.
+void read_description (std::string const & path, char const * arch, image_builder & builder);
+
+#endif // DESCRIPTION_HPP
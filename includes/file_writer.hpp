@@ -0,0 +1,56 @@
+#ifndef FILE_WRITER_HPP
+#define FILE_WRITER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "universal.hpp"
+
+/// Opens \p path for writing, creating it if necessary. Throws std::system_error.
+int open_output (std::string const & path, bool truncate);
+
+/// Builds the image of each of \p slices and writes them to \p path: a single slice as a thin
+/// file and several as a universal binary. Throws std::system_error.
+///
+/// \param incremental  If true and there is a single slice, only the parts of the previous
+///   output which have changed are written. The state which describes them is kept in
+///   "<path>.incremental".
+void write_image_file (std::string const & path, std::vector<slice> const & slices,
+                       bool incremental);
+
+/// Writes finished images to their files on a thread of its own so that the next image can
+/// be built and laid out while the previous one is written. There are two buffers: the one
+/// being written and the one being filled.
+class file_writer {
+public:
+    file_writer ();
+    file_writer (file_writer const &) = delete;
+    file_writer & operator= (file_writer const &) = delete;
+    ~file_writer () noexcept;
+
+    /// Waits for the previous write to finish then starts to write \p bytes to \p path.
+    /// \p bytes is exchanged for the previous buffer so that it can be reused.
+    void submit (std::string const & path, std::vector<std::uint8_t> & bytes);
+    /// Waits for the write in progress, if any, to finish.
+    void wait ();
+    /// \returns The errors raised by the writes which have finished.
+    std::vector<std::string> errors ();
+
+private:
+    void run ();
+
+    std::mutex mut_;
+    std::condition_variable cv_;
+    bool busy_ = false;
+    bool done_ = false;
+    std::string path_;
+    std::vector<std::uint8_t> bytes_;
+    std::vector<std::string> errors_;
+    std::thread thread_;
+};
+
+#endif // FILE_WRITER_HPP
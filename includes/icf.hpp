@@ -0,0 +1,49 @@
+#ifndef ICF_HPP
+#define ICF_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class thread_pool;
+
+/// What a relocation of an identical code folding (ICF) candidate refers to.
+struct icf_target {
+    static constexpr std::uint32_t none = ~std::uint32_t{0};
+
+    std::uint32_t atom = none;   ///< The target atom (then value is the offset in it)
+    std::uint32_t global = none; ///< An import or common symbol
+    std::uint64_t value = 0;
+};
+
+/// A relocation of an ICF candidate.
+struct icf_ref {
+    std::uint32_t offset; ///< The relocation's offset within its atom
+    std::uint8_t type;
+    std::uint8_t length;
+    std::uint8_t flags;
+    std::int64_t addend; ///< From an ARM64_RELOC_ADDEND
+    icf_target to;
+};
+
+/// An atom which may be folded into an identical one.
+struct icf_candidate {
+    std::uint32_t atom;
+    std::uint8_t const * contents; ///< The atom's bytes
+    std::uint32_t size;
+    unsigned align; ///< The atom's alignment (log2)
+    std::vector<icf_ref> refs; ///< The atom's relocations in any order
+};
+
+/// Finds the candidates which are identical: their contents, alignment and relocations are the
+/// same and the atoms to which they refer are either the same or are themselves identical.
+/// Candidates must be in ascending order of atom. The references of each candidate are sorted.
+/// Work is shared amongst the workers of \p pool.
+///
+/// \param atoms  The total number of atoms: the bound of every icf_target::atom.
+/// \returns For each candidate, the atom of the first candidate which is identical to it. This
+///   is the candidate's own atom unless it can be folded into an earlier one.
+std::vector<std::uint32_t> find_identical (std::vector<icf_candidate> & candidates,
+                                           std::size_t atoms, thread_pool & pool);
+
+#endif // ICF_HPP
@@ -0,0 +1,74 @@
+#ifndef IMAGE_HPP
+#define IMAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "command.hpp"
+#include "mach-o.hpp"
+#include "uuid.hpp"
+
+class output;
+
+/// A Mach-O image: a header and the load commands which describe its contents.
+class image {
+public:
+    image (mach_o::cpu_type cputype, mach_o::cpu_subtype cpusubtype, mach_o::filetype_t filetype,
+           std::uint32_t flags, std::vector<std::unique_ptr<command>> && commands);
+
+    mach_o::cpu_type cputype () const noexcept { return header_.cputype; }
+    mach_o::cpu_subtype cpusubtype () const noexcept { return header_.cpusubtype; }
+
+    /// Registers a function which is called each time that the image has been laid out, before
+    /// any payload is written. This is the point at which the final address of every section is
+    /// known: section contents which depend on those addresses are patched here. Any state that
+    /// the function needs is kept alive by the image.
+    void on_layout (std::function<void ()> f) { on_layout_.push_back (std::move (f)); }
+    /// Keeps \p p alive for as long as the image: for example, the storage for section contents
+    /// or names to which the commands refer.
+    void retain (std::shared_ptr<void const> p) { retained_.push_back (std::move (p)); }
+
+    /// Reserves unused space between the load commands and the first section's contents so
+    /// that tools which edit the image after the link can add or grow load commands without
+    /// moving any segment. At least \p bytes are reserved. If \p max_install_names is true,
+    /// the padding is also enough for every dylib load command to name a path of MAXPATHLEN
+    /// bytes. The amount is rounded up to a multiple of 8.
+    void reserve_header_pad (std::uint32_t bytes, bool max_install_names);
+    /// \returns The number of bytes reserved after the load commands.
+    std::uint32_t header_pad () const noexcept { return header_pad_; }
+
+    /// \returns The size of the header and load commands: the bytes which describe the layout
+    ///   of the image once it has been written.
+    std::size_t header_size () const noexcept { return sizeof (header_) + header_.sizeofcmds; }
+
+    /// Lays out the image and writes it to \p out: write_commands() followed by write_payload().
+    ///
+    /// \returns The number of bytes occupied by the image.
+    std::uint64_t write (output & out);
+    /// Lays out the image and writes its header and load commands (the first header_size()
+    /// bytes) to \p out. Nothing else is written, so the layout and size of an image can be
+    /// found without producing its contents.
+    ///
+    /// \returns The number of bytes occupied by the image.
+    std::uint64_t write_commands (output & out);
+    /// Writes the contents of the image laid out by the preceding call to write_commands(): the
+    /// functions registered with on_layout() are called, then the segments' contents and the
+    /// link-edit tables are written to \p out. The header and load commands are not. Finally,
+    /// each command is given a digest of the bytes of the whole image (see
+    /// command::write_digest()).
+    void write_payload (output & out);
+
+private:
+    mach_o::mach_header_64 header_;
+    std::vector<std::unique_ptr<command>> commands_;
+    std::vector<std::function<void ()>> on_layout_;
+    std::vector<std::shared_ptr<void const>> retained_;
+    std::uint32_t header_pad_ = 0;
+    /// Hashes the bytes written by write_commands() and write_payload().
+    uuid_hasher hasher_;
+};
+
+#endif // IMAGE_HPP
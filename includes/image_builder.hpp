@@ -0,0 +1,130 @@
+#ifndef IMAGE_BUILDER_HPP
+#define IMAGE_BUILDER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "image.hpp"
+#include "lc_segment.hpp"
+
+class string_arena;
+
+/// Builds an executable (MH_EXECUTE) image from segments, sections and load commands without the
+/// caller having to wire the commands together. build() adds the commands that every executable
+/// needs: __LINKEDIT and the link-edit data which it holds (the dyld information, the symbol
+/// tables and the data-in-code table), LC_LOAD_DYLINKER, LC_UUID, LC_BUILD_VERSION and LC_MAIN.
+/// The data-in-code table holds the ranges recorded with add_data_in_code().
+///
+/// Segments and sections are placed in the order in which they are added. A section's address
+/// and file offset are assigned when the image is laid out.
+class image_builder {
+public:
+    /// Passed as the address of a segment which is to start at the first page boundary after
+    /// the end of the previous segment.
+    static constexpr std::uint64_t follow = ~std::uint64_t{0};
+
+    /// \param cputype  The image's CPU type.
+    /// \param cpusubtype  The image's CPU subtype.
+    /// \param page_size  The target's page size: the alignment of the segments.
+    /// \param min_os  The default minimum OS and SDK version for the LC_BUILD_VERSION command.
+    image_builder (mach_o::cpu_type cputype, mach_o::cpu_subtype cpusubtype,
+                   std::uint64_t page_size, std::uint32_t min_os);
+    /// Creates a builder for one of the target traits types in target.hpp.
+    template <typename Target>
+    static image_builder for_target () {
+        return {Target::cpu_type (), Target::cpu_subtype (), Target::page_size (),
+                Target::min_os_version ()};
+    }
+
+    /// \returns The target's page size: the alignment of the segments.
+    std::uint64_t page_size () const noexcept { return page_size_; }
+    /// Adds a __PAGEZERO segment of \p size bytes at address 0. It must be the first segment.
+    void add_page_zero (std::uint64_t size = std::uint64_t{1} << 32);
+    /// Adds a segment. The __TEXT segment also maps the image's header and load commands.
+    /// \param name  The segment name (at most 16 characters).
+    /// \param vmaddr  The segment's address or image_builder::follow.
+    /// \param maxprot  The maximum VM protection.
+    /// \param initprot  The initial VM protection.
+    /// \returns The index of the segment.
+    std::size_t add_segment (char const * name, std::uint64_t vmaddr, mach_o::vm_prot_t maxprot,
+                             mach_o::vm_prot_t initprot);
+    /// Adds a section to \p segment whose contents are the bytes between the pointers of
+    /// \p contents. The bytes are not copied: they must outlive the image or be kept alive with
+    /// retain(). A zero-fill section has no contents and occupies \p zerofill_size bytes of
+    /// memory; it must follow the segment's other sections.
+    /// \returns The index of the section within its segment.
+    std::size_t add_section (std::size_t segment, char const * name, std::uint32_t align,
+                             std::uint32_t flags, lc_segment::contents_range contents,
+                             std::uint64_t zerofill_size = 0);
+    /// Adds a section whose contents are held by the image.
+    std::size_t add_section (std::size_t segment, char const * name, std::uint32_t align,
+                             std::uint32_t flags, std::vector<std::uint8_t> contents);
+
+    /// Records that \p length bytes at \p offset in the section at \p section of \p segment are
+    /// data rather than instructions (see lc_data_in_code::add()). \p kind is one of the
+    /// mach_o::dice_kind_xxx constants. Throws std::out_of_range if the section does not exist
+    /// or the range does not lie within its contents.
+    void add_data_in_code (std::size_t segment, std::size_t section, std::uint32_t offset,
+                           std::uint32_t length, std::uint16_t kind);
+    /// Sets the entry point to \p offset bytes from the start of the section at \p section of
+    /// \p segment. By default, execution starts at the first section of the __TEXT segment.
+    void set_entry_point (std::size_t segment, std::size_t section, std::uint64_t offset = 0);
+    /// Adds an LC_LOAD_DYLIB command for the library with install name \p path.
+    void add_dylib (std::string const & path);
+    /// Sets the platform and versions recorded by the LC_BUILD_VERSION command.
+    void set_build_version (std::uint32_t platform, std::uint32_t minos, std::uint32_t sdk);
+    /// Controls whether build() adds an LC_UUID command. The UUID is derived from the contents
+    /// of the image. It does by default.
+    void emit_uuid (bool enabled) noexcept { uuid_ = enabled; }
+    /// Controls whether build() adds an LC_BUILD_VERSION command. It does by default.
+    void emit_build_version (bool enabled) noexcept { build_version_ = enabled; }
+    /// Reserves unused space after the load commands (see image::reserve_header_pad()).
+    void set_header_pad (std::uint32_t bytes, bool max_install_names = false);
+    /// Adds an arbitrary command. Such commands follow the ones which build() adds.
+    void add_command (std::unique_ptr<command> cmd);
+    /// Keeps \p p alive for as long as the image that is built.
+    void retain (std::shared_ptr<void const> p);
+
+    /// Creates the image. The builder must not be used afterwards.
+    image build ();
+
+private:
+    struct entry_point {
+        std::size_t segment;
+        std::size_t section;
+        std::uint64_t offset;
+    };
+    struct data_in_code_range {
+        std::size_t segment;
+        std::size_t section;
+        std::uint32_t offset;
+        std::uint32_t length;
+        std::uint16_t kind;
+    };
+
+    mach_o::cpu_type cputype_;
+    mach_o::cpu_subtype cpusubtype_;
+    std::uint64_t page_size_;
+    std::uint32_t platform_;
+    std::uint32_t minos_;
+    std::uint32_t sdk_;
+    bool uuid_ = true;
+    bool build_version_ = true;
+    std::uint32_t header_pad_ = 0;
+    bool header_pad_max_install_names_ = false;
+
+    std::shared_ptr<string_arena> names_;
+    std::vector<std::unique_ptr<lc_segment>> segments_;
+    bool has_entry_ = false;
+    entry_point entry_{0, 0, 0};
+    std::vector<std::string> dylibs_;
+    /// Sections are not added to the data-in-code table until build(): adding a section to a
+    /// segment may move the others.
+    std::vector<data_in_code_range> data_in_code_;
+    std::vector<std::unique_ptr<command>> extra_;
+    std::vector<std::shared_ptr<void const>> retained_;
+};
+
+#endif // IMAGE_BUILDER_HPP
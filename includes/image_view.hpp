@@ -0,0 +1,192 @@
+#ifndef IMAGE_VIEW_HPP
+#define IMAGE_VIEW_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+
+#include "mach-o.hpp"
+#include "util.hpp"
+
+/// Thrown when the contents of a file do not describe a well-formed Mach-O image.
+class format_error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// The views in this file refer directly to the bytes of an image (typically a mapped_file) using
+// the structure definitions from mach-o.hpp. Nothing is copied and no memory is allocated, but
+// each access is checked against the bounds of the image.
+
+/// A view of a single load command.
+class load_command_view {
+public:
+    explicit load_command_view (mach_o::load_command const * lc) noexcept
+            : lc_{lc} {}
+
+    std::uint32_t cmd () const noexcept { return lc_->cmd; }
+    std::uint32_t cmdsize () const noexcept { return lc_->cmdsize; }
+    std::uint8_t const * data () const noexcept {
+        return reinterpret_cast<std::uint8_t const *> (lc_);
+    }
+
+    /// \returns The load command as its full structure type \p T. Throws format_error if the
+    /// command is too small or is not correctly aligned for \p T.
+    template <typename T>
+    T const & as () const;
+
+private:
+    mach_o::load_command const * lc_;
+};
+
+template <typename T>
+T const & load_command_view::as () const {
+    if (lc_->cmdsize < sizeof (T)) {
+        throw format_error ("load command is too small");
+    }
+    if (reinterpret_cast<std::uintptr_t> (lc_) % alignof (T) != 0U) {
+        throw format_error ("load command is misaligned");
+    }
+    return *reinterpret_cast<T const *> (lc_);
+}
+
+/// Iterates over the load commands of an image. Each command is checked to lie within the
+/// sizeofcmds bytes following the header as the iterator reaches it.
+class load_command_iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = load_command_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = load_command_view const *;
+    using reference = load_command_view;
+
+    load_command_iterator (std::uint8_t const * pos, std::uint8_t const * end,
+                           std::uint32_t remaining)
+            : pos_{pos}
+            , end_{end}
+            , remaining_{remaining} {
+        this->check ();
+    }
+
+    reference operator* () const noexcept {
+        return load_command_view{reinterpret_cast<mach_o::load_command const *> (pos_)};
+    }
+    load_command_iterator & operator++ () {
+        assert (remaining_ > 0U);
+        pos_ += reinterpret_cast<mach_o::load_command const *> (pos_)->cmdsize;
+        --remaining_;
+        this->check ();
+        return *this;
+    }
+    load_command_iterator operator++ (int) {
+        auto const prev = *this;
+        ++*this;
+        return prev;
+    }
+
+    bool operator== (load_command_iterator const & rhs) const noexcept {
+        return remaining_ == rhs.remaining_;
+    }
+    bool operator!= (load_command_iterator const & rhs) const noexcept {
+        return !operator== (rhs);
+    }
+
+private:
+    void check () const;
+
+    std::uint8_t const * pos_;
+    std::uint8_t const * end_;
+    std::uint32_t remaining_;
+};
+
+class load_command_range {
+public:
+    load_command_range (load_command_iterator first, load_command_iterator last) noexcept
+            : first_{first}
+            , last_{last} {}
+    load_command_iterator begin () const noexcept { return first_; }
+    load_command_iterator end () const noexcept { return last_; }
+
+private:
+    load_command_iterator first_;
+    load_command_iterator last_;
+};
+
+
+/// A view of a single-architecture 64-bit Mach-O image.
+class image_view {
+public:
+    /// Checks the header of the image occupying \p size bytes at \p data. Throws format_error
+    /// if it isn't a 64-bit little-endian Mach-O image or if its load commands would overflow
+    /// the image.
+    image_view (std::uint8_t const * data, std::size_t size);
+
+    std::uint8_t const * data () const noexcept { return data_; }
+    std::size_t size () const noexcept { return size_; }
+
+    mach_o::mach_header_64 const & header () const noexcept {
+        return *reinterpret_cast<mach_o::mach_header_64 const *> (data_);
+    }
+    load_command_range commands () const;
+
+    /// \returns The section_64 array which follows \p segment.
+    array_view<mach_o::section_64> sections (mach_o::segment_command_64 const & segment) const;
+
+    /// \returns The \p size bytes starting at file offset \p offset.
+    array_view<std::uint8_t> bytes (std::uint64_t offset, std::uint64_t size) const;
+    /// \returns The file contents of \p section. Empty for zero-fill sections.
+    array_view<std::uint8_t> contents (mach_o::section_64 const & section) const;
+    /// \returns The link-edit data described by a linkedit_data_command.
+    array_view<std::uint8_t> blob (mach_o::linkedit_data_command const & lc) const {
+        return this->bytes (lc.dataoff, lc.datasize);
+    }
+    /// \returns An array of \p count instances of \p T starting at file offset \p offset.
+    template <typename T>
+    array_view<T> table (std::uint64_t offset, std::uint64_t count) const;
+
+private:
+    void check_range (std::uint64_t offset, std::uint64_t size) const;
+
+    std::uint8_t const * data_;
+    std::size_t size_;
+};
+
+template <typename T>
+array_view<T> image_view::table (std::uint64_t offset, std::uint64_t count) const {
+    if (count > type_max<std::uint64_t> () / sizeof (T)) {
+        throw format_error ("table is too large");
+    }
+    this->check_range (offset, count * sizeof (T));
+    std::uint8_t const * const first = data_ + offset;
+    if (reinterpret_cast<std::uintptr_t> (first) % alignof (T) != 0U) {
+        throw format_error ("table is misaligned");
+    }
+    return {reinterpret_cast<T const *> (first), static_cast<std::size_t> (count)};
+}
+
+
+/// A view of a universal (fat) file. The fat_header and fat_arch structures are big-endian so
+/// their fields are converted as they are read.
+class universal_view {
+public:
+    /// Throws format_error if the file is not a universal binary or its architecture table
+    /// overflows the file.
+    universal_view (std::uint8_t const * data, std::size_t size);
+
+    /// \returns True if the \p size bytes at \p data start with the fat magic number.
+    static bool is_universal (std::uint8_t const * data, std::size_t size) noexcept;
+
+    std::size_t size () const noexcept { return nfat_arch_; }
+    /// \returns The fat_arch entry at \p index with its fields in host byte order.
+    mach_o::fat_arch arch (std::size_t index) const noexcept;
+    /// \returns The image described by the fat_arch entry at \p index.
+    image_view slice (std::size_t index) const;
+
+private:
+    std::uint8_t const * data_;
+    std::size_t size_;
+    std::uint32_t nfat_arch_;
+};
+
+#endif // IMAGE_VIEW_HPP
@@ -0,0 +1,103 @@
+#ifndef INCREMENTAL_HPP
+#define INCREMENTAL_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "output.hpp"
+
+/// The properties of a file which tell whether it has been changed: its size and modification
+/// time.
+struct file_stamp {
+    std::uint64_t size;
+    std::int64_t mtime;
+    std::int64_t mtime_nsec;
+};
+
+inline bool operator== (file_stamp const & a, file_stamp const & b) noexcept {
+    return a.size == b.size && a.mtime == b.mtime && a.mtime_nsec == b.mtime_nsec;
+}
+inline bool operator!= (file_stamp const & a, file_stamp const & b) noexcept {
+    return !(a == b);
+}
+
+/// \returns The stamp of the file open as \p fd. Throws std::system_error.
+file_stamp get_file_stamp (int fd);
+
+/// A record of the bytes written to an output file: the extent and hash of each run of
+/// contiguous writes. It is kept in a sidecar file so that the next link of the same output
+/// can tell which runs are unchanged and skip writing them.
+class incremental_state {
+public:
+    struct extent {
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::uint64_t hash;
+    };
+
+    /// Reads the state recorded for the file open as \p fd from \p path. The result is empty if
+    /// the state file is missing or malformed or if the output file has been changed (its size
+    /// or modification time differ) since the state was saved.
+    static incremental_state load (std::string const & path, int fd);
+    /// Records the extents and the current size and modification time of the file open as
+    /// \p fd in \p path. Throws std::system_error.
+    void save (std::string const & path, int fd) const;
+
+    bool empty () const noexcept { return extents_.empty (); }
+    /// \returns The recorded extent which starts at \p offset or nullptr if there is none.
+    extent const * find (std::uint64_t offset) const noexcept;
+
+    /// The extents, ordered by offset.
+    std::vector<extent> const & extents () const noexcept { return extents_; }
+
+private:
+    friend class incremental_output;
+    std::vector<extent> extents_;
+};
+
+/// Writes an image over the previous contents of a file, skipping every run of writes whose
+/// extent and hash are the same as in the state recorded by the previous link. If only a few
+/// sections change and none moves, only those sections and the image's UUID (which is derived
+/// from its contents) reach the disk. When the layout does change, the runs which no longer
+/// match are written and finish() clears any stale bytes that the new image does not cover.
+///
+/// Small writes which follow one another are gathered into a single run so that the state does
+/// not grow with the number of symbols or section headers.
+class incremental_output final : public output {
+public:
+    /// \param fd  The output file, opened for reading and writing without truncation.
+    /// \param previous  The state saved by the previous link. If empty, the file is truncated
+    ///   and every byte is written.
+    incremental_output (int fd, incremental_state previous);
+
+    /// Flushes any pending run, zeroes the bytes written by the previous link which are not
+    /// covered by this one and sets the file's size to \p size.
+    void finish (std::uint64_t size);
+
+    /// \returns The state to save for the next link. Valid after finish().
+    incremental_state const & state () const noexcept { return next_; }
+    /// \returns The number of bytes that have been written to the file.
+    std::uint64_t bytes_written () const noexcept { return written_; }
+
+private:
+    void write_at (std::uint64_t pos, void const * data, std::size_t size) override;
+    /// Records the run of \p size bytes at \p pos and writes it unless it is unchanged.
+    void put (std::uint64_t pos, std::uint8_t const * data, std::size_t size);
+    void flush ();
+
+    int fd_;
+    file_output file_;
+    incremental_state previous_;
+    incremental_state next_;
+    std::uint64_t written_ = 0;
+
+    /// The run being gathered.
+    std::uint64_t run_pos_ = 0;
+    std::vector<std::uint8_t> run_;
+};
+
+/// \returns A 64-bit hash of the \p size bytes at \p data.
+std::uint64_t hash_bytes (void const * data, std::size_t size) noexcept;
+
+#endif // INCREMENTAL_HPP
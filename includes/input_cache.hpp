@@ -0,0 +1,81 @@
+#ifndef INPUT_CACHE_HPP
+#define INPUT_CACHE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "incremental.hpp"
+#include "mach-o.hpp"
+
+class archive;
+class object_file;
+class thread_pool;
+
+/// Keeps parsed input files (object files with their sections, symbol and relocation tables, and
+/// archives with their symbol indexes and the members loaded so far) in memory so that a program
+/// which links repeatedly parses each unchanged input once.
+///
+/// A cached file is reused while its size and modification time are unchanged. If they have
+/// changed, the file is hashed: when the contents are the same (the file was touched or
+/// regenerated identically) the parsed form is still reused; otherwise the file is parsed again.
+/// Inputs should be replaced rather than rewritten in place while a link which uses them is in
+/// progress.
+///
+/// All of the member functions may be called concurrently.
+class input_cache {
+public:
+    struct statistics {
+        std::uint64_t hits = 0;     ///< Files whose stamp was unchanged
+        std::uint64_t rehashed = 0; ///< Files whose stamp had changed but contents had not
+        std::uint64_t loads = 0;    ///< Files which were parsed
+    };
+
+    /// Returns the object files at \p paths for \p cputype, in order. Those which are not cached
+    /// or have changed are loaded concurrently using the workers of \p pool. If any file cannot
+    /// be loaded, the first error (in the order of \p paths) is thrown as a load_error whose
+    /// message names the file.
+    std::vector<std::shared_ptr<object_file const>>
+    objects (std::vector<std::string> const & paths, mach_o::cpu_type cputype, thread_pool & pool);
+
+    /// Returns the archive at \p path for \p cputype, opening it if it is not cached or has
+    /// changed. Throws format_error or std::system_error.
+    std::shared_ptr<archive> archive_at (std::string const & path, mach_o::cpu_type cputype);
+
+    /// Starts a new generation: the files used from now on are marked with it.
+    void next_generation ();
+    /// Drops the files which have not been used during the last \p max_idle generations.
+    /// \returns The number of files dropped.
+    std::size_t evict (std::uint64_t max_idle);
+
+    /// \returns The number of cached files.
+    std::size_t size () const;
+    /// \returns The counts of the lookups made since the cache was created.
+    statistics stats () const;
+
+private:
+    struct entry {
+        file_stamp stamp;
+        std::uint64_t hash;
+        std::uint64_t used; ///< The generation in which the entry was last used
+        std::shared_ptr<object_file const> object;
+        std::shared_ptr<archive> arch;
+    };
+
+    /// Returns the file at \p path for \p cputype from the cache, if it is current, or by
+    /// calling \p parse (mapped_file) and caching the result. \p member selects the kind of
+    /// file.
+    template <typename T, typename Parse>
+    std::shared_ptr<T> lookup (std::string const & path, mach_o::cpu_type cputype,
+                               std::shared_ptr<T> entry::*member, Parse parse);
+
+    mutable std::mutex mut_;
+    std::unordered_map<std::string, entry> entries_;
+    std::uint64_t generation_ = 0;
+    statistics stats_;
+};
+
+#endif // INPUT_CACHE_HPP
@@ -0,0 +1,85 @@
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <iosfwd>
+
+/// The phases into which the production of an image is divided when it is instrumented.
+enum class phase {
+    command_construction, ///< Building an image's commands: linking or reading a description
+    layout,               ///< Assigning addresses and file offsets to segments and sections
+    relocation,           ///< Patching section contents once their addresses are known
+    load_commands,        ///< Writing the header and load commands
+    payload,              ///< Writing section contents and relocations
+    linkedit,             ///< Generating and writing the __LINKEDIT tables
+};
+constexpr std::size_t phase_count = 6;
+
+struct phase_time {
+    std::uint64_t wall_ns = 0;
+    std::uint64_t cpu_ns = 0;
+};
+
+/// A snapshot of the instrumentation counters.
+struct counters {
+    std::array<phase_time, phase_count> phases{};
+    std::uint64_t syscalls = 0;      ///< File system calls made to read inputs and write outputs
+    std::uint64_t bytes_written = 0; ///< Bytes written to files
+    std::uint64_t seeks = 0; ///< Writes which did not start where the previous one ended
+    std::uint64_t allocations = 0;
+    /// False if the program does not count its allocations (see enable_allocation_counting()),
+    /// in which case allocations is always 0 and is reported as unavailable.
+    bool allocations_counted = false;
+};
+
+/// \returns The counts accumulated between the snapshots \p b and \p a.
+counters operator- (counters const & a, counters const & b) noexcept;
+
+/// Starts or stops recording. While instrumentation is disabled, the counters are not updated
+/// and phase_timer does nothing, so instrumentation costs little more than a test of a flag.
+/// \returns True if instrumentation was enabled before the call.
+bool enable_instrumentation (bool enabled = true) noexcept;
+bool instrumentation_enabled () noexcept;
+/// \returns The counts recorded since instrumentation was enabled.
+counters read_counters () noexcept;
+
+void count_syscalls (unsigned n = 1U) noexcept;
+void count_bytes_written (std::uint64_t bytes) noexcept;
+void count_seek () noexcept;
+/// Heap allocations can only be counted by a program which replaces the global operator new and
+/// calls count_allocation() from it. The library does not do this (the machowriter executable
+/// does), so a program which does should call enable_allocation_counting() once at startup;
+/// otherwise the allocation count is reported as unavailable.
+void enable_allocation_counting () noexcept;
+void count_allocation () noexcept;
+
+/// Records the wall-clock and CPU time between its construction and destruction against a
+/// phase. Time spent in a phase_timer nested within this one on the same thread is recorded
+/// against the inner timer's phase only. CPU time is that of the whole process so it includes
+/// the work of a thread pool's workers; when phases run concurrently (as do the slices of a
+/// universal binary), each is also charged the CPU time of the others.
+class phase_timer {
+public:
+    explicit phase_timer (phase p) noexcept;
+    phase_timer (phase_timer const &) = delete;
+    phase_timer & operator= (phase_timer const &) = delete;
+    ~phase_timer () noexcept;
+
+private:
+    phase phase_;
+    bool active_;
+    phase_timer * parent_ = nullptr;
+    std::chrono::steady_clock::time_point start_wall_;
+    std::clock_t start_cpu_ = 0;
+    std::uint64_t child_wall_ns_ = 0;
+    std::uint64_t child_cpu_ns_ = 0;
+};
+
+/// Writes \p c to \p os as text or, if \p json is true, as a single-line JSON object.
+void print_counters (std::ostream & os, counters const & c, bool json);
+
+#endif // INSTRUMENTATION_HPP
@@ -0,0 +1,62 @@
+#ifndef LAYOUT_HPP
+#define LAYOUT_HPP
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "mach-o.hpp"
+#include "universal.hpp"
+
+class image;
+
+struct section_layout {
+    std::string name;
+    std::uint64_t addr;
+    std::uint64_t size;
+    std::uint32_t offset; ///< The file offset of the contents or 0 for a zero-fill section
+};
+
+struct segment_layout {
+    std::string name;
+    std::uint64_t vmaddr;
+    std::uint64_t vmsize;
+    std::uint64_t fileoff;
+    std::uint64_t filesize;
+    std::vector<section_layout> sections;
+};
+
+/// One of the tables in the __LINKEDIT segment: the symbol table, the dyld information and so on.
+struct linkedit_layout {
+    char const * name;
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+struct image_layout {
+    mach_o::cpu_type cputype;
+    std::uint64_t offset; ///< The offset of the image within its file
+    std::uint64_t size;
+    std::vector<segment_layout> segments;
+    std::vector<linkedit_layout> linkedit;
+};
+
+struct file_layout {
+    std::uint64_t size;
+    std::vector<image_layout> images;
+};
+
+/// Lays out \p img as image::write() does and describes the result. Only the header and load
+/// commands are produced: the contents are not relocated or written.
+image_layout lay_out_image (image & img);
+
+/// Builds and lays out each of \p slices and places them in a file exactly as
+/// write_image_file() would, but without opening or writing anything.
+file_layout lay_out_file (std::vector<slice> const & slices);
+
+/// Writes a description of \p layout to \p os: the size of the file, then the position of each
+/// image, segment, section and link-edit table. \p name is the name of the file.
+void print_layout (std::ostream & os, std::string const & name, file_layout const & layout);
+
+#endif // LAYOUT_HPP
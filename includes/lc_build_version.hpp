@@ -2,11 +2,28 @@
 #define LC_BUILD_VERSION_HPP
 
 #include "command.hpp"
+#include "mach-o.hpp"
+#include "version.hpp"
 
 class lc_build_version : public command {
 public:
+    /// \param platform  The platform (e.g. mach_o::platform_macos).
+    /// \param minos  The minimum OS version: X.Y.Z is encoded in nibbles xxxx.yy.zz.
+    /// \param sdk  The SDK version: X.Y.Z is encoded in nibbles xxxx.yy.zz.
+    explicit lc_build_version (std::uint32_t platform = mach_o::platform_macos,
+                               std::uint32_t minos = version (10, 14, 0),
+                               std::uint32_t sdk = version (10, 14, 0)) noexcept
+            : platform_{platform}
+            , minos_{minos}
+            , sdk_{sdk} {}
+
     std::uint32_t size_bytes () const noexcept override;
-    std::uint64_t write_command (int fd, std::uint64_t offset) override;
+    std::uint64_t write_command (output & out, std::uint64_t offset) override;
+
+private:
+    std::uint32_t platform_;
+    std::uint32_t minos_;
+    std::uint32_t sdk_;
 };
 
 #endif // LC_BUILD_VERSION_HPP
@@ -1,12 +1,52 @@
 #ifndef LC_DATA_IN_CODE_HPP
 #define LC_DATA_IN_CODE_HPP
 
+#include <vector>
+
 #include "command.hpp"
+#include "lc_segment.hpp"
+#include "linkedit_blob.hpp"
+#include "util.hpp"
 
-class lc_data_in_code : public command {
+/// The LC_DATA_IN_CODE command and the table of data_in_code_entry records that it describes.
+/// The table is written to the __LINKEDIT segment: the object must be added to that segment's
+/// blobs.
+class lc_data_in_code : public command, public linkedit_blob {
 public:
+    /// Records a range of non-instruction bytes (a jump table or literal pool, for example) in a
+    /// text section. Ranges may be added in any order; adjacent or overlapping ranges of the same
+    /// kind are merged. Ranges of different kinds must not overlap: finalize() throws
+    /// std::logic_error if they do. Throws std::out_of_range if the range does not lie within
+    /// the contents of \p section.
+    ///
+    /// \param section  The section containing the data.
+    /// \param offset  The offset of the start of the data from the start of \p section.
+    /// \param length  The number of bytes of data.
+    /// \param kind  The kind of data: one of the mach_o::dice_kind_xxx constants.
+    void add (not_null<lc_segment::section_value const *> section, std::uint32_t offset,
+              std::uint32_t length, std::uint16_t kind);
+
     std::uint32_t size_bytes () const noexcept override;
-    std::uint64_t write_command (int fd, std::uint64_t offset) override;
+    std::uint64_t write_command (output & out, std::uint64_t offset) override;
+
+    std::uint64_t finalize () override;
+    void write_blob (output & out) override;
+
+private:
+    struct range {
+        std::uint32_t offset;
+        std::uint32_t length;
+        std::uint16_t kind;
+    };
+    struct section_ranges {
+        section_ranges (not_null<lc_segment::section_value const *> s)
+                : section{s} {}
+        not_null<lc_segment::section_value const *> section;
+        std::vector<range> ranges;
+    };
+
+    /// The ranges recorded for each section, in the order that the sections were first seen.
+    std::vector<section_ranges> sections_;
 };
 
 #endif // LC_DATA_IN_CODE_HPP
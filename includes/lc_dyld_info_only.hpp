@@ -1,12 +1,67 @@
 #ifndef LC_DYLD_INFO_ONLY_HPP
 #define LC_DYLD_INFO_ONLY_HPP
 
+#include <vector>
+
 #include "command.hpp"
+#include "lc_segment.hpp"
+#include "linkedit_blob.hpp"
+#include "string_arena.hpp"
+#include "util.hpp"
 
-class lc_dyld_info_only : public command {
+/// The LC_DYLD_INFO_ONLY command and the rebase and (non-lazy) binding opcode streams that it
+/// describes. The streams are encoded once the segments have been laid out and are written to
+/// the __LINKEDIT segment: the object must be added to that segment's blobs.
+class lc_dyld_info_only : public command, public linkedit_blob {
 public:
+    /// The location of a pointer in the image.
+    struct location {
+        /// The index of the segment's LC_SEGMENT_64 command amongst the image's segments.
+        unsigned segment_index;
+        not_null<lc_segment const *> segment;
+        not_null<lc_segment::section_value const *> section;
+        /// The offset of the pointer from the start of the section.
+        std::uint64_t offset;
+    };
+
+    /// Records that the pointer at \p where holds an address within the image and must be
+    /// adjusted by dyld if the image is not loaded at its preferred address.
+    void add_rebase (location const & where) { rebases_.push_back (where); }
+
+    /// Records that dyld must store the address of the symbol \p name plus \p addend at
+    /// \p where.
+    ///
+    /// \param name  The symbol's name. Its arena must outlive the object.
+    /// \param ordinal  The ordinal of the library (its LC_LOAD_DYLIB command) which defines the
+    ///   symbol.
+    /// \param weak_import  True if the symbol may be missing at run time.
+    void add_bind (location const & where, interned_string name, unsigned ordinal,
+                   std::int64_t addend, bool weak_import);
+
     std::uint32_t size_bytes () const noexcept override;
-    std::uint64_t write_command (int fd, std::uint64_t offset) override;
+    std::uint64_t write_command (output & out, std::uint64_t offset) override;
+
+    std::uint64_t finalize () override;
+    void write_blob (output & out) override;
+
+private:
+    struct binding {
+        location where;
+        interned_string name;
+        unsigned ordinal;
+        std::int64_t addend;
+        bool weak_import;
+    };
+
+    void encode_rebases ();
+    void encode_bindings ();
+
+    std::vector<location> rebases_;
+    std::vector<binding> bindings_;
+
+    /// The encoded opcode streams, each padded to an 8-byte boundary. Built by finalize().
+    std::vector<std::uint8_t> rebase_;
+    std::vector<std::uint8_t> bind_;
 };
 
 #endif // LC_DYLD_INFO_ONLY_HPP
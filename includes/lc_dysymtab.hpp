@@ -1,12 +1,39 @@
 #ifndef LC_DYSYMTAB_HPP
 #define LC_DYSYMTAB_HPP
 
+#include <vector>
+
 #include "command.hpp"
+#include "linkedit_blob.hpp"
+#include "util.hpp"
+
+class lc_symtab;
 
-class lc_dysymtab : public command {
+/// The LC_DYSYMTAB command and the indirect symbol table that it describes. The ranges of local,
+/// externally defined and undefined symbols are taken from the associated symbol table. The
+/// indirect symbol table is written to the __LINKEDIT segment: the object must be added to that
+/// segment's blobs.
+class lc_dysymtab : public command, public linkedit_blob {
 public:
+    explicit lc_dysymtab (not_null<lc_symtab const *> symtab) noexcept
+            : symtab_{symtab} {}
+
+    /// Appends an entry to the indirect symbol table.
+    ///
+    /// \param symbol  The index of a symbol in the symbol table or one of
+    ///   mach_o::indirect_symbol_local or mach_o::indirect_symbol_abs.
+    /// \returns The index of the new entry.
+    std::uint32_t add_indirect (std::uint32_t symbol);
+
     std::uint32_t size_bytes () const noexcept override;
-    std::uint64_t write_command (int fd, std::uint64_t offset) override;
+    std::uint64_t write_command (output & out, std::uint64_t offset) override;
+
+    std::uint64_t finalize () override;
+    void write_blob (output & out) override;
+
+private:
+    not_null<lc_symtab const *> symtab_;
+    std::vector<std::uint32_t> indirect_;
 };
 
 #endif // LC_DYSYMTAB_HPP
@@ -1,18 +1,21 @@
 #ifndef LC_LOAD_DYLIB_HPP
 #define LC_LOAD_DYLIB_HPP
 
-#include <string>
 #include "command.hpp"
+#include "string_arena.hpp"
 
 class lc_load_dylib : public command {
 public:
-    explicit lc_load_dylib (std::string name)
-            : name_{std::move (name)} {}
+    /// \param name  The library's install name. Its arena must outlive the object.
+    explicit lc_load_dylib (interned_string name) noexcept
+            : name_{name} {}
     std::uint32_t size_bytes () const noexcept override;
-    std::uint64_t write_command (int fd, std::uint64_t offset) override;
+    /// \returns The size of the command if the install name were MAXPATHLEN bytes long.
+    std::uint32_t max_size_bytes () const noexcept override;
+    std::uint64_t write_command (output & out, std::uint64_t offset) override;
 
 private:
-    std::string name_;
+    interned_string name_;
 };
 
 #endif // LC_LOAD_DYLIB_HPP
@@ -7,12 +7,16 @@
 
 class lc_main : public command {
 public:
-    explicit lc_main (not_null<lc_segment::section_value const *> main) noexcept;
+    /// \param main  The section containing the entry point.
+    /// \param offset  The offset of the entry point from the start of \p main.
+    explicit lc_main (not_null<lc_segment::section_value const *> main,
+                      std::uint64_t offset = 0) noexcept;
     std::uint32_t size_bytes () const noexcept override;
-    std::uint64_t write_command (int fd, std::uint64_t offset) override;
+    std::uint64_t write_command (output & out, std::uint64_t offset) override;
 
 private:
     not_null<lc_segment::section_value const *> main_;
+    std::uint64_t offset_;
 };
 
 #endif // LC_MAIN_HPP
@@ -6,7 +6,9 @@
 #include <vector>
 
 #include "command.hpp"
+#include "linkedit_blob.hpp"
 #include "mach-o.hpp"
+#include "mach-o_reloc.hpp"
 #include "util.hpp"
 
 
@@ -31,31 +33,63 @@ public:
         contents_range const & contents () const noexcept { return contents_; }
         std::size_t contents_size () const noexcept;
 
+        /// \returns True if the section is zero-filled: it occupies memory but no space in the
+        ///   file. Its size is taken from the section_64 rather than from its (empty) contents.
+        bool is_zerofill () const noexcept;
+
+        /// Adds an entry to the section's relocation table. Relocations are only meaningful in
+        /// MH_OBJECT files; they are written in address order after the segment's section data.
+        void add_relocation (mach_o::relocation const & r) { relocs_.push_back (r); }
+        std::vector<mach_o::relocation> const & relocations () const noexcept { return relocs_; }
+        /// Sorts the relocations by address. The sort is stable so that pairs of entries which
+        /// share an address (such as X86_64_RELOC_SUBTRACTOR and its X86_64_RELOC_UNSIGNED) are
+        /// kept together and in order.
+        void sort_relocations ();
+
     private:
         mach_o::section_64 s_;
         contents_range contents_;
+        std::vector<mach_o::relocation> relocs_;
         // TODO: eliminate and use std::optional<std::uint64_t> offset_.
         bool has_offset_ = false;
         std::uint64_t offset_ = 0;
     };
 
-    explicit lc_segment (mach_o::segment_command_64 const & v) noexcept
-            : v_{v} {}
+    lc_segment (mach_o::segment_command_64 const & v, std::uint64_t page_size) noexcept
+            : v_{v}
+            , page_size_{page_size} {}
 
     /// \param segname  Segment name.
     /// \param vm  Memory address and size of this segment.
     /// \param maxprot  Maximum VM protection.
     /// \param initprot  Initial VM protection.
     /// \param flags  Flags.
+    /// \param page_size  The target's page size: the alignment of the segment's file offset and
+    ///   VM size.
     lc_segment (char const * segname, position vm, mach_o::vm_prot_t maxprot,
-                mach_o::vm_prot_t initprot, std::uint32_t flags) noexcept;
+                mach_o::vm_prot_t initprot, std::uint32_t flags, std::uint64_t page_size) noexcept;
 
+    /// Adds a section to the segment. Zero-fill sections must follow all of the segment's other
+    /// sections.
     section_value & add_section (mach_o::section_64 const & sec, contents_range const & contents);
 
+    /// Places the segment in memory at the first page boundary after the end of \p previous,
+    /// which must be laid out (appear in the image's command list) before this segment. The
+    /// address passed to the constructor is ignored.
+    void follow (not_null<lc_segment const *> previous) noexcept { previous_ = previous; }
+
+    mach_o::segment_command_64 const & get () const noexcept { return v_; }
+
+    /// Adds a block of link-edit data to the segment's payload. Blobs are placed after any
+    /// section contents and are 8-byte aligned. The blob must outlive the segment.
+    void add_blob (not_null<linkedit_blob *> blob);
+
     std::uint32_t size_bytes () const noexcept override;
-    std::uint64_t write_command (int fd, std::uint64_t payload_offset) override;
-    void write_payload (int fd) override;
+    std::uint64_t write_command (output & out, std::uint64_t payload_offset) override;
+    void write_payload (output & out) override;
 
+    /// \returns The number of sections in the segment.
+    std::size_t size () const noexcept { return sections_.size (); }
     section_value & operator[] (std::size_t pos) noexcept { return sections_[pos]; }
     section_value const & operator[] (std::size_t pos) const noexcept { return sections_[pos]; }
 
@@ -63,26 +97,45 @@ protected:
     virtual std::uint64_t file_offset (std::uint64_t offset) const noexcept;
 
 private:
-    std::size_t payload_size () const noexcept;
+    /// Assigns file offsets and addresses to the segment's sections and blobs.
+    /// \param payload_offset  The file offset of the first section.
+    /// \param vm_addr  On entry, the address of the first section. On return, the address just
+    ///   beyond the end of the last section.
+    /// \returns The file offset just beyond the end of the segment's payload.
+    std::uint64_t layout (std::uint64_t payload_offset, std::uint64_t & vm_addr);
+    /// Assigns file offsets to the sections' relocation tables.
+    /// \returns The file offset just beyond the end of the last relocation table.
+    std::uint64_t layout_relocations (std::uint64_t offset);
+    std::uint64_t aligned (std::uint64_t v) const noexcept;
 
     mach_o::segment_command_64 v_;
-    // TODO: eliminate and use std::optional<std::uint64_t> payload_pos_.
-    bool have_payload_pos_ = false;
-    std::uint64_t payload_pos_ = 0;
+    std::uint64_t page_size_;
+    lc_segment const * previous_ = nullptr;
     std::vector<section_value> sections_;
+    std::vector<not_null<linkedit_blob *>> blobs_;
 };
 
 class lc_text_segment : public lc_segment {
 public:
-    explicit lc_text_segment (mach_o::segment_command_64 const & v) noexcept
-            : lc_segment{v} {}
+    lc_text_segment (mach_o::segment_command_64 const & v, std::uint64_t page_size) noexcept
+            : lc_segment{v, page_size} {}
 
     lc_text_segment (char const * segname, position vm, mach_o::vm_prot_t maxprot,
-                     mach_o::vm_prot_t initprot, std::uint32_t flags) noexcept
-            : lc_segment (segname, vm, maxprot, initprot, flags) {}
+                     mach_o::vm_prot_t initprot, std::uint32_t flags,
+                     std::uint64_t page_size) noexcept
+            : lc_segment (segname, vm, maxprot, initprot, flags, page_size) {}
 
 protected:
     std::uint64_t file_offset (std::uint64_t offset) const noexcept override;
 };
 
+/// The single unnamed segment of an MH_OBJECT file. It contains the sections of every segment and
+/// is padded only to an 8-byte boundary rather than to a page boundary.
+class lc_object_segment : public lc_segment {
+public:
+    lc_object_segment () noexcept
+            : lc_segment ("", position (0x0, 0x0), mach_o::vm_prot_all, mach_o::vm_prot_all, 0x00,
+                          8) {}
+};
+
 #endif // LC_SEGMENT_HPP
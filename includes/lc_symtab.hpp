@@ -1,12 +1,67 @@
 #ifndef LC_SYMTAB_HPP
 #define LC_SYMTAB_HPP
 
+#include <vector>
+
 #include "command.hpp"
+#include "lc_segment.hpp"
+#include "linkedit_blob.hpp"
+#include "string_arena.hpp"
 
-class lc_symtab : public command {
+/// The LC_SYMTAB command together with the symbol and string tables that it describes. The two
+/// tables are written as a single blob: the nlist_64 array followed by the strings. Names are
+/// interned so symbols which share a name (local symbols from different files, for example) share
+/// a single copy in the string table. The object must be added to the __LINKEDIT segment's blobs.
+class lc_symtab : public command, public linkedit_blob {
 public:
+    /// The ranges of the symbol table which hold local, externally defined and undefined symbols.
+    struct partition {
+        std::uint32_t ilocal;
+        std::uint32_t nlocal;
+        std::uint32_t iextdef;
+        std::uint32_t nextdef;
+        std::uint32_t iundef;
+        std::uint32_t nundef;
+    };
+
+    /// Appends a symbol to the table. Local symbols must be added first, then external
+    /// definitions, then undefined symbols: the grouping which LC_DYSYMTAB describes.
+    ///
+    /// \param name  The symbol's name. Its arena must outlive the object.
+    /// \param type  The symbol's n_type.
+    /// \param sect  The ordinal of the section which defines the symbol or mach_o::no_sect.
+    /// \param desc  The symbol's n_desc.
+    /// \param section  The section which defines the symbol or nullptr.
+    /// \param value  If \p section is not null, the offset of the symbol from the start of the
+    ///   section. Otherwise, the symbol's value.
+    /// \returns The index of the new symbol.
+    std::uint32_t add (interned_string name, std::uint8_t type, std::uint8_t sect,
+                       std::uint16_t desc, lc_segment::section_value const * section,
+                       std::uint64_t value);
+
+    std::uint32_t size () const noexcept;
+    partition ranges () const noexcept;
+
     std::uint32_t size_bytes () const noexcept override;
-    std::uint64_t write_command (int fd, std::uint64_t offset) override;
+    std::uint64_t write_command (output & out, std::uint64_t offset) override;
+
+    std::uint64_t finalize () override;
+    void write_blob (output & out) override;
+
+private:
+    struct entry {
+        interned_string name;
+        std::uint8_t type;
+        std::uint8_t sect;
+        std::uint16_t desc;
+        lc_segment::section_value const * section;
+        std::uint64_t value;
+    };
+    std::vector<entry> entries_;
+
+    /// The string table and the index of each entry's name within it. Built by finalize().
+    std::vector<char> strings_;
+    std::vector<std::uint32_t> strx_;
 };
 
 #endif // LC_SYMTAB_HPP
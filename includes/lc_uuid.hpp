@@ -3,10 +3,17 @@
 
 #include "command.hpp"
 
+/// An LC_UUID command whose UUID is derived from the contents of the image, so that linking
+/// the same inputs always produces the same UUID.
 class lc_uuid : public command {
 public:
     std::uint32_t size_bytes () const noexcept override;
-    std::uint64_t write_command (int fd, std::uint64_t offset) override;
+    std::uint64_t write_command (output & out, std::uint64_t offset) override;
+    void write_digest (output & out, uuid const & digest) override;
+
+private:
+    /// The position of the uuid field in the image.
+    std::uint64_t position_ = 0;
 };
 
 #endif // LC_UUID_HPP
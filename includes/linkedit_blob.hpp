@@ -0,0 +1,36 @@
+#ifndef LINKEDIT_BLOB_HPP
+#define LINKEDIT_BLOB_HPP
+
+#include <cstdint>
+
+class output;
+
+/// A linkedit_blob is a block of data which lives in the __LINKEDIT segment and which is
+/// described by a load command: the data-in-code table, for example. The segment that owns the
+/// blob decides where it goes; the command that owns it records the resulting position.
+class linkedit_blob {
+public:
+    virtual ~linkedit_blob () noexcept = default;
+
+    /// Called once the blob's contents are complete and before the __LINKEDIT segment is laid
+    /// out. An image may be laid out more than once so this function must be idempotent.
+    ///
+    /// \returns The number of bytes that the blob will occupy in the file.
+    virtual std::uint64_t finalize () = 0;
+
+    /// Writes the blob's data. The output position has already been set to blob_offset().
+    virtual void write_blob (output & out) = 0;
+
+    void place (std::uint64_t offset, std::uint64_t size) noexcept {
+        offset_ = offset;
+        size_ = size;
+    }
+    std::uint64_t blob_offset () const noexcept { return offset_; }
+    std::uint64_t blob_size () const noexcept { return size_; }
+
+private:
+    std::uint64_t offset_ = 0;
+    std::uint64_t size_ = 0;
+};
+
+#endif // LINKEDIT_BLOB_HPP
@@ -0,0 +1,76 @@
+#ifndef LINKER_HPP
+#define LINKER_HPP
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "image.hpp"
+
+class input_cache;
+class string_arena;
+class thread_pool;
+
+/// Thrown when the inputs cannot be linked: for example, if a symbol is defined more than once
+/// or the entry point is not defined.
+class link_error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+struct link_options {
+    /// Object files (.o) and static archives (.a). Every object file is linked; the archives
+    /// are searched, in order, for the definitions of symbols which remain undefined.
+    std::vector<std::string> inputs;
+    /// The name of the symbol at which execution starts.
+    std::string entry = "_main";
+    /// If true, code and data which cannot be reached from the entry point (or from a symbol or
+    /// section marked as not to be dead stripped) are removed. Sections are split into atoms
+    /// at their symbols when an input was assembled with subsections-via-symbols.
+    bool dead_strip = false;
+    /// If true, every external definition is a root when dead stripping: none are removed.
+    bool export_dynamic = false;
+    /// If true, functions (atoms of __TEXT,__text) whose bytes and relocations are identical
+    /// are folded to a single copy. The symbols of the removed copies are given the address of
+    /// the one which is kept, so distinct functions may compare equal.
+    bool fold_identical_code = false;
+    /// The path of a file which lists symbols, one per line, in the order in which they are to
+    /// be placed. The atoms (see dead_strip) which define the listed symbols are placed at the
+    /// start of their output sections so that hot code is packed onto the fewest pages; the
+    /// others follow in input order. A line may start with "x86_64:" or "arm64:" to apply to
+    /// one architecture only, and '#' starts a comment. Empty if there is no order file.
+    std::string order_file;
+    /// The path of a sampled call-graph profile: lines of "caller callee weight" where the
+    /// weight is the number of calls observed. The functions are clustered so that callers and
+    /// their hottest callees are adjacent and the hottest clusters come first. Functions named
+    /// by order_file are placed ahead of the rest. Empty if there is no profile.
+    std::string call_graph_profile;
+    /// The minimum number of bytes of unused space to leave after the load commands so that
+    /// commands can be added or grown in place after the link.
+    std::uint32_t header_pad = 0;
+    /// If true, the header pad is also large enough for every dylib's install name to be
+    /// changed to a path of MAXPATHLEN bytes.
+    bool header_pad_max_install_names = false;
+    /// If not null, the inputs are taken from, and parsed into, this cache rather than being
+    /// parsed for this link alone. It is used only while the inputs are loaded.
+    input_cache * cache = nullptr;
+};
+
+/// Links the inputs named by \p options into an executable image for \p Target. Symbols which
+/// no input defines are imported from libSystem: calls go through stubs and other references
+/// through the GOT, both bound by dyld when the program is loaded.
+///
+/// The work is shared between the workers of \p pool. The section contents are relocated,
+/// using the pool, each time that the image is laid out so the pool must outlive the image.
+///
+/// If \p names is not null, symbol and section names are stored in that arena rather than in one
+/// of the link's own. A program which performs many links can share one arena between them so
+/// that each distinct name is stored once; the image keeps the arena alive.
+///
+/// Throws link_error, load_error, format_error or std::system_error.
+template <typename Target>
+image link (link_options const & options, thread_pool & pool,
+            std::shared_ptr<string_arena> names = nullptr);
+
+#endif // LINKER_HPP
@@ -0,0 +1,79 @@
+#ifndef LOAD_COMMAND_EDITOR_HPP
+#define LOAD_COMMAND_EDITOR_HPP
+
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "image_view.hpp"
+#include "uuid.hpp"
+
+/// Thrown when a requested edit cannot be made: for example, if the named dylib is not loaded
+/// or the edited load commands would not fit in the space before the image's first section.
+class edit_error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/// Edits the load commands of a linked image. The editor holds a copy of the header and the
+/// commands; the image's segments are never moved so the commands must still fit in the space
+/// (the header pad) which precedes the first byte of section or segment data.
+///
+/// Editing an image invalidates any code signature that it carries.
+class load_command_editor {
+public:
+    /// Copies the header and load commands of \p image. Throws format_error if they are
+    /// malformed.
+    explicit load_command_editor (image_view const & image);
+
+    /// Changes the path of every dylib load command which names \p from to \p to. Throws
+    /// edit_error if no command names \p from.
+    void change_dylib (std::string const & from, std::string const & to);
+    /// Sets the current and compatibility versions recorded by the dylib load commands which
+    /// name \p path. Versions are encoded as by version(). Throws edit_error if no command
+    /// names \p path.
+    void set_dylib_versions (std::string const & path, std::uint32_t current_version,
+                             std::uint32_t compatibility_version);
+    /// Appends an LC_RPATH command for \p path. Throws edit_error if the image already has one.
+    void add_rpath (std::string const & path);
+    /// Replaces the image's UUID, adding an LC_UUID command if there is none.
+    void set_uuid (uuid const & u);
+    /// Replaces the platform and versions of the LC_BUILD_VERSION command, adding one if there is
+    /// none. The command's tool entries are kept.
+    void set_build_version (std::uint32_t platform, std::uint32_t minos, std::uint32_t sdk);
+
+    /// \returns The number of bytes available for the header and load commands.
+    std::uint64_t capacity () const noexcept { return capacity_; }
+    /// \returns The header and load commands as they are to be written back to the image. The
+    ///   result is padded with zeros to cover the original commands if they were longer. Throws
+    ///   edit_error if the commands no longer fit.
+    std::vector<std::uint8_t> serialize () const;
+
+private:
+    /// Calls \p f for each dylib load command which names \p path.
+    /// \returns The number of commands visited.
+    unsigned for_each_dylib (std::string const & path,
+                             std::function<void (std::vector<std::uint8_t> &)> const & f);
+    /// \returns The first command whose cmd field is \p cmd or nullptr if there is none.
+    std::vector<std::uint8_t> * find (std::uint32_t cmd);
+
+    mach_o::mach_header_64 header_;
+    std::vector<std::vector<std::uint8_t>> commands_;
+    /// The size of the header and commands when the image was read.
+    std::uint64_t original_size_;
+    std::uint64_t capacity_;
+};
+
+/// Maps the file at \p path and calls \p f with an editor for each of its images: one for a
+/// single-architecture file or one per slice of a universal binary. The results are written
+/// back in place: only the bytes of the headers and load commands are rewritten, so the cost
+/// does not depend on the size of the file. No byte is written unless every image can be edited.
+/// An image which carries an LC_CODE_SIGNATURE command is refused with edit_error because the
+/// edit would invalidate its signature.
+///
+/// Throws edit_error, format_error or std::system_error.
+void edit_file (char const * path, std::function<void (load_command_editor &)> const & f);
+
+#endif // LOAD_COMMAND_EDITOR_HPP
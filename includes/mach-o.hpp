@@ -7,7 +7,9 @@
 #include <type_traits>
 
 #if __APPLE__
+#    include <mach-o/fat.h>
 #    include <mach-o/loader.h>
+#    include <mach-o/nlist.h>
 #    define CHECK 1
 #endif
 
@@ -81,6 +83,11 @@ namespace mach_o {
         x86_64_all = 3,
         x86_arch1 = 4,
         x86_64_h = 8, // Haswell feature subset
+
+        // ARM64 subtypes.
+        arm64_all = 0,
+        arm64_v8 = 1,
+        arm64e = 2,
     };
 
 #ifdef CHECK
@@ -88,6 +95,9 @@ namespace mach_o {
     STATIC_ASSERT (static_cast<std::uint32_t> (cpu_subtype::x86_64_all) == CPU_SUBTYPE_X86_64_ALL);
     STATIC_ASSERT (static_cast<std::uint32_t> (cpu_subtype::x86_arch1) == CPU_SUBTYPE_X86_ARCH1);
     STATIC_ASSERT (static_cast<std::uint32_t> (cpu_subtype::x86_64_h) == CPU_SUBTYPE_X86_64_H);
+    STATIC_ASSERT (static_cast<std::uint32_t> (cpu_subtype::arm64_all) == CPU_SUBTYPE_ARM64_ALL);
+    STATIC_ASSERT (static_cast<std::uint32_t> (cpu_subtype::arm64_v8) == CPU_SUBTYPE_ARM64_V8);
+    STATIC_ASSERT (static_cast<std::uint32_t> (cpu_subtype::arm64e) == CPU_SUBTYPE_ARM64E);
 #endif // CHECK
 
     /*
@@ -288,6 +298,75 @@ namespace mach_o {
     STATIC_ASSERT (mh_cigam_64 == MH_CIGAM_64);
 #endif
 
+    // A universal (fat) file starts with a fat_header followed by one fat_arch for each of the
+    // architectures that it contains. Unlike the rest of the file, all of the fields of these
+    // structures are big-endian.
+    constexpr std::uint32_t fat_magic = 0xcafebabe; // the fat magic number
+    constexpr std::uint32_t fat_cigam = 0xbebafeca; // NXSwapLong(FAT_MAGIC)
+
+#ifdef CHECK
+    STATIC_ASSERT (fat_magic == FAT_MAGIC);
+    STATIC_ASSERT (fat_cigam == FAT_CIGAM);
+#endif
+
+    struct fat_header {
+        std::uint32_t magic;     ///< FAT_MAGIC
+        std::uint32_t nfat_arch; ///< Number of structs that follow
+    };
+
+#ifdef CHECK
+    STATIC_ASSERT (sizeof (fat_header) == sizeof (::fat_header));
+    STATIC_ASSERT (offsetof (fat_header, magic) == offsetof (::fat_header, magic));
+    STATIC_ASSERT (offsetof (fat_header, nfat_arch) == offsetof (::fat_header, nfat_arch));
+#else
+    STATIC_ASSERT (sizeof (fat_header) == 8);
+    STATIC_ASSERT (offsetof (fat_header, magic) == 0);
+    STATIC_ASSERT (offsetof (fat_header, nfat_arch) == 4);
+#endif // CHECK
+
+    struct fat_arch {
+        std::uint32_t cputype;    ///< CPU specifier (int)
+        std::uint32_t cpusubtype; ///< Machine specifier (int)
+        std::uint32_t offset;     ///< File offset to this object file
+        std::uint32_t size;       ///< Size of this object file
+        std::uint32_t align;      ///< Alignment as a power of 2
+    };
+
+#ifdef CHECK
+    STATIC_ASSERT (sizeof (fat_arch) == sizeof (::fat_arch));
+    STATIC_ASSERT (offsetof (fat_arch, cputype) == offsetof (::fat_arch, cputype));
+    STATIC_ASSERT (offsetof (fat_arch, cpusubtype) == offsetof (::fat_arch, cpusubtype));
+    STATIC_ASSERT (offsetof (fat_arch, offset) == offsetof (::fat_arch, offset));
+    STATIC_ASSERT (offsetof (fat_arch, size) == offsetof (::fat_arch, size));
+    STATIC_ASSERT (offsetof (fat_arch, align) == offsetof (::fat_arch, align));
+#else
+    STATIC_ASSERT (sizeof (fat_arch) == 20);
+    STATIC_ASSERT (offsetof (fat_arch, cputype) == 0);
+    STATIC_ASSERT (offsetof (fat_arch, cpusubtype) == 4);
+    STATIC_ASSERT (offsetof (fat_arch, offset) == 8);
+    STATIC_ASSERT (offsetof (fat_arch, size) == 12);
+    STATIC_ASSERT (offsetof (fat_arch, align) == 16);
+#endif // CHECK
+
+
+    // The load commands directly follow the mach_header_64. Every load command starts with
+    // these two fields: the command type and the size of the command in bytes including any
+    // trailing data.
+    struct load_command {
+        std::uint32_t cmd;     ///< Type of load command
+        std::uint32_t cmdsize; ///< Total size of command in bytes
+    };
+
+#ifdef CHECK
+    STATIC_ASSERT (sizeof (load_command) == sizeof (::load_command));
+    STATIC_ASSERT (offsetof (load_command, cmd) == offsetof (::load_command, cmd));
+    STATIC_ASSERT (offsetof (load_command, cmdsize) == offsetof (::load_command, cmdsize));
+#else
+    STATIC_ASSERT (sizeof (load_command) == 8);
+    STATIC_ASSERT (offsetof (load_command, cmd) == 0);
+    STATIC_ASSERT (offsetof (load_command, cmdsize) == 4);
+#endif // CHECK
+
 
     // A variable length string in a load command is represented by an lc_str union. The strings
     // are stored just after the load command structure and the offset is from the start of the load
@@ -447,6 +526,105 @@ namespace mach_o {
     STATIC_ASSERT (offsetof (dyld_info_command, export_size) == 44);
 #endif
 
+    // The rebase information is a stream of byte-sized opcodes whose symbolic names start with
+    // REBASE_OPCODE_. The low four bits of an opcode hold an immediate operand.
+    enum : std::uint8_t {
+        rebase_type_pointer = 1,
+        rebase_type_text_absolute32 = 2,
+        rebase_type_text_pcrel32 = 3,
+
+        rebase_opcode_mask = 0xf0,
+        rebase_immediate_mask = 0x0f,
+        rebase_opcode_done = 0x00,
+        rebase_opcode_set_type_imm = 0x10,
+        rebase_opcode_set_segment_and_offset_uleb = 0x20,
+        rebase_opcode_add_addr_uleb = 0x30,
+        rebase_opcode_add_addr_imm_scaled = 0x40,
+        rebase_opcode_do_rebase_imm_times = 0x50,
+        rebase_opcode_do_rebase_uleb_times = 0x60,
+        rebase_opcode_do_rebase_add_addr_uleb = 0x70,
+        rebase_opcode_do_rebase_uleb_times_skipping_uleb = 0x80,
+    };
+
+    // The binding information is a stream of byte-sized opcodes whose symbolic names start with
+    // BIND_OPCODE_.
+    enum : std::uint8_t {
+        bind_type_pointer = 1,
+        bind_type_text_absolute32 = 2,
+        bind_type_text_pcrel32 = 3,
+
+        bind_special_dylib_self = 0,
+        bind_special_dylib_main_executable = 0xff,    // -1
+        bind_special_dylib_flat_lookup = 0xfe,        // -2
+        bind_special_dylib_weak_lookup = 0xfd,        // -3
+
+        bind_symbol_flags_weak_import = 0x1,
+        bind_symbol_flags_non_weak_definition = 0x8,
+
+        bind_opcode_mask = 0xf0,
+        bind_immediate_mask = 0x0f,
+        bind_opcode_done = 0x00,
+        bind_opcode_set_dylib_ordinal_imm = 0x10,
+        bind_opcode_set_dylib_ordinal_uleb = 0x20,
+        bind_opcode_set_dylib_special_imm = 0x30,
+        bind_opcode_set_symbol_trailing_flags_imm = 0x40,
+        bind_opcode_set_type_imm = 0x50,
+        bind_opcode_set_addend_sleb = 0x60,
+        bind_opcode_set_segment_and_offset_uleb = 0x70,
+        bind_opcode_add_addr_uleb = 0x80,
+        bind_opcode_do_bind = 0x90,
+        bind_opcode_do_bind_add_addr_uleb = 0xa0,
+        bind_opcode_do_bind_add_addr_imm_scaled = 0xb0,
+        bind_opcode_do_bind_uleb_times_skipping_uleb = 0xc0,
+    };
+
+#ifdef CHECK
+    STATIC_ASSERT (rebase_type_pointer == REBASE_TYPE_POINTER);
+    STATIC_ASSERT (rebase_type_text_absolute32 == REBASE_TYPE_TEXT_ABSOLUTE32);
+    STATIC_ASSERT (rebase_type_text_pcrel32 == REBASE_TYPE_TEXT_PCREL32);
+    STATIC_ASSERT (rebase_opcode_mask == REBASE_OPCODE_MASK);
+    STATIC_ASSERT (rebase_immediate_mask == REBASE_IMMEDIATE_MASK);
+    STATIC_ASSERT (rebase_opcode_done == REBASE_OPCODE_DONE);
+    STATIC_ASSERT (rebase_opcode_set_type_imm == REBASE_OPCODE_SET_TYPE_IMM);
+    STATIC_ASSERT (rebase_opcode_set_segment_and_offset_uleb ==
+                   REBASE_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB);
+    STATIC_ASSERT (rebase_opcode_add_addr_uleb == REBASE_OPCODE_ADD_ADDR_ULEB);
+    STATIC_ASSERT (rebase_opcode_add_addr_imm_scaled == REBASE_OPCODE_ADD_ADDR_IMM_SCALED);
+    STATIC_ASSERT (rebase_opcode_do_rebase_imm_times == REBASE_OPCODE_DO_REBASE_IMM_TIMES);
+    STATIC_ASSERT (rebase_opcode_do_rebase_uleb_times == REBASE_OPCODE_DO_REBASE_ULEB_TIMES);
+    STATIC_ASSERT (rebase_opcode_do_rebase_add_addr_uleb ==
+                   REBASE_OPCODE_DO_REBASE_ADD_ADDR_ULEB);
+    STATIC_ASSERT (rebase_opcode_do_rebase_uleb_times_skipping_uleb ==
+                   REBASE_OPCODE_DO_REBASE_ULEB_TIMES_SKIPPING_ULEB);
+
+    STATIC_ASSERT (bind_type_pointer == BIND_TYPE_POINTER);
+    STATIC_ASSERT (bind_type_text_absolute32 == BIND_TYPE_TEXT_ABSOLUTE32);
+    STATIC_ASSERT (bind_type_text_pcrel32 == BIND_TYPE_TEXT_PCREL32);
+    STATIC_ASSERT (bind_special_dylib_self == BIND_SPECIAL_DYLIB_SELF);
+    STATIC_ASSERT (bind_symbol_flags_weak_import == BIND_SYMBOL_FLAGS_WEAK_IMPORT);
+    STATIC_ASSERT (bind_symbol_flags_non_weak_definition ==
+                   BIND_SYMBOL_FLAGS_NON_WEAK_DEFINITION);
+    STATIC_ASSERT (bind_opcode_mask == BIND_OPCODE_MASK);
+    STATIC_ASSERT (bind_immediate_mask == BIND_IMMEDIATE_MASK);
+    STATIC_ASSERT (bind_opcode_done == BIND_OPCODE_DONE);
+    STATIC_ASSERT (bind_opcode_set_dylib_ordinal_imm == BIND_OPCODE_SET_DYLIB_ORDINAL_IMM);
+    STATIC_ASSERT (bind_opcode_set_dylib_ordinal_uleb == BIND_OPCODE_SET_DYLIB_ORDINAL_ULEB);
+    STATIC_ASSERT (bind_opcode_set_dylib_special_imm == BIND_OPCODE_SET_DYLIB_SPECIAL_IMM);
+    STATIC_ASSERT (bind_opcode_set_symbol_trailing_flags_imm ==
+                   BIND_OPCODE_SET_SYMBOL_TRAILING_FLAGS_IMM);
+    STATIC_ASSERT (bind_opcode_set_type_imm == BIND_OPCODE_SET_TYPE_IMM);
+    STATIC_ASSERT (bind_opcode_set_addend_sleb == BIND_OPCODE_SET_ADDEND_SLEB);
+    STATIC_ASSERT (bind_opcode_set_segment_and_offset_uleb ==
+                   BIND_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB);
+    STATIC_ASSERT (bind_opcode_add_addr_uleb == BIND_OPCODE_ADD_ADDR_ULEB);
+    STATIC_ASSERT (bind_opcode_do_bind == BIND_OPCODE_DO_BIND);
+    STATIC_ASSERT (bind_opcode_do_bind_add_addr_uleb == BIND_OPCODE_DO_BIND_ADD_ADDR_ULEB);
+    STATIC_ASSERT (bind_opcode_do_bind_add_addr_imm_scaled ==
+                   BIND_OPCODE_DO_BIND_ADD_ADDR_IMM_SCALED);
+    STATIC_ASSERT (bind_opcode_do_bind_uleb_times_skipping_uleb ==
+                   BIND_OPCODE_DO_BIND_ULEB_TIMES_SKIPPING_ULEB);
+#endif // CHECK
+
 
 
     // A program that uses a dynamic linker contains a dylinker_command to identify the name of the
@@ -601,6 +779,15 @@ namespace mach_o {
         uint32_t nlocrel;   // number of local relocation entries
     };
 
+    // Values which may appear in the indirect symbol table in place of a symbol index.
+    constexpr std::uint32_t indirect_symbol_local = 0x80000000U;
+    constexpr std::uint32_t indirect_symbol_abs = 0x40000000U;
+
+#ifdef CHECK
+    STATIC_ASSERT (indirect_symbol_local == INDIRECT_SYMBOL_LOCAL);
+    STATIC_ASSERT (indirect_symbol_abs == INDIRECT_SYMBOL_ABS);
+#endif // CHECK
+
     struct linkedit_data_command {
         std::uint32_t
             cmd; // LC_CODE_SIGNATURE, LC_SEGMENT_SPLIT_INFO, LC_FUNCTION_STARTS, LC_DATA_IN_CODE,
@@ -629,6 +816,44 @@ namespace mach_o {
 #endif // CHECK
 
 
+    // The LC_DATA_IN_CODE load command uses a linkedit_data_command to point to an array of
+    // data_in_code_entry entries. Each entry describes a range of data in a code section.
+    struct data_in_code_entry {
+        std::uint32_t offset; // from mach_header to start of data range
+        std::uint16_t length; // number of bytes in data range
+        std::uint16_t kind;   // a DICE_KIND_* value
+    };
+
+#ifdef CHECK
+    STATIC_ASSERT (sizeof (data_in_code_entry) == sizeof (::data_in_code_entry));
+    STATIC_ASSERT (offsetof (data_in_code_entry, offset) == offsetof (::data_in_code_entry, offset));
+    STATIC_ASSERT (offsetof (data_in_code_entry, length) == offsetof (::data_in_code_entry, length));
+    STATIC_ASSERT (offsetof (data_in_code_entry, kind) == offsetof (::data_in_code_entry, kind));
+#else
+    STATIC_ASSERT (sizeof (data_in_code_entry) == 8);
+    STATIC_ASSERT (offsetof (data_in_code_entry, offset) == 0);
+    STATIC_ASSERT (offsetof (data_in_code_entry, length) == 4);
+    STATIC_ASSERT (offsetof (data_in_code_entry, kind) == 6);
+#endif // CHECK
+
+    // Constants for the kind field of a data_in_code_entry.
+    enum : std::uint16_t {
+        dice_kind_data = 0x0001,
+        dice_kind_jump_table8 = 0x0002,
+        dice_kind_jump_table16 = 0x0003,
+        dice_kind_jump_table32 = 0x0004,
+        dice_kind_abs_jump_table32 = 0x0005,
+    };
+
+#ifdef CHECK
+    STATIC_ASSERT (dice_kind_data == DICE_KIND_DATA);
+    STATIC_ASSERT (dice_kind_jump_table8 == DICE_KIND_JUMP_TABLE8);
+    STATIC_ASSERT (dice_kind_jump_table16 == DICE_KIND_JUMP_TABLE16);
+    STATIC_ASSERT (dice_kind_jump_table32 == DICE_KIND_JUMP_TABLE32);
+    STATIC_ASSERT (dice_kind_abs_jump_table32 == DICE_KIND_ABS_JUMP_TABLE32);
+#endif // CHECK
+
+
     // The build_version_command contains the min OS version on which this binary was built to run
     // for its platform. The list of known platforms and tool values following it.
     struct build_version_command {
@@ -737,6 +962,28 @@ namespace mach_o {
 
 
 
+    // The rpath_command contains a path which at runtime should be added to the current run path
+    // used to find @rpath prefixed dylibs.
+    struct rpath_command {
+        std::uint32_t cmd;     // LC_RPATH
+        std::uint32_t cmdsize; // includes string
+        union lc_str path;     // path to add to run path
+    };
+
+#ifdef CHECK
+    STATIC_ASSERT (sizeof (rpath_command) == sizeof (::rpath_command));
+    STATIC_ASSERT (offsetof (rpath_command, cmd) == offsetof (::rpath_command, cmd));
+    STATIC_ASSERT (offsetof (rpath_command, cmdsize) == offsetof (::rpath_command, cmdsize));
+    STATIC_ASSERT (offsetof (rpath_command, path) == offsetof (::rpath_command, path));
+#else
+    STATIC_ASSERT (sizeof (rpath_command) == 12);
+    STATIC_ASSERT (offsetof (rpath_command, cmd) == 0);
+    STATIC_ASSERT (offsetof (rpath_command, cmdsize) == 4);
+    STATIC_ASSERT (offsetof (rpath_command, path) == 8);
+#endif // CHECK
+
+
+
     // The entry_point_command is a replacement for thread_command. It is used for main executables
     // to specify the location (file offset) of main().  If -stack_size was used at link time, the
     // stacksize field will contain the stack size need for the main thread.
@@ -934,6 +1181,91 @@ namespace mach_o {
     STATIC_ASSERT (offsetof (symtab_command, strsize) == 20);
 #endif // CHECK
 
+    // An entry in the symbol table described by the symtab_command. n_strx is an index into the
+    // string table; zero means that the symbol has no name.
+    struct nlist_64 {
+        std::uint32_t n_strx;  // index into the string table
+        std::uint8_t n_type;   // type flag, see below
+        std::uint8_t n_sect;   // section number or NO_SECT
+        std::uint16_t n_desc;  // see <mach-o/stab.h>
+        std::uint64_t n_value; // value of this symbol (or stab offset)
+    };
+
+#ifdef CHECK
+    STATIC_ASSERT (sizeof (nlist_64) == sizeof (::nlist_64));
+    STATIC_ASSERT (offsetof (nlist_64, n_strx) == offsetof (::nlist_64, n_un.n_strx));
+    STATIC_ASSERT (offsetof (nlist_64, n_type) == offsetof (::nlist_64, n_type));
+    STATIC_ASSERT (offsetof (nlist_64, n_sect) == offsetof (::nlist_64, n_sect));
+    STATIC_ASSERT (offsetof (nlist_64, n_desc) == offsetof (::nlist_64, n_desc));
+    STATIC_ASSERT (offsetof (nlist_64, n_value) == offsetof (::nlist_64, n_value));
+#else
+    STATIC_ASSERT (sizeof (nlist_64) == 16);
+    STATIC_ASSERT (offsetof (nlist_64, n_strx) == 0);
+    STATIC_ASSERT (offsetof (nlist_64, n_type) == 4);
+    STATIC_ASSERT (offsetof (nlist_64, n_sect) == 5);
+    STATIC_ASSERT (offsetof (nlist_64, n_desc) == 6);
+    STATIC_ASSERT (offsetof (nlist_64, n_value) == 8);
+#endif // CHECK
+
+    // Masks for the n_type field of an nlist_64.
+    enum : std::uint8_t {
+        n_stab = 0xe0, // if any of these bits set, a symbolic debugging entry
+        n_pext = 0x10, // private external symbol bit
+        n_type = 0x0e, // mask for the type bits
+        n_ext = 0x01,  // external symbol bit, set for external symbols
+    };
+    // Values for the N_TYPE bits of the n_type field.
+    enum : std::uint8_t {
+        n_undf = 0x0, // undefined, n_sect == NO_SECT
+        n_abs = 0x2,  // absolute, n_sect == NO_SECT
+        n_sect = 0xe, // defined in section number n_sect
+        n_pbud = 0xc, // prebound undefined (defined in a dylib)
+        n_indr = 0xa, // indirect
+    };
+    constexpr std::uint8_t no_sect = 0;    // symbol is not in any section
+    constexpr std::uint8_t max_sect = 255; // 1 thru 255 inclusive
+
+    // Bits of the n_desc field.
+    enum : std::uint16_t {
+        n_no_dead_strip = 0x0020, // symbol is not to be dead stripped
+        n_weak_ref = 0x0040,      // symbol is weak referenced
+        n_weak_def = 0x0080,      // coalesced symbol is a weak definition
+        n_alt_entry = 0x0200,     // symbol is an alternate entry point in its section
+    };
+
+#ifdef CHECK
+    STATIC_ASSERT (n_stab == N_STAB);
+    STATIC_ASSERT (n_pext == N_PEXT);
+    STATIC_ASSERT (n_type == N_TYPE);
+    STATIC_ASSERT (n_ext == N_EXT);
+    STATIC_ASSERT (n_undf == N_UNDF);
+    STATIC_ASSERT (n_abs == N_ABS);
+    STATIC_ASSERT (n_sect == N_SECT);
+    STATIC_ASSERT (n_pbud == N_PBUD);
+    STATIC_ASSERT (n_indr == N_INDR);
+    STATIC_ASSERT (no_sect == NO_SECT);
+    STATIC_ASSERT (max_sect == MAX_SECT);
+    STATIC_ASSERT (n_no_dead_strip == N_NO_DEAD_STRIP);
+    STATIC_ASSERT (n_weak_ref == N_WEAK_REF);
+    STATIC_ASSERT (n_weak_def == N_WEAK_DEF);
+    STATIC_ASSERT (n_alt_entry == N_ALT_ENTRY);
+#endif // CHECK
+
+    // For an undefined symbol in an image which uses two-level namespace hints, the high 8 bits of
+    // n_desc hold the ordinal of the library (its LC_LOAD_DYLIB command) expected to define it.
+    // For a common symbol (undefined, external, with a non-zero n_value) they hold the log2 of its
+    // alignment.
+    constexpr std::uint8_t get_library_ordinal (std::uint16_t n_desc) noexcept {
+        return static_cast<std::uint8_t> (n_desc >> 8);
+    }
+    constexpr std::uint16_t set_library_ordinal (std::uint16_t n_desc,
+                                                 std::uint8_t ordinal) noexcept {
+        return static_cast<std::uint16_t> ((n_desc & 0x00ffU) | (unsigned{ordinal} << 8));
+    }
+    constexpr std::uint8_t get_comm_align (std::uint16_t n_desc) noexcept {
+        return static_cast<std::uint8_t> ((n_desc >> 8) & 0x0fU);
+    }
+
 
 
     // The uuid load command contains a single 128-bit unique random number that identifies an
@@ -980,7 +1312,7 @@ namespace mach_o {
         //#define LC_PREPAGE      0xa     // prepage command (internal use)
         lc_dysymtab = 0xb,   // dynamic link-edit symbol table info
         lc_load_dylib = 0xc, // load a dynamically linked shared library
-        //#define LC_ID_DYLIB    0xd    // dynamically linked shared lib ident
+        lc_id_dylib = 0xd,   // dynamically linked shared lib ident
         lc_load_dylinker = 0xe,   // load a dynamic linker
         lc_id_dylinker = 0xf,     // dynamic linker identification
         lc_prebound_dylib = 0x10, // modules prebound for a dynamically linked shared library
@@ -992,22 +1324,22 @@ namespace mach_o {
         // #define LC_SUB_LIBRARY  0x15    // sub library
         // #define LC_TWOLEVEL_HINTS 0x16    // two-level namespace lookup hints
         lc_prebind_cksum = 0x17, // prebind checksum
-        // #define LC_LOAD_WEAK_DYLIB (0x18 | LC_REQ_DYLD)
+        lc_load_weak_dylib = (0x18 | lc_req_dyld), // load a dylib which may be missing
         lc_segment_64 = 0x19,            // 64-bit segment of this file to be mapped
         lc_routines_64 = 0x1a,           // 64-bit image routines
         lc_uuid = 0x1b,                  // the uuid
         lc_rpath = (0x1c | lc_req_dyld), // runpath additions
         lc_code_signature = 0x1d,        // local of code signature
-        // #define LC_SEGMENT_SPLIT_INFO 0x1e // local of info to split segments
-        // #define LC_REEXPORT_DYLIB (0x1f | LC_REQ_DYLD) // load and re-export dylib
-        // #define LC_LAZY_LOAD_DYLIB 0x20    // delay load of dylib until first use
+        lc_segment_split_info = 0x1e, // local of info to split segments
+        lc_reexport_dylib = (0x1f | lc_req_dyld), // load and re-export dylib
+        lc_lazy_load_dylib = 0x20,                // delay load of dylib until first use
         // #define LC_ENCRYPTION_INFO 0x21    // encrypted segment information
         lc_dyld_info = 0x22,                       //  compressed dyld information
         lc_dyld_info_only = 0x22 | lc_req_dyld,    // compressed dyld information only
         lc_load_upward_dylib = 0x23 | lc_req_dyld, // load upward dylib
         lc_version_min_macosx = 0x24,              // build for MacOSX min OS version
         //#define LC_VERSION_MIN_IPHONEOS 0x25 // build for iPhoneOS min OS version
-        //#define LC_FUNCTION_STARTS 0x26 // compressed table of function start addresses
+        lc_function_starts = 0x26, // compressed table of function start addresses
         //#define LC_DYLD_ENVIRONMENT 0x27 // string for dyld to treat like environment variable
         lc_main = 0x28 | lc_req_dyld, // replacement for LC_UNIXTHREAD
         lc_data_in_code = 0x29,       // table of non-instructions in __text
@@ -1015,7 +1347,7 @@ namespace mach_o {
         lc_dylib_code_sign_drs = 0x2B, // Code signing DRs copied from linked dylibs
         //#define LC_ENCRYPTION_INFO_64 0x2C // 64-bit encrypted segment information
         lc_linker_option = 0x2D, // linker options in MH_OBJECT files
-        //#define LC_LINKER_OPTIMIZATION_HINT 0x2E // optimization hints in MH_OBJECT files
+        lc_linker_optimization_hint = 0x2E, // optimization hints in MH_OBJECT files
         //#define LC_VERSION_MIN_TVOS 0x2F // build for AppleTV min OS version
         //#define LC_VERSION_MIN_WATCHOS 0x30 // build for Watch min OS version
         lc_note = 0x31,          // arbitrary data included within a Mach-O file
@@ -1041,7 +1373,7 @@ namespace mach_o {
     //  STATIC_ASSERT (LC_PREPAGE      0xa     // prepage command (internal use)
     //  STATIC_ASSERT (LC_DYSYMTAB    0xb    // dynamic link-edit symbol table info
     STATIC_ASSERT (lc_load_dylib == LC_LOAD_DYLIB);
-    //  STATIC_ASSERT (LC_ID_DYLIB    0xd    // dynamically linked shared lib ident
+    STATIC_ASSERT (lc_id_dylib == LC_ID_DYLIB);
     //  STATIC_ASSERT (LC_LOAD_DYLINKER 0xe    // load a dynamic linker
     //  STATIC_ASSERT (LC_ID_DYLINKER    0xf    // dynamic linker identification
     STATIC_ASSERT (lc_prebound_dylib == LC_PREBOUND_DYLIB);
@@ -1051,21 +1383,22 @@ namespace mach_o {
     // STATIC_ASSERT (LC_SUB_LIBRARY 0x15    // sub library
     // STATIC_ASSERT (LC_TWOLEVEL_HINTS 0x16    // two-level namespace lookup hints
     STATIC_ASSERT (lc_prebind_cksum == LC_PREBIND_CKSUM);
+    STATIC_ASSERT (lc_load_weak_dylib == LC_LOAD_WEAK_DYLIB);
     STATIC_ASSERT (lc_segment_64 == LC_SEGMENT_64);
     STATIC_ASSERT (lc_routines_64 == LC_ROUTINES_64);
     STATIC_ASSERT (lc_uuid == LC_UUID);
     STATIC_ASSERT (lc_rpath == LC_RPATH);
     STATIC_ASSERT (lc_code_signature == LC_CODE_SIGNATURE);
-    //  STATIC_ASSERT (LC_SEGMENT_SPLIT_INFO 0x1e // local of info to split segments
-    //  STATIC_ASSERT (LC_REEXPORT_DYLIB (0x1f | LC_REQ_DYLD) // load and re-export dylib
-    //  STATIC_ASSERT (LC_LAZY_LOAD_DYLIB 0x20    // delay load of dylib until first use
+    STATIC_ASSERT (lc_segment_split_info == LC_SEGMENT_SPLIT_INFO);
+    STATIC_ASSERT (lc_reexport_dylib == LC_REEXPORT_DYLIB);
+    STATIC_ASSERT (lc_lazy_load_dylib == LC_LAZY_LOAD_DYLIB);
     //  STATIC_ASSERT (LC_ENCRYPTION_INFO 0x21    // encrypted segment information
     STATIC_ASSERT (lc_dyld_info == LC_DYLD_INFO);
     //  STATIC_ASSERT (LC_DYLD_INFO_ONLY (0x22|LC_REQ_DYLD)    // compressed dyld information only
     //  STATIC_ASSERT (LC_LOAD_UPWARD_DYLIB (0x23 | LC_REQ_DYLD) // load upward dylib
     //  STATIC_ASSERT (LC_VERSION_MIN_MACOSX 0x24   // build for MacOSX min OS version
     //  STATIC_ASSERT (LC_VERSION_MIN_IPHONEOS 0x25 // build for iPhoneOS min OS version
-    //  STATIC_ASSERT (LC_FUNCTION_STARTS 0x26 // compressed table of function start addresses
+    STATIC_ASSERT (lc_function_starts == LC_FUNCTION_STARTS);
     //  STATIC_ASSERT (LC_DYLD_ENVIRONMENT 0x27 // string for dyld to treat like environment
     //  variable
     STATIC_ASSERT (lc_main == LC_MAIN);
@@ -1074,7 +1407,7 @@ namespace mach_o {
     //  STATIC_ASSERT (LC_DYLIB_CODE_SIGN_DRS 0x2B // Code signing DRs copied from linked dylibs
     //  STATIC_ASSERT (LC_ENCRYPTION_INFO_64 0x2C // 64-bit encrypted segment information
     //  STATIC_ASSERT (LC_LINKER_OPTION 0x2D // linker options in MH_OBJECT files
-    //  STATIC_ASSERT (LC_LINKER_OPTIMIZATION_HINT 0x2E // optimization hints in MH_OBJECT files
+    STATIC_ASSERT (lc_linker_optimization_hint == LC_LINKER_OPTIMIZATION_HINT);
     //  STATIC_ASSERT (LC_VERSION_MIN_TVOS 0x2F // build for AppleTV min OS version
     //  STATIC_ASSERT (LC_VERSION_MIN_WATCHOS 0x30 // build for Watch min OS version
     STATIC_ASSERT (lc_note == LC_NOTE);
@@ -1102,20 +1435,74 @@ namespace mach_o {
         s_attr_no_dead_strip = 0x10000000,       // no dead stripping
         s_attr_live_support = 0x08000000,        // blocks are live if they reference live blocks
         s_attr_self_modifying_code = 0x04000000, // Used with i386 code stubs written on by dyld
+        s_attr_debug = 0x02000000,               // a debug section
         s_attr_some_instructions = 0x00000400,   // section contains some machine instructions
 
     };
 
+    // The flags field of a section structure is separated into two parts a section type and
+    // section attributes. The section types are mutually exclusive (it can only have one type)
+    // but the section attributes are not (it may have more than one attribute).
+    constexpr std::uint32_t section_type = 0x000000ff;       // 256 section types
+    constexpr std::uint32_t section_attributes = 0xffffff00; //  24 section attributes
+
     // Constants for the type of a section
     enum {
-        s_regular = 0x0,          // regular section
-        s_zerofill = 0x1,         // zero fill on demand section
-        s_cstring_literals = 0x2, // section with only literal C strings
-        s_4byte_literals = 0x3,   // section with only 4 byte literals
-        s_8byte_literals = 0x4,   // section with only 8 byte literals
-        s_literal_pointers = 0x5, // section with only pointers to literals
+        s_regular = 0x0,                   // regular section
+        s_zerofill = 0x1,                  // zero fill on demand section
+        s_cstring_literals = 0x2,          // section with only literal C strings
+        s_4byte_literals = 0x3,            // section with only 4 byte literals
+        s_8byte_literals = 0x4,            // section with only 8 byte literals
+        s_literal_pointers = 0x5,          // section with only pointers to literals
+        s_non_lazy_symbol_pointers = 0x6,  // section with only non-lazy symbol pointers
+        s_lazy_symbol_pointers = 0x7,      // section with only lazy symbol pointers
+        s_symbol_stubs = 0x8,              // section with only symbol stubs
+        s_mod_init_func_pointers = 0x9,    // section with only function pointers for initialization
+        s_mod_term_func_pointers = 0xa,    // section with only function pointers for termination
+        s_coalesced = 0xb,                 // section contains symbols that are to be coalesced
+        s_gb_zerofill = 0xc,               // zero fill on demand section (that can be larger than 4
+                                           // gigabytes)
+        s_interposing = 0xd,               // section with only pairs of function pointers for
+                                           // interposing
+        s_16byte_literals = 0xe,           // section with only 16 byte literals
+        s_dtrace_dof = 0xf,                // section contains DTrace Object Format
+        s_lazy_dylib_symbol_pointers = 0x10, // section with only lazy symbol pointers to lazy
+                                             // loaded dylibs
+        s_thread_local_regular = 0x11,       // template of initial values for TLVs
+        s_thread_local_zerofill = 0x12,      // template of initial values for TLVs
+        s_thread_local_variables = 0x13,     // TLV descriptors
+        s_thread_local_variable_pointers = 0x14,      // pointers to TLV descriptors
+        s_thread_local_init_function_pointers = 0x15, // functions to call to initialize TLV values
     };
 
+#ifdef CHECK
+    STATIC_ASSERT (section_type == SECTION_TYPE);
+    STATIC_ASSERT (section_attributes == SECTION_ATTRIBUTES);
+    STATIC_ASSERT (s_regular == S_REGULAR);
+    STATIC_ASSERT (s_zerofill == S_ZEROFILL);
+    STATIC_ASSERT (s_cstring_literals == S_CSTRING_LITERALS);
+    STATIC_ASSERT (s_4byte_literals == S_4BYTE_LITERALS);
+    STATIC_ASSERT (s_8byte_literals == S_8BYTE_LITERALS);
+    STATIC_ASSERT (s_literal_pointers == S_LITERAL_POINTERS);
+    STATIC_ASSERT (s_non_lazy_symbol_pointers == S_NON_LAZY_SYMBOL_POINTERS);
+    STATIC_ASSERT (s_lazy_symbol_pointers == S_LAZY_SYMBOL_POINTERS);
+    STATIC_ASSERT (s_symbol_stubs == S_SYMBOL_STUBS);
+    STATIC_ASSERT (s_mod_init_func_pointers == S_MOD_INIT_FUNC_POINTERS);
+    STATIC_ASSERT (s_mod_term_func_pointers == S_MOD_TERM_FUNC_POINTERS);
+    STATIC_ASSERT (s_coalesced == S_COALESCED);
+    STATIC_ASSERT (s_gb_zerofill == S_GB_ZEROFILL);
+    STATIC_ASSERT (s_interposing == S_INTERPOSING);
+    STATIC_ASSERT (s_16byte_literals == S_16BYTE_LITERALS);
+    STATIC_ASSERT (s_dtrace_dof == S_DTRACE_DOF);
+    STATIC_ASSERT (s_lazy_dylib_symbol_pointers == S_LAZY_DYLIB_SYMBOL_POINTERS);
+    STATIC_ASSERT (s_thread_local_regular == S_THREAD_LOCAL_REGULAR);
+    STATIC_ASSERT (s_thread_local_zerofill == S_THREAD_LOCAL_ZEROFILL);
+    STATIC_ASSERT (s_thread_local_variables == S_THREAD_LOCAL_VARIABLES);
+    STATIC_ASSERT (s_thread_local_variable_pointers == S_THREAD_LOCAL_VARIABLE_POINTERS);
+    STATIC_ASSERT (s_thread_local_init_function_pointers ==
+                   S_THREAD_LOCAL_INIT_FUNCTION_POINTERS);
+#endif // CHECK
+
 
 
     constexpr auto seg_pagezero = "__PAGEZERO"; // the pagezero segment which has no protections and
@@ -1,10 +1,15 @@
 #ifndef MACH_O_RELOC_HPP
 #define MACH_O_RELOC_HPP
 
+#include <cstddef>
 #include <cstdint>
 
+#include "mach-o.hpp"
+
 #ifdef __APPLE__
 #    include <mach-o/reloc.h>
+#    include <mach-o/arm64/reloc.h>
+#    include <mach-o/x86_64/reloc.h>
 #    define CHECK 1
 #endif
 
@@ -27,6 +32,111 @@ namespace mach_o {
 
     constexpr std::uint32_t r_abs = 0; /// Absolute relocation type for Mach-O files
 
+    // Relocation types used in 64-bit x86 Mach-O files.
+    enum : std::uint8_t {
+        x86_64_reloc_unsigned = 0,   // for absolute addresses
+        x86_64_reloc_signed = 1,     // for signed 32-bit displacement
+        x86_64_reloc_branch = 2,     // a CALL/JMP instruction with 32-bit displacement
+        x86_64_reloc_got_load = 3,   // a MOVQ load of a GOT entry
+        x86_64_reloc_got = 4,        // other GOT references
+        x86_64_reloc_subtractor = 5, // must be followed by a X86_64_RELOC_UNSIGNED
+        x86_64_reloc_signed_1 = 6,   // for signed 32-bit displacement with a -1 addend
+        x86_64_reloc_signed_2 = 7,   // for signed 32-bit displacement with a -2 addend
+        x86_64_reloc_signed_4 = 8,   // for signed 32-bit displacement with a -4 addend
+        x86_64_reloc_tlv = 9,        // for thread local variables
+    };
+
+#ifdef CHECK
+    STATIC_ASSERT (x86_64_reloc_unsigned == X86_64_RELOC_UNSIGNED);
+    STATIC_ASSERT (x86_64_reloc_signed == X86_64_RELOC_SIGNED);
+    STATIC_ASSERT (x86_64_reloc_branch == X86_64_RELOC_BRANCH);
+    STATIC_ASSERT (x86_64_reloc_got_load == X86_64_RELOC_GOT_LOAD);
+    STATIC_ASSERT (x86_64_reloc_got == X86_64_RELOC_GOT);
+    STATIC_ASSERT (x86_64_reloc_subtractor == X86_64_RELOC_SUBTRACTOR);
+    STATIC_ASSERT (x86_64_reloc_signed_1 == X86_64_RELOC_SIGNED_1);
+    STATIC_ASSERT (x86_64_reloc_signed_2 == X86_64_RELOC_SIGNED_2);
+    STATIC_ASSERT (x86_64_reloc_signed_4 == X86_64_RELOC_SIGNED_4);
+    STATIC_ASSERT (x86_64_reloc_tlv == X86_64_RELOC_TLV);
+#endif // CHECK
+
+    // Relocation types used in 64-bit ARM Mach-O files.
+    enum : std::uint8_t {
+        arm64_reloc_unsigned = 0,            // for pointers
+        arm64_reloc_subtractor = 1,          // must be followed by a ARM64_RELOC_UNSIGNED
+        arm64_reloc_branch26 = 2,            // a B/BL instruction with 26-bit displacement
+        arm64_reloc_page21 = 3,              // pc-rel distance to page of target
+        arm64_reloc_pageoff12 = 4,           // offset within page, scaled by r_length
+        arm64_reloc_got_load_page21 = 5,     // pc-rel distance to page of GOT slot
+        arm64_reloc_got_load_pageoff12 = 6,  // offset within page of GOT slot, scaled by r_length
+        arm64_reloc_pointer_to_got = 7,      // for pointers to GOT slots
+        arm64_reloc_tlvp_load_page21 = 8,    // pc-rel distance to page of TLVP slot
+        arm64_reloc_tlvp_load_pageoff12 = 9, // offset within page of TLVP slot, scaled by r_length
+        arm64_reloc_addend = 10,             // must be followed by PAGE21 or PAGEOFF12
+    };
+
+#ifdef CHECK
+    STATIC_ASSERT (arm64_reloc_unsigned == ARM64_RELOC_UNSIGNED);
+    STATIC_ASSERT (arm64_reloc_subtractor == ARM64_RELOC_SUBTRACTOR);
+    STATIC_ASSERT (arm64_reloc_branch26 == ARM64_RELOC_BRANCH26);
+    STATIC_ASSERT (arm64_reloc_page21 == ARM64_RELOC_PAGE21);
+    STATIC_ASSERT (arm64_reloc_pageoff12 == ARM64_RELOC_PAGEOFF12);
+    STATIC_ASSERT (arm64_reloc_got_load_page21 == ARM64_RELOC_GOT_LOAD_PAGE21);
+    STATIC_ASSERT (arm64_reloc_got_load_pageoff12 == ARM64_RELOC_GOT_LOAD_PAGEOFF12);
+    STATIC_ASSERT (arm64_reloc_pointer_to_got == ARM64_RELOC_POINTER_TO_GOT);
+    STATIC_ASSERT (arm64_reloc_tlvp_load_page21 == ARM64_RELOC_TLVP_LOAD_PAGE21);
+    STATIC_ASSERT (arm64_reloc_tlvp_load_pageoff12 == ARM64_RELOC_TLVP_LOAD_PAGEOFF12);
+    STATIC_ASSERT (arm64_reloc_addend == ARM64_RELOC_ADDEND);
+#endif // CHECK
+
+    // A relocation entry in a form that is convenient to build and manipulate. Unlike
+    // relocation_info, its layout does not depend on the compiler's allocation of bit-fields: use
+    // encode_relocations() to produce the on-disk representation.
+    struct relocation {
+        std::int32_t address;    ///< offset in the section to what is being relocated
+        std::uint32_t symbolnum; ///< Symbol index if is_extern or section ordinal if not
+        std::uint8_t length;     ///< 0=byte, 1=word, 2=long, 3=quad
+        std::uint8_t type;       ///< Machine specific relocation type
+        bool pcrel;              ///< Was relocated pc relative already?
+        bool is_extern;          ///< Does not include value of sym referenced
+    };
+
+    // The second word of an encoded relocation entry holds r_symbolnum in bits 0-23, r_pcrel in
+    // bit 24, r_length in bits 25-26, r_extern in bit 27 and r_type in bits 28-31.
+    constexpr std::uint32_t pack_relocation_info (relocation const & r) noexcept {
+        return (r.symbolnum & 0x00FFFFFFU) | (static_cast<std::uint32_t> (r.pcrel) << 24) |
+               ((static_cast<std::uint32_t> (r.length) & 0x3U) << 25) |
+               (static_cast<std::uint32_t> (r.is_extern) << 27) |
+               ((static_cast<std::uint32_t> (r.type) & 0xFU) << 28);
+    }
+
+    /// The inverse of pack_relocation_info().
+    ///
+    /// \param address  The first word of an encoded relocation entry (r_address).
+    /// \param info  The second word of an encoded relocation entry.
+    constexpr relocation unpack_relocation_info (std::int32_t address,
+                                                 std::uint32_t info) noexcept {
+        return {address,
+                info & 0x00FFFFFFU,
+                static_cast<std::uint8_t> ((info >> 25) & 0x3U),
+                static_cast<std::uint8_t> (info >> 28),
+                ((info >> 24) & 0x1U) != 0U,
+                ((info >> 27) & 0x1U) != 0U};
+    }
+
+    /// Encodes an array of relocations as pairs of 32-bit words. The loop is free of branches so
+    /// that the compiler is able to vectorize it.
+    ///
+    /// \param first  The first relocation to be encoded.
+    /// \param count  The number of relocations to be encoded.
+    /// \param out  The output buffer. Must have room for 2 * \p count words.
+    inline void encode_relocations (relocation const * first, std::size_t count,
+                                    std::uint32_t * out) noexcept {
+        for (std::size_t ctr = 0; ctr < count; ++ctr) {
+            out[ctr * 2] = static_cast<std::uint32_t> (first[ctr].address);
+            out[ctr * 2 + 1] = pack_relocation_info (first[ctr]);
+        }
+    }
+
 } // end namespace mach_o
 
 #endif // MACH_O_RELOC_HPP
@@ -0,0 +1,30 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/// A read-only memory mapping of an entire file. The mapping is released when the object is
+/// destroyed.
+class mapped_file {
+public:
+    /// Maps the file at \p path. Throws std::system_error on failure.
+    explicit mapped_file (char const * path);
+    mapped_file (mapped_file && rhs) noexcept;
+    mapped_file (mapped_file const &) = delete;
+    ~mapped_file () noexcept;
+
+    mapped_file & operator= (mapped_file && rhs) noexcept;
+    mapped_file & operator= (mapped_file const &) = delete;
+
+    std::uint8_t const * data () const noexcept { return data_; }
+    std::size_t size () const noexcept { return size_; }
+
+private:
+    void release () noexcept;
+
+    std::uint8_t const * data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+#endif // MAPPED_FILE_HPP
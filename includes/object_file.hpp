@@ -0,0 +1,107 @@
+#ifndef OBJECT_FILE_HPP
+#define OBJECT_FILE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "mach-o.hpp"
+#include "mapped_file.hpp"
+#include "util.hpp"
+
+class image_view;
+class thread_pool;
+
+/// A section of an input object file. The contents refer to the mapped file.
+struct input_section {
+    char sectname[16];
+    char segname[16];
+    std::uint64_t addr;
+    std::uint64_t size;
+    std::uint32_t align; ///< Alignment as a power of 2
+    std::uint32_t flags;
+    array_view<std::uint8_t> contents; ///< Empty for zero-fill sections
+    std::uint32_t first_reloc;         ///< Index of the section's first entry in the relocations
+    std::uint32_t nreloc;              ///< Number of relocation entries
+};
+
+/// The symbol table of an object file held as a structure of arrays: the fields of symbol i are
+/// found at index i of each array. Names refer to the mapped string table.
+struct symbol_table {
+    std::vector<std::uint32_t> strx;
+    std::vector<std::uint8_t> type;
+    std::vector<std::uint8_t> sect;
+    std::vector<std::uint16_t> desc;
+    std::vector<std::uint64_t> value;
+
+    char const * strings = nullptr;
+
+    std::size_t size () const noexcept { return strx.size (); }
+    char const * name (std::size_t index) const noexcept { return strings + strx[index]; }
+    void reserve (std::size_t n);
+};
+
+/// The relocations of all of an object file's sections held as a structure of arrays. The
+/// entries for each section are contiguous and in the order that they appear in the file.
+struct relocation_table {
+    std::vector<std::int32_t> address;
+    std::vector<std::uint32_t> symbolnum;
+    std::vector<std::uint8_t> length;
+    std::vector<std::uint8_t> type;
+    std::vector<std::uint8_t> flags; ///< pcrel_flag and extern_flag bits
+
+    enum : std::uint8_t {
+        pcrel_flag = 1U << 0,
+        extern_flag = 1U << 1,
+    };
+
+    std::size_t size () const noexcept { return address.size (); }
+    void reserve (std::size_t n);
+};
+
+/// An MH_OBJECT file which has been mapped and parsed.
+class object_file {
+public:
+    /// Maps and parses the object file at \p path. If the file is universal, the slice for
+    /// \p cputype is used. Throws format_error or std::system_error on failure.
+    object_file (std::string path, mach_o::cpu_type cputype);
+    /// Parses an object file occupying \p bytes within \p file: an archive member, for
+    /// example.
+    object_file (std::string name, std::shared_ptr<mapped_file const> file,
+                 array_view<std::uint8_t> bytes, mach_o::cpu_type cputype);
+
+    /// The file's path. For an archive member this is "archive(member)".
+    std::string const & path () const noexcept { return path_; }
+    std::uint32_t flags () const noexcept { return flags_; }
+    std::vector<input_section> const & sections () const noexcept { return sections_; }
+    symbol_table const & symbols () const noexcept { return symbols_; }
+    relocation_table const & relocations () const noexcept { return relocs_; }
+
+private:
+    void parse (image_view const & image);
+
+    std::string path_;
+    std::shared_ptr<mapped_file const> file_;
+    /// A copy of the file's bytes used if they are not suitably aligned in the mapping.
+    std::vector<std::uint64_t> copy_;
+    std::uint32_t flags_ = 0;
+    std::vector<input_section> sections_;
+    symbol_table symbols_;
+    relocation_table relocs_;
+};
+
+/// Thrown by load_objects() when an input file cannot be loaded.
+class load_error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/// Loads the object files named by \p paths concurrently using the workers of \p pool. If any
+/// file cannot be loaded, the first error (in the order of \p paths) is thrown as a load_error
+/// whose message names the file.
+std::vector<object_file> load_objects (std::vector<std::string> const & paths,
+                                       mach_o::cpu_type cputype, thread_pool & pool);
+
+#endif // OBJECT_FILE_HPP
@@ -0,0 +1,48 @@
+#ifndef ORDERING_HPP
+#define ORDERING_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "string_arena.hpp"
+
+/// Reads the order file at \p path (see link_options::order_file). Lines restricted to an
+/// architecture other than \p arch are skipped. Throws link_error if the file cannot be read.
+///
+/// \returns Each name listed mapped to the position of its first appearance.
+std::unordered_map<interned_string, std::uint32_t>
+read_order_file (std::string const & path, char const * arch, string_arena & names);
+
+/// The number of calls observed from one function to another.
+struct weighted_call {
+    std::uint32_t caller;
+    std::uint32_t callee;
+    std::uint64_t weight;
+};
+
+/// A call graph profile (see link_options::call_graph_profile). Each distinct name is a node.
+struct call_graph_profile {
+    /// Each name mapped to its node: nodes are numbered in order of first appearance.
+    std::unordered_map<interned_string, std::uint32_t> nodes;
+    /// The calls between nodes in the order in which they are listed.
+    std::vector<weighted_call> calls;
+};
+
+/// Reads the call graph profile at \p path. Throws link_error if the file cannot be read or a
+/// line is malformed.
+call_graph_profile read_call_graph_profile (std::string const & path, string_arena & names);
+
+/// Orders functions so that callers and their hottest callees are adjacent and the hottest
+/// clusters of functions come first. Functions are identified by number: \p calls are between
+/// functions and \p size (f) is the size in bytes of function f. A call from a function to
+/// itself is ignored.
+///
+/// \returns The functions which take part in a call, in the order in which they are to be
+///   placed.
+std::vector<std::uint32_t> cluster_functions (std::vector<weighted_call> const & calls,
+                                              std::function<std::uint64_t (std::uint32_t)> size);
+
+#endif // ORDERING_HPP
@@ -0,0 +1,86 @@
+#ifndef OUTPUT_HPP
+#define OUTPUT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// An output is the destination for the bytes of a single Mach-O image. It keeps its own file
+/// position so that no state is shared with other outputs: the slices of a universal binary are
+/// each written through their own output into the same file at the same time.
+class output {
+public:
+    virtual ~output () noexcept = default;
+
+    /// Writes \p size bytes from \p data at the current position and advances it.
+    void write (void const * data, std::size_t size) {
+        this->write_at (pos_, data, size);
+        pos_ += size;
+        end_ = std::max (end_, pos_);
+    }
+    void seek (std::uint64_t pos) noexcept { pos_ = pos; }
+    std::uint64_t tell () const noexcept { return pos_; }
+    /// \returns The offset of the end of the furthest byte written.
+    std::uint64_t end () const noexcept { return end_; }
+
+protected:
+    virtual void write_at (std::uint64_t pos, void const * data, std::size_t size) = 0;
+
+private:
+    std::uint64_t pos_ = 0;
+    std::uint64_t end_ = 0;
+};
+
+/// Writes an image to a file descriptor starting at a fixed base offset. Positions are relative
+/// to that base.
+class file_output final : public output {
+public:
+    file_output (int fd, std::uint64_t base) noexcept
+            : fd_{fd}
+            , base_{base} {}
+
+private:
+    void write_at (std::uint64_t pos, void const * data, std::size_t size) override;
+
+    int fd_;
+    std::uint64_t base_;
+    std::uint64_t next_ = 0; ///< The position at which the previous write ended
+};
+
+/// Writes an image into memory. The buffer is emptied when the output is created but its
+/// capacity is kept, so one buffer can be reused for many images without reallocation. Bytes
+/// which are skipped over are zero.
+class buffer_output final : public output {
+public:
+    explicit buffer_output (std::vector<std::uint8_t> & buffer) noexcept
+            : buffer_{buffer} {
+        buffer_.clear ();
+    }
+
+private:
+    void write_at (std::uint64_t pos, void const * data, std::size_t size) override;
+
+    std::vector<std::uint8_t> & buffer_;
+};
+
+/// Keeps the first \p limit bytes of an image and discards the rest. With a limit of
+/// image::header_size(), this captures the header and load commands (and so the layout) of an
+/// image without copying its contents.
+class prefix_output final : public output {
+public:
+    prefix_output (std::vector<std::uint8_t> & buffer, std::size_t limit)
+            : buffer_{buffer} {
+        buffer_.assign (limit, std::uint8_t{0});
+    }
+
+private:
+    void write_at (std::uint64_t pos, void const * data, std::size_t size) override;
+
+    std::vector<std::uint8_t> & buffer_;
+};
+
+/// Sets the size of the file open as \p fd to at least \p size bytes.
+void extend_file (int fd, std::uint64_t size);
+
+#endif // OUTPUT_HPP
@@ -0,0 +1,140 @@
+#ifndef RELOCATION_ENGINE_HPP
+#define RELOCATION_ENGINE_HPP
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "target.hpp"
+
+/// A fixup is a relocation whose target has been resolved to an address: it describes a value to
+/// be computed and stored into section contents.
+struct fixup {
+    std::uint64_t offset;     ///< Offset of the bytes to be patched from the start of the buffer.
+    std::uint64_t target;     ///< Address of the target (symbol, GOT slot or TLV descriptor).
+    std::uint64_t subtrahend; ///< For a SUBTRACTOR relocation, the address being subtracted.
+    std::int64_t addend;      ///< The value added to the target address.
+    std::uint8_t type;        ///< A relocation type for the target (e.g. x86_64_reloc_xxx).
+    std::uint8_t length;      ///< 2=long, 3=quad.
+};
+
+/// Thrown when a fixup cannot be added or applied: its type or length is not one that the engine
+/// handles, or its field lies beyond the end of the contents.
+class relocation_error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/// The parts of the relocation engine which are common to all targets.
+///
+/// Fixups are bucketed by the operation that they need as they are added: absolute stores,
+/// subtractions and target-specific pc-relative or instruction-field updates. Each bucket is a
+/// structure of arrays and is processed in fixed-size batches: first a branch-free loop which
+/// computes the values and an overflow flag, then a loop which stores them. The compiler is able
+/// to vectorize the first loop; the second touches only the bytes to be patched.
+class relocation_engine_base {
+public:
+    std::size_t size () const noexcept { return size_; }
+
+protected:
+    /// Target + addend stored as a 32- or 64-bit value.
+    struct absolute_bucket {
+        std::vector<std::uint64_t> offset;
+        std::vector<std::uint64_t> target;
+        std::vector<std::int64_t> addend;
+    };
+    /// Target - subtrahend + addend stored as a 32- or 64-bit value.
+    struct subtract_bucket {
+        std::vector<std::uint64_t> offset;
+        std::vector<std::uint64_t> target;
+        std::vector<std::uint64_t> subtrahend;
+        std::vector<std::int64_t> addend;
+    };
+    /// Target + addend - address of the field. Any bias (the distance from the field to the
+    /// address that the displacement is relative to) is folded into the addend.
+    using pcrel_bucket = absolute_bucket;
+
+    /// Records the extent of a fixup's field.
+    void note (fixup const & f, unsigned bytes);
+    /// Throws relocation_error unless the length of \p f is \p length.
+    static void check_length (fixup const & f, std::uint8_t length);
+    void add_absolute (fixup const & f);
+    void add_subtract (fixup const & f);
+    static void add_pcrel (pcrel_bucket * b, fixup const & f, std::int64_t bias);
+
+    /// Applies the absolute and subtract fixups. Throws relocation_error if a field lies beyond
+    /// \p size bytes.
+    void apply_common (std::uint8_t * contents, std::size_t size,
+                       std::vector<std::uint64_t> * errors) const;
+    /// Applies fixups which store a signed 32-bit pc-relative value.
+    static void apply_pcrel32 (pcrel_bucket const & b, std::uint8_t * contents,
+                               std::uint64_t base_address, std::vector<std::uint64_t> * errors);
+
+private:
+    absolute_bucket abs32_;
+    absolute_bucket abs64_;
+    subtract_bucket sub32_;
+    subtract_bucket sub64_;
+    /// The offset just beyond the last byte to be patched.
+    std::uint64_t end_ = 0;
+    std::size_t size_ = 0;
+};
+
+
+/// Applies fixups for the target described by the Target traits type to a contiguous buffer of
+/// section contents.
+template <typename Target>
+class relocation_engine;
+
+template <>
+class relocation_engine<x86_64_target> : public relocation_engine_base {
+public:
+    /// Adds a fixup. SUBTRACTOR/UNSIGNED pairs are represented by a single fixup of type
+    /// X86_64_RELOC_SUBTRACTOR whose subtrahend is the address of the SUBTRACTOR's symbol and
+    /// whose target is the address of the UNSIGNED's symbol. Throws relocation_error if the
+    /// fixup's type or length is invalid.
+    void add (fixup const & f);
+    void clear () noexcept { *this = relocation_engine{}; }
+
+    /// Patches \p contents with the values of all of the fixups that have been added.
+    ///
+    /// \param contents  The buffer to be patched.
+    /// \param size  The number of bytes in \p contents.
+    /// \param base_address  The address at which the first byte of \p contents will be loaded.
+    /// \returns The offsets of fixups whose values could not be represented in their field. An
+    ///   empty vector indicates success. Throws relocation_error if a fixup's field lies beyond
+    ///   \p size bytes: no bytes are patched in that case.
+    std::vector<std::uint64_t> apply (std::uint8_t * contents, std::size_t size,
+                                      std::uint64_t base_address) const;
+
+private:
+    pcrel_bucket pcrel32_;
+};
+
+template <>
+class relocation_engine<arm64_target> : public relocation_engine_base {
+public:
+    /// Adds a fixup. SUBTRACTOR/UNSIGNED pairs are represented as for x86_64. An ARM64_RELOC_ADDEND
+    /// is folded into the addend of the fixup that it modifies. GOT_LOAD and TLVP_LOAD fixups
+    /// target the address of the GOT or TLV slot. Throws relocation_error if the fixup's type or
+    /// length is invalid.
+    void add (fixup const & f);
+    void clear () noexcept { *this = relocation_engine{}; }
+
+    /// Patches \p contents with the values of all of the fixups that have been added.
+    /// \see relocation_engine<x86_64_target>::apply
+    std::vector<std::uint64_t> apply (std::uint8_t * contents, std::size_t size,
+                                      std::uint64_t base_address) const;
+
+private:
+    /// B/BL: a 26-bit word displacement.
+    absolute_bucket branch26_;
+    /// ADRP: a 21-bit displacement between 4K pages.
+    absolute_bucket page21_;
+    /// ADD/LDR/STR: the low 12 bits of the target, scaled by the size of the access.
+    absolute_bucket pageoff12_;
+    /// A 32-bit displacement to a GOT slot.
+    pcrel_bucket pcrel32_;
+};
+
+#endif // RELOCATION_ENGINE_HPP
@@ -0,0 +1,108 @@
+#ifndef RESOLVER_HPP
+#define RESOLVER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "string_arena.hpp"
+
+class object_file;
+class thread_pool;
+
+/// Resolves the external symbols of a set of object files. Every external name is bound either
+/// to one definition or, if no file defines it, left undefined (to be imported from a dylib).
+///
+/// Names are interned in a string_arena so each distinct name is hashed once and names are
+/// compared by pointer. They live in an open-addressed hash table with a fixed number of slots
+/// (linear probing, the size is a power of 2). The names of a batch of files are interned (which
+/// takes the arena's shard locks) before any of their symbols are inserted. Symbols are then
+/// inserted concurrently and without locks: an empty slot is claimed with a compare-and-swap and
+/// each slot's preferred symbol is updated with a compare-and-swap "minimum" over a key which
+/// orders strong definitions before weak definitions before common symbols before references
+/// and, within each of those, by file and symbol index. Because that key is a total order, the
+/// result does not depend on the order in which the symbols were inserted and therefore on the
+/// number of threads. The table is grown between calls to add(), never during one.
+class resolver {
+public:
+    enum class kind : std::uint8_t {
+        defined,
+        common,
+        undefined,
+    };
+
+    /// The outcome of resolution for one name.
+    struct resolution {
+        interned_string name;
+        kind k;
+        /// For a defined symbol, the winning definition. For a common symbol, the first of the
+        /// common definitions. For an undefined symbol, the first reference.
+        std::uint32_t file;
+        std::uint32_t index;
+        /// The number of strong (non-weak) definitions. More than one is an error.
+        std::uint32_t strong_definitions;
+        /// The size and alignment (log2) of a common symbol: the largest of those requested.
+        std::uint64_t common_size;
+        std::uint8_t common_align;
+        /// True if an undefined symbol is only weakly referenced.
+        bool weak_ref;
+    };
+
+    /// \param pool  The workers used to insert and select symbols.
+    /// \param names  The arena in which symbol names are interned. It must outlive the resolver.
+    resolver (thread_pool & pool, string_arena & names);
+    ~resolver () noexcept;
+    resolver (resolver const &) = delete;
+    resolver & operator= (resolver const &) = delete;
+
+    /// Adds \p files to the set being resolved and inserts their external symbols using the
+    /// workers of the thread pool. Files are numbered in the order that they are added. The
+    /// files must outlive the resolver. Must not be called concurrently with any other member
+    /// function.
+    void add (std::vector<object_file const *> const & files);
+
+    std::uint32_t file_count () const noexcept;
+    object_file const & file (std::uint32_t index) const noexcept { return *files_[index]; }
+
+    /// \returns The global index of the name of external symbol \p index of file \p file.
+    std::uint32_t global (std::uint32_t file, std::uint32_t index) const noexcept;
+
+    /// \returns The global index of \p name or none if no file mentions it.
+    std::uint32_t find (interned_string name) const noexcept;
+    /// \returns A value greater than every global index.
+    std::uint32_t global_limit () const noexcept;
+
+    /// \returns The resolution of the name whose global index is \p g.
+    resolution get (std::uint32_t g) const noexcept;
+
+    /// \returns The global indices of every name, sorted by name.
+    std::vector<std::uint32_t> globals () const;
+    /// \returns The global indices of the names which are not defined, sorted by name.
+    std::vector<std::uint32_t> undefined () const;
+
+    static constexpr std::uint32_t none = ~std::uint32_t{0};
+
+private:
+    struct slot;
+
+    template <typename Predicate>
+    std::vector<std::uint32_t> select (Predicate pred) const;
+    /// Inserts symbol \p index of file \p file, whose interned name is \p name, and returns the
+    /// index of its slot.
+    std::uint32_t insert (std::uint32_t file, std::uint32_t index, interned_string name);
+    /// Ensures that the table has room for \p extra more names.
+    void reserve (std::size_t extra);
+
+    thread_pool & pool_;
+    string_arena & names_;
+    std::vector<object_file const *> files_;
+    /// For each file, the global index of each of its symbols (or none for local symbols).
+    std::vector<std::vector<std::uint32_t>> globals_;
+
+    std::unique_ptr<slot[]> slots_;
+    std::size_t capacity_ = 0;
+    std::atomic<std::size_t> used_{0};
+};
+
+#endif // RESOLVER_HPP
@@ -0,0 +1,19 @@
+#ifndef SAMPLE_PROGRAM_HPP
+#define SAMPLE_PROGRAM_HPP
+
+#include "image.hpp"
+
+/// Builds the image of a minimal program whose main() returns 0. This is what machowriter writes
+/// when it is given no input files.
+///
+/// \tparam Target  One of the target traits types in target.hpp.
+/// \param object  True if the program is to be built as an MH_OBJECT file rather than as an
+///   executable.
+/// \param header_pad  The number of bytes to reserve after the load commands as
+///   image::reserve_header_pad() does.
+/// \param max_install_names  True if the header pad must allow every dylib load command to name
+///   a path of MAXPATHLEN bytes.
+template <typename Target>
+image build_sample_program (bool object, std::uint32_t header_pad, bool max_install_names);
+
+#endif // SAMPLE_PROGRAM_HPP
@@ -0,0 +1,36 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/// Performs one request. \p args are the request's arguments and \p cwd is the client's working
+/// directory: relative paths among the arguments must be resolved against \p cwd since the
+/// server's own working directory is never changed. The request's results for the client are
+/// appended to \p output and its messages to \p diagnostics. Setting \p stop ends the server
+/// once the reply has been sent.
+///
+/// \returns The request's exit status.
+using request_handler =
+    std::function<int (std::string const & cwd, std::vector<std::string> const & args,
+                       std::string & output, std::string & diagnostics, bool & stop)>;
+
+/// Listens on the Unix domain socket at \p path and passes each request to \p handler. Requests
+/// are handled one at a time, in the order they arrive, so the handler may keep state between
+/// them. A client which takes more than 30 seconds to send its request or to read its reply is
+/// dropped so that it cannot stall the others. A stale socket left by a server which has exited
+/// is replaced. Throws std::system_error if the socket cannot be created or another server is
+/// already listening on it.
+void serve (std::string const & path, request_handler const & handler);
+
+/// Sends \p args, together with the current directory, to the server listening on the Unix domain
+/// socket at \p path and waits for the reply. The request's results are appended to \p output
+/// and the server's messages to \p diagnostics. Throws std::system_error if the server cannot
+/// be reached.
+///
+/// \returns The request's exit status.
+int send_request (std::string const & path, std::vector<std::string> const & args,
+                  std::string & output, std::string & diagnostics);
+
+#endif // SERVER_HPP
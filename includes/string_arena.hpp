@@ -0,0 +1,104 @@
+#ifndef STRING_ARENA_HPP
+#define STRING_ARENA_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// A handle to a string which has been stored in a string_arena. The string's length and 64-bit
+/// hash are stored alongside its characters. Handles to strings from the same arena are equal if
+/// and only if the strings are equal, so comparing two names is a pointer compare. A
+/// default-constructed handle is null.
+class interned_string {
+public:
+    constexpr interned_string () noexcept = default;
+
+    /// \returns The string's characters. The string is NUL-terminated.
+    char const * c_str () const noexcept { return reinterpret_cast<char const *> (h_ + 1); }
+    std::size_t size () const noexcept { return h_->length; }
+    /// \returns The FNV-1a hash of the string (as given by hash_string()).
+    std::uint64_t hash () const noexcept { return h_->hash; }
+
+    explicit operator bool () const noexcept { return h_ != nullptr; }
+
+    friend bool operator== (interned_string a, interned_string b) noexcept { return a.h_ == b.h_; }
+    friend bool operator!= (interned_string a, interned_string b) noexcept { return a.h_ != b.h_; }
+
+private:
+    friend class string_arena;
+    /// Each string's characters immediately follow its header.
+    struct header {
+        std::uint64_t hash;
+        std::uint64_t length;
+    };
+    constexpr explicit interned_string (header const * h) noexcept
+            : h_{h} {}
+
+    header const * h_ = nullptr;
+};
+
+namespace std {
+    template <>
+    struct hash<interned_string> {
+        std::size_t operator() (interned_string s) const noexcept {
+            return static_cast<std::size_t> (s.hash ());
+        }
+    };
+} // end namespace std
+
+/// Stores each distinct string once. Strings are never freed individually: they live until the
+/// arena is destroyed.
+///
+/// The arena is split into shards, selected by the high bits of a string's hash, each with its
+/// own lock, open-addressed table and storage blocks, so that threads which intern different
+/// names rarely contend. intern() and find() may be called concurrently.
+class string_arena {
+public:
+    string_arena ();
+    ~string_arena () noexcept;
+    string_arena (string_arena const &) = delete;
+    string_arena & operator= (string_arena const &) = delete;
+
+    /// \returns The arena's copy of the \p length characters at \p str, adding it if this is the
+    ///   first request for that string.
+    interned_string intern (char const * str, std::size_t length);
+    interned_string intern (char const * str) { return this->intern (str, std::strlen (str)); }
+
+    /// \returns The arena's copy of \p str or a null handle if it has not been interned.
+    interned_string find (char const * str, std::size_t length) const;
+    interned_string find (char const * str) const { return this->find (str, std::strlen (str)); }
+
+    /// \returns The number of distinct strings in the arena.
+    std::size_t size () const;
+
+private:
+    using header = interned_string::header;
+
+    struct shard {
+        mutable std::mutex mut;
+        /// Open-addressed, linear probing, size is a power of 2.
+        std::vector<header const *> table;
+        std::size_t used = 0;
+        /// Storage for headers and characters. Allocated in units of 8 bytes so that every
+        /// header is suitably aligned.
+        std::vector<std::unique_ptr<std::uint64_t[]>> blocks;
+        std::uint64_t * next = nullptr;
+        std::size_t available = 0; ///< Number of units left at next
+    };
+
+    static constexpr unsigned shard_bits = 6;
+
+    static std::size_t shard_index (std::uint64_t hash) noexcept;
+    static header const * lookup (shard const & s, char const * str, std::size_t length,
+                                  std::uint64_t hash) noexcept;
+    static header * allocate (shard & s, std::size_t length);
+    static void grow (shard & s);
+
+    std::array<shard, std::size_t{1} << shard_bits> shards_;
+};
+
+#endif // STRING_ARENA_HPP
@@ -0,0 +1,34 @@
+#ifndef TARGET_HPP
+#define TARGET_HPP
+
+#include <cstdint>
+
+#include "mach-o.hpp"
+#include "version.hpp"
+
+// Target traits. Code which depends on the target architecture is parameterized on one of these
+// types so that each target gets its own specialized copy rather than testing a run-time value.
+
+struct x86_64_target {
+    static constexpr mach_o::cpu_type cpu_type () noexcept { return mach_o::cpu_type::x86_64; }
+    static constexpr mach_o::cpu_subtype cpu_subtype () noexcept {
+        return mach_o::cpu_subtype::x86_64_all;
+    }
+    /// The VM page size and therefore the alignment of segments in an image.
+    static constexpr std::uint64_t page_size () noexcept { return 0x1000; }
+    /// The earliest macOS version which can run an executable for this target.
+    static constexpr std::uint32_t min_os_version () noexcept { return version (10, 14, 0); }
+    static constexpr char const * name () noexcept { return "x86_64"; }
+};
+
+struct arm64_target {
+    static constexpr mach_o::cpu_type cpu_type () noexcept { return mach_o::cpu_type::arm64; }
+    static constexpr mach_o::cpu_subtype cpu_subtype () noexcept {
+        return mach_o::cpu_subtype::arm64_all;
+    }
+    static constexpr std::uint64_t page_size () noexcept { return 0x4000; }
+    static constexpr std::uint32_t min_os_version () noexcept { return version (11, 0, 0); }
+    static constexpr char const * name () noexcept { return "arm64"; }
+};
+
+#endif // TARGET_HPP
@@ -0,0 +1,64 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// A fixed-size pool of worker threads which run tasks taken from a shared queue.
+class thread_pool {
+public:
+    /// \param threads  The number of worker threads. Zero selects the number of hardware
+    ///   threads.
+    explicit thread_pool (unsigned threads = 0);
+    thread_pool (thread_pool const &) = delete;
+    thread_pool & operator= (thread_pool const &) = delete;
+    /// Waits for the queued tasks to finish then joins the workers.
+    ~thread_pool () noexcept;
+
+    std::size_t size () const noexcept { return workers_.size (); }
+
+    /// Queues \p f to be run by one of the workers.
+    /// \returns A future which yields the result of \p f or the exception that it threw.
+    template <typename Function>
+    auto submit (Function && f) -> std::future<std::result_of_t<std::decay_t<Function> ()>>;
+
+    /// Calls \p f (index) for every index in [0, \p count) using the pool's workers and the
+    /// calling thread. Returns once all of the calls are complete. If any of them threw, the
+    /// exception thrown by the call with the lowest index is re-thrown.
+    void parallel_for (std::size_t count, std::function<void (std::size_t)> const & f);
+
+private:
+    void worker ();
+
+    std::mutex mut_;
+    std::condition_variable cv_;
+    std::deque<std::function<void ()>> tasks_;
+    bool done_ = false;
+    std::vector<std::thread> workers_;
+};
+
+template <typename Function>
+auto thread_pool::submit (Function && f)
+    -> std::future<std::result_of_t<std::decay_t<Function> ()>> {
+    using result_type = std::result_of_t<std::decay_t<Function> ()>;
+    // std::function requires a copyable target so the (move-only) task is held by pointer.
+    auto task =
+        std::make_shared<std::packaged_task<result_type ()>> (std::forward<Function> (f));
+    std::future<result_type> result = task->get_future ();
+    {
+        std::lock_guard<std::mutex> const lock{mut_};
+        tasks_.emplace_back ([task] () { (*task) (); });
+    }
+    cv_.notify_one ();
+    return result;
+}
+
+#endif // THREAD_POOL_HPP
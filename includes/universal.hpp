@@ -0,0 +1,30 @@
+#ifndef UNIVERSAL_HPP
+#define UNIVERSAL_HPP
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "image.hpp"
+
+/// One architecture slice of a universal (fat) binary.
+struct slice {
+    /// Builds the slice's image. Called on the thread that will lay out and write the slice.
+    std::function<image ()> build;
+    /// The alignment of the slice within the file expressed as a power of 2. This is normally
+    /// the target's page size.
+    std::uint32_t align;
+};
+
+/// Builds the image of \p s. The time taken is recorded as the command construction phase.
+image build_image (slice const & s);
+
+/// Writes a universal binary containing \p slices to the file open as \p fd. Each slice is built
+/// and laid out on its own thread; once the position of every slice is known, the slices'
+/// contents are written concurrently, each directly into its own region of the file. Each slice
+/// is laid out and written once.
+///
+/// \returns The size of the file.
+std::uint64_t write_universal (int fd, std::vector<slice> const & slices);
+
+#endif // UNIVERSAL_HPP
@@ -3,6 +3,8 @@
 
 #include <cstdlib>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <limits>
 #include <type_traits>
 #include <utility>
@@ -52,6 +54,60 @@ constexpr T narrow_cast (U && u) noexcept {
     return static_cast<T> (std::forward<U> (u));
 }
 
+// big endian
+// ~~~~~~~~~~
+/// \returns The value whose in-memory representation is \p v stored most significant byte
+/// first, whatever the byte order of the host.
+inline std::uint32_t big_endian (std::uint32_t v) noexcept {
+    std::uint8_t const bytes[] = {
+        static_cast<std::uint8_t> (v >> 24), static_cast<std::uint8_t> (v >> 16),
+        static_cast<std::uint8_t> (v >> 8), static_cast<std::uint8_t> (v)};
+    std::uint32_t result;
+    std::memcpy (&result, bytes, sizeof (result));
+    return result;
+}
+
+// hash string
+// ~~~~~~~~~~~
+/// \returns The 64-bit FNV-1a hash of the \p length bytes at \p str.
+inline std::uint64_t hash_string (char const * str, std::size_t length) noexcept {
+    std::uint64_t h = 0xcbf29ce484222325ULL; // offset basis
+    for (std::size_t ctr = 0; ctr < length; ++ctr) {
+        h ^= static_cast<std::uint8_t> (str[ctr]);
+        h *= 0x100000001b3ULL; // FNV prime
+    }
+    return h;
+}
+
+// array view
+// ~~~~~~~~~~
+/// A non-owning view of a contiguous, read-only array of \p T.
+template <typename T>
+class array_view {
+public:
+    using value_type = T;
+    using const_iterator = T const *;
+
+    constexpr array_view () noexcept = default;
+    constexpr array_view (T const * first, std::size_t size) noexcept
+            : first_{first}
+            , size_{size} {}
+
+    constexpr T const * data () const noexcept { return first_; }
+    constexpr std::size_t size () const noexcept { return size_; }
+    constexpr bool empty () const noexcept { return size_ == 0U; }
+    constexpr const_iterator begin () const noexcept { return first_; }
+    constexpr const_iterator end () const noexcept { return first_ + size_; }
+    T const & operator[] (std::size_t index) const noexcept {
+        assert (index < size_);
+        return first_[index];
+    }
+
+private:
+    T const * first_ = nullptr;
+    std::size_t size_ = 0;
+};
+
 template <typename T>
 class not_null {
     static_assert (std::is_assignable<T &, std::nullptr_t>::value, "T cannot be assigned nullptr.");
@@ -0,0 +1,29 @@
+#ifndef UUID_HPP
+#define UUID_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/// The 128-bit value held by an LC_UUID command.
+using uuid = std::array<std::uint8_t, 16>;
+
+/// \returns A random (version 4) UUID.
+uuid random_uuid ();
+
+/// Derives a UUID from the bytes of an image so that linking the same inputs always produces
+/// the same UUID. The bytes may be added in any order: each block is hashed along with its
+/// offset and the results are combined with an order-independent sum.
+class uuid_hasher {
+public:
+    /// Adds the \p size bytes at \p data which are written at \p offset in the image.
+    void add (std::uint64_t offset, void const * data, std::size_t size) noexcept;
+    /// \returns A (version 8) UUID derived from the bytes added so far.
+    uuid get () const noexcept;
+
+private:
+    std::uint64_t h0_ = 0;
+    std::uint64_t h1_ = 0;
+};
+
+#endif // UUID_HPP
@@ -0,0 +1,31 @@
+#ifndef VALIDATE_HPP
+#define VALIDATE_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "image_view.hpp"
+
+/// A problem found by validate().
+struct diagnostic {
+    std::uint64_t offset; ///< The offset within the image of the structure at fault.
+    char const * message;
+};
+
+/// Checks the structure of \p image in a single pass over its load commands:
+///
+/// - the load command sizes are 8-byte aligned and sum to sizeofcmds;
+/// - segments are page-aligned, lie within the file, and do not overlap in the file or in
+///   memory;
+/// - sections lie within their segment;
+/// - __LINKEDIT is the last segment and all link-edit data lies within it;
+/// - the LC_MAIN entry point lies within __TEXT.
+///
+/// Only the header and load commands are read: section contents and link-edit data are never
+/// touched so the cost depends on the number of load commands rather than the size of the
+/// image. MH_OBJECT files are not subject to the segment and __LINKEDIT checks.
+///
+/// \returns The problems found. Empty if the image is well-formed.
+std::vector<diagnostic> validate (image_view const & image);
+
+#endif // VALIDATE_HPP
@@ -0,0 +1,187 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "load_command_editor.hpp"
+#include "thread_pool.hpp"
+#include "version.hpp"
+
+namespace {
+
+    [[noreturn]] void usage (char const * argv0) {
+        std::cerr << "Usage: " << argv0
+                  << " [-change old new]... [-dylib_version path current compatibility]..."
+                     " [-add_rpath path]... [-uuid random|UUID]"
+                     " [-build_version platform minos sdk] file...\n";
+        std::exit (EXIT_FAILURE);
+    }
+
+    /// Parses a version of the form X[.Y[.Z]].
+    /// \returns True if \p str is well-formed.
+    bool parse_version (char const * str, std::uint32_t * out) {
+        unsigned long parts[3] = {0, 0, 0};
+        unsigned long const limits[3] = {0xFFFF, 0xFF, 0xFF};
+        for (unsigned ctr = 0; ctr < 3U; ++ctr) {
+            char * end = nullptr;
+            parts[ctr] = std::strtoul (str, &end, 10);
+            if (end == str || parts[ctr] > limits[ctr]) {
+                return false;
+            }
+            if (*end == '\0') {
+                break;
+            }
+            if (*end != '.' || ctr == 2U) {
+                return false;
+            }
+            str = end + 1;
+        }
+        *out = version (static_cast<std::uint16_t> (parts[0]), static_cast<std::uint8_t> (parts[1]),
+                        static_cast<std::uint8_t> (parts[2]));
+        return true;
+    }
+
+    /// Parses 32 hexadecimal digits, optionally separated by hyphens.
+    /// \returns True if \p str is well-formed.
+    bool parse_uuid (char const * str, uuid * out) {
+        unsigned digits = 0;
+        for (; *str != '\0'; ++str) {
+            if (*str == '-') {
+                continue;
+            }
+            char const c = *str;
+            unsigned v;
+            if (c >= '0' && c <= '9') {
+                v = static_cast<unsigned> (c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                v = static_cast<unsigned> (c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                v = static_cast<unsigned> (c - 'A' + 10);
+            } else {
+                return false;
+            }
+            if (digits >= 32U) {
+                return false;
+            }
+            std::uint8_t & b = (*out)[digits / 2U];
+            b = static_cast<std::uint8_t> ((digits % 2U == 0U) ? v << 4 : (b | v));
+            ++digits;
+        }
+        return digits == 32U;
+    }
+
+    /// Parses a platform given either by number or as "macos".
+    bool parse_platform (char const * str, std::uint32_t * out) {
+        if (std::strcmp (str, "macos") == 0) {
+            *out = mach_o::platform_macos;
+            return true;
+        }
+        char * end = nullptr;
+        unsigned long const v = std::strtoul (str, &end, 10);
+        if (end == str || *end != '\0' || v > 0xFFFFFFFFUL) {
+            return false;
+        }
+        *out = static_cast<std::uint32_t> (v);
+        return true;
+    }
+
+    struct dylib_versions {
+        std::string path;
+        std::uint32_t current;
+        std::uint32_t compatibility;
+    };
+
+    struct edits {
+        std::vector<std::pair<std::string, std::string>> changes;
+        std::vector<dylib_versions> versions;
+        std::vector<std::string> rpaths;
+        bool set_uuid = false;
+        bool random_uuid = false;
+        uuid new_uuid{};
+        bool set_build_version = false;
+        std::uint32_t platform = 0;
+        std::uint32_t minos = 0;
+        std::uint32_t sdk = 0;
+    };
+
+    void apply (edits const & e, load_command_editor & editor) {
+        for (auto const & c : e.changes) {
+            editor.change_dylib (c.first, c.second);
+        }
+        for (dylib_versions const & v : e.versions) {
+            editor.set_dylib_versions (v.path, v.current, v.compatibility);
+        }
+        for (std::string const & r : e.rpaths) {
+            editor.add_rpath (r);
+        }
+        if (e.set_uuid) {
+            editor.set_uuid (e.random_uuid ? random_uuid () : e.new_uuid);
+        }
+        if (e.set_build_version) {
+            editor.set_build_version (e.platform, e.minos, e.sdk);
+        }
+    }
+
+} // end anonymous namespace
+
+int main (int argc, char const * argv[]) {
+    edits e;
+    std::vector<char const *> files;
+    for (int arg = 1; arg < argc; ++arg) {
+        if (std::strcmp (argv[arg], "-change") == 0 && arg + 2 < argc) {
+            e.changes.emplace_back (argv[arg + 1], argv[arg + 2]);
+            arg += 2;
+        } else if (std::strcmp (argv[arg], "-dylib_version") == 0 && arg + 3 < argc) {
+            dylib_versions v{argv[arg + 1], 0, 0};
+            if (!parse_version (argv[arg + 2], &v.current) ||
+                !parse_version (argv[arg + 3], &v.compatibility)) {
+                usage (argv[0]);
+            }
+            e.versions.push_back (std::move (v));
+            arg += 3;
+        } else if (std::strcmp (argv[arg], "-add_rpath") == 0 && arg + 1 < argc) {
+            e.rpaths.emplace_back (argv[++arg]);
+        } else if (std::strcmp (argv[arg], "-uuid") == 0 && arg + 1 < argc) {
+            e.set_uuid = true;
+            e.random_uuid = std::strcmp (argv[++arg], "random") == 0;
+            if (!e.random_uuid && !parse_uuid (argv[arg], &e.new_uuid)) {
+                usage (argv[0]);
+            }
+        } else if (std::strcmp (argv[arg], "-build_version") == 0 && arg + 3 < argc) {
+            e.set_build_version = true;
+            if (!parse_platform (argv[arg + 1], &e.platform) ||
+                !parse_version (argv[arg + 2], &e.minos) ||
+                !parse_version (argv[arg + 3], &e.sdk)) {
+                usage (argv[0]);
+            }
+            arg += 3;
+        } else if (argv[arg][0] == '-') {
+            usage (argv[0]);
+        } else {
+            files.push_back (argv[arg]);
+        }
+    }
+    if (files.empty ()) {
+        usage (argv[0]);
+    }
+
+    // Each file touches only a page or two so many are edited at once.
+    std::mutex mut;
+    bool ok = true;
+    thread_pool pool;
+    pool.parallel_for (files.size (), [&] (std::size_t index) {
+        char const * const path = files[index];
+        try {
+            edit_file (path, [&e] (load_command_editor & editor) { apply (e, editor); });
+        } catch (std::exception const & ex) {
+            // edit_error, format_error, std::system_error.
+            std::lock_guard<std::mutex> const lock{mut};
+            std::cerr << path << ": " << ex.what () << '\n';
+            ok = false;
+        }
+    });
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,59 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+#include "image_view.hpp"
+#include "mapped_file.hpp"
+#include "validate.hpp"
+
+namespace {
+
+    /// Validates a single image and reports any problems to stderr.
+    /// \returns True if the image is well-formed.
+    bool check (std::string const & name, std::uint8_t const * data, std::size_t size) {
+        std::vector<diagnostic> const diags = validate (image_view{data, size});
+        for (diagnostic const & d : diags) {
+            std::cerr << name << ": 0x" << std::hex << d.offset << std::dec << ": " << d.message
+                      << '\n';
+        }
+        return diags.empty ();
+    }
+
+    bool check_file (char const * path) {
+        mapped_file const file{path};
+        if (!universal_view::is_universal (file.data (), file.size ())) {
+            return check (path, file.data (), file.size ());
+        }
+        bool ok = true;
+        universal_view const fat{file.data (), file.size ()};
+        for (std::size_t ctr = 0; ctr < fat.size (); ++ctr) {
+            image_view const slice = fat.slice (ctr);
+            ok = check (std::string{path} + " (slice " + std::to_string (ctr) + ")",
+                        slice.data (), slice.size ()) &&
+                 ok;
+        }
+        return ok;
+    }
+
+} // end anonymous namespace
+
+int main (int argc, char const * argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " file...\n";
+        return EXIT_FAILURE;
+    }
+    bool ok = true;
+    for (int arg = 1; arg < argc; ++arg) {
+        try {
+            ok = check_file (argv[arg]) && ok;
+        } catch (format_error const & ex) {
+            std::cerr << argv[arg] << ": " << ex.what () << '\n';
+            ok = false;
+        } catch (std::system_error const & ex) {
+            std::cerr << argv[arg] << ": " << ex.what () << '\n';
+            ok = false;
+        }
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,244 +1,468 @@
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <memory>
-#include <numeric>
-
-#include <fcntl.h>
-
-#ifdef _WIN32
-#    include <io.h>
-#else
-#    include <unistd.h>
-#endif
-
-#include "command.hpp"
-#include "lc_build_version.hpp"
-#include "lc_dyld_info_only.hpp"
-#include "lc_dysymtab.hpp"
-#include "lc_load_dylib.hpp"
-#include "lc_load_dylinker.hpp"
-#include "lc_main.hpp"
-#include "lc_segment.hpp"
-#include "lc_symtab.hpp"
-#include "lc_uuid.hpp"
-#include "mach-o_reloc.hpp"
-
-#define BUILD_DATA_COMMAND
-#define BUILD_UUID_COMMAND
-#define BUILD_VERSION_COMMAND
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "description.hpp"
+#include "file_writer.hpp"
+#include "image.hpp"
+#include "image_builder.hpp"
+#include "input_cache.hpp"
+#include "instrumentation.hpp"
+#include "layout.hpp"
+#include "linker.hpp"
+#include "output.hpp"
+#include "sample_program.hpp"
+#include "server.hpp"
+#include "string_arena.hpp"
+#include "target.hpp"
+#include "thread_pool.hpp"
+#include "universal.hpp"
+#include "util.hpp"
 
 namespace {
 
-    template <typename To, typename From>
-    std::unique_ptr<To> static_unique_pointer_cast (std::unique_ptr<From> && old) {
-        return std::unique_ptr<To>{static_cast<To *> (old.release ())};
+    [[noreturn]] void usage (char const * argv0) {
+        std::cerr << "Usage: " << argv0
+                  << " [--arch x86_64|arm64]... [--object | --description path | -e entry]"
+                     " [-dead_strip [-export_dynamic]] [--icf] [-order_file path]"
+                     " [-call_graph_profile path] [-headerpad size] [-headerpad_max_install_names]"
+                     " [--incremental] [--dry-run] [--stats text|json] output-path [input...]\n"
+                  << "       " << argv0 << " --batch manifest\n"
+                  << "       " << argv0 << " --serve socket\n"
+                  << "       " << argv0 << " --client socket (arguments... | --shutdown)\n";
+        std::exit (EXIT_FAILURE);
     }
 
+    /// The description of one output file: the arguments of a single command line.
+    struct job {
+        bool object = false;
+        bool incremental = false;
+        bool dry_run = false; ///< Lay out the image and report its layout without writing it
+        bool stats = false;   ///< Report the time taken by each phase and the I/O performed
+        bool stats_json = false;
+        std::string description;
+        std::vector<std::string> archs;
+        std::string output_path;
+        link_options options;
+    };
+
+    /// \param j  The job whose output is to be built.
+    /// \param pool  The workers used by the linker.
+    /// \param names  The arena for symbol and section names or nullptr to use one per link.
+    template <typename Target>
+    slice make_slice (job const & j, thread_pool & pool,
+                      std::shared_ptr<string_arena> const & names) {
+        static_assert (is_power_of_two (Target::page_size ()), "Page size must be a power of 2");
+        std::uint32_t align = 0;
+        while ((std::uint64_t{1} << align) < Target::page_size ()) {
+            ++align;
+        }
+        // If input files are named, they are linked; if a description is named, the image that
+        // it describes is built; otherwise the built-in program is written.
+        if (!j.options.inputs.empty ()) {
+            return {[&j, &pool, names] () { return link<Target> (j.options, pool, names); },
+                    align};
+        }
+        if (!j.description.empty ()) {
+            return {[&j] () {
+                        image_builder builder = image_builder::for_target<Target> ();
+                        read_description (j.description, Target::name (), builder);
+                        builder.set_header_pad (j.options.header_pad,
+                                                j.options.header_pad_max_install_names);
+                        return builder.build ();
+                    },
+                    align};
+        }
+        return {[&j] () {
+                    return build_sample_program<Target> (j.object, j.options.header_pad,
+                                                         j.options.header_pad_max_install_names);
+                },
+                align};
+    }
 
-    std::unique_ptr<lc_segment> build_page_zero () {
-        return std::make_unique<lc_segment> (
-            mach_o::seg_pagezero,
-            position (0x0, std::uint64_t{1} << 32), // memory address and size of this segment
-            mach_o::vm_prot_none,                   // maximum VM protection
-            mach_o::vm_prot_none,                   // initial VM protection
-            0x00                                    // flags
-        );
+    /// The options which take a value: the next argument.
+    constexpr char const * value_options[] = {
+        "--description", "--arch", "-e", "-order_file", "-call_graph_profile", "-headerpad",
+        "--stats",
+    };
+
+    /// Parses the arguments of a command line, or of one line of a batch manifest, into \p j.
+    /// \returns False if the arguments are malformed, in which case \p error says why.
+    bool parse_job (std::vector<std::string> const & args, job & j, std::string & error) {
+        for (std::size_t arg = 0; arg < args.size (); ++arg) {
+            std::string const & a = args[arg];
+            if (std::find (std::begin (value_options), std::end (value_options), a) !=
+                    std::end (value_options) &&
+                arg + 1U >= args.size ()) {
+                error = "missing value for " + a;
+                return false;
+            }
+            if (a == "--object") {
+                j.object = true;
+            } else if (a == "--description") {
+                j.description = args[++arg];
+            } else if (a == "--arch") {
+                j.archs.push_back (args[++arg]);
+            } else if (a == "-e") {
+                j.options.entry = args[++arg];
+            } else if (a == "-dead_strip") {
+                j.options.dead_strip = true;
+            } else if (a == "-export_dynamic") {
+                j.options.export_dynamic = true;
+            } else if (a == "--icf") {
+                j.options.fold_identical_code = true;
+            } else if (a == "-order_file") {
+                j.options.order_file = args[++arg];
+            } else if (a == "-call_graph_profile") {
+                j.options.call_graph_profile = args[++arg];
+            } else if (a == "-headerpad") {
+                // As for ld64, the size is hexadecimal with or without a leading "0x".
+                char const * const first = args[++arg].c_str ();
+                char * end = nullptr;
+                unsigned long const pad = std::strtoul (first, &end, 16);
+                if (*first == '\0' || *end != '\0' || pad > type_max<std::uint32_t> ()) {
+                    error = "bad header pad size " + args[arg];
+                    return false;
+                }
+                j.options.header_pad = static_cast<std::uint32_t> (pad);
+            } else if (a == "-headerpad_max_install_names") {
+                j.options.header_pad_max_install_names = true;
+            } else if (a == "--incremental") {
+                j.incremental = true;
+            } else if (a == "--dry-run") {
+                j.dry_run = true;
+            } else if (a == "--stats") {
+                std::string const & format = args[++arg];
+                if (format != "text" && format != "json") {
+                    error = "unknown statistics format " + format;
+                    return false;
+                }
+                j.stats = true;
+                j.stats_json = format == "json";
+            } else if (a.size () > 1U && a.front () == '-') {
+                error = "unknown option " + a;
+                return false;
+            } else if (j.output_path.empty ()) {
+                j.output_path = a;
+            } else {
+                j.options.inputs.push_back (a);
+            }
+        }
+        if (j.output_path.empty ()) {
+            error = "no output path";
+            return false;
+        }
+        // The image is built from the inputs, from a description or as the built-in program.
+        unsigned const sources = unsigned{!j.options.inputs.empty ()} +
+                                 unsigned{!j.description.empty ()} + unsigned{j.object};
+        if (sources > 1U) {
+            error = "only one of input files, --description and --object may be given";
+            return false;
+        }
+        if (j.archs.empty ()) {
+            j.archs.emplace_back (x86_64_target::name ());
+        }
+        for (std::string const & arch : j.archs) {
+            if (arch != x86_64_target::name () && arch != arm64_target::name ()) {
+                error = "unknown architecture " + arch;
+                return false;
+            }
+        }
+        return true;
     }
 
+    /// Selects the target of each of a job's slices once, here: everything below make_slice<> is
+    /// specialized for it. The slices refer to \p j which must outlive them.
+    std::vector<slice> make_slices (job const & j, thread_pool & pool,
+                                    std::shared_ptr<string_arena> const & names) {
+        std::vector<slice> slices;
+        slices.reserve (j.archs.size ());
+        for (std::string const & arch : j.archs) {
+            if (arch == x86_64_target::name ()) {
+                slices.push_back (make_slice<x86_64_target> (j, pool, names));
+            } else {
+                assert (arch == arm64_target::name ());
+                slices.push_back (make_slice<arm64_target> (j, pool, names));
+            }
+        }
+        return slices;
+    }
 
-    std::unique_ptr<lc_segment> build_text () {
+    /// Records the statistics of a job. Instrumentation is enabled for the lifetime of the
+    /// object if the job asks for statistics; the previous state is restored afterwards, so a
+    /// job which does not ask for them (the next request to a link server, for example) does
+    /// not pay for instrumentation.
+    class job_stats {
+    public:
+        explicit job_stats (job const & j) noexcept
+                : job_{j}
+                , was_enabled_{j.stats ? enable_instrumentation () : instrumentation_enabled ()}
+                , start_{read_counters ()} {}
+        job_stats (job_stats const &) = delete;
+        job_stats & operator= (job_stats const &) = delete;
+        ~job_stats () noexcept { enable_instrumentation (was_enabled_); }
+
+        /// Writes the statistics of the job, if it asked for them, to \p os.
+        void report (std::ostream & os) const {
+            if (job_.stats) {
+                print_counters (os, read_counters () - start_, job_.stats_json);
+            }
+        }
+
+    private:
+        job const & job_;
+        bool const was_enabled_;
+        counters const start_;
+    };
+
+    /// Produces the output of \p j: its image file or, for a dry run, a description of the
+    /// image's layout written to \p report. Statistics are written to \p stats.
+    void run_job (job const & j, thread_pool & pool, std::shared_ptr<string_arena> const & names,
+                  std::ostream & report, std::ostream & stats) {
+        job_stats const js{j};
+        std::vector<slice> const slices = make_slices (j, pool, names);
+        if (j.dry_run) {
+            print_layout (report, j.output_path, lay_out_file (slices));
+        } else {
+            write_image_file (j.output_path, slices, j.incremental);
+        }
+        js.report (stats);
+    }
 
-        // The 64-bit segment load command indicates that a part of this file is to be mapped into a
-        // 64-bit task's address space.  If the 64-bit segment has sections then section_64
-        // structures directly follow the 64-bit segment command and their size is reflected in
-        // cmdsize.
-        auto text_segment = std::make_unique<lc_segment> (
-            mach_o::seg_text,
-            position (0x0000000100000000, 0x0), // memory address and size of this segment
-            mach_o::vm_prot_all,                // maximum VM protection
-            mach_o::vm_prot_execute | mach_o::vm_prot_read, // initial VM protection
-            0x00                                            // flags
-        );
+    /// Splits a line of a batch manifest into its arguments. Arguments are separated by white
+    /// space and '#' starts a comment.
+    std::vector<std::string> split (std::string const & line) {
+        std::vector<std::string> args;
+        std::istringstream in{line.substr (0, line.find ('#'))};
+        std::string arg;
+        while (in >> arg) {
+            args.push_back (std::move (arg));
+        }
+        return args;
+    }
 
-        // 0000000000000000    pushq    %rbp
-        // 0000000000000001    movq    %rsp, %rbp
-        // 0000000000000004    xorl    %eax, %eax
-        // 0000000000000006    popq    %rbp
-        // 0000000000000007    retq
-        static constexpr std::uint8_t text_section_contents[] = {
-            0x55, 0x48, 0x89, 0xe5, 0x31, 0xc0, 0x5d, 0xc3,
-        };
-        text_segment->add_section (
-            {
-                mach_o::sect_text,  // name of this section
-                mach_o::seg_text,   // segment this section goes in
-                0x0000000100000000, // memory address of this section
-                0,                  // size in bytes of this section (patched up later)
-                0,                  // file offset of this section (patched up later)
-                4,                  // section alignment (power of 2)
-                0,                  // file offset of relocation entries
-                0,                  // number of relocation entries
-                mach_o::s_attr_pure_instructions | mach_o::s_attr_some_instructions |
-                    mach_o::s_regular // flags (section type and attributes)
-            },
-            lc_segment::contents_range (text_section_contents,
-                                        text_section_contents + sizeof (text_section_contents)));
-        return static_unique_pointer_cast<lc_segment> (std::move (text_segment));
-    }
-
-
-#ifdef BUILD_DATA_COMMAND
-    std::unique_ptr<lc_segment> build_data () {
-        auto data_segment = std::make_unique<lc_segment> (
-            mach_o::seg_data,
-            position (0x0000000200000000, 0x0),           // memory address and size of this segment
-            mach_o::vm_prot_all,                          // maximum VM protection
-            mach_o::vm_prot_write | mach_o::vm_prot_read, // initial VM protection
-            0x00                                          // flags
-        );
-
-        static constexpr std::uint8_t data_section_contents[4096] = {
-            0x0,
+    /// Produces every image described by \p manifest, one per line. The thread pool, the name
+    /// arena and the output buffers are shared by all of the images.
+    int run_batch (char const * manifest) {
+        std::ifstream in{manifest};
+        if (!in) {
+            std::cerr << "Error: " << manifest << ": cannot open the manifest\n";
+            return EXIT_FAILURE;
+        }
+        thread_pool pool;
+        auto const names = std::make_shared<string_arena> ();
+        std::vector<std::uint8_t> buffer;
+        file_writer writer;
+        bool ok = true;
+        std::string line;
+        for (unsigned line_number = 1; std::getline (in, line); ++line_number) {
+            std::vector<std::string> const args = split (line);
+            if (args.empty ()) {
+                continue;
+            }
+            std::string const where = std::string{manifest} + ':' + std::to_string (line_number);
+            job j;
+            std::string error;
+            if (!parse_job (args, j, error)) {
+                std::cerr << "Error: " << where << ": " << error << '\n';
+                ok = false;
+                continue;
+            }
+            try {
+                if (j.stats) {
+                    // Count this image's work alone: the writer thread may still be busy with
+                    // the previous one.
+                    writer.wait ();
+                }
+                job_stats const js{j};
+                std::vector<slice> const slices = make_slices (j, pool, names);
+                if (j.dry_run) {
+                    print_layout (std::cout, j.output_path, lay_out_file (slices));
+                } else if (slices.size () == 1U && !j.incremental) {
+                    image img = build_image (slices.front ());
+                    buffer_output out{buffer};
+                    buffer.resize (img.write (out));
+                    writer.submit (j.output_path, buffer);
+                } else {
+                    writer.wait ();
+                    write_image_file (j.output_path, slices, j.incremental);
+                }
+                if (j.stats) {
+                    // Include the writer thread's work on this image.
+                    writer.wait ();
+                }
+                js.report (std::cerr);
+            } catch (std::exception const & ex) {
+                // link_error, load_error, format_error, std::system_error.
+                std::cerr << "Error: " << where << ": " << ex.what () << '\n';
+                ok = false;
+            }
+        }
+        writer.wait ();
+        for (std::string const & error : writer.errors ()) {
+            std::cerr << "Error: " << error << '\n';
+            ok = false;
+        }
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    /// \returns \p path interpreted relative to the directory \p dir.
+    std::string resolve (std::string const & dir, std::string const & path) {
+        if (path.empty () || path.front () == '/') {
+            return path;
+        }
+        return dir + '/' + path;
+    }
+
+    /// Makes the relative paths named by \p j relative to \p dir rather than to the current
+    /// directory.
+    void resolve_paths (job & j, std::string const & dir) {
+        j.description = resolve (dir, j.description);
+        j.output_path = resolve (dir, j.output_path);
+        for (std::string & input : j.options.inputs) {
+            input = resolve (dir, input);
+        }
+        j.options.order_file = resolve (dir, j.options.order_file);
+        j.options.call_graph_profile = resolve (dir, j.options.call_graph_profile);
+    }
+
+    /// The number of consecutive requests for which a cached input may go unused before the
+    /// server drops it.
+    constexpr std::uint64_t max_idle_requests = 64;
+    /// The number of names that the server's arena may hold before it is replaced.
+    constexpr std::size_t max_arena_names = std::size_t{1} << 20;
+
+    /// Produces images on behalf of clients which connect to \p socket_path. Each request holds
+    /// the arguments of a command line. The parsed inputs are kept between requests, as are the
+    /// thread pool and the name arena, so a link whose inputs have not changed reads none of
+    /// them again.
+    int run_server (char const * socket_path) {
+        thread_pool pool;
+        auto names = std::make_shared<string_arena> ();
+        input_cache cache;
+        auto const handler = [&] (std::string const & cwd, std::vector<std::string> const & args,
+                                  std::string & output, std::string & diagnostics, bool & stop) {
+            if (args.size () == 1U && args.front () == "--shutdown") {
+                stop = true;
+                return EXIT_SUCCESS;
+            }
+            job j;
+            std::string error;
+            if (!parse_job (args, j, error)) {
+                diagnostics += "Error: " + error + '\n';
+                return EXIT_FAILURE;
+            }
+            resolve_paths (j, cwd);
+            j.options.cache = &cache;
+            input_cache::statistics const before = cache.stats ();
+            int status = EXIT_SUCCESS;
+            try {
+                std::ostringstream report;
+                std::ostringstream stats;
+                run_job (j, pool, names, report, stats);
+                output += report.str ();
+                diagnostics += stats.str ();
+            } catch (std::exception const & ex) {
+                // link_error, load_error, format_error, std::system_error.
+                diagnostics += std::string{"Error: "} + ex.what () + '\n';
+                status = EXIT_FAILURE;
+            }
+            input_cache::statistics const after = cache.stats ();
+            std::clog << j.output_path << ": " << after.hits - before.hits << " cached, "
+                      << after.rehashed - before.rehashed << " unchanged, "
+                      << after.loads - before.loads << " parsed\n";
+            cache.next_generation ();
+            // Strings are never removed from an arena. Once inputs have been dropped, or the
+            // arena is large, a new one is started so that the names of files which are no
+            // longer used do not accumulate. (The cached files do not refer to the arena; an
+            // image keeps the arena with which it was linked alive for as long as it needs it.)
+            if (cache.evict (max_idle_requests) > 0U || names->size () > max_arena_names) {
+                names = std::make_shared<string_arena> ();
+            }
+            return status;
         };
-        data_segment->add_section (
-            {
-                mach_o::sect_data,  // name of this section
-                mach_o::seg_data,   // segment this section goes in
-                0x0000000200000000, // memory address of this section
-                0,                  // size in bytes of this section (patched up later)
-                0,                  // file offset of this section (patched up later)
-                4,                  // section alignment (power of 2)
-                0,                  // file offset of relocation entries
-                0,                  // number of relocation entries
-                mach_o::s_regular,  // 0x80000400, // flags (section type and attributes)
-            },
-            lc_segment::contents_range (data_section_contents,
-                                        data_section_contents + sizeof (data_section_contents)));
-        return data_segment;
-    }
-#endif // BUILD_DATA_COMMAND
-
-    std::unique_ptr<lc_segment> build_linkedit () {
-        auto linkedit_segment = std::make_unique<lc_segment> (
-            mach_o::seg_linkedit,
-            position (0x0000000200001000, 0x0), // memory address and size of this segment
-            mach_o::vm_prot_all,                // maximum VM protection
-            mach_o::vm_prot_read,               // initial VM protection
-            0x00                                // flags
-        );
-
-        // struct relocation_info {
-        //    int32_t r_address;         /* offset in the section to what is being
-        //                      relocated */
-        //    uint32_t r_symbolnum : 24, /* symbol index if r_extern == 1 or section
-        //               ordinal if r_extern == 0 */
-        //        r_pcrel : 1,           /* was relocated pc relative already */
-        //        r_length : 2,          /* 0=byte, 1=word, 2=long, 3=quad */
-        //        r_extern : 1,          /* does not include value of sym referenced */
-        //        r_type : 4;            /* if not 0, machine specific relocation type */
-        //};
-        static mach_o::relocation_info ri;
-        ri.r_address = 0;
-        ri.r_symbolnum = 0;
-        ri.r_pcrel = 0;
-        ri.r_length = 0;
-        ri.r_extern = 0;
-        ri.r_type = 0;
-
-
-        linkedit_segment->add_section (
-            {
-                "",                   // name of this section
-                mach_o::seg_linkedit, // segment this section goes in
-                0x0000000200001000,   // memory address of this section
-                0,                    // size in bytes of this section (patched up later)
-                0,                    // file offset of this section (patched up later)
-                4,                    // section alignment (power of 2)
-                0,                    // file offset of relocation entries
-                0,                    // number of relocation entries
-                mach_o::s_regular     // 0x80000400, // flags (section type and attributes)
-            },
-            lc_segment::contents_range (&ri, &ri + 1));
-        return linkedit_segment;
+        try {
+            serve (socket_path, handler);
+        } catch (std::exception const & ex) {
+            std::cerr << "Error: " << socket_path << ": " << ex.what () << '\n';
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    /// Sends the arguments \p args to the server listening on \p socket_path.
+    int run_client (char const * socket_path, std::vector<std::string> const & args) {
+        std::string output;
+        std::string diagnostics;
+        int status;
+        try {
+            status = send_request (socket_path, args, output, diagnostics);
+        } catch (std::exception const & ex) {
+            std::cerr << "Error: " << socket_path << ": " << ex.what () << '\n';
+            return EXIT_FAILURE;
+        }
+        std::cout << output;
+        std::cerr << diagnostics;
+        return status;
     }
 
 } // namespace
 
+// The replacement allocation functions count allocations for --stats.
+void * operator new (std::size_t size) {
+    count_allocation ();
+    for (;;) {
+        if (void * const p = std::malloc (size == 0U ? 1U : size)) {
+            return p;
+        }
+        std::new_handler const handler = std::get_new_handler ();
+        if (handler == nullptr) {
+            throw std::bad_alloc ();
+        }
+        handler ();
+    }
+}
+void operator delete (void * p) noexcept {
+    std::free (p);
+}
+void operator delete (void * p, std::size_t) noexcept {
+    std::free (p);
+}
+
 
 int main (int argc, char const * argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " output-path\n";
-        std::exit (EXIT_FAILURE);
+    // The replacement operator new above counts every allocation.
+    enable_allocation_counting ();
+    if (argc == 3 && std::strcmp (argv[1], "--batch") == 0) {
+        return run_batch (argv[2]);
     }
-
-#ifdef _WIN32
-    int const fd = _open (argv[1], O_RDWR | O_CREAT | O_TRUNC);
-#else
-    int const fd = open (argv[1], O_RDWR | O_CREAT | O_TRUNC, S_IRWXU | S_IRWXG | S_IRWXO);
-#endif
-    if (fd == -1) {
-        perror ("open");
-    }
-    auto const scope = make_scope_guard ([fd] () { ::close (fd); });
-
-    auto text_segment = build_text ();
-    lc_segment::section_value const & text_section = (*text_segment)[0];
-
-    constexpr auto reserve = std::size_t{12};
-    std::vector<std::unique_ptr<command>> commands;
-    commands.reserve (reserve);
-
-    // segments
-    commands.emplace_back (build_page_zero ());
-    commands.emplace_back (std::move (text_segment));
-#ifdef BUILD_DATA_COMMAND
-    commands.emplace_back (build_data ());
-#endif
-    commands.emplace_back (build_linkedit ()); // must be last and not writable.
-
-    commands.emplace_back (std::make_unique<lc_dyld_info_only> ());
-    commands.emplace_back (std::make_unique<lc_symtab> ());
-    commands.emplace_back (std::make_unique<lc_dysymtab> ());
-    commands.emplace_back (std::make_unique<lc_load_dylinker> ());
-#ifdef BUILD_UUID_COMMAND
-    commands.emplace_back (std::make_unique<lc_uuid> ());
-#endif
-#ifdef BUILD_VERSION_COMMAND
-    commands.emplace_back (std::make_unique<lc_build_version> ());
-#endif
-    commands.emplace_back (std::make_unique<lc_main> (&text_section));
-    commands.emplace_back (std::make_unique<lc_load_dylib> ("/usr/lib/libSystem.B.dylib"));
-    assert (commands.size () <= reserve);
-
-    std::size_t const total_command_size =
-        std::accumulate (std::begin (commands), std::end (commands), std::size_t{0},
-                         [] (std::size_t acc, std::unique_ptr<command> const & v) noexcept {
-                             return acc + v->size_bytes ();
-                         });
-    assert (total_command_size <= type_max<std::uint32_t> ());
-
-    mach_o::mach_header_64 header;
-    header.magic = mach_o::mh_magic_64;                           // mach magic number identifier
-    header.cputype = mach_o::cpu_type::x86_64;                    // cpu specifier
-    header.cpusubtype = mach_o::cpu_subtype::x86_64_all;          // machine specifier
-    header.filetype = mach_o::filetype_t::execute;                // type of file
-    header.ncmds = narrow_cast<std::uint32_t> (commands.size ()); // number of load commands
-    header.sizeofcmds =
-        narrow_cast<std::uint32_t> (total_command_size); // the size of all the load commands.
-    header.flags = mach_o::mh_noundefs | mach_o::mh_dyldlink | mach_o::mh_twolevel | mach_o::mh_pie;
-    header.reserved = 0;
-
-    write (fd, &header, sizeof (header));
-
-    auto const payload_start = sizeof (header) + total_command_size;
-    auto payload_offset = payload_start;
-    for (std::unique_ptr<command> const & v : commands) {
-        assert (payload_offset % 8 == 0);
-        payload_offset = v->write_command (fd, payload_offset);
-    }
-
-    assert (static_cast<std::uint64_t> (lseek (fd, 0, SEEK_CUR)) == payload_start);
-    for (std::unique_ptr<command> const & v : commands) {
-        v->write_payload (fd);
+    if (argc == 3 && std::strcmp (argv[1], "--serve") == 0) {
+        return run_server (argv[2]);
+    }
+    if (argc >= 4 && std::strcmp (argv[1], "--client") == 0) {
+        return run_client (argv[2], std::vector<std::string> (argv + 3, argv + argc));
+    }
+    job j;
+    std::string error;
+    if (!parse_job (std::vector<std::string> (argv + 1, argv + argc), j, error)) {
+        std::cerr << "Error: " << error << '\n';
+        usage (argv[0]);
+    }
+    thread_pool pool;
+    try {
+        run_job (j, pool, nullptr, std::cout, std::cerr);
+    } catch (std::exception const & ex) {
+        // link_error, load_error, format_error, std::system_error.
+        std::cerr << "Error: " << ex.what () << '\n';
+        return EXIT_FAILURE;
     }
 }
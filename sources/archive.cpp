@@ -0,0 +1,261 @@
+#include "archive.hpp"
+
+#include <cstring>
+
+#include "image_view.hpp"
+#include "util.hpp"
+
+namespace {
+
+    constexpr char ar_magic[] = "!<arch>\n";
+    constexpr std::size_t ar_magic_size = sizeof (ar_magic) - 1U;
+    constexpr char ar_fmag[] = "`\n";
+    constexpr char bsd_long_name[] = "#1/"; // followed by the length of the name
+
+    // The header which precedes each archive member. All fields are ASCII, padded with spaces.
+    struct ar_header {
+        char name[16];
+        char date[12];
+        char uid[6];
+        char gid[6];
+        char mode[8];
+        char size[10];
+        char fmag[2];
+    };
+    STATIC_ASSERT (sizeof (ar_header) == 60);
+
+    std::uint64_t parse_decimal (char const * first, std::size_t size) {
+        std::uint64_t result = 0;
+        char const * const last = first + size;
+        for (; first != last && *first != ' '; ++first) {
+            if (*first < '0' || *first > '9') {
+                throw format_error ("bad number in archive member header");
+            }
+            result = result * 10U + static_cast<std::uint64_t> (*first - '0');
+        }
+        return result;
+    }
+
+    struct member {
+        std::string name;
+        array_view<std::uint8_t> contents;
+    };
+
+    /// Reads the member whose header is at \p offset within \p ar.
+    member read_member (array_view<std::uint8_t> ar, std::uint64_t offset) {
+        if (offset > ar.size () || ar.size () - offset < sizeof (ar_header)) {
+            throw format_error ("archive member header is outside the file");
+        }
+        ar_header header;
+        std::memcpy (&header, ar.data () + offset, sizeof (header));
+        if (std::memcmp (header.fmag, ar_fmag, sizeof (header.fmag)) != 0) {
+            throw format_error ("bad archive member header");
+        }
+        std::uint64_t size = parse_decimal (header.size, sizeof (header.size));
+        offset += sizeof (ar_header);
+        if (size > ar.size () - offset) {
+            throw format_error ("archive member is outside the file");
+        }
+
+        member m;
+        if (std::strncmp (header.name, bsd_long_name, sizeof (bsd_long_name) - 1U) == 0) {
+            // A BSD long name: the name occupies the start of the member's data.
+            std::size_t const prefix = sizeof (bsd_long_name) - 1U;
+            std::uint64_t const length =
+                parse_decimal (header.name + prefix, sizeof (header.name) - prefix);
+            if (length > size) {
+                throw format_error ("archive member name is outside the member");
+            }
+            auto const * const name = reinterpret_cast<char const *> (ar.data () + offset);
+            m.name.assign (name, ::strnlen (name, static_cast<std::size_t> (length)));
+            offset += length;
+            size -= length;
+        } else {
+            std::size_t length = sizeof (header.name);
+            while (length > 0U && header.name[length - 1U] == ' ') {
+                --length;
+            }
+            m.name.assign (header.name, length);
+        }
+        m.contents = {ar.data () + offset, static_cast<std::size_t> (size)};
+        return m;
+    }
+
+    template <typename T>
+    T read (std::uint8_t const * p) noexcept {
+        T t;
+        std::memcpy (&t, p, sizeof (t));
+        return t;
+    }
+
+} // end anonymous namespace
+
+// ctor
+// ~~~~
+archive::archive (std::string path, mach_o::cpu_type cputype)
+        : archive (path, std::make_shared<mapped_file> (path.c_str ()), cputype) {}
+
+archive::archive (std::string path, std::shared_ptr<mapped_file const> file,
+                  mach_o::cpu_type cputype)
+        : path_{std::move (path)}
+        , file_{std::move (file)}
+        , cputype_{cputype}
+        , bytes_{file_->data (), file_->size ()} {
+
+    if (universal_view::is_universal (bytes_.data (), bytes_.size ())) {
+        universal_view const fat{bytes_.data (), bytes_.size ()};
+        std::size_t ctr = 0;
+        for (; ctr < fat.size (); ++ctr) {
+            mach_o::fat_arch const arch = fat.arch (ctr);
+            if (arch.cputype == static_cast<std::uint32_t> (cputype)) {
+                if (arch.offset > bytes_.size () || arch.size > bytes_.size () - arch.offset) {
+                    throw format_error ("architecture slice is outside the file");
+                }
+                bytes_ = {bytes_.data () + arch.offset, arch.size};
+                break;
+            }
+        }
+        if (ctr == fat.size ()) {
+            throw format_error ("universal file does not contain the required architecture");
+        }
+    }
+
+    if (bytes_.size () < ar_magic_size ||
+        std::memcmp (bytes_.data (), ar_magic, ar_magic_size) != 0) {
+        throw format_error ("not an archive");
+    }
+    // The symbol table is the first member.
+    member const symdef = read_member (bytes_, ar_magic_size);
+    if (symdef.name == "__.SYMDEF" || symdef.name == "__.SYMDEF SORTED") {
+        this->index_symbols (symdef.contents, false);
+    } else if (symdef.name == "__.SYMDEF_64" || symdef.name == "__.SYMDEF_64 SORTED") {
+        this->index_symbols (symdef.contents, true);
+    } else {
+        throw format_error ("archive has no symbol table (run ranlib)");
+    }
+}
+
+// index symbols
+// ~~~~~~~~~~~~~
+void archive::index_symbols (array_view<std::uint8_t> contents, bool is64) {
+    // The ranlib table is:
+    //     size of the ranlib array in bytes (32 or 64 bits)
+    //     ranlib array: pairs of string table index and member header offset
+    //     size of the string table in bytes
+    //     string table
+    std::size_t const word = is64 ? sizeof (std::uint64_t) : sizeof (std::uint32_t);
+    auto const read_word = [&] (std::uint64_t pos) -> std::uint64_t {
+        if (pos > contents.size () || contents.size () - pos < word) {
+            throw format_error ("archive symbol table is truncated");
+        }
+        return is64 ? read<std::uint64_t> (contents.data () + pos)
+                    : read<std::uint32_t> (contents.data () + pos);
+    };
+
+    std::uint64_t const ranlib_size = read_word (0);
+    // The array must fit between the two size words and hold whole entries. Checking this first
+    // keeps the positions computed from ranlib_size from wrapping.
+    if (contents.size () < 2U * word || ranlib_size > contents.size () - 2U * word) {
+        throw format_error ("archive symbol table is truncated");
+    }
+    if (ranlib_size % (2U * word) != 0U) {
+        throw format_error ("archive symbol table has a partial entry");
+    }
+    std::uint64_t const ranlib_first = word;
+    std::uint64_t const strtab_size = read_word (ranlib_first + ranlib_size);
+    std::uint64_t const strtab_first = ranlib_first + ranlib_size + word;
+    if (strtab_size > contents.size () - strtab_first) {
+        throw format_error ("archive string table is truncated");
+    }
+    auto const * const strtab = reinterpret_cast<char const *> (contents.data () + strtab_first);
+
+    count_ = static_cast<std::size_t> (ranlib_size / (2U * word));
+    std::size_t capacity = 16;
+    while (capacity < count_ * 2U) {
+        capacity *= 2U;
+    }
+    buckets_.assign (capacity, bucket{0, nullptr, 0, 0});
+
+    for (std::size_t ctr = 0; ctr < count_; ++ctr) {
+        std::uint64_t const pos = ranlib_first + ctr * 2U * word;
+        std::uint64_t const strx = read_word (pos);
+        std::uint64_t const offset = read_word (pos + word);
+        if (strx >= strtab_size) {
+            throw format_error ("archive symbol name is outside the string table");
+        }
+        char const * const name = strtab + strx;
+        this->insert (name, ::strnlen (name, static_cast<std::size_t> (strtab_size - strx)),
+                      offset);
+    }
+}
+
+// insert
+// ~~~~~~
+void archive::insert (char const * name, std::size_t length, std::uint64_t offset) {
+    std::uint64_t const hash = hash_string (name, length);
+    std::size_t const mask = buckets_.size () - 1U;
+    for (std::size_t index = hash & mask;; index = (index + 1U) & mask) {
+        bucket & b = buckets_[index];
+        if (b.name == nullptr) {
+            b = bucket{hash, name, narrow_cast<std::uint32_t> (length), offset};
+            return;
+        }
+        if (b.hash == hash && b.length == length && std::memcmp (b.name, name, length) == 0) {
+            return; // The first definition wins, as it does for ld64.
+        }
+    }
+}
+
+// find
+// ~~~~
+std::uint64_t archive::find (char const * name, std::size_t length) const noexcept {
+    if (buckets_.empty ()) {
+        return 0;
+    }
+    std::uint64_t const hash = hash_string (name, length);
+    std::size_t const mask = buckets_.size () - 1U;
+    for (std::size_t index = hash & mask;; index = (index + 1U) & mask) {
+        bucket const & b = buckets_[index];
+        if (b.name == nullptr) {
+            return 0;
+        }
+        if (b.hash == hash && b.length == length && std::memcmp (b.name, name, length) == 0) {
+            return b.offset;
+        }
+    }
+}
+
+// load member for
+// ~~~~~~~~~~~~~~~
+object_file const * archive::load_member_for (char const * name, std::size_t length) {
+    std::uint64_t const offset = this->find (name, length);
+    return offset == 0U ? nullptr : this->load_member (offset);
+}
+
+// load member
+// ~~~~~~~~~~~
+object_file const * archive::load_member (std::uint64_t offset) {
+    {
+        std::lock_guard<std::mutex> const lock{mut_};
+        auto const pos = members_.find (offset);
+        if (pos != members_.end ()) {
+            return pos->second.get ();
+        }
+    }
+    // Parse without holding the lock so that different members can be loaded concurrently.
+    member const m = read_member (bytes_, offset);
+    auto obj = std::make_unique<object_file> (path_ + '(' + m.name + ')', file_, m.contents,
+                                              cputype_);
+
+    std::lock_guard<std::mutex> const lock{mut_};
+    // If another thread loaded the same member in the meantime, its copy is used.
+    auto const res = members_.emplace (offset, std::move (obj));
+    return res.first->second.get ();
+}
+
+// loaded members
+// ~~~~~~~~~~~~~~
+std::size_t archive::loaded_members () const {
+    std::lock_guard<std::mutex> const lock{mut_};
+    return members_.size ();
+}
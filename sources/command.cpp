@@ -1,3 +1,6 @@
 #include "command.hpp"
 
-void command::write_payload (int /*fd*/) {}
+#include "output.hpp"
+
+void command::write_payload (output & /*out*/) {}
+void command::write_digest (output & /*out*/, uuid const & /*digest*/) {}
@@ -0,0 +1,103 @@
+#include "dead_strip.hpp"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "thread_pool.hpp"
+
+// make_atom_graph
+// ~~~~~~~~~~~~~~~
+atom_graph make_atom_graph (std::size_t atoms,
+                            std::vector<std::vector<atom_reference>> const & edges) {
+    // Gather the edges by source atom.
+    atom_graph result;
+    result.start.assign (atoms + 1U, 0U);
+    for (auto const & f : edges) {
+        for (atom_reference const & edge : f) {
+            ++result.start[edge.first + 1U];
+        }
+    }
+    for (std::size_t a = 0; a < atoms; ++a) {
+        result.start[a + 1U] += result.start[a];
+    }
+    result.refs.resize (result.start.back ());
+    std::vector<std::uint32_t> next (std::begin (result.start), std::end (result.start) - 1);
+    for (auto const & f : edges) {
+        for (atom_reference const & edge : f) {
+            result.refs[next[edge.first]++] = edge.second;
+        }
+    }
+    return result;
+}
+
+// mark_live
+// ~~~~~~~~~
+std::vector<std::uint8_t> mark_live (atom_graph const & graph,
+                                     std::vector<std::uint32_t> const & roots, thread_pool & pool) {
+    constexpr auto none = ~std::uint32_t{0};
+    std::size_t const atoms = graph.start.size () - 1U;
+    // Each worker takes atoms from the back of its own queue and, when that is empty, steals
+    // from the front of the others'. pending counts the atoms which have been marked but whose
+    // references have not yet been followed: once it reaches zero, the work is done.
+    struct queue {
+        std::mutex mut;
+        std::deque<std::uint32_t> atoms;
+    };
+    std::size_t const workers = pool.size () + 1U;
+    auto queues = std::make_unique<queue[]> (workers);
+    auto live = std::make_unique<std::atomic<bool>[]> (atoms);
+    std::atomic<std::size_t> pending{0};
+
+    auto const mark = [&] (std::uint32_t a, queue & q) {
+        if (!live[a].exchange (true, std::memory_order_relaxed)) {
+            pending.fetch_add (1U, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> const lock{q.mut};
+            q.atoms.push_back (a);
+        }
+    };
+    for (std::size_t ctr = 0; ctr < roots.size (); ++ctr) {
+        mark (roots[ctr], queues[ctr % workers]);
+    }
+
+    pool.parallel_for (workers, [&] (std::size_t w) {
+        for (;;) {
+            std::uint32_t a = none;
+            {
+                queue & own = queues[w];
+                std::lock_guard<std::mutex> const lock{own.mut};
+                if (!own.atoms.empty ()) {
+                    a = own.atoms.back ();
+                    own.atoms.pop_back ();
+                }
+            }
+            for (std::size_t ctr = 1; a == none && ctr < workers; ++ctr) {
+                queue & victim = queues[(w + ctr) % workers];
+                std::lock_guard<std::mutex> const lock{victim.mut};
+                if (!victim.atoms.empty ()) {
+                    a = victim.atoms.front ();
+                    victim.atoms.pop_front ();
+                }
+            }
+            if (a == none) {
+                if (pending.load (std::memory_order_acquire) == 0U) {
+                    return;
+                }
+                std::this_thread::yield ();
+                continue;
+            }
+            for (std::uint32_t ref = graph.start[a]; ref < graph.start[a + 1U]; ++ref) {
+                mark (graph.refs[ref], queues[w]);
+            }
+            pending.fetch_sub (1U, std::memory_order_acq_rel);
+        }
+    });
+
+    std::vector<std::uint8_t> result (atoms);
+    for (std::size_t a = 0; a < atoms; ++a) {
+        result[a] = live[a].load (std::memory_order_relaxed) ? 1U : 0U;
+    }
+    return result;
+}
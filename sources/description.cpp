@@ -0,0 +1,771 @@
+#include "description.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "image_builder.hpp"
+#include "mach-o.hpp"
+#include "mapped_file.hpp"
+#include "target.hpp"
+#include "util.hpp"
+#include "version.hpp"
+
+namespace {
+
+    bool is_space (char c) noexcept { return c == ' ' || c == '\t' || c == '\r'; }
+
+    /// A run of non-space characters within a line.
+    struct token {
+        char const * first;
+        char const * last;
+
+        bool empty () const noexcept { return first == last; }
+        std::size_t size () const noexcept { return static_cast<std::size_t> (last - first); }
+        bool operator== (char const * s) const noexcept {
+            return std::strlen (s) == this->size () && std::strncmp (first, s, this->size ()) == 0;
+        }
+        bool operator!= (char const * s) const noexcept { return !operator== (s); }
+    };
+
+    /// \returns The value of the hexadecimal digit \p c or a value greater than 0xF if \p c is
+    ///   not a hexadecimal digit.
+    unsigned hex_digit (char c) noexcept {
+        if (c >= '0' && c <= '9') {
+            return static_cast<unsigned> (c - '0');
+        }
+        // Setting bit 5 maps upper case letters to lower case.
+        auto const lower = static_cast<unsigned> (static_cast<unsigned char> (c) | 0x20U);
+        return lower >= 'a' && lower <= 'f' ? lower - 'a' + 10U : 0x10U;
+    }
+
+    struct flag_name {
+        char const * name;
+        std::uint32_t value;
+    };
+
+    constexpr std::array<flag_name, 15> section_types{{
+        {"regular", mach_o::s_regular},
+        {"zerofill", mach_o::s_zerofill},
+        {"cstring_literals", mach_o::s_cstring_literals},
+        {"4byte_literals", mach_o::s_4byte_literals},
+        {"8byte_literals", mach_o::s_8byte_literals},
+        {"16byte_literals", mach_o::s_16byte_literals},
+        {"literal_pointers", mach_o::s_literal_pointers},
+        {"non_lazy_symbol_pointers", mach_o::s_non_lazy_symbol_pointers},
+        {"mod_init_func_pointers", mach_o::s_mod_init_func_pointers},
+        {"mod_term_func_pointers", mach_o::s_mod_term_func_pointers},
+        {"coalesced", mach_o::s_coalesced},
+        {"gb_zerofill", mach_o::s_gb_zerofill},
+        {"thread_local_regular", mach_o::s_thread_local_regular},
+        {"thread_local_zerofill", mach_o::s_thread_local_zerofill},
+        {"thread_local_variables", mach_o::s_thread_local_variables},
+    }};
+
+    constexpr std::array<flag_name, 6> section_attributes{{
+        {"pure_instructions", mach_o::s_attr_pure_instructions},
+        {"some_instructions", mach_o::s_attr_some_instructions},
+        {"no_toc", mach_o::s_attr_no_toc},
+        {"strip_static_syms", mach_o::s_attr_strip_static_syms},
+        {"no_dead_strip", mach_o::s_attr_no_dead_strip},
+        {"live_support", mach_o::s_attr_live_support},
+    }};
+
+    constexpr std::array<flag_name, 5> data_in_code_kinds{{
+        {"data", mach_o::dice_kind_data},
+        {"jump_table8", mach_o::dice_kind_jump_table8},
+        {"jump_table16", mach_o::dice_kind_jump_table16},
+        {"jump_table32", mach_o::dice_kind_jump_table32},
+        {"abs_jump_table32", mach_o::dice_kind_abs_jump_table32},
+    }};
+
+    template <std::size_t Size>
+    flag_name const * find_flag (std::array<flag_name, Size> const & names, token const & t) {
+        auto const pos = std::find_if (std::begin (names), std::end (names),
+                                       [&t] (flag_name const & f) { return t == f.name; });
+        return pos != std::end (names) ? &*pos : nullptr;
+    }
+
+    bool is_zerofill_type (std::uint32_t flags) noexcept {
+        switch (flags & mach_o::section_type) {
+        case mach_o::s_zerofill:
+        case mach_o::s_gb_zerofill:
+        case mach_o::s_thread_local_zerofill: return true;
+        default: return false;
+        }
+    }
+
+    /// \returns \p a + \p b or, if the sum is not representable, the largest std::uint64_t.
+    std::uint64_t saturating_add (std::uint64_t a, std::uint64_t b) noexcept {
+        return b > type_max<std::uint64_t> () - a ? type_max<std::uint64_t> () : a + b;
+    }
+    /// \returns \p v rounded up to a multiple of \p align, saturating as saturating_add().
+    std::uint64_t saturating_aligned (std::uint64_t v, unsigned align) noexcept {
+        return saturating_add (v, align - 1U) & ~std::uint64_t{align - 1U};
+    }
+
+    /// A segment or section name: at most 16 characters and NUL-terminated.
+    using name_buffer = std::array<char, 17>;
+
+    /// Builds an image from the lines of a description.
+    class parser {
+    public:
+        parser (std::string const & name, char const * arch, image_builder & builder)
+                : name_{name}
+                , arch_{arch}
+                , builder_{builder} {}
+
+        void line (unsigned line_number, char const * first, char const * last);
+        void finish ();
+
+    private:
+        [[noreturn]] void error (std::string const & message) const;
+
+        /// \returns The next token of the current line (which is empty at the end of the line).
+        token next ();
+        /// \returns The next token of the current line which must not be empty.
+        token expect (char const * what);
+        /// Checks that the current line has no more tokens.
+        void end_of_line ();
+        /// \returns The remainder of the current line.
+        token rest ();
+
+        std::uint64_t number (token const & t, std::uint64_t max = type_max<std::uint64_t> ());
+        std::uint32_t parse_version (token const & t);
+        name_buffer parse_name (token const & t);
+        mach_o::vm_prot_t parse_prot (token const & t);
+
+        void page_zero ();
+        void segment ();
+        void section ();
+        void hex ();
+        void fill ();
+        void file ();
+        void zerofill ();
+        void data_in_code ();
+        void entry ();
+        void build_version ();
+        void uuid ();
+
+        /// Adds the section whose contents are being gathered, if any, to the builder.
+        void flush_section ();
+        /// Checks that contents may be added to the current section. \p mapped is true for the
+        /// contents of a file which cannot be combined with any others.
+        void check_contents (bool mapped);
+        /// Checks that no two segments occupy the same addresses.
+        void check_overlap ();
+
+        std::string const & name_;
+        char const * const arch_;
+        image_builder & builder_;
+
+        unsigned line_number_ = 0;
+        char const * pos_ = nullptr;
+        char const * end_ = nullptr;
+
+        /// A segment that has been added and the names of its sections.
+        struct segment_names {
+            name_buffer name;
+            unsigned line;
+            std::uint64_t vmaddr; ///< The segment's address or image_builder::follow
+            /// A lower bound for the number of bytes that the segment's contents occupy.
+            std::uint64_t size;
+            bool has_zerofill;
+            /// Maps a section name to the index of the section within the segment.
+            std::unordered_map<std::string, std::size_t> sections;
+        };
+        std::vector<segment_names> segments_;
+
+        // The section whose contents are being gathered.
+        bool has_section_ = false;
+        name_buffer section_name_{};
+        std::uint32_t section_align_ = 0;
+        std::uint32_t section_flags_ = 0;
+        std::vector<std::uint8_t> bytes_;
+        std::shared_ptr<mapped_file> mapped_;
+        std::uint64_t zerofill_size_ = 0;
+        /// The data-in-code ranges of the current section.
+        struct data_in_code_range {
+            unsigned line;
+            std::uint32_t offset;
+            std::uint32_t length;
+            std::uint16_t kind;
+        };
+        std::vector<data_in_code_range> data_in_code_;
+
+        bool has_entry_ = false;
+        unsigned entry_line_ = 0;
+        name_buffer entry_segment_{};
+        name_buffer entry_section_{};
+        std::uint64_t entry_offset_ = 0;
+    };
+
+    // error
+    // ~~~~~
+    void parser::error (std::string const & message) const {
+        throw description_error (name_ + ':' + std::to_string (line_number_) + ": " + message);
+    }
+
+    // next
+    // ~~~~
+    token parser::next () {
+        char const * const first = std::find_if_not (pos_, end_, is_space);
+        pos_ = std::find_if (first, end_, is_space);
+        return {first, pos_};
+    }
+
+    // expect
+    // ~~~~~~
+    token parser::expect (char const * what) {
+        token const t = this->next ();
+        if (t.empty ()) {
+            this->error (std::string{"expected "} + what);
+        }
+        return t;
+    }
+
+    // end_of_line
+    // ~~~~~~~~~~~
+    void parser::end_of_line () {
+        token const t = this->next ();
+        if (!t.empty ()) {
+            this->error ("unexpected '" + std::string{t.first, t.last} + '\'');
+        }
+    }
+
+    // rest
+    // ~~~~
+    token parser::rest () {
+        token const t{std::find_if_not (pos_, end_, is_space), end_};
+        pos_ = end_;
+        return t;
+    }
+
+    // number
+    // ~~~~~~
+    std::uint64_t parser::number (token const & t, std::uint64_t max) {
+        char const * p = t.first;
+        unsigned base = 10;
+        if (t.size () > 2U && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+            base = 16;
+            p += 2;
+        }
+        std::uint64_t result = 0;
+        for (; p < t.last; ++p) {
+            unsigned const digit = hex_digit (*p);
+            if (digit >= base) {
+                this->error ("bad number '" + std::string{t.first, t.last} + '\'');
+            }
+            if (result > (max - digit) / base) {
+                this->error ("number '" + std::string{t.first, t.last} + "' is too large");
+            }
+            result = result * base + digit;
+        }
+        return result;
+    }
+
+    // parse_version
+    // ~~~~~~~~~~~~~
+    std::uint32_t parser::parse_version (token const & t) {
+        // X[.Y[.Z]]
+        std::array<std::uint64_t, 3> parts{{0, 0, 0}};
+        std::array<std::uint64_t, 3> const limits{{0xFFFF, 0xFF, 0xFF}};
+        char const * first = t.first;
+        for (std::size_t ctr = 0; ctr < parts.size (); ++ctr) {
+            char const * const dot = std::find (first, t.last, '.');
+            if (dot == first || (dot != t.last && ctr == parts.size () - 1U)) {
+                this->error ("bad version '" + std::string{t.first, t.last} + '\'');
+            }
+            parts[ctr] = this->number ({first, dot}, limits[ctr]);
+            if (dot == t.last) {
+                break;
+            }
+            first = dot + 1;
+        }
+        return version (static_cast<std::uint16_t> (parts[0]), static_cast<std::uint8_t> (parts[1]),
+                        static_cast<std::uint8_t> (parts[2]));
+    }
+
+    // parse_name
+    // ~~~~~~~~~~
+    name_buffer parser::parse_name (token const & t) {
+        name_buffer result{};
+        if (t.size () >= result.size ()) {
+            this->error ("name '" + std::string{t.first, t.last} +
+                         "' is longer than 16 characters");
+        }
+        std::copy (t.first, t.last, result.data ());
+        return result;
+    }
+
+    // parse_prot
+    // ~~~~~~~~~~
+    mach_o::vm_prot_t parser::parse_prot (token const & t) {
+        mach_o::vm_prot_t prot = mach_o::vm_prot_none;
+        for (char const * p = t.first; p < t.last; ++p) {
+            switch (*p) {
+            case 'r': prot |= mach_o::vm_prot_read; break;
+            case 'w': prot |= mach_o::vm_prot_write; break;
+            case 'x': prot |= mach_o::vm_prot_execute; break;
+            case '-': break;
+            default: this->error ("bad protection '" + std::string{t.first, t.last} + '\'');
+            }
+        }
+        return prot;
+    }
+
+    // line
+    // ~~~~
+    void parser::line (unsigned line_number, char const * first, char const * last) {
+        line_number_ = line_number;
+        pos_ = first;
+        end_ = last;
+
+        token directive = this->next ();
+        // A line may be restricted to one architecture by an "arch:" prefix.
+        if (directive.last[-1] == ':') {
+            token const arch{directive.first, directive.last - 1};
+            if (arch != x86_64_target::name () && arch != arm64_target::name ()) {
+                this->error ("unknown architecture '" + std::string{arch.first, arch.last} +
+                             '\'');
+            }
+            if (arch != arch_) {
+                return;
+            }
+            directive = this->expect ("a directive");
+        }
+
+        if (directive == "hex") {
+            this->hex ();
+            return;
+        }
+        if (directive == "fill") {
+            this->fill ();
+            return;
+        }
+        if (directive == "file") {
+            this->file ();
+            return;
+        }
+        if (directive == "zerofill") {
+            this->zerofill ();
+            return;
+        }
+        if (directive == "data_in_code") {
+            this->data_in_code ();
+            return;
+        }
+
+        // Any other directive ends the contents of the current section.
+        this->flush_section ();
+        if (directive == "page_zero") {
+            this->page_zero ();
+        } else if (directive == "segment") {
+            this->segment ();
+        } else if (directive == "section") {
+            this->section ();
+        } else if (directive == "dylib") {
+            token const path = this->rest ();
+            if (path.empty ()) {
+                this->error ("expected a path");
+            }
+            builder_.add_dylib ({path.first, path.last});
+        } else if (directive == "entry") {
+            this->entry ();
+        } else if (directive == "build_version") {
+            this->build_version ();
+        } else if (directive == "uuid") {
+            this->uuid ();
+        } else {
+            this->error ("unknown directive '" + std::string{directive.first, directive.last} +
+                         '\'');
+        }
+    }
+
+    // page_zero
+    // ~~~~~~~~~
+    void parser::page_zero () {
+        if (!segments_.empty ()) {
+            this->error ("page_zero must be the first segment");
+        }
+        token const size = this->next ();
+        std::uint64_t const vmsize =
+            size.empty () ? std::uint64_t{1} << 32 : this->number (size);
+        builder_.add_page_zero (vmsize);
+        this->end_of_line ();
+        segments_.push_back ({name_buffer{}, line_number_, 0U, vmsize, false, {}});
+        std::strncpy (segments_.back ().name.data (), mach_o::seg_pagezero, 16);
+    }
+
+    // segment
+    // ~~~~~~~
+    void parser::segment () {
+        name_buffer const name = this->parse_name (this->expect ("a segment name"));
+        token const address = this->expect ("an address");
+        std::uint64_t vmaddr = image_builder::follow;
+        if (address != "follow") {
+            vmaddr = this->number (address);
+        } else if (segments_.empty ()) {
+            this->error ("the first segment cannot follow another");
+        }
+        mach_o::vm_prot_t const initprot = this->parse_prot (this->expect ("a protection"));
+        token const max = this->next ();
+        mach_o::vm_prot_t const maxprot =
+            max.empty () ? mach_o::vm_prot_all : this->parse_prot (max);
+        this->end_of_line ();
+        auto const pos = std::find_if (
+            std::begin (segments_), std::end (segments_),
+            [&name] (segment_names const & s) { return s.name == name; });
+        if (pos != std::end (segments_)) {
+            this->error ("segment " + std::string{name.data ()} + " is defined more than once");
+        }
+        builder_.add_segment (name.data (), vmaddr, maxprot, initprot);
+        // The __TEXT segment also maps the image's header. The size of the load commands is not
+        // known until the image is built so the header is counted as the mach_header alone.
+        std::uint64_t const size = std::strncmp (name.data (), mach_o::seg_text, 16) == 0
+                                       ? sizeof (mach_o::mach_header_64)
+                                       : 0U;
+        segments_.push_back ({name, line_number_, vmaddr, size, false, {}});
+    }
+
+    // section
+    // ~~~~~~~
+    void parser::section () {
+        if (segments_.empty () ||
+            std::strncmp (segments_.back ().name.data (), mach_o::seg_pagezero, 16) == 0) {
+            this->error ("a section must follow a segment");
+        }
+        segment_names & segment = segments_.back ();
+        section_name_ = this->parse_name (this->expect ("a section name"));
+        section_align_ =
+            static_cast<std::uint32_t> (this->number (this->expect ("an alignment"), 15));
+        section_flags_ = mach_o::s_regular;
+        bool has_type = false;
+        for (token t = this->next (); !t.empty (); t = this->next ()) {
+            if (flag_name const * const type = find_flag (section_types, t)) {
+                if (has_type) {
+                    this->error ("a section has only one type");
+                }
+                has_type = true;
+                section_flags_ |= type->value;
+            } else if (flag_name const * const attr = find_flag (section_attributes, t)) {
+                section_flags_ |= attr->value;
+            } else {
+                this->error ("unknown section type or attribute '" + std::string{t.first, t.last} +
+                             '\'');
+            }
+        }
+        // Zero-fill sections take no space in the file so they must come after all of the
+        // segment's other sections.
+        if (is_zerofill_type (section_flags_)) {
+            segment.has_zerofill = true;
+        } else if (segment.has_zerofill) {
+            this->error ("section " + std::string{section_name_.data ()} +
+                         " has contents so it cannot follow a zero-fill section");
+        }
+        if (!segment.sections.emplace (section_name_.data (), segment.sections.size ()).second) {
+            this->error ("section " + std::string{section_name_.data ()} +
+                         " is defined more than once in segment " + segment.name.data ());
+        }
+        has_section_ = true;
+        bytes_.clear ();
+        mapped_.reset ();
+        zerofill_size_ = 0;
+        data_in_code_.clear ();
+    }
+
+    // check_contents
+    // ~~~~~~~~~~~~~~
+    void parser::check_contents (bool mapped) {
+        if (!has_section_) {
+            this->error ("contents must follow a section");
+        }
+        if (is_zerofill_type (section_flags_)) {
+            this->error ("a zero-fill section has no contents");
+        }
+        if (mapped_ || zerofill_size_ != 0U || (mapped && !bytes_.empty ())) {
+            this->error ("file and zerofill cannot be combined with other contents");
+        }
+    }
+
+    // hex
+    // ~~~
+    void parser::hex () {
+        this->check_contents (false);
+        // Digits may be separated by white space but each pair makes a byte. The bytes are
+        // decoded in place: a line cannot hold more than half its length. (Growing with
+        // resize() rather than reserve() keeps the vector's geometric growth across lines.)
+        std::size_t const size = bytes_.size ();
+        bytes_.resize (size + static_cast<std::size_t> (end_ - pos_) / 2U);
+        std::uint8_t * out = bytes_.data () + size;
+        unsigned digits = 0;
+        unsigned value = 0;
+        for (char const * p = pos_; p < end_; ++p) {
+            char const c = *p;
+            if (is_space (c)) {
+                continue;
+            }
+            unsigned const v = hex_digit (c);
+            if (v > 0xFU) {
+                this->error (std::string{"bad hex digit '"} + c + '\'');
+            }
+            value = (value << 4) | v;
+            if ((++digits & 1U) == 0U) {
+                *(out++) = static_cast<std::uint8_t> (value);
+                value = 0;
+            }
+        }
+        if ((digits & 1U) != 0U) {
+            this->error ("odd number of hex digits");
+        }
+        bytes_.resize (static_cast<std::size_t> (out - bytes_.data ()));
+        pos_ = end_;
+    }
+
+    // fill
+    // ~~~~
+    void parser::fill () {
+        this->check_contents (false);
+        std::uint64_t const size =
+            this->number (this->expect ("a size"), type_max<std::uint32_t> ());
+        token const byte = this->next ();
+        auto const value =
+            static_cast<std::uint8_t> (byte.empty () ? 0U : this->number (byte, 0xFF));
+        this->end_of_line ();
+        bytes_.insert (std::end (bytes_), static_cast<std::size_t> (size), value);
+    }
+
+    // file
+    // ~~~~
+    void parser::file () {
+        this->check_contents (true);
+        token const path = this->rest ();
+        if (path.empty ()) {
+            this->error ("expected a path");
+        }
+        try {
+            mapped_ = std::make_shared<mapped_file> (std::string{path.first, path.last}.c_str ());
+        } catch (std::system_error const & ex) {
+            this->error (std::string{path.first, path.last} + ": " + ex.what ());
+        }
+    }
+
+    // zerofill
+    // ~~~~~~~~
+    void parser::zerofill () {
+        if (!has_section_) {
+            this->error ("contents must follow a section");
+        }
+        if (!is_zerofill_type (section_flags_)) {
+            this->error ("only a zero-fill section can have a zerofill size");
+        }
+        zerofill_size_ = this->number (this->expect ("a size"));
+        this->end_of_line ();
+    }
+
+    // data_in_code
+    // ~~~~~~~~~~~~
+    void parser::data_in_code () {
+        if (!has_section_) {
+            this->error ("data_in_code must follow a section");
+        }
+        if (is_zerofill_type (section_flags_)) {
+            this->error ("a zero-fill section has no contents");
+        }
+        auto const offset =
+            static_cast<std::uint32_t> (this->number (this->expect ("an offset"), 0xFFFFFFFF));
+        auto const length =
+            static_cast<std::uint32_t> (this->number (this->expect ("a length"), 0xFFFFFFFF));
+        token const kind = this->expect ("a kind");
+        flag_name const * const k = find_flag (data_in_code_kinds, kind);
+        if (k == nullptr) {
+            this->error ("unknown data-in-code kind '" + std::string{kind.first, kind.last} + '\'');
+        }
+        this->end_of_line ();
+        // The section's contents may not be complete: the range is checked when it is.
+        data_in_code_.push_back (
+            {line_number_, offset, length, static_cast<std::uint16_t> (k->value)});
+    }
+
+    // flush_section
+    // ~~~~~~~~~~~~~
+    void parser::flush_section () {
+        if (!has_section_) {
+            return;
+        }
+        has_section_ = false;
+        std::size_t const segment = segments_.size () - 1U;
+        std::uint64_t const size = mapped_ ? mapped_->size ()
+                                   : is_zerofill_type (section_flags_) ? zerofill_size_
+                                                                       : bytes_.size ();
+        std::uint64_t & extent = segments_.back ().size;
+        extent = saturating_add (saturating_aligned (extent, 1U << section_align_), size);
+        if (mapped_) {
+            builder_.add_section (segment, section_name_.data (), section_align_, section_flags_,
+                                  lc_segment::contents_range{
+                                      mapped_->data (), mapped_->data () + mapped_->size ()});
+            builder_.retain (std::move (mapped_));
+        } else if (is_zerofill_type (section_flags_)) {
+            builder_.add_section (segment, section_name_.data (), section_align_, section_flags_,
+                                  lc_segment::contents_range{nullptr, nullptr}, zerofill_size_);
+        } else {
+            // The contents are moved to the builder: bytes_ starts again with no capacity.
+            builder_.add_section (segment, section_name_.data (), section_align_, section_flags_,
+                                  std::move (bytes_));
+            bytes_.clear ();
+        }
+        std::size_t const section = segments_.back ().sections.size () - 1U;
+        for (data_in_code_range const & r : data_in_code_) {
+            if (std::uint64_t{r.offset} + r.length > size) {
+                line_number_ = r.line;
+                this->error ("data-in-code range is outside section " +
+                             std::string{section_name_.data ()});
+            }
+            builder_.add_data_in_code (segment, section, r.offset, r.length, r.kind);
+        }
+        data_in_code_.clear ();
+    }
+
+    // entry
+    // ~~~~~
+    void parser::entry () {
+        entry_segment_ = this->parse_name (this->expect ("a segment name"));
+        entry_section_ = this->parse_name (this->expect ("a section name"));
+        token const offset = this->next ();
+        entry_offset_ = offset.empty () ? 0U : this->number (offset);
+        this->end_of_line ();
+        has_entry_ = true;
+        entry_line_ = line_number_;
+    }
+
+    // build_version
+    // ~~~~~~~~~~~~~
+    void parser::build_version () {
+        token const platform = this->expect ("a platform");
+        if (platform == "off") {
+            builder_.emit_build_version (false);
+        } else {
+            std::uint32_t const p = platform == "macos"
+                                        ? mach_o::platform_macos
+                                        : static_cast<std::uint32_t> (this->number (
+                                              platform, type_max<std::uint32_t> ()));
+            std::uint32_t const minos = this->parse_version (this->expect ("a minimum OS version"));
+            std::uint32_t const sdk = this->parse_version (this->expect ("an SDK version"));
+            builder_.set_build_version (p, minos, sdk);
+            builder_.emit_build_version (true);
+        }
+        this->end_of_line ();
+    }
+
+    // uuid
+    // ~~~~
+    void parser::uuid () {
+        token const t = this->expect ("on or off");
+        if (t != "on" && t != "off") {
+            this->error ("expected on or off");
+        }
+        builder_.emit_uuid (t == "on");
+        this->end_of_line ();
+    }
+
+    // check_overlap
+    // ~~~~~~~~~~~~~
+    void parser::check_overlap () {
+        auto const page_size = static_cast<unsigned> (builder_.page_size ());
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> extents;
+        extents.reserve (segments_.size ());
+        for (segment_names const & segment : segments_) {
+            // A following segment starts at the page after its predecessor, so it cannot
+            // overlap that segment. Its end is needed to place any segment after it.
+            std::uint64_t const first =
+                segment.vmaddr != image_builder::follow
+                    ? segment.vmaddr
+                    : saturating_aligned (extents.back ().second, page_size);
+            std::uint64_t const last =
+                saturating_add (first, saturating_aligned (segment.size, page_size));
+            if (first < last) {
+                for (std::size_t ctr = 0; ctr < extents.size (); ++ctr) {
+                    if (first < extents[ctr].second && extents[ctr].first < last) {
+                        line_number_ = segment.line;
+                        this->error ("segment " + std::string{segment.name.data ()} +
+                                     " overlaps segment " + segments_[ctr].name.data ());
+                    }
+                }
+            }
+            extents.emplace_back (first, last);
+        }
+    }
+
+    // finish
+    // ~~~~~~
+    void parser::finish () {
+        this->flush_section ();
+        this->check_overlap ();
+        if (!has_entry_) {
+            return;
+        }
+        line_number_ = entry_line_;
+        auto const seg = std::find_if (
+            std::begin (segments_), std::end (segments_),
+            [this] (segment_names const & s) { return s.name == entry_segment_; });
+        if (seg == std::end (segments_)) {
+            this->error ("entry segment " + std::string{entry_segment_.data ()} +
+                         " is not defined");
+        }
+        auto const sect = seg->sections.find (entry_section_.data ());
+        if (sect == std::end (seg->sections)) {
+            this->error ("entry section " + std::string{entry_section_.data ()} +
+                         " is not defined");
+        }
+        builder_.set_entry_point (static_cast<std::size_t> (seg - std::begin (segments_)),
+                                  sect->second, entry_offset_);
+    }
+
+} // end anonymous namespace
+
+// parse_description
+// ~~~~~~~~~~~~~~~~~
+void parse_description (char const * first, char const * last, std::string const & name,
+                        char const * arch, image_builder & builder) {
+    parser p{name, arch, builder};
+    unsigned line_number = 0;
+    // memchr() is used to find the ends of lines and comments: it is much faster than a loop.
+    auto const find = [] (char const * f, char const * l, char c) {
+        auto const * const pos = std::memchr (f, c, static_cast<std::size_t> (l - f));
+        return pos != nullptr ? static_cast<char const *> (pos) : l;
+    };
+    for (char const * line = first; line < last;) {
+        ++line_number;
+        char const * end = find (line, last, '\n');
+        char const * const next = end == last ? last : end + 1;
+        end = find (line, end, '#');
+        while (line < end && is_space (*line)) {
+            ++line;
+        }
+        while (end > line && is_space (end[-1])) {
+            --end;
+        }
+        if (line < end) {
+            p.line (line_number, line, end);
+        }
+        line = next;
+    }
+    p.finish ();
+}
+
+// read_description
+// ~~~~~~~~~~~~~~~~
+void read_description (std::string const & path, char const * arch, image_builder & builder) {
+    std::unique_ptr<mapped_file> file;
+    try {
+        file = std::make_unique<mapped_file> (path.c_str ());
+    } catch (std::system_error const & ex) {
+        throw description_error (path + ": " + ex.what ());
+    }
+    auto const * const first = reinterpret_cast<char const *> (file->data ());
+    parse_description (first, first + file->size (), path, arch, builder);
+}
@@ -0,0 +1,237 @@
+#include "file_writer.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#    define NOMINMAX
+#    define WIN32_LEAN_AND_MEAN
+#    include <Windows.h>
+#    include <io.h>
+#    include <process.h>
+#else
+#    include <unistd.h>
+#endif
+
+#include "incremental.hpp"
+#include "instrumentation.hpp"
+#include "output.hpp"
+#include "util.hpp"
+
+namespace {
+
+    /// A file which is written under a temporary name in the same directory as \p path and
+    /// which replaces the file at \p path only when it is committed. An output which cannot be
+    /// produced (because the link fails, say) is removed, leaving any previous file alone.
+    class temporary_file {
+    public:
+        explicit temporary_file (std::string const & path);
+        temporary_file (temporary_file const &) = delete;
+        temporary_file & operator= (temporary_file const &) = delete;
+        ~temporary_file () noexcept;
+
+        int fd () const noexcept { return fd_; }
+        /// Closes the file and renames it to the path given to the constructor.
+        void commit ();
+
+    private:
+        void close () noexcept;
+
+        std::string path_;
+        std::string temp_path_;
+        int fd_ = -1;
+    };
+
+    // ctor
+    // ~~~~
+    temporary_file::temporary_file (std::string const & path)
+            : path_{path} {
+        static std::atomic<unsigned> counter{0};
+#ifdef _WIN32
+        int const pid = _getpid ();
+#else
+        int const pid = ::getpid ();
+#endif
+        for (;;) {
+            temp_path_ = path + ".tmp." + std::to_string (pid) + '.' +
+                         std::to_string (counter.fetch_add (1U, std::memory_order_relaxed));
+#ifdef _WIN32
+            fd_ = _open (temp_path_.c_str (), O_RDWR | O_CREAT | O_EXCL | O_BINARY,
+                         _S_IREAD | _S_IWRITE);
+#else
+            fd_ = ::open (temp_path_.c_str (), O_RDWR | O_CREAT | O_EXCL,
+                          S_IRWXU | S_IRWXG | S_IRWXO);
+#endif
+            count_syscalls ();
+            if (fd_ != -1) {
+                return;
+            }
+            if (errno != EEXIST) {
+                throw std::system_error (errno, std::generic_category (), "open");
+            }
+        }
+    }
+
+    // dtor
+    // ~~~~
+    temporary_file::~temporary_file () noexcept {
+        if (fd_ != -1) {
+            this->close ();
+            std::remove (temp_path_.c_str ());
+            count_syscalls ();
+        }
+    }
+
+    // close
+    // ~~~~~
+    void temporary_file::close () noexcept {
+        ::close (fd_);
+        count_syscalls ();
+        fd_ = -1;
+    }
+
+    // commit
+    // ~~~~~~
+    void temporary_file::commit () {
+        this->close ();
+        count_syscalls ();
+#ifdef _WIN32
+        if (!::MoveFileExA (temp_path_.c_str (), path_.c_str (), MOVEFILE_REPLACE_EXISTING)) {
+            auto const error = static_cast<int> (::GetLastError ());
+            std::remove (temp_path_.c_str ());
+            throw std::system_error (error, std::system_category (), "MoveFileEx");
+        }
+#else
+        if (std::rename (temp_path_.c_str (), path_.c_str ()) != 0) {
+            int const error = errno;
+            std::remove (temp_path_.c_str ());
+            throw std::system_error (error, std::generic_category (), "rename");
+        }
+#endif
+    }
+
+} // end anonymous namespace
+
+// open_output
+// ~~~~~~~~~~~
+int open_output (std::string const & path, bool truncate) {
+    int const trunc = truncate ? O_TRUNC : 0;
+#ifdef _WIN32
+    int const fd = _open (path.c_str (), O_RDWR | O_CREAT | trunc | O_BINARY);
+#else
+    int const fd = open (path.c_str (), O_RDWR | O_CREAT | trunc, S_IRWXU | S_IRWXG | S_IRWXO);
+#endif
+    count_syscalls ();
+    if (fd == -1) {
+        throw std::system_error (errno, std::generic_category (), "open");
+    }
+    return fd;
+}
+
+// write_image_file
+// ~~~~~~~~~~~~~~~~
+void write_image_file (std::string const & path, std::vector<slice> const & slices,
+                       bool incremental) {
+    if (slices.size () != 1U) {
+        temporary_file file{path};
+        write_universal (file.fd (), slices);
+        file.commit ();
+        return;
+    }
+    // The image is built before the output is opened so that a link which fails leaves the
+    // previous output intact.
+    image img = build_image (slices.front ());
+    if (incremental) {
+        // An incremental link overwrites only the parts of the previous output which have
+        // changed so the file must not be truncated when it is opened.
+        int const fd = open_output (path, false);
+        auto const scope = make_scope_guard ([fd] () {
+            ::close (fd);
+            count_syscalls ();
+        });
+        std::string const state_path = path + ".incremental";
+        incremental_output out{fd, incremental_state::load (state_path, fd)};
+        out.finish (img.write (out));
+        out.state ().save (state_path, fd);
+        return;
+    }
+    temporary_file file{path};
+    file_output out{file.fd (), 0};
+    extend_file (file.fd (), img.write (out));
+    file.commit ();
+}
+
+// ctor
+// ~~~~
+file_writer::file_writer ()
+        : thread_{[this] () { this->run (); }} {}
+
+// dtor
+// ~~~~
+file_writer::~file_writer () noexcept {
+    {
+        std::lock_guard<std::mutex> const lock{mut_};
+        done_ = true;
+    }
+    cv_.notify_all ();
+    thread_.join ();
+}
+
+// submit
+// ~~~~~~
+void file_writer::submit (std::string const & path, std::vector<std::uint8_t> & bytes) {
+    std::unique_lock<std::mutex> lock{mut_};
+    cv_.wait (lock, [this] () { return !busy_; });
+    path_ = path;
+    bytes_.swap (bytes);
+    busy_ = true;
+    cv_.notify_all ();
+}
+
+// wait
+// ~~~~
+void file_writer::wait () {
+    std::unique_lock<std::mutex> lock{mut_};
+    cv_.wait (lock, [this] () { return !busy_; });
+}
+
+// errors
+// ~~~~~~
+std::vector<std::string> file_writer::errors () {
+    std::lock_guard<std::mutex> const lock{mut_};
+    return errors_;
+}
+
+// run
+// ~~~
+void file_writer::run () {
+    std::unique_lock<std::mutex> lock{mut_};
+    for (;;) {
+        cv_.wait (lock, [this] () { return busy_ || done_; });
+        if (!busy_) {
+            return;
+        }
+        // path_ and bytes_ belong to this thread until busy_ is cleared.
+        lock.unlock ();
+        std::string error;
+        try {
+            temporary_file file{path_};
+            file_output out{file.fd (), 0};
+            out.write (bytes_.data (), bytes_.size ());
+            file.commit ();
+        } catch (std::exception const & ex) {
+            error = path_ + ": " + ex.what ();
+        }
+        lock.lock ();
+        if (!error.empty ()) {
+            errors_.push_back (std::move (error));
+        }
+        busy_ = false;
+        cv_.notify_all ();
+    }
+}
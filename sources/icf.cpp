@@ -0,0 +1,150 @@
+#include "icf.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+#include "thread_pool.hpp"
+#include "util.hpp"
+
+namespace {
+
+    constexpr auto none = icf_target::none;
+
+    std::uint64_t mix (std::uint64_t h, std::uint64_t v) noexcept {
+        return (h ^ v) * 0x100000001b3ULL;
+    }
+
+} // end anonymous namespace
+
+// find_identical
+// ~~~~~~~~~~~~~~
+std::vector<std::uint32_t> find_identical (std::vector<icf_candidate> & candidates,
+                                           std::size_t atoms, thread_pool & pool) {
+    // Put each candidate's references in a canonical order.
+    std::vector<std::uint64_t> hash (candidates.size ());
+    pool.parallel_for (candidates.size (), [&] (std::size_t c) {
+        icf_candidate & cand = candidates[c];
+        std::vector<icf_ref> & r = cand.refs;
+        std::sort (std::begin (r), std::end (r), [] (icf_ref const & x, icf_ref const & y) {
+            return std::make_tuple (x.offset, x.type) < std::make_tuple (y.offset, y.type);
+        });
+        std::uint64_t h =
+            hash_string (reinterpret_cast<char const *> (cand.contents), cand.size);
+        h = mix (mix (h, cand.size), cand.align);
+        for (icf_ref const & ref : r) {
+            h = mix (mix (mix (h, ref.offset), ref.type), ref.to.value);
+        }
+        hash[c] = h;
+    });
+
+    // Two candidates start in the same class if their bytes, alignment and references are
+    // identical, except that references to atoms need only agree on the offset: the atoms'
+    // classes are compared by the refinement below.
+    auto const same_contents = [&] (std::uint32_t x, std::uint32_t y) {
+        icf_candidate const & cx = candidates[x];
+        icf_candidate const & cy = candidates[y];
+        std::vector<icf_ref> const & rx = cx.refs;
+        std::vector<icf_ref> const & ry = cy.refs;
+        if (cx.size != cy.size || cx.align != cy.align || rx.size () != ry.size () ||
+            std::memcmp (cx.contents, cy.contents, cx.size) != 0) {
+            return false;
+        }
+        for (std::size_t k = 0; k < rx.size (); ++k) {
+            icf_ref const & p = rx[k];
+            icf_ref const & q = ry[k];
+            if (p.offset != q.offset || p.type != q.type || p.length != q.length ||
+                p.flags != q.flags || p.addend != q.addend || p.to.value != q.to.value ||
+                p.to.global != q.to.global || (p.to.atom == none) != (q.to.atom == none)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    // The class of every atom: an atom which is not a candidate is in a class of its own. A
+    // class is named by the index of its first member.
+    std::vector<std::uint32_t> klass (atoms);
+    for (std::uint32_t a = 0; a < atoms; ++a) {
+        klass[a] = a;
+    }
+    auto const same_targets = [&] (std::uint32_t x, std::uint32_t y) {
+        for (std::size_t k = 0; k < candidates[x].refs.size (); ++k) {
+            std::uint32_t const p = candidates[x].refs[k].to.atom;
+            std::uint32_t const q = candidates[y].refs[k].to.atom;
+            if (p != none && klass[p] != klass[q]) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Splits each group of candidates with equal keys into classes of equivalent members.
+    // Returns the number of classes.
+    std::vector<std::uint32_t> order (candidates.size ());
+    auto const partition = [&] (auto const & key, auto const & equivalent) {
+        for (std::uint32_t c = 0; c < order.size (); ++c) {
+            order[c] = c;
+        }
+        std::sort (std::begin (order), std::end (order), [&] (std::uint32_t x, std::uint32_t y) {
+            return std::make_tuple (key (x), x) < std::make_tuple (key (y), y);
+        });
+        std::vector<std::uint32_t> next (klass);
+        std::size_t classes = 0;
+        for (std::size_t first = 0; first < order.size ();) {
+            std::size_t last = first + 1U;
+            while (last < order.size () && key (order[last]) == key (order[first])) {
+                ++last;
+            }
+            // Members are in candidate order so each class is named by its first atom.
+            std::vector<std::uint32_t> leaders;
+            for (std::size_t k = first; k < last; ++k) {
+                std::uint32_t const c = order[k];
+                auto const it =
+                    std::find_if (std::begin (leaders), std::end (leaders),
+                                  [&] (std::uint32_t l) { return equivalent (l, c); });
+                if (it == std::end (leaders)) {
+                    leaders.push_back (c);
+                    next[candidates[c].atom] = candidates[c].atom;
+                } else {
+                    next[candidates[c].atom] = candidates[*it].atom;
+                }
+            }
+            classes += leaders.size ();
+            first = last;
+        }
+        klass = std::move (next);
+        return classes;
+    };
+
+    std::size_t classes = partition ([&] (std::uint32_t c) { return hash[c]; }, same_contents);
+    // Refine the classes until the members of each reference equivalent atoms. Classes are only
+    // ever split so this terminates; mutually recursive functions which are identical stay
+    // together because each class is assumed to be equivalent until shown otherwise.
+    for (;;) {
+        pool.parallel_for (candidates.size (), [&] (std::size_t c) {
+            std::uint64_t h = 0xcbf29ce484222325ULL;
+            for (icf_ref const & ref : candidates[c].refs) {
+                h = mix (h, ref.to.atom != none ? klass[ref.to.atom] : none);
+            }
+            hash[c] = h;
+        });
+        std::size_t const refined = partition (
+            [&] (std::uint32_t c) { return std::make_pair (klass[candidates[c].atom], hash[c]); },
+            [&] (std::uint32_t x, std::uint32_t y) {
+                return klass[candidates[x].atom] == klass[candidates[y].atom] &&
+                       same_targets (x, y);
+            });
+        if (refined == classes) {
+            break;
+        }
+        classes = refined;
+    }
+
+    std::vector<std::uint32_t> result;
+    result.reserve (candidates.size ());
+    for (icf_candidate const & cand : candidates) {
+        result.push_back (klass[cand.atom]);
+    }
+    return result;
+}
@@ -0,0 +1,130 @@
+#include "image.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+#include "instrumentation.hpp"
+#include "output.hpp"
+#include "util.hpp"
+
+namespace {
+
+    /// Passes writes through to another output, adding each to a hash of the image.
+    class hashing_output final : public output {
+    public:
+        hashing_output (output & inner, uuid_hasher & hasher) noexcept
+                : inner_{inner}
+                , hasher_{hasher} {
+            this->seek (inner.tell ());
+        }
+
+    private:
+        void write_at (std::uint64_t pos, void const * data, std::size_t size) override {
+            hasher_.add (pos, data, size);
+            inner_.seek (pos);
+            inner_.write (data, size);
+        }
+
+        output & inner_;
+        uuid_hasher & hasher_;
+    };
+
+} // end anonymous namespace
+
+// ctor
+// ~~~~
+image::image (mach_o::cpu_type cputype, mach_o::cpu_subtype cpusubtype,
+              mach_o::filetype_t filetype, std::uint32_t flags,
+              std::vector<std::unique_ptr<command>> && commands)
+        : commands_{std::move (commands)} {
+
+    std::size_t const total_command_size =
+        std::accumulate (std::begin (commands_), std::end (commands_), std::size_t{0},
+                         [] (std::size_t acc, std::unique_ptr<command> const & v) noexcept {
+                             return acc + v->size_bytes ();
+                         });
+    assert (total_command_size <= type_max<std::uint32_t> ());
+
+    header_.magic = mach_o::mh_magic_64; // mach magic number identifier
+    header_.cputype = cputype;           // cpu specifier
+    header_.cpusubtype = cpusubtype;     // machine specifier
+    header_.filetype = filetype;         // type of file
+    header_.ncmds = narrow_cast<std::uint32_t> (commands_.size ()); // number of load commands
+    header_.sizeofcmds =
+        narrow_cast<std::uint32_t> (total_command_size); // the size of all the load commands.
+    header_.flags = flags;
+    header_.reserved = 0;
+}
+
+// reserve_header_pad
+// ~~~~~~~~~~~~~~~~~~
+void image::reserve_header_pad (std::uint32_t bytes, bool max_install_names) {
+    std::uint64_t pad = bytes;
+    if (max_install_names) {
+        std::uint64_t const growth =
+            std::accumulate (std::begin (commands_), std::end (commands_), std::uint64_t{0},
+                             [] (std::uint64_t acc, std::unique_ptr<command> const & v) noexcept {
+                                 return acc + (v->max_size_bytes () - v->size_bytes ());
+                             });
+        pad = std::max (pad, growth);
+    }
+    pad += calc_alignment (pad, 8U);
+    assert (pad + header_.sizeofcmds <= type_max<std::uint32_t> ());
+    header_pad_ = narrow_cast<std::uint32_t> (pad);
+}
+
+// write
+// ~~~~~
+std::uint64_t image::write (output & out) {
+    std::uint64_t const size = this->write_commands (out);
+    this->write_payload (out);
+    // Empty link-edit blobs may sit beyond the last byte written.
+    return std::max (size, out.end ());
+}
+
+// write_commands
+// ~~~~~~~~~~~~~~
+std::uint64_t image::write_commands (output & out) {
+    auto const payload_start = sizeof (header_) + header_.sizeofcmds;
+    // The header pad follows the load commands: nothing is written there.
+    std::uint64_t payload_offset = payload_start + header_pad_;
+    hasher_ = uuid_hasher{};
+    hashing_output hashed{out, hasher_};
+    {
+        // The segments lay out their contents as their commands are written. That time is
+        // recorded as the layout phase.
+        phase_timer const timer{phase::load_commands};
+        hashed.seek (0);
+        hashed.write (&header_, sizeof (header_));
+        for (std::unique_ptr<command> const & v : commands_) {
+            assert (payload_offset % 8 == 0);
+            payload_offset = v->write_command (hashed, payload_offset);
+        }
+    }
+
+    assert (hashed.tell () == payload_start);
+    return payload_offset;
+}
+
+// write_payload
+// ~~~~~~~~~~~~~
+void image::write_payload (output & out) {
+    {
+        phase_timer const timer{phase::relocation};
+        for (std::function<void ()> const & f : on_layout_) {
+            f ();
+        }
+    }
+    {
+        phase_timer const timer{phase::payload};
+        hashing_output hashed{out, hasher_};
+        for (std::unique_ptr<command> const & v : commands_) {
+            v->write_payload (hashed);
+        }
+    }
+    uuid const digest = hasher_.get ();
+    for (std::unique_ptr<command> const & v : commands_) {
+        v->write_digest (out, digest);
+    }
+}
@@ -0,0 +1,240 @@
+#include "image_builder.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include "lc_build_version.hpp"
+#include "lc_data_in_code.hpp"
+#include "lc_dyld_info_only.hpp"
+#include "lc_dysymtab.hpp"
+#include "lc_load_dylib.hpp"
+#include "lc_load_dylinker.hpp"
+#include "lc_main.hpp"
+#include "lc_symtab.hpp"
+#include "lc_uuid.hpp"
+#include "string_arena.hpp"
+
+constexpr std::uint64_t image_builder::follow;
+
+// ctor
+// ~~~~
+image_builder::image_builder (mach_o::cpu_type cputype, mach_o::cpu_subtype cpusubtype,
+                              std::uint64_t page_size, std::uint32_t min_os)
+        : cputype_{cputype}
+        , cpusubtype_{cpusubtype}
+        , page_size_{page_size}
+        , platform_{mach_o::platform_macos}
+        , minos_{min_os}
+        , sdk_{min_os}
+        , names_{std::make_shared<string_arena> ()} {}
+
+// add_page_zero
+// ~~~~~~~~~~~~~
+void image_builder::add_page_zero (std::uint64_t size) {
+    assert (segments_.empty ());
+    segments_.push_back (std::make_unique<lc_segment> (
+        mach_o::seg_pagezero,
+        position (0x0, size), // memory address and size of this segment
+        mach_o::vm_prot_none, // maximum VM protection
+        mach_o::vm_prot_none, // initial VM protection
+        0x00,                 // flags
+        page_size_));
+}
+
+// add_segment
+// ~~~~~~~~~~~
+std::size_t image_builder::add_segment (char const * name, std::uint64_t vmaddr,
+                                        mach_o::vm_prot_t maxprot, mach_o::vm_prot_t initprot) {
+    std::unique_ptr<lc_segment> segment;
+    position const vm{vmaddr == follow ? 0U : vmaddr, 0x0};
+    if (std::strncmp (name, mach_o::seg_text, 16) == 0) {
+        segment = std::make_unique<lc_text_segment> (name, vm, maxprot, initprot, 0x00,
+                                                     page_size_);
+    } else {
+        segment = std::make_unique<lc_segment> (name, vm, maxprot, initprot, 0x00, page_size_);
+    }
+    if (vmaddr == follow) {
+        if (segments_.empty ()) {
+            throw std::logic_error ("the first segment cannot follow another");
+        }
+        segment->follow (segments_.back ().get ());
+    }
+    segments_.push_back (std::move (segment));
+    return segments_.size () - 1U;
+}
+
+// add_section
+// ~~~~~~~~~~~
+std::size_t image_builder::add_section (std::size_t segment, char const * name,
+                                        std::uint32_t align, std::uint32_t flags,
+                                        lc_segment::contents_range contents,
+                                        std::uint64_t zerofill_size) {
+    lc_segment & seg = *segments_.at (segment);
+    seg.add_section (
+        {
+            name,               // name of this section
+            seg.get ().segname, // segment this section goes in
+            0x0,                // memory address of this section (patched up later)
+            zerofill_size,      // size in bytes of this section (patched up later)
+            0,                  // file offset of this section (patched up later)
+            align,              // section alignment (power of 2)
+            0,                  // file offset of relocation entries
+            0,                  // number of relocation entries
+            flags,              // flags (section type and attributes)
+        },
+        contents);
+    return seg.size () - 1U;
+}
+
+std::size_t image_builder::add_section (std::size_t segment, char const * name,
+                                        std::uint32_t align, std::uint32_t flags,
+                                        std::vector<std::uint8_t> contents) {
+    auto const storage = std::make_shared<std::vector<std::uint8_t> const> (std::move (contents));
+    retained_.push_back (storage);
+    std::uint8_t const * const first = storage->data ();
+    return this->add_section (segment, name, align, flags,
+                              lc_segment::contents_range{first, first + storage->size ()});
+}
+
+// add_data_in_code
+// ~~~~~~~~~~~~~~~~
+void image_builder::add_data_in_code (std::size_t segment, std::size_t section,
+                                      std::uint32_t offset, std::uint32_t length,
+                                      std::uint16_t kind) {
+    lc_segment const & seg = *segments_.at (segment);
+    if (section >= seg.size ()) {
+        throw std::out_of_range ("the data-in-code range's section does not exist");
+    }
+    if (std::uint64_t{offset} + length > seg[section].contents_size ()) {
+        throw std::out_of_range ("the data-in-code range is outside its section");
+    }
+    data_in_code_.push_back ({segment, section, offset, length, kind});
+}
+
+// set_entry_point
+// ~~~~~~~~~~~~~~~
+void image_builder::set_entry_point (std::size_t segment, std::size_t section,
+                                     std::uint64_t offset) {
+    has_entry_ = true;
+    entry_ = {segment, section, offset};
+}
+
+// add_dylib
+// ~~~~~~~~~
+void image_builder::add_dylib (std::string const & path) {
+    dylibs_.push_back (path);
+}
+
+// set_build_version
+// ~~~~~~~~~~~~~~~~~
+void image_builder::set_build_version (std::uint32_t platform, std::uint32_t minos,
+                                       std::uint32_t sdk) {
+    platform_ = platform;
+    minos_ = minos;
+    sdk_ = sdk;
+}
+
+// set_header_pad
+// ~~~~~~~~~~~~~~
+void image_builder::set_header_pad (std::uint32_t bytes, bool max_install_names) {
+    header_pad_ = bytes;
+    header_pad_max_install_names_ = max_install_names;
+}
+
+// add_command
+// ~~~~~~~~~~~
+void image_builder::add_command (std::unique_ptr<command> cmd) {
+    extra_.push_back (std::move (cmd));
+}
+
+// retain
+// ~~~~~~
+void image_builder::retain (std::shared_ptr<void const> p) {
+    retained_.push_back (std::move (p));
+}
+
+// build
+// ~~~~~
+image image_builder::build () {
+    if (segments_.empty ()) {
+        throw std::logic_error ("an image needs at least one segment");
+    }
+    if (!has_entry_) {
+        auto const text = std::find_if (
+            std::begin (segments_), std::end (segments_),
+            [] (std::unique_ptr<lc_segment> const & s) {
+                return std::strncmp (s->get ().segname, mach_o::seg_text, 16) == 0;
+            });
+        if (text == std::end (segments_)) {
+            throw std::logic_error ("an image needs a __TEXT segment or an entry point");
+        }
+        entry_ = {static_cast<std::size_t> (text - std::begin (segments_)), 0, 0};
+    }
+    lc_segment & entry_segment = *segments_.at (entry_.segment);
+    if (entry_.section >= entry_segment.size ()) {
+        throw std::logic_error ("the entry point's section does not exist");
+    }
+    lc_segment::section_value const & entry_section = entry_segment[entry_.section];
+
+    // The link-edit data lives in __LINKEDIT which must be the last segment. The symbol tables
+    // are empty.
+    auto data_in_code = std::make_unique<lc_data_in_code> ();
+    for (data_in_code_range const & r : data_in_code_) {
+        data_in_code->add (&(*segments_[r.segment])[r.section], r.offset, r.length, r.kind);
+    }
+    auto dyld_info = std::make_unique<lc_dyld_info_only> ();
+    auto symtab = std::make_unique<lc_symtab> ();
+    auto dysymtab = std::make_unique<lc_dysymtab> (symtab.get ());
+    auto linkedit_segment = std::make_unique<lc_segment> (
+        mach_o::seg_linkedit,
+        position (0x0, 0x0),  // memory address and size of this segment
+        mach_o::vm_prot_all,  // maximum VM protection
+        mach_o::vm_prot_read, // initial VM protection
+        0x00,                 // flags
+        page_size_);
+    linkedit_segment->follow (segments_.back ().get ());
+    linkedit_segment->add_blob (dyld_info.get ());
+    linkedit_segment->add_blob (symtab.get ());
+    linkedit_segment->add_blob (dysymtab.get ());
+    linkedit_segment->add_blob (data_in_code.get ());
+
+    std::vector<std::unique_ptr<command>> commands;
+    commands.reserve (segments_.size () + dylibs_.size () + extra_.size () + 9U);
+    for (std::unique_ptr<lc_segment> & s : segments_) {
+        commands.emplace_back (std::move (s));
+    }
+    commands.emplace_back (std::move (linkedit_segment)); // must be last and not writable.
+    commands.emplace_back (std::move (dyld_info));
+    commands.emplace_back (std::move (symtab));
+    commands.emplace_back (std::move (dysymtab));
+    commands.emplace_back (std::make_unique<lc_load_dylinker> ());
+    if (uuid_) {
+        commands.emplace_back (std::make_unique<lc_uuid> ());
+    }
+    if (build_version_) {
+        commands.emplace_back (std::make_unique<lc_build_version> (platform_, minos_, sdk_));
+    }
+    commands.emplace_back (std::make_unique<lc_main> (&entry_section, entry_.offset));
+    for (std::string const & path : dylibs_) {
+        commands.emplace_back (std::make_unique<lc_load_dylib> (names_->intern (path.c_str ())));
+    }
+    commands.emplace_back (std::move (data_in_code));
+    for (std::unique_ptr<command> & c : extra_) {
+        commands.emplace_back (std::move (c));
+    }
+    segments_.clear ();
+    extra_.clear ();
+
+    image result{cputype_, cpusubtype_, mach_o::filetype_t::execute,
+                 mach_o::mh_noundefs | mach_o::mh_dyldlink | mach_o::mh_twolevel | mach_o::mh_pie,
+                 std::move (commands)};
+    result.reserve_header_pad (header_pad_, header_pad_max_install_names_);
+    result.retain (names_);
+    for (std::shared_ptr<void const> & p : retained_) {
+        result.retain (std::move (p));
+    }
+    retained_.clear ();
+    return result;
+}
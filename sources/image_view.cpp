@@ -0,0 +1,139 @@
+#include "image_view.hpp"
+
+#include <cstring>
+
+// check
+// ~~~~~
+void load_command_iterator::check () const {
+    if (remaining_ == 0U) {
+        return;
+    }
+    auto const available = static_cast<std::size_t> (end_ - pos_);
+    if (available < sizeof (mach_o::load_command)) {
+        throw format_error ("load commands overflow sizeofcmds");
+    }
+    std::uint32_t const cmdsize = reinterpret_cast<mach_o::load_command const *> (pos_)->cmdsize;
+    if (cmdsize < sizeof (mach_o::load_command)) {
+        throw format_error ("load command size is too small");
+    }
+    if (cmdsize > available) {
+        throw format_error ("load commands overflow sizeofcmds");
+    }
+}
+
+
+// ctor
+// ~~~~
+image_view::image_view (std::uint8_t const * data, std::size_t size)
+        : data_{data}
+        , size_{size} {
+    if (size < sizeof (mach_o::mach_header_64)) {
+        throw format_error ("file is too small to be a Mach-O image");
+    }
+    if (reinterpret_cast<std::uintptr_t> (data) % alignof (mach_o::mach_header_64) != 0U) {
+        throw format_error ("image is misaligned");
+    }
+    mach_o::mach_header_64 const & h = this->header ();
+    if (h.magic != mach_o::mh_magic_64) {
+        throw format_error ("not a 64-bit little-endian Mach-O image");
+    }
+    if (h.sizeofcmds > size - sizeof (mach_o::mach_header_64)) {
+        throw format_error ("load commands overflow the image");
+    }
+}
+
+// commands
+// ~~~~~~~~
+load_command_range image_view::commands () const {
+    mach_o::mach_header_64 const & h = this->header ();
+    std::uint8_t const * const first = data_ + sizeof (mach_o::mach_header_64);
+    std::uint8_t const * const last = first + h.sizeofcmds;
+    return {load_command_iterator{first, last, h.ncmds}, load_command_iterator{last, last, 0}};
+}
+
+// sections
+// ~~~~~~~~
+array_view<mach_o::section_64>
+image_view::sections (mach_o::segment_command_64 const & segment) const {
+    std::uint64_t const bytes = std::uint64_t{segment.nsects} * sizeof (mach_o::section_64);
+    if (bytes > segment.cmdsize - sizeof (mach_o::segment_command_64)) {
+        throw format_error ("segment sections overflow the load command");
+    }
+    // The section_64 structures directly follow the segment command.
+    return {reinterpret_cast<mach_o::section_64 const *> (&segment + 1), segment.nsects};
+}
+
+// check range
+// ~~~~~~~~~~~
+void image_view::check_range (std::uint64_t offset, std::uint64_t size) const {
+    if (offset > size_ || size > size_ - offset) {
+        throw format_error ("file range is outside the image");
+    }
+}
+
+// bytes
+// ~~~~~
+array_view<std::uint8_t> image_view::bytes (std::uint64_t offset, std::uint64_t size) const {
+    this->check_range (offset, size);
+    return {data_ + offset, static_cast<std::size_t> (size)};
+}
+
+// contents
+// ~~~~~~~~
+array_view<std::uint8_t> image_view::contents (mach_o::section_64 const & section) const {
+    switch (section.flags & mach_o::section_type) {
+    case mach_o::s_zerofill:
+    case mach_o::s_gb_zerofill:
+    case mach_o::s_thread_local_zerofill: return {};
+    default: return this->bytes (section.offset, section.size);
+    }
+}
+
+
+// ctor
+// ~~~~
+universal_view::universal_view (std::uint8_t const * data, std::size_t size)
+        : data_{data}
+        , size_{size} {
+    if (!is_universal (data, size)) {
+        throw format_error ("not a universal binary");
+    }
+    mach_o::fat_header header;
+    std::memcpy (&header, data, sizeof (header));
+    nfat_arch_ = big_endian (header.nfat_arch);
+    if (nfat_arch_ > (size - sizeof (mach_o::fat_header)) / sizeof (mach_o::fat_arch)) {
+        throw format_error ("architecture table overflows the file");
+    }
+}
+
+// is universal
+// ~~~~~~~~~~~~
+bool universal_view::is_universal (std::uint8_t const * data, std::size_t size) noexcept {
+    if (size < sizeof (mach_o::fat_header)) {
+        return false;
+    }
+    std::uint32_t magic;
+    std::memcpy (&magic, data, sizeof (magic));
+    return big_endian (magic) == mach_o::fat_magic;
+}
+
+// arch
+// ~~~~
+mach_o::fat_arch universal_view::arch (std::size_t index) const noexcept {
+    assert (index < nfat_arch_);
+    mach_o::fat_arch be;
+    std::memcpy (&be, data_ + sizeof (mach_o::fat_header) + index * sizeof (mach_o::fat_arch),
+                 sizeof (be));
+    return {big_endian (be.cputype), big_endian (be.cpusubtype), big_endian (be.offset),
+            big_endian (be.size), big_endian (be.align)};
+}
+
+// slice
+// ~~~~~
+image_view universal_view::slice (std::size_t index) const {
+    mach_o::fat_arch const a = this->arch (index);
+    if (a.offset > size_ || a.size > size_ - a.offset) {
+        throw format_error ("architecture slice is outside the file");
+    }
+    return {data_ + a.offset, a.size};
+}
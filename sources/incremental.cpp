@@ -0,0 +1,270 @@
+#include "incremental.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#    include <io.h>
+#else
+#    include <unistd.h>
+#endif
+
+#include "instrumentation.hpp"
+#include "mapped_file.hpp"
+#include "util.hpp"
+
+namespace {
+
+    [[noreturn]] void raise (char const * what) {
+        throw std::system_error (errno, std::generic_category (), what);
+    }
+
+    constexpr char state_magic[8] = {'M', 'W', 'I', 'N', 'C', 'R', '0', '1'};
+
+    /// Writes which are at least this large form a run of their own rather than being gathered.
+    constexpr std::size_t large_write = 4096;
+    /// The largest run into which small writes are gathered.
+    constexpr std::size_t max_run = 1024 * 1024;
+
+    void resize_file (int fd, std::uint64_t size) {
+        count_syscalls ();
+#ifdef _WIN32
+        if (_chsize_s (fd, static_cast<__int64> (size)) != 0) {
+            raise ("chsize");
+        }
+#else
+        if (::ftruncate (fd, static_cast<off_t> (size)) == -1) {
+            raise ("ftruncate");
+        }
+#endif
+    }
+
+    std::uint64_t rotl (std::uint64_t v, unsigned shift) noexcept {
+        return (v << shift) | (v >> (64U - shift));
+    }
+
+} // end anonymous namespace
+
+// get_file_stamp
+// ~~~~~~~~~~~~~~
+file_stamp get_file_stamp (int fd) {
+    count_syscalls ();
+#ifdef _WIN32
+    struct _stat64 buf;
+    if (::_fstat64 (fd, &buf) == -1) {
+        raise ("fstat");
+    }
+    return {static_cast<std::uint64_t> (buf.st_size), buf.st_mtime, 0};
+#else
+    struct stat buf;
+    if (::fstat (fd, &buf) == -1) {
+        raise ("fstat");
+    }
+#    ifdef __APPLE__
+    std::int64_t const nsec = buf.st_mtimespec.tv_nsec;
+#    else
+    std::int64_t const nsec = buf.st_mtim.tv_nsec;
+#    endif
+    return {static_cast<std::uint64_t> (buf.st_size), buf.st_mtime, nsec};
+#endif
+}
+
+// hash_bytes
+// ~~~~~~~~~~
+std::uint64_t hash_bytes (void const * data, std::size_t size) noexcept {
+    // Consumes eight bytes at a time: the sections of a large image are hashed on every link.
+    constexpr std::uint64_t k1 = 0x87c37b91114253d5ULL;
+    constexpr std::uint64_t k2 = 0x4cf5ad432745937fULL;
+    auto const * p = static_cast<std::uint8_t const *> (data);
+    std::uint64_t h = 0xcbf29ce484222325ULL ^ size;
+    for (; size >= 8U; p += 8, size -= 8U) {
+        std::uint64_t w;
+        std::memcpy (&w, p, sizeof (w));
+        h = rotl (h ^ (w * k1), 31U) * k2;
+    }
+    std::uint64_t tail = 0;
+    std::memcpy (&tail, p, size);
+    h = rotl (h ^ (tail * k1), 31U) * k2;
+    // Finalize so that every input bit affects every output bit.
+    h ^= h >> 33U;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33U;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33U;
+    return h;
+}
+
+// load
+// ~~~~
+incremental_state incremental_state::load (std::string const & path, int fd) {
+    incremental_state result;
+    try {
+        mapped_file const file{path.c_str ()};
+        std::uint8_t const * p = file.data ();
+        std::size_t const size = file.size ();
+        file_stamp recorded;
+        std::uint64_t count;
+        std::size_t const header_size = sizeof (state_magic) + sizeof (recorded) + sizeof (count);
+        if (size < header_size || std::memcmp (p, state_magic, sizeof (state_magic)) != 0) {
+            return result;
+        }
+        p += sizeof (state_magic);
+        std::memcpy (&recorded, p, sizeof (recorded));
+        p += sizeof (recorded);
+        std::memcpy (&count, p, sizeof (count));
+        p += sizeof (count);
+        if (count != (size - header_size) / sizeof (extent) ||
+            (size - header_size) % sizeof (extent) != 0U) {
+            return result;
+        }
+        if (get_file_stamp (fd) != recorded) {
+            return result;
+        }
+        result.extents_.resize (static_cast<std::size_t> (count));
+        std::memcpy (result.extents_.data (), p, result.extents_.size () * sizeof (extent));
+    } catch (std::system_error const &) {
+        // There's no usable state so every byte will be written.
+        result.extents_.clear ();
+    }
+    return result;
+}
+
+// save
+// ~~~~
+void incremental_state::save (std::string const & path, int fd) const {
+    file_stamp const current = get_file_stamp (fd);
+    auto const count = std::uint64_t{extents_.size ()};
+#ifdef _WIN32
+    int const out_fd = _open (path.c_str (), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY);
+#else
+    int const out_fd = ::open (path.c_str (), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+#endif
+    count_syscalls ();
+    if (out_fd == -1) {
+        raise ("open");
+    }
+    auto const scope = make_scope_guard ([out_fd] () {
+        ::close (out_fd);
+        count_syscalls ();
+    });
+    file_output out{out_fd, 0};
+    out.write (state_magic, sizeof (state_magic));
+    out.write (&current, sizeof (current));
+    out.write (&count, sizeof (count));
+    out.write (extents_.data (), extents_.size () * sizeof (extent));
+}
+
+// find
+// ~~~~
+auto incremental_state::find (std::uint64_t offset) const noexcept -> extent const * {
+    auto const pos =
+        std::lower_bound (std::begin (extents_), std::end (extents_), offset,
+                          [] (extent const & e, std::uint64_t o) noexcept { return e.offset < o; });
+    return pos != std::end (extents_) && pos->offset == offset ? &*pos : nullptr;
+}
+
+// ctor
+// ~~~~
+incremental_output::incremental_output (int fd, incremental_state previous)
+        : fd_{fd}
+        , file_{fd, 0}
+        , previous_{std::move (previous)} {
+    if (previous_.empty ()) {
+        // Without a record of the previous contents nothing can be skipped and nothing that
+        // remains in the file can be trusted.
+        resize_file (fd_, 0);
+    }
+}
+
+// write_at
+// ~~~~~~~~
+void incremental_output::write_at (std::uint64_t pos, void const * data, std::size_t size) {
+    auto const * const p = static_cast<std::uint8_t const *> (data);
+    if (size >= large_write) {
+        this->flush ();
+        this->put (pos, p, size);
+        return;
+    }
+    if (!run_.empty () && (pos != run_pos_ + run_.size () || run_.size () + size > max_run)) {
+        this->flush ();
+    }
+    if (run_.empty ()) {
+        run_pos_ = pos;
+    }
+    run_.insert (std::end (run_), p, p + size);
+}
+
+// flush
+// ~~~~~
+void incremental_output::flush () {
+    if (!run_.empty ()) {
+        this->put (run_pos_, run_.data (), run_.size ());
+        run_.clear ();
+    }
+}
+
+// put
+// ~~~
+void incremental_output::put (std::uint64_t pos, std::uint8_t const * data, std::size_t size) {
+    if (size == 0U) {
+        return;
+    }
+    std::uint64_t const hash = hash_bytes (data, size);
+    next_.extents_.push_back ({pos, size, hash});
+    incremental_state::extent const * const old = previous_.find (pos);
+    if (old != nullptr && old->size == size && old->hash == hash) {
+        return;
+    }
+    file_.seek (pos);
+    file_.write (data, size);
+    written_ += size;
+}
+
+// finish
+// ~~~~~~
+void incremental_output::finish (std::uint64_t size) {
+    this->flush ();
+    std::vector<incremental_state::extent> & next = next_.extents_;
+    std::sort (std::begin (next), std::end (next),
+               [] (incremental_state::extent const & a, incremental_state::extent const & b) {
+                   return a.offset < b.offset;
+               });
+
+    // The gaps between the extents of a freshly written file are zero. Clear the parts of the
+    // previous extents that this image leaves alone so that the same is true here.
+    static constexpr std::uint8_t zeros[4096] = {};
+    auto zero = [this, size] (std::uint64_t first, std::uint64_t last) {
+        last = std::min (last, size);
+        while (first < last) {
+            auto const n = static_cast<std::size_t> (std::min (last - first, std::uint64_t{4096}));
+            file_.seek (first);
+            file_.write (zeros, n);
+            written_ += n;
+            first += n;
+        }
+    };
+    auto it = std::begin (next);
+    for (incremental_state::extent const & old : previous_.extents ()) {
+        std::uint64_t first = old.offset;
+        std::uint64_t const last = old.offset + old.size;
+        // Skip the new extents which end before this one starts.
+        while (it != std::end (next) && it->offset + it->size <= first) {
+            ++it;
+        }
+        for (auto cover = it; cover != std::end (next) && cover->offset < last && first < last;
+             ++cover) {
+            if (cover->offset > first) {
+                zero (first, cover->offset);
+            }
+            first = std::max (first, cover->offset + cover->size);
+        }
+        zero (first, last);
+    }
+    resize_file (fd_, size);
+}
@@ -0,0 +1,176 @@
+#include "input_cache.hpp"
+
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+
+#ifdef _WIN32
+#    include <direct.h>
+#    include <io.h>
+#else
+#    include <unistd.h>
+#endif
+
+#include "archive.hpp"
+#include "instrumentation.hpp"
+#include "object_file.hpp"
+#include "thread_pool.hpp"
+#include "util.hpp"
+
+namespace {
+
+    file_stamp stamp_path (std::string const & path) {
+#ifdef _WIN32
+        int const fd = _open (path.c_str (), O_RDONLY | O_BINARY);
+#else
+        int const fd = ::open (path.c_str (), O_RDONLY);
+#endif
+        count_syscalls ();
+        if (fd == -1) {
+            throw std::system_error (errno, std::generic_category (), "open");
+        }
+        auto const scope = make_scope_guard ([fd] () {
+            ::close (fd);
+            count_syscalls ();
+        });
+        return get_file_stamp (fd);
+    }
+
+    /// \returns \p path made absolute so that a cache which outlives a change of working
+    ///   directory does not confuse two files.
+    std::string absolute (std::string const & path) {
+        if (!path.empty () && (path.front () == '/' || path.front () == '\\')) {
+            return path;
+        }
+        char buffer[4096];
+#ifdef _WIN32
+        char const * const cwd = _getcwd (buffer, sizeof (buffer));
+#else
+        char const * const cwd = ::getcwd (buffer, sizeof (buffer));
+#endif
+        if (cwd == nullptr) {
+            throw std::system_error (errno, std::generic_category (), "getcwd");
+        }
+        return std::string{cwd} + '/' + path;
+    }
+
+} // end anonymous namespace
+
+// lookup
+// ~~~~~~
+template <typename T, typename Parse>
+std::shared_ptr<T> input_cache::lookup (std::string const & path, mach_o::cpu_type cputype,
+                                        std::shared_ptr<T> entry::*member, Parse parse) {
+    std::string const key =
+        std::to_string (static_cast<std::uint32_t> (cputype)) + ':' + absolute (path);
+    file_stamp const stamp = stamp_path (path);
+    {
+        std::lock_guard<std::mutex> const lock{mut_};
+        auto const pos = entries_.find (key);
+        if (pos != entries_.end () && pos->second.stamp == stamp && pos->second.*member) {
+            ++stats_.hits;
+            pos->second.used = generation_;
+            return pos->second.*member;
+        }
+    }
+
+    // The stamp is missing or has changed: compare the contents. The stamp was taken before the
+    // file was mapped so, if the file changes in between, the next lookup hashes it again.
+    auto const file = std::make_shared<mapped_file const> (path.c_str ());
+    std::uint64_t const hash = hash_bytes (file->data (), file->size ());
+    {
+        std::lock_guard<std::mutex> const lock{mut_};
+        auto const pos = entries_.find (key);
+        if (pos != entries_.end () && pos->second.hash == hash && pos->second.*member) {
+            ++stats_.rehashed;
+            pos->second.stamp = stamp;
+            pos->second.used = generation_;
+            return pos->second.*member;
+        }
+    }
+
+    std::shared_ptr<T> const result = parse (file);
+    std::lock_guard<std::mutex> const lock{mut_};
+    ++stats_.loads;
+    entry & e = entries_[key];
+    e = entry{stamp, hash, generation_, nullptr, nullptr};
+    e.*member = result;
+    return result;
+}
+
+// objects
+// ~~~~~~~
+std::vector<std::shared_ptr<object_file const>>
+input_cache::objects (std::vector<std::string> const & paths, mach_o::cpu_type cputype,
+                      thread_pool & pool) {
+    std::size_t const count = paths.size ();
+    std::vector<std::shared_ptr<object_file const>> result (count);
+    std::vector<std::string> errors (count);
+    pool.parallel_for (count, [&] (std::size_t index) {
+        std::string const & path = paths[index];
+        try {
+            result[index] = this->lookup (
+                path, cputype, &entry::object,
+                [&path, cputype] (std::shared_ptr<mapped_file const> const & file) {
+                    array_view<std::uint8_t> const bytes{file->data (), file->size ()};
+                    return std::make_shared<object_file const> (path, file, bytes, cputype);
+                });
+        } catch (std::exception const & ex) {
+            errors[index] = path + ": " + ex.what ();
+        }
+    });
+    for (std::size_t ctr = 0; ctr < count; ++ctr) {
+        if (!result[ctr]) {
+            throw load_error (errors[ctr]);
+        }
+    }
+    return result;
+}
+
+// archive_at
+// ~~~~~~~~~~
+std::shared_ptr<archive> input_cache::archive_at (std::string const & path,
+                                                  mach_o::cpu_type cputype) {
+    return this->lookup (path, cputype, &entry::arch,
+                         [&path, cputype] (std::shared_ptr<mapped_file const> const & file) {
+                             return std::make_shared<archive> (path, file, cputype);
+                         });
+}
+
+// next_generation
+// ~~~~~~~~~~~~~~~
+void input_cache::next_generation () {
+    std::lock_guard<std::mutex> const lock{mut_};
+    ++generation_;
+}
+
+// evict
+// ~~~~~
+std::size_t input_cache::evict (std::uint64_t max_idle) {
+    std::lock_guard<std::mutex> const lock{mut_};
+    std::size_t dropped = 0;
+    for (auto it = entries_.begin (); it != entries_.end ();) {
+        if (generation_ - it->second.used > max_idle) {
+            it = entries_.erase (it);
+            ++dropped;
+        } else {
+            ++it;
+        }
+    }
+    return dropped;
+}
+
+// size
+// ~~~~
+std::size_t input_cache::size () const {
+    std::lock_guard<std::mutex> const lock{mut_};
+    return entries_.size ();
+}
+
+// stats
+// ~~~~~
+input_cache::statistics input_cache::stats () const {
+    std::lock_guard<std::mutex> const lock{mut_};
+    return stats_;
+}
@@ -0,0 +1,203 @@
+#include "instrumentation.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <ostream>
+
+namespace {
+
+    std::atomic<bool> enabled{false};
+    std::atomic<bool> allocations_counted{false};
+
+    struct atomic_phase_time {
+        std::atomic<std::uint64_t> wall_ns{0};
+        std::atomic<std::uint64_t> cpu_ns{0};
+    };
+    std::array<atomic_phase_time, phase_count> phase_times;
+    std::atomic<std::uint64_t> syscalls{0};
+    std::atomic<std::uint64_t> bytes_written{0};
+    std::atomic<std::uint64_t> seeks{0};
+    std::atomic<std::uint64_t> allocations{0};
+
+    /// The innermost phase_timer running on this thread.
+    thread_local phase_timer * current_timer = nullptr;
+
+    constexpr char const * phase_names[phase_count] = {
+        "command_construction", "layout", "relocation", "load_commands", "payload", "linkedit",
+    };
+    constexpr char const * phase_descriptions[phase_count] = {
+        "command construction", "layout", "relocation", "load commands", "payload write",
+        "linkedit generation",
+    };
+
+    void add (std::atomic<std::uint64_t> & counter, std::uint64_t n) noexcept {
+        if (enabled.load (std::memory_order_relaxed)) {
+            counter.fetch_add (n, std::memory_order_relaxed);
+        }
+    }
+
+    std::uint64_t cpu_ns (std::clock_t c) noexcept {
+        // CLOCKS_PER_SEC is 1000000 for POSIX and 1000 for Windows.
+        return static_cast<std::uint64_t> (c) * (1000000000U / CLOCKS_PER_SEC);
+    }
+
+    double ms (std::uint64_t ns) noexcept { return static_cast<double> (ns) / 1e6; }
+
+} // end anonymous namespace
+
+// operator-
+// ~~~~~~~~~
+counters operator- (counters const & a, counters const & b) noexcept {
+    counters result;
+    for (std::size_t ctr = 0; ctr < phase_count; ++ctr) {
+        result.phases[ctr].wall_ns = a.phases[ctr].wall_ns - b.phases[ctr].wall_ns;
+        result.phases[ctr].cpu_ns = a.phases[ctr].cpu_ns - b.phases[ctr].cpu_ns;
+    }
+    result.syscalls = a.syscalls - b.syscalls;
+    result.bytes_written = a.bytes_written - b.bytes_written;
+    result.seeks = a.seeks - b.seeks;
+    result.allocations = a.allocations - b.allocations;
+    result.allocations_counted = a.allocations_counted && b.allocations_counted;
+    return result;
+}
+
+// enable_instrumentation
+// ~~~~~~~~~~~~~~~~~~~~~~
+bool enable_instrumentation (bool enable) noexcept {
+    return enabled.exchange (enable, std::memory_order_relaxed);
+}
+
+// instrumentation_enabled
+// ~~~~~~~~~~~~~~~~~~~~~~~
+bool instrumentation_enabled () noexcept {
+    return enabled.load (std::memory_order_relaxed);
+}
+
+// read_counters
+// ~~~~~~~~~~~~~
+counters read_counters () noexcept {
+    counters result;
+    for (std::size_t ctr = 0; ctr < phase_count; ++ctr) {
+        result.phases[ctr].wall_ns = phase_times[ctr].wall_ns.load (std::memory_order_relaxed);
+        result.phases[ctr].cpu_ns = phase_times[ctr].cpu_ns.load (std::memory_order_relaxed);
+    }
+    result.syscalls = syscalls.load (std::memory_order_relaxed);
+    result.bytes_written = bytes_written.load (std::memory_order_relaxed);
+    result.seeks = seeks.load (std::memory_order_relaxed);
+    result.allocations = allocations.load (std::memory_order_relaxed);
+    result.allocations_counted = allocations_counted.load (std::memory_order_relaxed);
+    return result;
+}
+
+// count_syscalls
+// ~~~~~~~~~~~~~~
+void count_syscalls (unsigned n) noexcept {
+    add (syscalls, n);
+}
+
+// count_bytes_written
+// ~~~~~~~~~~~~~~~~~~~
+void count_bytes_written (std::uint64_t bytes) noexcept {
+    add (bytes_written, bytes);
+}
+
+// count_seek
+// ~~~~~~~~~~
+void count_seek () noexcept {
+    add (seeks, 1U);
+}
+
+// enable_allocation_counting
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+void enable_allocation_counting () noexcept {
+    allocations_counted.store (true, std::memory_order_relaxed);
+}
+
+// count_allocation
+// ~~~~~~~~~~~~~~~~
+void count_allocation () noexcept {
+    add (allocations, 1U);
+}
+
+// ctor
+// ~~~~
+phase_timer::phase_timer (phase p) noexcept
+        : phase_{p}
+        , active_{instrumentation_enabled ()} {
+    if (active_) {
+        parent_ = current_timer;
+        current_timer = this;
+        start_cpu_ = std::clock ();
+        start_wall_ = std::chrono::steady_clock::now ();
+    }
+}
+
+// dtor
+// ~~~~
+phase_timer::~phase_timer () noexcept {
+    if (!active_) {
+        return;
+    }
+    auto const wall_ns = static_cast<std::uint64_t> (
+        std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now () -
+                                                              start_wall_)
+            .count ());
+    std::clock_t const cpu = std::clock () - start_cpu_;
+    std::uint64_t const cpu_time = cpu > 0 ? cpu_ns (cpu) : 0U;
+
+    // The time of nested timers has been recorded against their own phases.
+    atomic_phase_time & total = phase_times[static_cast<std::size_t> (phase_)];
+    total.wall_ns.fetch_add (wall_ns - std::min (child_wall_ns_, wall_ns),
+                             std::memory_order_relaxed);
+    total.cpu_ns.fetch_add (cpu_time - std::min (child_cpu_ns_, cpu_time),
+                            std::memory_order_relaxed);
+    if (parent_ != nullptr) {
+        parent_->child_wall_ns_ += wall_ns;
+        parent_->child_cpu_ns_ += cpu_time;
+    }
+    current_timer = parent_;
+}
+
+// print_counters
+// ~~~~~~~~~~~~~~
+void print_counters (std::ostream & os, counters const & c, bool json) {
+    std::ios_base::fmtflags const flags = os.flags ();
+    std::streamsize const precision = os.precision ();
+    os << std::fixed << std::setprecision (3);
+    if (json) {
+        os << "{\"phases\":{";
+        for (std::size_t ctr = 0; ctr < phase_count; ++ctr) {
+            os << (ctr > 0U ? "," : "") << '"' << phase_names[ctr] << "\":{\"wall_ms\":"
+               << ms (c.phases[ctr].wall_ns) << ",\"cpu_ms\":" << ms (c.phases[ctr].cpu_ns)
+               << '}';
+        }
+        os << "},\"syscalls\":" << c.syscalls << ",\"bytes_written\":" << c.bytes_written
+           << ",\"seeks\":" << c.seeks << ",\"allocations\":";
+        if (c.allocations_counted) {
+            os << c.allocations;
+        } else {
+            os << "null";
+        }
+        os << "}\n";
+    } else {
+        os << std::left << std::setw (22) << "phase" << std::right << std::setw (12)
+           << "wall (ms)" << std::setw (12) << "cpu (ms)" << '\n';
+        for (std::size_t ctr = 0; ctr < phase_count; ++ctr) {
+            os << std::left << std::setw (22) << phase_descriptions[ctr] << std::right
+               << std::setw (12) << ms (c.phases[ctr].wall_ns) << std::setw (12)
+               << ms (c.phases[ctr].cpu_ns) << '\n';
+        }
+        os << "syscalls: " << c.syscalls << '\n'
+           << "bytes written: " << c.bytes_written << '\n'
+           << "seeks: " << c.seeks << '\n'
+           << "allocations: ";
+        if (c.allocations_counted) {
+            os << c.allocations << '\n';
+        } else {
+            os << "unavailable\n";
+        }
+    }
+    os.flags (flags);
+    os.precision (precision);
+}
@@ -0,0 +1,158 @@
+#include "layout.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <future>
+#include <iomanip>
+#include <ostream>
+
+#include "image.hpp"
+#include "image_view.hpp"
+#include "output.hpp"
+#include "target.hpp"
+#include "util.hpp"
+
+namespace {
+
+    std::string name_of (char const (&name)[16]) {
+        return {name, strnlen (name, sizeof (name))};
+    }
+
+    void add_linkedit (image_layout & layout, char const * name, std::uint64_t offset,
+                       std::uint64_t size) {
+        if (size > 0U) {
+            layout.linkedit.push_back ({name, offset, size});
+        }
+    }
+
+    char const * cpu_name (mach_o::cpu_type cputype) noexcept {
+        switch (cputype) {
+        case mach_o::cpu_type::x86_64: return x86_64_target::name ();
+        case mach_o::cpu_type::arm64: return arm64_target::name ();
+        default: return "unknown";
+        }
+    }
+
+    std::ostream & hex (std::ostream & os, std::uint64_t v) {
+        return os << "0x" << std::hex << v << std::dec;
+    }
+
+} // end anonymous namespace
+
+// lay_out_image
+// ~~~~~~~~~~~~~~
+image_layout lay_out_image (image & img) {
+    std::vector<std::uint8_t> header;
+    prefix_output out{header, img.header_size ()};
+    image_layout layout{img.cputype (), 0, img.write_commands (out), {}, {}};
+
+    image_view const view{header.data (), header.size ()};
+    for (load_command_view const lc : view.commands ()) {
+        switch (lc.cmd ()) {
+        case mach_o::lc_segment_64: {
+            auto const & seg = lc.as<mach_o::segment_command_64> ();
+            segment_layout s{name_of (seg.segname), seg.vmaddr, seg.vmsize, seg.fileoff,
+                             seg.filesize, {}};
+            array_view<mach_o::section_64> const sections = view.sections (seg);
+            s.sections.reserve (sections.size ());
+            for (mach_o::section_64 const & sect : sections) {
+                s.sections.push_back (
+                    {name_of (sect.sectname), sect.addr, sect.size, sect.offset});
+            }
+            layout.segments.push_back (std::move (s));
+        } break;
+        case mach_o::lc_symtab: {
+            auto const & st = lc.as<mach_o::symtab_command> ();
+            add_linkedit (layout, "symbol table", st.symoff,
+                          std::uint64_t{st.nsyms} * sizeof (mach_o::nlist_64));
+            add_linkedit (layout, "string table", st.stroff, st.strsize);
+        } break;
+        case mach_o::lc_dysymtab: {
+            auto const & dst = lc.as<mach_o::dysymtab_command> ();
+            add_linkedit (layout, "indirect symbols", dst.indirectsymoff,
+                          std::uint64_t{dst.nindirectsyms} * sizeof (std::uint32_t));
+        } break;
+        case mach_o::lc_dyld_info:
+        case mach_o::lc_dyld_info_only: {
+            auto const & di = lc.as<mach_o::dyld_info_command> ();
+            add_linkedit (layout, "rebase info", di.rebase_off, di.rebase_size);
+            add_linkedit (layout, "bind info", di.bind_off, di.bind_size);
+            add_linkedit (layout, "weak bind info", di.weak_bind_off, di.weak_bind_size);
+            add_linkedit (layout, "lazy bind info", di.lazy_bind_off, di.lazy_bind_size);
+            add_linkedit (layout, "export trie", di.export_off, di.export_size);
+        } break;
+        case mach_o::lc_function_starts: {
+            auto const & ld = lc.as<mach_o::linkedit_data_command> ();
+            add_linkedit (layout, "function starts", ld.dataoff, ld.datasize);
+        } break;
+        case mach_o::lc_data_in_code: {
+            auto const & ld = lc.as<mach_o::linkedit_data_command> ();
+            add_linkedit (layout, "data in code", ld.dataoff, ld.datasize);
+        } break;
+        case mach_o::lc_code_signature: {
+            auto const & ld = lc.as<mach_o::linkedit_data_command> ();
+            add_linkedit (layout, "code signature", ld.dataoff, ld.datasize);
+        } break;
+        default: break;
+        }
+    }
+    return layout;
+}
+
+// lay_out_file
+// ~~~~~~~~~~~~~
+file_layout lay_out_file (std::vector<slice> const & slices) {
+    std::size_t const nslices = slices.size ();
+    if (nslices == 1U) {
+        image img = build_image (slices.front ());
+        image_layout layout = lay_out_image (img);
+        std::uint64_t const size = layout.size;
+        return {size, {std::move (layout)}};
+    }
+
+    // As for write_universal(), each slice is built and laid out on its own thread.
+    std::vector<std::future<image_layout>> laid_out;
+    laid_out.reserve (nslices);
+    for (slice const & s : slices) {
+        laid_out.emplace_back (std::async (std::launch::async, [&s] () {
+            image img = build_image (s);
+            return lay_out_image (img);
+        }));
+    }
+    file_layout result{sizeof (mach_o::fat_header) + nslices * sizeof (mach_o::fat_arch), {}};
+    result.images.reserve (nslices);
+    for (std::size_t ctr = 0; ctr < nslices; ++ctr) {
+        image_layout layout = laid_out[ctr].get ();
+        assert (slices[ctr].align < 32U);
+        layout.offset = aligned (result.size, 1U << slices[ctr].align);
+        result.size = layout.offset + layout.size;
+        result.images.push_back (std::move (layout));
+    }
+    return result;
+}
+
+// print_layout
+// ~~~~~~~~~~~~
+void print_layout (std::ostream & os, std::string const & name, file_layout const & layout) {
+    os << name << ": " << layout.size << " bytes\n";
+    for (image_layout const & img : layout.images) {
+        os << cpu_name (img.cputype) << ": offset " << img.offset << ", " << img.size
+           << " bytes\n";
+        for (segment_layout const & seg : img.segments) {
+            os << "  segment " << std::left << std::setw (16) << seg.name << std::right
+               << " vmaddr ";
+            hex (os, seg.vmaddr) << " vmsize ";
+            hex (os, seg.vmsize) << " fileoff " << seg.fileoff << " filesize " << seg.filesize
+                                 << '\n';
+            for (section_layout const & sect : seg.sections) {
+                os << "    section " << std::left << std::setw (16) << sect.name << std::right
+                   << " addr ";
+                hex (os, sect.addr) << " size ";
+                hex (os, sect.size) << " offset " << sect.offset << '\n';
+            }
+        }
+        for (linkedit_layout const & le : img.linkedit) {
+            os << "  " << le.name << ": offset " << le.offset << " size " << le.size << '\n';
+        }
+    }
+}
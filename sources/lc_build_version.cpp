@@ -4,13 +4,9 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
-#ifdef _WIN32
-#    include <io.h>
-#else
-#    include <unistd.h>
-#endif
 
 #include "mach-o.hpp"
+#include "output.hpp"
 #include "version.hpp"
 
 namespace {
@@ -29,22 +25,22 @@ std::uint32_t lc_build_version::size_bytes () const noexcept {
 }
 
 
-std::uint64_t lc_build_version::write_command (int fd, std::uint64_t offset) {
-    constexpr mach_o::build_version_command cmd{
+std::uint64_t lc_build_version::write_command (output & out, std::uint64_t offset) {
+    mach_o::build_version_command const cmd{
         mach_o::lc_build_version,
         command_size_bytes (),
-        mach_o::platform_macos, // platform
-        version (10, 14, 0),    // minos: X.Y.Z is encoded in nibbles xxxx.yy.zz
-        version (10, 14, 0),    // sdk: X.Y.Z is encoded in nibbles xxxx.yy.zz
-        ntools                  // number of tool entries following this
+        platform_, // platform
+        minos_,    // minos: X.Y.Z is encoded in nibbles xxxx.yy.zz
+        sdk_,      // sdk: X.Y.Z is encoded in nibbles xxxx.yy.zz
+        ntools     // number of tool entries following this
     };
 
     constexpr mach_o::build_tool_version tools[1] = {{mach_o::tool_ld, version (409, 12, 0)}};
 
-    off_t prev = lseek (fd, 0, SEEK_CUR);
-    ::write (fd, &cmd, sizeof (cmd));
-    ::write (fd, &tools, sizeof (tools));
-    assert (prev + cmd.cmdsize == lseek (fd, 0, SEEK_CUR));
+    std::uint64_t const prev = out.tell ();
+    out.write (&cmd, sizeof (cmd));
+    out.write (&tools, sizeof (tools));
+    assert (prev + cmd.cmdsize == out.tell ());
     assert (cmd.cmdsize % 8 == 0);
     return offset;
 }
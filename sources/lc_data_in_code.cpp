@@ -1,28 +1,136 @@
 #include "lc_data_in_code.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
-#ifdef _WIN32
-#    include <io.h>
-#else
-#    include <unistd.h>
-#endif
+#include <cstring>
+#include <stdexcept>
+#include <string>
 
 #include "mach-o.hpp"
+#include "output.hpp"
 
+namespace {
+
+    /// The largest number of bytes that a single data_in_code_entry can describe. Longer ranges
+    /// are split across multiple entries.
+    constexpr auto max_entry_length = std::uint32_t{type_max<std::uint16_t> ()};
+
+    std::size_t entries_for (std::uint32_t length) noexcept {
+        return (length + max_entry_length - 1U) / max_entry_length;
+    }
+
+    std::string name_of (lc_segment::section_value const & s) {
+        return {s.get ().sectname, strnlen (s.get ().sectname, sizeof (s.get ().sectname))};
+    }
+
+} // end anonymous namespace
+
+// add
+// ~~~
+void lc_data_in_code::add (not_null<lc_segment::section_value const *> section,
+                           std::uint32_t offset, std::uint32_t length, std::uint16_t kind) {
+    if (std::uint64_t{offset} + length > section->contents_size ()) {
+        throw std::out_of_range ("data-in-code range is outside section " + name_of (*section));
+    }
+    if (length == 0U) {
+        return;
+    }
+    auto pos = std::find_if (
+        std::begin (sections_), std::end (sections_),
+        [section] (section_ranges const & sr) noexcept { return sr.section == section; });
+    if (pos == std::end (sections_)) {
+        sections_.emplace_back (section);
+        pos = std::prev (std::end (sections_));
+    }
+    pos->ranges.push_back ({offset, length, kind});
+}
+
+// size_bytes
+// ~~~~~~~~~~
 std::uint32_t lc_data_in_code::size_bytes () const noexcept {
-    return sizeof (mach_o::dyld_info_command);
+    return sizeof (mach_o::linkedit_data_command);
 }
 
-std::uint64_t lc_data_in_code::write_command (int fd, std::uint64_t offset) {
+// write_command
+// ~~~~~~~~~~~~~
+std::uint64_t lc_data_in_code::write_command (output & out, std::uint64_t offset) {
     // see <macho/loader.h> for detailed comments.
     mach_o::linkedit_data_command const cmd{
         mach_o::lc_data_in_code, sizeof (cmd),
-        0, // file offset of data
-        0, // file size of data in __LINKEDIT segment
+        narrow_cast<std::uint32_t> (this->blob_offset ()), // file offset of data
+        narrow_cast<std::uint32_t> (this->blob_size ()), // file size of data in __LINKEDIT segment
     };
 
     assert (sizeof (cmd) % 8 == 0);
-    ::write (fd, &cmd, sizeof (cmd));
+    out.write (&cmd, sizeof (cmd));
     return offset;
 }
+
+// finalize
+// ~~~~~~~~
+std::uint64_t lc_data_in_code::finalize () {
+    std::size_t entries = 0;
+    for (section_ranges & sr : sections_) {
+        std::vector<range> & ranges = sr.ranges;
+        std::sort (std::begin (ranges), std::end (ranges),
+                   [] (range const & a, range const & b) noexcept { return a.offset < b.offset; });
+
+        // Coalesce ranges of the same kind which touch or overlap. The entries of the table may
+        // not overlap so neither may ranges of different kinds.
+        auto out = std::begin (ranges);
+        for (auto it = std::next (out), end = std::end (ranges); it != end; ++it) {
+            std::uint64_t const out_end = std::uint64_t{out->offset} + out->length;
+            if (it->kind == out->kind && it->offset <= out_end) {
+                std::uint64_t const it_end = std::uint64_t{it->offset} + it->length;
+                out->length = narrow_cast<std::uint32_t> (std::max (out_end, it_end) - out->offset);
+            } else if (it->offset < out_end) {
+                throw std::logic_error (
+                    "data-in-code ranges of different kinds overlap at offset " +
+                    std::to_string (it->offset) + " of section " + name_of (*sr.section));
+            } else {
+                *(++out) = *it;
+            }
+        }
+        ranges.erase (std::next (out), std::end (ranges));
+
+        for (range const & r : ranges) {
+            entries += entries_for (r.length);
+        }
+    }
+    return entries * sizeof (mach_o::data_in_code_entry);
+}
+
+// write_blob
+// ~~~~~~~~~~
+void lc_data_in_code::write_blob (output & out) {
+    // The table must be sorted by file offset. The sections' offsets were assigned when their
+    // segment was laid out.
+    std::vector<section_ranges const *> order;
+    order.reserve (sections_.size ());
+    for (section_ranges const & sr : sections_) {
+        order.push_back (&sr);
+    }
+    std::sort (std::begin (order), std::end (order),
+               [] (section_ranges const * a, section_ranges const * b) noexcept {
+                   return a->section->get_offset () < b->section->get_offset ();
+               });
+
+    std::vector<mach_o::data_in_code_entry> entries;
+    entries.reserve (this->blob_size () / sizeof (mach_o::data_in_code_entry));
+    for (section_ranges const * sr : order) {
+        std::uint64_t const base = sr->section->get_offset ();
+        for (range const & r : sr->ranges) {
+            std::uint64_t offset = base + r.offset;
+            for (std::uint32_t remaining = r.length; remaining > 0U;) {
+                auto const length = std::min (remaining, max_entry_length);
+                entries.push_back ({narrow_cast<std::uint32_t> (offset),
+                                    narrow_cast<std::uint16_t> (length), r.kind});
+                offset += length;
+                remaining -= length;
+            }
+        }
+    }
+    assert (entries.size () * sizeof (mach_o::data_in_code_entry) == this->blob_size ());
+    out.write (entries.data (), entries.size () * sizeof (mach_o::data_in_code_entry));
+}
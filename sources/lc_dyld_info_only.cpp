@@ -1,28 +1,80 @@
 #include "lc_dyld_info_only.hpp"
 
+#include <algorithm>
 #include <cassert>
-#ifdef _WIN32
-#    include <io.h>
-#else
-#    include <unistd.h>
-#endif
+#include <cstring>
+#include <tuple>
 
 #include "mach-o.hpp"
+#include "output.hpp"
 
+namespace {
+
+    void append_uleb128 (std::vector<std::uint8_t> * const out, std::uint64_t v) {
+        do {
+            auto byte = static_cast<std::uint8_t> (v & 0x7FU);
+            v >>= 7;
+            if (v != 0U) {
+                byte |= 0x80U;
+            }
+            out->push_back (byte);
+        } while (v != 0U);
+    }
+
+    void append_sleb128 (std::vector<std::uint8_t> * const out, std::int64_t v) {
+        for (bool more = true; more;) {
+            auto byte = static_cast<std::uint8_t> (v & 0x7F);
+            v >>= 7; // arithmetic shift
+            more = !((v == 0 && (byte & 0x40U) == 0U) || (v == -1 && (byte & 0x40U) != 0U));
+            if (more) {
+                byte |= 0x80U;
+            }
+            out->push_back (byte);
+        }
+    }
+
+    /// \returns The address of \p where relative to the start of its segment.
+    std::uint64_t segment_offset (lc_dyld_info_only::location const & where) noexcept {
+        std::uint64_t const addr = where.section->get ().addr + where.offset;
+        assert (addr >= where.segment->get ().vmaddr);
+        return addr - where.segment->get ().vmaddr;
+    }
+
+    void pad (std::vector<std::uint8_t> * const out) {
+        out->resize (aligned (out->size (), 8U), std::uint8_t{0});
+    }
+
+} // end anonymous namespace
+
+// add_bind
+// ~~~~~~~~
+void lc_dyld_info_only::add_bind (location const & where, interned_string name, unsigned ordinal,
+                                  std::int64_t addend, bool weak_import) {
+    assert (ordinal > 0U);
+    bindings_.push_back ({where, name, ordinal, addend, weak_import});
+}
+
+// size_bytes
+// ~~~~~~~~~~
 std::uint32_t lc_dyld_info_only::size_bytes () const noexcept {
     return sizeof (mach_o::dyld_info_command);
 }
 
-std::uint64_t lc_dyld_info_only::write_command (int fd, std::uint64_t offset) {
+// write_command
+// ~~~~~~~~~~~~~
+std::uint64_t lc_dyld_info_only::write_command (output & out, std::uint64_t offset) {
+    auto const rebase_size = narrow_cast<std::uint32_t> (rebase_.size ());
+    auto const bind_size = narrow_cast<std::uint32_t> (bind_.size ());
+    auto const rebase_off = narrow_cast<std::uint32_t> (this->blob_offset ());
     mach_o::dyld_info_command const cmd{
         mach_o::lc_dyld_info_only, // LC_DYLD_INFO or LC_DYLD_INFO_ONLY
         sizeof (mach_o::dyld_info_command),
 
-        0, // file offset to rebase info
-        0, // size of rebase info
+        rebase_size > 0U ? rebase_off : 0U, // file offset to rebase info
+        rebase_size,                        // size of rebase info
 
-        0, // file offset to binding info
-        0, // size of binding info
+        bind_size > 0U ? rebase_off + rebase_size : 0U, // file offset to binding info
+        bind_size,                                      // size of binding info
 
         0, // file offset to weak binding info
         0, // size of weak binding info
@@ -34,6 +86,140 @@ std::uint64_t lc_dyld_info_only::write_command (int fd, std::uint64_t offset) {
         0, // size of lazy binding info
     };
     assert (sizeof (cmd) % 8 == 0);
-    ::write (fd, &cmd, sizeof (cmd));
+    out.write (&cmd, sizeof (cmd));
     return offset;
 }
+
+// finalize
+// ~~~~~~~~
+std::uint64_t lc_dyld_info_only::finalize () {
+    // The __LINKEDIT segment is laid out after the segments which hold the pointers, so their
+    // addresses are known here.
+    this->encode_rebases ();
+    this->encode_bindings ();
+    return rebase_.size () + bind_.size ();
+}
+
+// encode_rebases
+// ~~~~~~~~~~~~~~
+void lc_dyld_info_only::encode_rebases () {
+    rebase_.clear ();
+    if (rebases_.empty ()) {
+        return;
+    }
+    std::vector<std::pair<unsigned, std::uint64_t>> addrs;
+    addrs.reserve (rebases_.size ());
+    for (location const & l : rebases_) {
+        addrs.emplace_back (l.segment_index, segment_offset (l));
+    }
+    std::sort (std::begin (addrs), std::end (addrs));
+
+    rebase_.push_back (mach_o::rebase_opcode_set_type_imm | mach_o::rebase_type_pointer);
+    auto segment = ~0U;
+    std::uint64_t address = 0; // the address that the next rebase will apply to
+    for (auto it = std::begin (addrs), end = std::end (addrs); it != end;) {
+        if (it->first != segment || it->second < address) {
+            segment = it->first;
+            assert (segment <= mach_o::rebase_immediate_mask);
+            rebase_.push_back (
+                static_cast<std::uint8_t> (mach_o::rebase_opcode_set_segment_and_offset_uleb |
+                                           segment));
+            append_uleb128 (&rebase_, it->second);
+        } else if (it->second > address) {
+            rebase_.push_back (mach_o::rebase_opcode_add_addr_uleb);
+            append_uleb128 (&rebase_, it->second - address);
+        }
+        // Count the run of consecutive pointers which starts here.
+        std::uint64_t count = 1;
+        auto next = std::next (it);
+        for (; next != end && next->first == segment &&
+               next->second == it->second + count * sizeof (std::uint64_t);
+             ++next) {
+            ++count;
+        }
+        if (count <= mach_o::rebase_immediate_mask) {
+            rebase_.push_back (static_cast<std::uint8_t> (
+                mach_o::rebase_opcode_do_rebase_imm_times | count));
+        } else {
+            rebase_.push_back (mach_o::rebase_opcode_do_rebase_uleb_times);
+            append_uleb128 (&rebase_, count);
+        }
+        address = it->second + count * sizeof (std::uint64_t);
+        it = next;
+    }
+    rebase_.push_back (mach_o::rebase_opcode_done);
+    pad (&rebase_);
+}
+
+// encode_bindings
+// ~~~~~~~~~~~~~~~
+void lc_dyld_info_only::encode_bindings () {
+    bind_.clear ();
+    if (bindings_.empty ()) {
+        return;
+    }
+    struct record {
+        binding const * b;
+        std::uint64_t offset;
+    };
+    std::vector<record> records;
+    records.reserve (bindings_.size ());
+    for (binding const & b : bindings_) {
+        records.push_back ({&b, segment_offset (b.where)});
+    }
+    // Grouping the records by symbol means that each name is written once.
+    std::sort (std::begin (records), std::end (records),
+               [] (record const & a, record const & b) noexcept {
+                   if (a.b->name != b.b->name) {
+                       return std::strcmp (a.b->name.c_str (), b.b->name.c_str ()) < 0;
+                   }
+                   return std::make_tuple (a.b->where.segment_index, a.offset) <
+                          std::make_tuple (b.b->where.segment_index, b.offset);
+               });
+
+    bind_.push_back (mach_o::bind_opcode_set_type_imm | mach_o::bind_type_pointer);
+    auto ordinal = 0U;
+    interned_string name;
+    bool weak_import = false;
+    std::int64_t addend = 0;
+    for (record const & r : records) {
+        binding const & b = *r.b;
+        if (b.ordinal != ordinal) {
+            ordinal = b.ordinal;
+            if (ordinal <= mach_o::bind_immediate_mask) {
+                bind_.push_back (static_cast<std::uint8_t> (
+                    mach_o::bind_opcode_set_dylib_ordinal_imm | ordinal));
+            } else {
+                bind_.push_back (mach_o::bind_opcode_set_dylib_ordinal_uleb);
+                append_uleb128 (&bind_, ordinal);
+            }
+        }
+        if (b.name != name || b.weak_import != weak_import) {
+            name = b.name;
+            weak_import = b.weak_import;
+            bind_.push_back (static_cast<std::uint8_t> (
+                mach_o::bind_opcode_set_symbol_trailing_flags_imm |
+                (weak_import ? mach_o::bind_symbol_flags_weak_import : 0U)));
+            bind_.insert (std::end (bind_), name.c_str (), name.c_str () + name.size () + 1U);
+        }
+        if (b.addend != addend) {
+            addend = b.addend;
+            bind_.push_back (mach_o::bind_opcode_set_addend_sleb);
+            append_sleb128 (&bind_, addend);
+        }
+        assert (b.where.segment_index <= mach_o::bind_immediate_mask);
+        bind_.push_back (static_cast<std::uint8_t> (
+            mach_o::bind_opcode_set_segment_and_offset_uleb | b.where.segment_index));
+        append_uleb128 (&bind_, r.offset);
+        bind_.push_back (mach_o::bind_opcode_do_bind);
+    }
+    bind_.push_back (mach_o::bind_opcode_done);
+    pad (&bind_);
+}
+
+// write_blob
+// ~~~~~~~~~~
+void lc_dyld_info_only::write_blob (output & out) {
+    out.write (rebase_.data (), rebase_.size ());
+    out.write (bind_.data (), bind_.size ());
+}
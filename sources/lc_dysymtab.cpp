@@ -1,30 +1,39 @@
 #include "lc_dysymtab.hpp"
 
-#ifdef _WIN32
-#    include <io.h>
-#else
-#    include <unistd.h>
-#endif
-
+#include "lc_symtab.hpp"
 #include "mach-o.hpp"
+#include "output.hpp"
+
+// add_indirect
+// ~~~~~~~~~~~~
+std::uint32_t lc_dysymtab::add_indirect (std::uint32_t symbol) {
+    indirect_.push_back (symbol);
+    return narrow_cast<std::uint32_t> (indirect_.size () - 1U);
+}
 
+// size_bytes
+// ~~~~~~~~~~
 std::uint32_t lc_dysymtab::size_bytes () const noexcept {
     return sizeof (mach_o::dysymtab_command);
 }
 
-std::uint64_t lc_dysymtab::write_command (int fd, std::uint64_t offset) {
+// write_command
+// ~~~~~~~~~~~~~
+std::uint64_t lc_dysymtab::write_command (output & out, std::uint64_t offset) {
+    lc_symtab::partition const p = symtab_->ranges ();
+    auto const nindirect = narrow_cast<std::uint32_t> (indirect_.size ());
     mach_o::dysymtab_command const cmd{
         mach_o::lc_dysymtab,
         sizeof (cmd),
 
-        0, // uint32_t ilocalsym;    /* index to local symbols */
-        0, // uint32_t nlocalsym;    /* number of local symbols */
+        p.ilocal, // uint32_t ilocalsym;    /* index to local symbols */
+        p.nlocal, // uint32_t nlocalsym;    /* number of local symbols */
 
-        0, // uint32_t iextdefsym;/* index to externally defined symbols */
-        0, // uint32_t nextdefsym;/* number of externally defined symbols */
+        p.iextdef, // uint32_t iextdefsym;/* index to externally defined symbols */
+        p.nextdef, // uint32_t nextdefsym;/* number of externally defined symbols */
 
-        0, // uint32_t iundefsym;    /* index to undefined symbols */
-        0, // uint32_t nundefsym;    /* number of undefined symbols */
+        p.iundef, // uint32_t iundefsym;    /* index to undefined symbols */
+        p.nundef, // uint32_t nundefsym;    /* number of undefined symbols */
 
         0, // uint32_t tocoff;    /* file offset to table of contents */
         0, // uint32_t ntoc;    /* number of entries in table of contents */
@@ -35,8 +44,9 @@ std::uint64_t lc_dysymtab::write_command (int fd, std::uint64_t offset) {
         0, // uint32_t extrefsymoff;    /* offset to referenced symbol table */
         0, // uint32_t nextrefsyms;    /* number of referenced symbol table entries */
 
-        0, // uint32_t indirectsymoff; /* file offset to the indirect symbol table */
-        0, // uint32_t nindirectsyms;  /* number of indirect symbol table entries */
+        // uint32_t indirectsymoff; /* file offset to the indirect symbol table */
+        narrow_cast<std::uint32_t> (nindirect > 0U ? this->blob_offset () : 0U),
+        nindirect, // uint32_t nindirectsyms;  /* number of indirect symbol table entries */
 
         0, // uint32_t extreloff;    /* offset to external relocation entries */
         0, // uint32_t nextrel;    /* number of external relocation entries */
@@ -44,6 +54,18 @@ std::uint64_t lc_dysymtab::write_command (int fd, std::uint64_t offset) {
         0, // uint32_t locreloff;    /* offset to local relocation entries */
         0, // uint32_t nlocrel;    /* number of local relocation entries */
     };
-    ::write (fd, &cmd, sizeof (cmd));
+    out.write (&cmd, sizeof (cmd));
     return offset;
 }
+
+// finalize
+// ~~~~~~~~
+std::uint64_t lc_dysymtab::finalize () {
+    return indirect_.size () * sizeof (std::uint32_t);
+}
+
+// write_blob
+// ~~~~~~~~~~
+void lc_dysymtab::write_blob (output & out) {
+    out.write (indirect_.data (), indirect_.size () * sizeof (std::uint32_t));
+}
@@ -1,26 +1,33 @@
 #include "lc_load_dylib.hpp"
 
-#ifdef _WIN32
-#    include <io.h>
-#else
-#    include <unistd.h>
-#endif
+#include <algorithm>
 
 #include "mach-o.hpp"
+#include "output.hpp"
 #include "util.hpp"
 #include "version.hpp"
 
 // size_bytes
 // ~~~~~~~~~~
 std::uint32_t lc_load_dylib::size_bytes () const noexcept {
-    std::size_t const length = name_.length ();
+    std::size_t const length = name_.size ();
     return narrow_cast<std::uint32_t> (sizeof (mach_o::dylib_command) + length +
                                        calc_alignment (length, 8U));
 }
 
+// max_size_bytes
+// ~~~~~~~~~~~~~~
+std::uint32_t lc_load_dylib::max_size_bytes () const noexcept {
+    // MAXPATHLEN from <sys/param.h>, which includes the terminating NUL.
+    constexpr std::size_t max_path_length = 1024;
+    std::size_t const size = sizeof (mach_o::dylib_command) + max_path_length;
+    return std::max (this->size_bytes (),
+                     narrow_cast<std::uint32_t> (size + calc_alignment (size, 8U)));
+}
+
 // write_command
 // ~~~~~~~~~~~~~
-std::uint64_t lc_load_dylib::write_command (int fd, std::uint64_t offset) {
+std::uint64_t lc_load_dylib::write_command (output & out, std::uint64_t offset) {
     mach_o::dylib_command cmd;
     cmd.cmd = mach_o::lc_load_dylib;      // LC_ID_DYLIB, LC_LOAD_{,WEAK_}DYLIB, LC_REEXPORT_DYLIB
     cmd.cmdsize = this->size_bytes ();    // command size: includes pathname string
@@ -28,12 +35,12 @@ std::uint64_t lc_load_dylib::write_command (int fd, std::uint64_t offset) {
     cmd.dylib.timestamp = 2;              // library's build time stamp
     cmd.dylib.current_version = version (1252, 200, 5);  // library's current version number
     cmd.dylib.compatibility_version = version (1, 0, 0); // library's compatibility vers number
-    ::write (fd, &cmd, sizeof (cmd));
+    out.write (&cmd, sizeof (cmd));
 
-    std::size_t const length = name_.length ();
-    ::write (fd, name_.c_str (), length);
+    std::size_t const length = name_.size ();
+    out.write (name_.c_str (), length);
 
     char padding[8] = {0};
-    ::write (fd, padding, calc_alignment (length, 8U));
+    out.write (padding, calc_alignment (length, 8U));
     return offset;
 }
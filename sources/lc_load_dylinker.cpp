@@ -1,12 +1,8 @@
 #include "lc_load_dylinker.hpp"
 
-#ifdef _WIN32
-#    include <io.h>
-#else
-#    include <unistd.h>
-#endif
 
 #include "mach-o.hpp"
+#include "output.hpp"
 #include "util.hpp"
 
 namespace {
@@ -26,13 +22,13 @@ std::uint32_t lc_load_dylinker::size_bytes () const noexcept {
 
 // write_command
 // ~~~~~~~~~~~~~
-std::uint64_t lc_load_dylinker::write_command (int fd, std::uint64_t offset) {
+std::uint64_t lc_load_dylinker::write_command (output & out, std::uint64_t offset) {
     mach_o::dylinker_command const cmd{
         mach_o::lc_load_dylinker, // LC_ID_DYLINKER, LC_LOAD_DYLINKER or LC_DYLD_ENVIRONMENT
         dylinker_cmdsize,         // command size: includes pathname string
         {sizeof (cmd)}            // dynamic linker's path name
     };
-    ::write (fd, &cmd, sizeof (cmd));
-    ::write (fd, dylinker, dylinker_size);
+    out.write (&cmd, sizeof (cmd));
+    out.write (dylinker, dylinker_size);
     return offset;
 }
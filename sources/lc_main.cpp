@@ -1,15 +1,13 @@
 #include "lc_main.hpp"
 
-#ifdef _WIN32
-#    include <io.h>
-#else
-#    include <unistd.h>
-#endif
+#include "output.hpp"
 
 // ctor
 // ~~~~
-lc_main::lc_main (not_null<lc_segment::section_value const *> main) noexcept
-        : main_{main} {}
+lc_main::lc_main (not_null<lc_segment::section_value const *> main,
+                  std::uint64_t offset) noexcept
+        : main_{main}
+        , offset_{offset} {}
 
 // size_bytes
 // ~~~~~~~~~~
@@ -19,14 +17,13 @@ std::uint32_t lc_main::size_bytes () const noexcept {
 
 // write_command
 // ~~~~~~~~~~~~~
-std::uint64_t lc_main::write_command (int fd, std::uint64_t offset) {
+std::uint64_t lc_main::write_command (output & out, std::uint64_t offset) {
     mach_o::entry_point_command cmd;
     cmd.cmd = mach_o::lc_main; // LC_MAIN only used in MH_EXECUTE filetypes
     cmd.cmdsize = sizeof (mach_o::entry_point_command);
-    cmd.entryoff =
-        static_cast<std::uint64_t> (main_->get_offset ()); // file (__TEXT) offset of main()
-    cmd.stacksize = 0;                                     // if not zero, initial stack size
+    cmd.entryoff = main_->get_offset () + offset_; // file (__TEXT) offset of main()
+    cmd.stacksize = 0;                             // if not zero, initial stack size
     assert (sizeof (cmd) % 8 == 0);
-    ::write (fd, &cmd, sizeof (cmd));
+    out.write (&cmd, sizeof (cmd));
     return offset;
 }
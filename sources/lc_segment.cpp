@@ -2,27 +2,17 @@
 
 #include <algorithm>
 #include <cstring>
-#include <numeric>
 
-#ifdef _WIN32
-#    include <io.h>
-#else
-#    include <unistd.h>
-#endif
-
-namespace {
-
-    constexpr std::uint64_t page_size = 0x1000;
-    inline std::uint64_t aligned (std::uint64_t v) noexcept {
-        return v + calc_alignment (v, page_size);
-    }
-
-} // namespace
+#include "instrumentation.hpp"
+#include "output.hpp"
 
 // ctor
 // ~~~~
 lc_segment::lc_segment (char const * segname, position vm, mach_o::vm_prot_t maxprot,
-                        mach_o::vm_prot_t initprot, std::uint32_t flags) noexcept {
+                        mach_o::vm_prot_t initprot, std::uint32_t flags,
+                        std::uint64_t page_size) noexcept
+        : page_size_{page_size} {
+    assert (is_power_of_two (page_size));
     v_.cmd = mach_o::lc_segment_64;
     v_.cmdsize = 0; // includes sizeof section_64 structs (patched up later)
     std::strncpy (v_.segname, segname, array_elements (v_.segname)); // segment name
@@ -41,11 +31,21 @@ lc_segment::lc_segment (char const * segname, position vm, mach_o::vm_prot_t max
 auto lc_segment::add_section (mach_o::section_64 const & sec, contents_range const & contents)
     -> section_value & {
     STATIC_ASSERT (sizeof (v_.segname) == sizeof (sec.segname));
-    assert (std::strncmp (sec.segname, v_.segname, array_elements (v_.segname)) == 0);
+    // The unnamed segment of an MH_OBJECT file holds the sections of every segment.
+    assert (v_.segname[0] == '\0' ||
+            std::strncmp (sec.segname, v_.segname, array_elements (v_.segname)) == 0);
     sections_.emplace_back (sec, contents);
+    assert (sections_.size () < 2U || sections_.back ().is_zerofill () ||
+            !sections_[sections_.size () - 2U].is_zerofill ());
     return sections_.back ();
 }
 
+// add_blob
+// ~~~~~~~~
+void lc_segment::add_blob (not_null<linkedit_blob *> blob) {
+    blobs_.push_back (blob);
+}
+
 // size_bytes
 // ~~~~~~~~~~
 std::uint32_t lc_segment::size_bytes () const noexcept {
@@ -54,63 +54,117 @@ std::uint32_t lc_segment::size_bytes () const noexcept {
     return narrow_cast<std::uint32_t> (resl);
 }
 
-// payload_size
-// ~~~~~~~~~~~~
-std::size_t lc_segment::payload_size () const noexcept {
-    return std::accumulate (std::begin (sections_), std::end (sections_), std::size_t{0},
-                            [] (std::size_t acc, section_value const & sv) noexcept {
-                                return acc + sv.contents_size ();
-                            });
-}
-
-// write_command
-// ~~~~~~~~~~~~~
-std::uint64_t lc_segment::write_command (int fd, std::uint64_t payload_offset) {
-    std::uint64_t const file_off = this->file_offset (payload_offset);
-    std::uint64_t const size = this->payload_size ();
-
-    v_.cmdsize = this->size_bytes ();
-    v_.nsects = narrow_cast<decltype (v_.nsects)> (sections_.size ());
-    v_.filesize = sections_.empty () ? uint64_t{0} : size + payload_offset - file_off;
-    v_.fileoff = aligned (v_.filesize == 0 ? uint64_t{0} : file_off);
-    v_.vmsize = aligned (std::max ({v_.vmsize, size, v_.filesize}));
-
-    ::write (fd, &v_, sizeof (v_));
-
-    if (sections_.empty ()) {
-        return payload_offset;
-    }
-
-    payload_pos_ = v_.fileoff;
-    std::uint64_t vm_addr = v_.vmaddr + (payload_offset - file_off);
+// layout
+// ~~~~~~
+std::uint64_t lc_segment::layout (std::uint64_t payload_offset, std::uint64_t & vm_addr) {
     for (section_value & sv : sections_) {
         mach_o::section_64 & section = sv.get ();
+        auto const padding = calc_alignment (vm_addr, std::size_t{1} << section.align);
+        vm_addr += padding;
         section.addr = vm_addr;
+        if (sv.is_zerofill ()) {
+            // Zero-fill sections come last and take no space in the file.
+            section.offset = 0;
+            sv.set_offset (0);
+            vm_addr += section.size;
+            continue;
+        }
+        payload_offset += padding;
+
         section.offset = narrow_cast<decltype (section.offset)> (payload_offset);
         section.size = sv.contents_size ();
-        ::write (fd, &section, sizeof (section));
-
         sv.set_offset (payload_offset);
 
         payload_offset += section.size;
         vm_addr += section.size;
     }
+    for (linkedit_blob * const blob : blobs_) {
+        payload_offset += calc_alignment (payload_offset, 8U);
+        phase_timer const timer{phase::linkedit};
+        blob->place (payload_offset, blob->finalize ());
+        payload_offset += blob->blob_size ();
+    }
+    return payload_offset;
+}
+
+// layout_relocations
+// ~~~~~~~~~~~~~~~~~~
+std::uint64_t lc_segment::layout_relocations (std::uint64_t offset) {
+    for (section_value & sv : sections_) {
+        mach_o::section_64 & section = sv.get ();
+        std::size_t const nreloc = sv.relocations ().size ();
+        if (nreloc == 0U) {
+            section.reloff = 0;
+            section.nreloc = 0;
+            continue;
+        }
+        sv.sort_relocations ();
+        offset += calc_alignment (offset, 8U);
+        section.reloff = narrow_cast<decltype (section.reloff)> (offset);
+        section.nreloc = narrow_cast<decltype (section.nreloc)> (nreloc);
+        offset += nreloc * sizeof (mach_o::relocation_info);
+    }
+    return offset;
+}
+
+// write_command
+// ~~~~~~~~~~~~~
+std::uint64_t lc_segment::write_command (output & out, std::uint64_t payload_offset) {
+    if (previous_ != nullptr) {
+        mach_o::segment_command_64 const & prev = previous_->get ();
+        v_.vmaddr = prev.vmaddr + prev.vmsize;
+    }
+    std::uint64_t const file_off = this->file_offset (payload_offset);
+    bool const empty = sections_.empty () && blobs_.empty ();
+    std::uint64_t vm_end = v_.vmaddr + (payload_offset - file_off);
+    std::uint64_t end;
+    std::uint64_t relocs_end;
+    {
+        phase_timer const timer{phase::layout};
+        end = this->layout (payload_offset, vm_end);
+        // Relocation tables follow the segment's data but are not part of its mapped contents.
+        relocs_end = this->layout_relocations (end);
+    }
+
+    v_.cmdsize = this->size_bytes ();
+    v_.nsects = narrow_cast<decltype (v_.nsects)> (sections_.size ());
+    v_.filesize = empty ? uint64_t{0} : end - file_off;
+    v_.fileoff = empty ? uint64_t{0} : aligned (file_off);
+    v_.vmsize = aligned (std::max ({v_.vmsize, vm_end - v_.vmaddr, v_.filesize}));
 
-    return aligned (v_.fileoff + v_.filesize);
+    out.write (&v_, sizeof (v_));
+    for (section_value const & sv : sections_) {
+        out.write (&sv.get (), sizeof (mach_o::section_64));
+    }
+    return empty ? payload_offset : aligned (std::max (v_.fileoff + v_.filesize, relocs_end));
 }
 
 // write_payload
 // ~~~~~~~~~~~~~
-void lc_segment::write_payload (int fd) {
-    if (sections_.empty ()) {
-        return;
+void lc_segment::write_payload (output & out) {
+    for (auto const & sv : sections_) {
+        if (sv.is_zerofill ()) {
+            continue;
+        }
+        out.seek (sv.get_offset ());
+        out.write (sv.contents ().first, sv.contents_size ());
     }
-
-    if (have_payload_pos_) {
-        ::lseek (fd, static_cast<off_t> (payload_pos_), SEEK_SET);
+    for (linkedit_blob * const blob : blobs_) {
+        out.seek (blob->blob_offset ());
+        phase_timer const timer{phase::linkedit};
+        blob->write_blob (out);
     }
+
+    std::vector<std::uint32_t> encoded;
     for (auto const & sv : sections_) {
-        ::write (fd, sv.contents ().first, sv.contents_size ());
+        std::vector<mach_o::relocation> const & relocs = sv.relocations ();
+        if (relocs.empty ()) {
+            continue;
+        }
+        encoded.resize (relocs.size () * 2U);
+        mach_o::encode_relocations (relocs.data (), relocs.size (), encoded.data ());
+        out.seek (sv.get ().reloff);
+        out.write (encoded.data (), encoded.size () * sizeof (std::uint32_t));
     }
 }
 
@@ -120,6 +174,12 @@ std::uint64_t lc_segment::file_offset (std::uint64_t offset) const noexcept {
     return offset;
 }
 
+// aligned
+// ~~~~~~~
+std::uint64_t lc_segment::aligned (std::uint64_t v) const noexcept {
+    return v + calc_alignment (v, page_size_);
+}
+
 
 
 void lc_segment::section_value::set_offset (std::uint64_t offset) noexcept {
@@ -134,6 +194,22 @@ std::uint64_t lc_segment::section_value::get_offset () const noexcept {
     return resl;
 }
 
+void lc_segment::section_value::sort_relocations () {
+    std::stable_sort (std::begin (relocs_), std::end (relocs_),
+                      [] (mach_o::relocation const & a, mach_o::relocation const & b) noexcept {
+                          return a.address < b.address;
+                      });
+}
+
+bool lc_segment::section_value::is_zerofill () const noexcept {
+    switch (s_.flags & mach_o::section_type) {
+    case mach_o::s_zerofill:
+    case mach_o::s_gb_zerofill:
+    case mach_o::s_thread_local_zerofill: return true;
+    default: return false;
+    }
+}
+
 std::size_t lc_segment::section_value::contents_size () const noexcept {
     auto const resl = std::distance (static_cast<std::uint8_t const *> (contents_.first),
                                      static_cast<std::uint8_t const *> (contents_.second));
@@ -1,26 +1,117 @@
 #include "lc_symtab.hpp"
 
-#ifdef _WIN32
-#    include <io.h>
-#else
-#    include <unistd.h>
-#endif
+#include <cassert>
+#include <unordered_map>
 
 #include "mach-o.hpp"
+#include "output.hpp"
+
+// add
+// ~~~
+std::uint32_t lc_symtab::add (interned_string name, std::uint8_t type, std::uint8_t sect,
+                              std::uint16_t desc, lc_segment::section_value const * section,
+                              std::uint64_t value) {
+    assert (name);
+    entries_.push_back ({name, type, sect, desc, section, value});
+    return narrow_cast<std::uint32_t> (entries_.size () - 1U);
+}
+
+// size
+// ~~~~
+std::uint32_t lc_symtab::size () const noexcept {
+    return narrow_cast<std::uint32_t> (entries_.size ());
+}
+
+// ranges
+// ~~~~~~
+auto lc_symtab::ranges () const noexcept -> partition {
+    auto const is_local = [] (entry const & e) noexcept { return (e.type & mach_o::n_ext) == 0U; };
+    auto const is_undef = [] (entry const & e) noexcept {
+        return (e.type & mach_o::n_type) == mach_o::n_undf;
+    };
 
+    auto const n = this->size ();
+    std::uint32_t index = 0;
+    while (index < n && is_local (entries_[index])) {
+        ++index;
+    }
+    std::uint32_t const nlocal = index;
+    while (index < n && !is_undef (entries_[index])) {
+        ++index;
+    }
+    std::uint32_t const nextdef = index - nlocal;
+#ifndef NDEBUG
+    for (std::uint32_t ctr = index; ctr < n; ++ctr) {
+        assert (!is_local (entries_[ctr]) && is_undef (entries_[ctr]));
+    }
+#endif
+    return {0, nlocal, nlocal, nextdef, index, n - index};
+}
+
+// size_bytes
+// ~~~~~~~~~~
 std::uint32_t lc_symtab::size_bytes () const noexcept {
     return sizeof (mach_o::symtab_command);
 }
 
-std::uint64_t lc_symtab::write_command (int fd, std::uint64_t offset) {
+// write_command
+// ~~~~~~~~~~~~~
+std::uint64_t lc_symtab::write_command (output & out, std::uint64_t offset) {
+    std::uint32_t const nsyms = this->size ();
+    std::uint64_t const symoff = nsyms > 0U ? this->blob_offset () : 0U;
+    std::uint64_t const symsize = std::uint64_t{nsyms} * sizeof (mach_o::nlist_64);
     mach_o::symtab_command const cmd{
         mach_o::lc_symtab,
         sizeof (cmd),
-        0, // uint32_t symoff;  /* symbol table offset */
-        0, // uint32_t nsyms;   /* number of symbol table entries */
-        0, // uint32_t stroff;  /* string table offset */
-        0, // uint32_t strsize; /* string table size in bytes */
+        narrow_cast<std::uint32_t> (symoff),                           // symbol table offset
+        nsyms,                                                         // number of entries
+        narrow_cast<std::uint32_t> (nsyms > 0U ? symoff + symsize : 0U), // string table offset
+        narrow_cast<std::uint32_t> (strings_.size ()), // string table size in bytes
     };
-    ::write (fd, &cmd, sizeof (cmd));
+    out.write (&cmd, sizeof (cmd));
     return offset;
 }
+
+// finalize
+// ~~~~~~~~
+std::uint64_t lc_symtab::finalize () {
+    strings_.clear ();
+    strx_.clear ();
+    if (entries_.empty ()) {
+        return 0;
+    }
+    // The first string is empty so that a zero n_strx means "no name".
+    strings_.push_back ('\0');
+    strx_.reserve (entries_.size ());
+    // Each distinct name is written once. Interned names are equal only if their handles are.
+    std::unordered_map<interned_string, std::uint32_t> offsets;
+    offsets.reserve (entries_.size ());
+    for (entry const & e : entries_) {
+        auto const inserted =
+            offsets.emplace (e.name, narrow_cast<std::uint32_t> (strings_.size ()));
+        if (inserted.second) {
+            char const * const name = e.name.c_str ();
+            strings_.insert (std::end (strings_), name, name + e.name.size () + 1U);
+        }
+        strx_.push_back (inserted.first->second);
+    }
+    strings_.resize (aligned (strings_.size (), 8U), '\0');
+    return entries_.size () * sizeof (mach_o::nlist_64) + strings_.size ();
+}
+
+// write_blob
+// ~~~~~~~~~~
+void lc_symtab::write_blob (output & out) {
+    // Symbol values are computed here because the sections' addresses have only now been
+    // assigned.
+    std::vector<mach_o::nlist_64> symbols;
+    symbols.reserve (entries_.size ());
+    auto strx = std::begin (strx_);
+    for (entry const & e : entries_) {
+        std::uint64_t const value =
+            e.section != nullptr ? e.section->get ().addr + e.value : e.value;
+        symbols.push_back ({*(strx++), e.type, e.sect, e.desc, value});
+    }
+    out.write (symbols.data (), symbols.size () * sizeof (mach_o::nlist_64));
+    out.write (strings_.data (), strings_.size ());
+}
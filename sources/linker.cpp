@@ -0,0 +1,2069 @@
+#include "linker.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+
+#include "archive.hpp"
+#include "dead_strip.hpp"
+#include "icf.hpp"
+#include "input_cache.hpp"
+#include "lc_build_version.hpp"
+#include "lc_dyld_info_only.hpp"
+#include "lc_dysymtab.hpp"
+#include "lc_load_dylib.hpp"
+#include "lc_load_dylinker.hpp"
+#include "lc_main.hpp"
+#include "lc_segment.hpp"
+#include "lc_symtab.hpp"
+#include "lc_uuid.hpp"
+#include "mach-o_reloc.hpp"
+#include "object_file.hpp"
+#include "ordering.hpp"
+#include "relocation_engine.hpp"
+#include "resolver.hpp"
+#include "target.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+    constexpr std::uint64_t text_vmaddr = 0x0000000100000000;
+    /// Symbols which no input defines are bound to the first (and only) dylib: libSystem.
+    constexpr unsigned libsystem_ordinal = 1;
+    constexpr auto libsystem_path = "/usr/lib/libSystem.B.dylib";
+
+    // The indices of the segments amongst the image's LC_SEGMENT_64 commands.
+    enum : unsigned {
+        text_segment_index = 1,
+        data_segment_index = 2,
+    };
+
+    constexpr auto none = resolver::none;
+
+    /// How the linker must treat a relocation.
+    enum class reloc_class {
+        other,       ///< A reference which is resolved entirely within the image
+        pointer,     ///< A 64-bit absolute address: needs rebasing or binding
+        absolute32,  ///< A 32-bit absolute address: not possible in a position independent image
+        subtractor,  ///< The first of a SUBTRACTOR/UNSIGNED pair
+        branch,      ///< A call or jump: imported targets are reached through a stub
+        got,         ///< A reference to the target's GOT slot
+        addend,      ///< ARM64_RELOC_ADDEND: supplies the addend of the following relocation
+        unsupported, ///< Thread-local variables, for example
+    };
+
+    // The target-specific parts of the linker.
+    template <typename Target>
+    struct link_traits;
+
+    template <>
+    struct link_traits<x86_64_target> {
+        static reloc_class classify (std::uint8_t type, std::uint8_t length) noexcept {
+            switch (type) {
+            case mach_o::x86_64_reloc_unsigned:
+                return length == 3U ? reloc_class::pointer : reloc_class::absolute32;
+            case mach_o::x86_64_reloc_subtractor: return reloc_class::subtractor;
+            case mach_o::x86_64_reloc_branch: return reloc_class::branch;
+            case mach_o::x86_64_reloc_got_load:
+            case mach_o::x86_64_reloc_got: return reloc_class::got;
+            case mach_o::x86_64_reloc_signed:
+            case mach_o::x86_64_reloc_signed_1:
+            case mach_o::x86_64_reloc_signed_2:
+            case mach_o::x86_64_reloc_signed_4: return reloc_class::other;
+            default: return reloc_class::unsupported;
+            }
+        }
+
+        /// The number of immediate bytes which follow the 32-bit displacement.
+        static std::int64_t trailing (std::uint8_t type) noexcept {
+            switch (type) {
+            case mach_o::x86_64_reloc_signed_1: return 1;
+            case mach_o::x86_64_reloc_signed_2: return 2;
+            case mach_o::x86_64_reloc_signed_4: return 4;
+            default: return 0;
+            }
+        }
+        /// \returns The addend of a pc-relative relocation against a symbol. The assembler
+        /// stores the displacement less the number of trailing immediate bytes.
+        static std::int64_t implicit_addend (std::uint8_t type, std::uint8_t const * field) {
+            std::int32_t disp;
+            std::memcpy (&disp, field, sizeof (disp));
+            return disp + trailing (type);
+        }
+        /// \returns The input address referenced by a pc-relative relocation against a section.
+        static std::uint64_t pcrel_target (std::uint8_t type, std::uint64_t field_addr,
+                                           std::uint8_t const * field) {
+            std::int32_t disp;
+            std::memcpy (&disp, field, sizeof (disp));
+            return field_addr + 4U + static_cast<std::uint64_t> (trailing (type) + disp);
+        }
+
+        // jmp *slot(%rip)
+        static constexpr std::size_t stub_size () noexcept { return 6; }
+        static std::uint8_t const * stub () noexcept {
+            static constexpr std::uint8_t contents[stub_size ()] = {
+                0xff, 0x25, 0x00, 0x00, 0x00, 0x00,
+            };
+            return contents;
+        }
+        static void add_stub_fixups (relocation_engine<x86_64_target> & engine,
+                                     std::uint64_t offset, std::uint64_t slot) {
+            engine.add ({offset + 2U, slot, 0, 0, mach_o::x86_64_reloc_got, 2});
+        }
+    };
+
+    template <>
+    struct link_traits<arm64_target> {
+        static reloc_class classify (std::uint8_t type, std::uint8_t length) noexcept {
+            switch (type) {
+            case mach_o::arm64_reloc_unsigned:
+                return length == 3U ? reloc_class::pointer : reloc_class::absolute32;
+            case mach_o::arm64_reloc_subtractor: return reloc_class::subtractor;
+            case mach_o::arm64_reloc_branch26: return reloc_class::branch;
+            case mach_o::arm64_reloc_got_load_page21:
+            case mach_o::arm64_reloc_got_load_pageoff12:
+            case mach_o::arm64_reloc_pointer_to_got: return reloc_class::got;
+            case mach_o::arm64_reloc_page21:
+            case mach_o::arm64_reloc_pageoff12: return reloc_class::other;
+            case mach_o::arm64_reloc_addend: return reloc_class::addend;
+            default: return reloc_class::unsupported;
+            }
+        }
+
+        /// Instruction fields do not hold an addend: it is given by a preceding
+        /// ARM64_RELOC_ADDEND.
+        static std::int64_t implicit_addend (std::uint8_t /*type*/,
+                                             std::uint8_t const * /*field*/) noexcept {
+            return 0;
+        }
+        static std::uint64_t pcrel_target (std::uint8_t /*type*/, std::uint64_t /*field_addr*/,
+                                           std::uint8_t const * /*field*/) {
+            throw link_error ("arm64 section-relative instruction relocations are not supported");
+        }
+
+        // adrp x16, slot@PAGE
+        // ldr  x16, [x16, slot@PAGEOFF]
+        // br   x16
+        static constexpr std::size_t stub_size () noexcept { return 12; }
+        static std::uint8_t const * stub () noexcept {
+            static constexpr std::uint8_t contents[stub_size ()] = {
+                0x10, 0x00, 0x00, 0x90, 0x10, 0x02, 0x40, 0xf9, 0x00, 0x02, 0x1f, 0xd6,
+            };
+            return contents;
+        }
+        static void add_stub_fixups (relocation_engine<arm64_target> & engine,
+                                     std::uint64_t offset, std::uint64_t slot) {
+            engine.add ({offset, slot, 0, 0, mach_o::arm64_reloc_got_load_page21, 2});
+            engine.add ({offset + 4U, slot, 0, 0, mach_o::arm64_reloc_got_load_pageoff12, 2});
+        }
+    };
+
+    std::int64_t read_signed (std::uint8_t const * field, std::uint8_t length) noexcept {
+        if (length == 3U) {
+            std::int64_t v;
+            std::memcpy (&v, field, sizeof (v));
+            return v;
+        }
+        std::int32_t v;
+        std::memcpy (&v, field, sizeof (v));
+        return v;
+    }
+
+    std::int64_t sign_extend24 (std::uint32_t v) noexcept {
+        return static_cast<std::int32_t> (v << 8) >> 8;
+    }
+
+    std::string name_of (char const (&name)[16]) {
+        return {name, strnlen (name, sizeof (name))};
+    }
+
+    bool is_external (symbol_table const & st, std::size_t index) noexcept {
+        return (st.type[index] & mach_o::n_stab) == 0U && (st.type[index] & mach_o::n_ext) != 0U;
+    }
+
+    bool has_suffix (std::string const & s, char const * suffix) {
+        std::size_t const length = std::strlen (suffix);
+        return s.length () >= length && s.compare (s.length () - length, length, suffix) == 0;
+    }
+
+    /// \returns The size of each literal in a section of type \p type, 1 for C strings (which
+    ///   are split at their terminating NUL), or 0 if the section's contents cannot be merged.
+    std::size_t literal_size (std::uint32_t type) noexcept {
+        switch (type) {
+        case mach_o::s_cstring_literals: return 1;
+        case mach_o::s_4byte_literals: return 4;
+        case mach_o::s_8byte_literals: return 8;
+        case mach_o::s_16byte_literals: return 16;
+        default: return 0;
+        }
+    }
+
+    /// \returns True if the section is not copied to the output. Debug information and the
+    ///   compact unwind entries (which would be used to build __unwind_info) are discarded.
+    bool is_discarded (input_section const & in) noexcept {
+        return (in.flags & mach_o::s_attr_debug) != 0U ||
+               std::strncmp (in.segname, "__LD", sizeof (in.segname)) == 0;
+    }
+
+    /// \returns True if every atom of a section of type \p type must be kept when dead
+    ///   stripping.
+    bool is_live_section (std::uint32_t flags) noexcept {
+        std::uint32_t const type = flags & mach_o::section_type;
+        return (flags & mach_o::s_attr_no_dead_strip) != 0U ||
+               type == mach_o::s_mod_init_func_pointers || type == mach_o::s_mod_term_func_pointers;
+    }
+
+    /// \returns The log2 of the largest power of 2 which divides \p v (which must not be 0).
+    unsigned trailing_zeros (std::uint32_t v) noexcept {
+        assert (v != 0U);
+        unsigned result = 0;
+        for (; (v & 1U) == 0U; v >>= 1) {
+            ++result;
+        }
+        return result;
+    }
+
+
+    /// The distinct literals of the merged literal sections. Each literal is identified by a
+    /// number which increases with its position in the inputs; every copy of a literal shares the
+    /// entry of the copy with the lowest number. The table is split into shards, selected by the
+    /// literals' hashes, each with its own lock so that the sections of different inputs can be
+    /// added concurrently. Since the winning copy is the one with the lowest number, the result
+    /// does not depend on the order in which the literals were added.
+    class literal_table {
+    public:
+        struct entry {
+            std::uint64_t first;  ///< The number of the first copy of the literal
+            std::uint32_t align;  ///< The strictest alignment (log2) of any copy
+            std::uint64_t offset; ///< The literal's offset in its output section
+        };
+
+        /// Adds a literal of \p length bytes to output section \p section.
+        /// \returns The literal's entry. Entries do not move until the table is destroyed.
+        entry * add (std::uint32_t section, std::uint8_t const * bytes, std::size_t length,
+                     std::uint64_t id, std::uint32_t align) {
+            key const k{section, bytes, length,
+                        hash_string (reinterpret_cast<char const *> (bytes), length)};
+            shard & s = shards_[k.hash >> (64U - shard_bits)];
+            std::lock_guard<std::mutex> const lock{s.mut};
+            auto const inserted = s.map.emplace (k, entry{id, align, 0});
+            entry & e = inserted.first->second;
+            if (!inserted.second) {
+                e.first = std::min (e.first, id);
+                e.align = std::max (e.align, align);
+            }
+            return &e;
+        }
+
+    private:
+        struct key {
+            std::uint32_t section;
+            std::uint8_t const * bytes;
+            std::size_t length;
+            std::uint64_t hash;
+
+            bool operator== (key const & rhs) const noexcept {
+                return hash == rhs.hash && section == rhs.section && length == rhs.length &&
+                       std::memcmp (bytes, rhs.bytes, length) == 0;
+            }
+        };
+        struct key_hash {
+            std::size_t operator() (key const & k) const noexcept {
+                return static_cast<std::size_t> (k.hash ^ k.section);
+            }
+        };
+        struct shard {
+            std::mutex mut;
+            std::unordered_map<key, entry, key_hash> map;
+        };
+
+        static constexpr unsigned shard_bits = 6;
+        std::array<shard, std::size_t{1} << shard_bits> shards_;
+    };
+
+
+    template <typename Target>
+    class linker {
+    public:
+        linker (link_options const & options, thread_pool & pool,
+                std::shared_ptr<string_arena> names)
+                : options_{options}
+                , pool_{pool}
+                , arena_{names ? std::move (names) : std::make_shared<string_arena> ()}
+                , names_{*arena_}
+                , symbols_{pool, names_}
+                , seg_text_{names_.intern (mach_o::seg_text)}
+                , seg_data_{names_.intern (mach_o::seg_data)}
+                , sect_text_{names_.intern (mach_o::sect_text)} {}
+
+        /// Loads and resolves the inputs and lays out the output sections.
+        void prepare ();
+        /// Builds the image's load commands.
+        std::vector<std::unique_ptr<command>> build_commands ();
+        /// Patches the section contents once their addresses are known.
+        void relocate () const;
+
+    private:
+        using traits = link_traits<Target>;
+
+        struct output_section {
+            interned_string segname;
+            interned_string sectname;
+            bool text = false; ///< True if the section belongs to __TEXT
+            std::uint32_t flags;
+            std::uint32_t align = 0;
+            std::uint64_t size = 0;
+            std::vector<std::uint8_t> contents; ///< Empty for zero-fill sections
+            std::uint32_t reserved1 = 0;
+            std::uint32_t reserved2 = 0;
+            /// The section's entry in its segment command and its ordinal (set by
+            /// build_commands()).
+            lc_segment::section_value const * value = nullptr;
+            std::uint8_t ordinal = 0;
+
+            bool is_text () const { return text; }
+            bool is_zerofill () const {
+                auto const type = flags & mach_o::section_type;
+                return type == mach_o::s_zerofill || type == mach_o::s_gb_zerofill;
+            }
+            std::uint64_t addr () const { return value->get ().addr; }
+        };
+
+        /// Where an input section was placed.
+        struct placement {
+            std::uint32_t section = none; ///< An index into sections_ or none if discarded
+            std::uint64_t offset = 0;     ///< The offset within the output section
+            /// For a merged literal section, an index into literals_. The section's offset is
+            /// then meaningless: each literal has its own.
+            std::uint32_t literals = none;
+            /// True if the section was placed atom by atom. The section's offset is then
+            /// meaningless: each atom has its own.
+            bool split = false;
+        };
+
+        /// A piece of an input section which is kept, removed or folded as a whole by dead
+        /// stripping and identical code folding. A section is split at its symbols if its file
+        /// was assembled with subsections-via-symbols; otherwise the whole section is one atom.
+        struct atom {
+            std::uint32_t file;
+            std::uint32_t section;
+            std::uint32_t start;     ///< The atom's offset within its input section
+            std::uint32_t size;
+            std::uint64_t offset;    ///< The atom's offset within its output section
+            /// The identical atom whose copy this atom shares or none if the atom is copied.
+            std::uint32_t replacement = none;
+        };
+
+        /// The literals of a merged input section.
+        struct literal_map {
+            std::uint32_t file;
+            std::uint32_t section;
+            /// The offset of each literal within the input section, in ascending order.
+            std::vector<std::uint32_t> start;
+            std::vector<literal_table::entry *> entry;
+        };
+
+        /// A 64-bit pointer in the output which dyld must rebase or bind.
+        struct pointer {
+            std::uint32_t section;
+            std::uint64_t offset;
+            std::uint32_t global; ///< The imported symbol or none for an address in the image
+            std::int64_t addend;
+        };
+
+        /// The results of scanning the relocations of one input file.
+        struct scan_result {
+            std::vector<std::uint32_t> got;
+            std::vector<std::uint32_t> stubs;
+            std::vector<pointer> pointers;
+        };
+
+        void load ();
+        void check_symbols () const;
+        void make_atoms ();
+        std::vector<atom_reference> references (std::uint32_t file) const;
+        std::vector<std::uint32_t> roots () const;
+        void dead_strip ();
+        unsigned atom_align (atom const & at) const;
+        icf_target icf_target_of (std::uint32_t file, std::uint32_t index) const;
+        icf_target icf_address_target (std::uint32_t file, std::uint32_t ordinal,
+                                       std::uint64_t addr) const;
+        /// Adds the relocations of the atoms of \p file which are ICF candidates to their
+        /// entries in \p candidates. \p candidate maps an atom to its entry or none.
+        void icf_references (std::uint32_t file, std::vector<std::uint32_t> const & candidate,
+                             std::vector<icf_candidate> & candidates) const;
+        void fold_identical ();
+        /// Calls \p f (id, atom) for each atom which defines one of \p names (each mapped to an
+        /// id): the definitions to which external names resolve and every local definition.
+        template <typename Function>
+        void for_each_definition (std::unordered_map<interned_string, std::uint32_t> const & names,
+                                  Function f) const;
+        /// Ranks the atoms named by the order file. \returns The first rank that is not used.
+        std::uint32_t order_atoms ();
+        /// Ranks the functions in the call graph profile, starting at \p first_rank.
+        void order_by_profile (std::uint32_t first_rank);
+        void place_sections ();
+        void merge_literals ();
+        scan_result scan (std::uint32_t file) const;
+        void scan_relocations ();
+        void copy_contents ();
+        std::uint32_t add_section (interned_string segname, interned_string sectname,
+                                   std::uint32_t flags, std::uint32_t align);
+
+        [[noreturn]] void error (std::uint32_t file, std::string const & message) const;
+        /// Interns a fixed-length, possibly unterminated, section or segment name.
+        interned_string intern (char const (&name)[16]) {
+            return names_.intern (name, strnlen (name, sizeof (name)));
+        }
+        bool is_import (std::uint32_t global) const noexcept;
+        std::uint32_t global_of (std::uint32_t file, std::uint32_t index) const noexcept;
+
+        /// \returns The atom which contains the byte at \p offset in section \p section (an
+        ///   index) of \p file or none if the inputs were not split into atoms.
+        std::uint32_t atom_of (std::uint32_t file, std::uint32_t section,
+                               std::uint64_t offset) const;
+        /// \returns The atom which contains the input address \p addr of the section with
+        ///   ordinal \p ordinal in \p file or none.
+        std::uint32_t address_atom (std::uint32_t file, std::uint32_t ordinal,
+                                    std::uint64_t addr) const;
+        /// \returns The atom which contains the definition \p index of \p file or none.
+        std::uint32_t definition_atom (std::uint32_t file, std::uint32_t index) const;
+        /// \returns The atom which contains the definition to which symbol \p index of \p
+        ///   file resolves or none (for an import or a common symbol, for example).
+        std::uint32_t symbol_atom (std::uint32_t file, std::uint32_t index) const;
+        /// \returns False if the byte at \p offset in section \p section of \p file was
+        ///   removed by dead stripping.
+        bool is_live (std::uint32_t file, std::uint32_t section, std::uint64_t offset) const;
+        /// \returns True if the byte at \p offset in section \p section of \p file is copied
+        ///   to the output: it was neither dead stripped nor folded into an identical atom.
+        bool is_copied (std::uint32_t file, std::uint32_t section, std::uint64_t offset) const;
+
+        /// \returns The offset within its output section of the byte at \p offset in section
+        ///   \p section (an index, not an ordinal) of \p file.
+        std::uint64_t output_offset (std::uint32_t file, std::uint32_t section,
+                                     std::uint64_t offset) const;
+        std::uint64_t input_address (std::uint32_t file, std::uint32_t ordinal,
+                                     std::uint64_t addr) const;
+        /// \returns The address of the definition \p index of \p file plus \p addend. The
+        ///   addend is applied before the address is mapped: in a merged literal section it
+        ///   selects the literal.
+        std::uint64_t definition_address (std::uint32_t file, std::uint32_t index,
+                                          std::int64_t addend = 0) const;
+        std::uint64_t symbol_address (std::uint32_t file, std::uint32_t index,
+                                      std::int64_t addend = 0) const;
+
+        void relocate_section (std::uint32_t file, std::uint32_t section) const;
+        void relocate_synthesized () const;
+        void apply (relocation_engine<Target> const & engine, output_section const & os,
+                    std::uint64_t offset, std::uint64_t size, std::string const & where) const;
+
+        link_options const options_;
+        thread_pool & pool_;
+        std::vector<std::shared_ptr<object_file const>> objects_;
+        std::vector<std::shared_ptr<archive>> archives_;
+        std::shared_ptr<string_arena> const arena_;
+        /// Symbol and section names. Names are compared by handle rather than by content.
+        string_arena & names_;
+        resolver symbols_;
+        interned_string const seg_text_;
+        interned_string const seg_data_;
+        interned_string const sect_text_;
+
+        std::vector<output_section> sections_;
+        /// The atoms of the input sections (empty unless dead stripping or folding identical
+        /// code). The atoms of each
+        /// section are contiguous and in address order: first_atom_[file][section] is the index
+        /// of the section's first atom and first_atom_[file][section + 1] is just beyond its
+        /// last.
+        std::vector<atom> atoms_;
+        std::vector<std::vector<std::uint32_t>> first_atom_;
+        /// Indexed by atom: non-zero if the atom is reachable from a root (or, if dead stripping
+        /// is disabled, always).
+        std::vector<std::uint8_t> live_;
+        /// Indexed by atom: the position in the order file of the first of the atom's symbols
+        /// that it lists, or the atom's position in the order derived from the call graph
+        /// profile, or none (empty if there is neither). Ranked atoms are placed first, in
+        /// this order.
+        std::vector<std::uint32_t> rank_;
+
+        /// The placement of each section of each input file.
+        std::vector<std::vector<placement>> placements_;
+        literal_table literal_table_;
+        std::vector<literal_map> literals_;
+
+        std::uint32_t got_section_ = none;
+        std::uint32_t stub_section_ = none;
+        std::uint32_t common_section_ = none;
+        /// The symbols with GOT slots and stubs, in slot order.
+        std::vector<std::uint32_t> got_;
+        std::vector<std::uint32_t> stubs_;
+        /// Indexed by global: a symbol's GOT slot, stub, or offset in __common.
+        std::vector<std::uint32_t> got_index_;
+        std::vector<std::uint32_t> stub_index_;
+        std::vector<std::uint64_t> common_offset_;
+        std::vector<pointer> pointers_;
+        /// Indexed by global: non-zero if the symbol is bound by the GOT or a pointer.
+        std::vector<std::uint8_t> bound_;
+    };
+
+    // error
+    // ~~~~~
+    template <typename Target>
+    void linker<Target>::error (std::uint32_t file, std::string const & message) const {
+        throw link_error (symbols_.file (file).path () + ": " + message);
+    }
+
+    // global_of
+    // ~~~~~~~~~
+    template <typename Target>
+    std::uint32_t linker<Target>::global_of (std::uint32_t file,
+                                             std::uint32_t index) const noexcept {
+        return is_external (symbols_.file (file).symbols (), index) ? symbols_.global (file, index)
+                                                                    : none;
+    }
+
+    // is_import
+    // ~~~~~~~~~
+    template <typename Target>
+    bool linker<Target>::is_import (std::uint32_t global) const noexcept {
+        return global != none && symbols_.get (global).k == resolver::kind::undefined;
+    }
+
+    // atom_of
+    // ~~~~~~~
+    template <typename Target>
+    std::uint32_t linker<Target>::atom_of (std::uint32_t file, std::uint32_t section,
+                                           std::uint64_t offset) const {
+        if (first_atom_.empty ()) {
+            return none;
+        }
+        auto const first = std::begin (atoms_) + first_atom_[file][section];
+        auto const last = std::begin (atoms_) + first_atom_[file][section + 1U];
+        // Every section's first atom starts at offset 0.
+        auto const it = std::upper_bound (
+            first, last, offset,
+            [] (std::uint64_t o, atom const & a) noexcept { return o < a.start; });
+        if (it == first) {
+            return none;
+        }
+        return static_cast<std::uint32_t> (it - std::begin (atoms_)) - 1U;
+    }
+
+    // address_atom
+    // ~~~~~~~~~~~~
+    template <typename Target>
+    std::uint32_t linker<Target>::address_atom (std::uint32_t file, std::uint32_t ordinal,
+                                                std::uint64_t addr) const {
+        std::vector<input_section> const & sections = symbols_.file (file).sections ();
+        if (ordinal == 0U || ordinal > sections.size () || addr < sections[ordinal - 1U].addr) {
+            return none;
+        }
+        return this->atom_of (file, ordinal - 1U, addr - sections[ordinal - 1U].addr);
+    }
+
+    // definition_atom
+    // ~~~~~~~~~~~~~~~
+    template <typename Target>
+    std::uint32_t linker<Target>::definition_atom (std::uint32_t file, std::uint32_t index) const {
+        symbol_table const & st = symbols_.file (file).symbols ();
+        if ((st.type[index] & mach_o::n_type) != mach_o::n_sect) {
+            return none;
+        }
+        return this->address_atom (file, st.sect[index], st.value[index]);
+    }
+
+    // symbol_atom
+    // ~~~~~~~~~~~
+    template <typename Target>
+    std::uint32_t linker<Target>::symbol_atom (std::uint32_t file, std::uint32_t index) const {
+        std::uint32_t const g = this->global_of (file, index);
+        if (g == none) {
+            return this->definition_atom (file, index);
+        }
+        resolver::resolution const r = symbols_.get (g);
+        return r.k == resolver::kind::defined ? this->definition_atom (r.file, r.index) : none;
+    }
+
+    // is_live
+    // ~~~~~~~
+    template <typename Target>
+    bool linker<Target>::is_live (std::uint32_t file, std::uint32_t section,
+                                  std::uint64_t offset) const {
+        std::uint32_t const a = this->atom_of (file, section, offset);
+        return a == none || live_[a] != 0U;
+    }
+
+    // is_copied
+    // ~~~~~~~~~
+    template <typename Target>
+    bool linker<Target>::is_copied (std::uint32_t file, std::uint32_t section,
+                                    std::uint64_t offset) const {
+        std::uint32_t const a = this->atom_of (file, section, offset);
+        return a == none || (live_[a] != 0U && atoms_[a].replacement == none);
+    }
+
+    // load
+    // ~~~~
+    template <typename Target>
+    void linker<Target>::load () {
+        std::vector<std::string> objects;
+        for (std::string const & path : options_.inputs) {
+            if (has_suffix (path, ".a")) {
+                archives_.push_back (options_.cache != nullptr
+                                         ? options_.cache->archive_at (path, Target::cpu_type ())
+                                         : std::make_shared<archive> (path, Target::cpu_type ()));
+            } else {
+                objects.push_back (path);
+            }
+        }
+        if (options_.cache != nullptr) {
+            objects_ = options_.cache->objects (objects, Target::cpu_type (), pool_);
+        } else {
+            std::vector<object_file> loaded = load_objects (objects, Target::cpu_type (), pool_);
+            objects_.reserve (loaded.size ());
+            for (object_file & obj : loaded) {
+                objects_.push_back (std::make_shared<object_file const> (std::move (obj)));
+            }
+        }
+        std::vector<object_file const *> files;
+        files.reserve (objects_.size ());
+        for (std::shared_ptr<object_file const> const & obj : objects_) {
+            files.push_back (obj.get ());
+        }
+        symbols_.add (files);
+
+        // Pull in the archive members which define undefined symbols until there are no more.
+        // Each round's members are added in (archive, offset) order so that file numbering, and
+        // hence the whole link, is independent of scheduling.
+        for (;;) {
+            struct member {
+                std::size_t archive;
+                std::uint64_t offset;
+                interned_string name;
+            };
+            std::vector<member> members;
+            for (std::uint32_t const g : symbols_.undefined ()) {
+                interned_string const name = symbols_.get (g).name;
+                for (std::size_t a = 0; a < archives_.size (); ++a) {
+                    if (std::uint64_t const offset =
+                            archives_[a]->find (name.c_str (), name.size ())) {
+                        members.push_back ({a, offset, name});
+                        break;
+                    }
+                }
+            }
+            std::sort (std::begin (members), std::end (members),
+                       [] (member const & a, member const & b) noexcept {
+                           return std::make_tuple (a.archive, a.offset) <
+                                  std::make_tuple (b.archive, b.offset);
+                       });
+            members.erase (std::unique (std::begin (members), std::end (members),
+                                        [] (member const & a, member const & b) noexcept {
+                                            return a.archive == b.archive && a.offset == b.offset;
+                                        }),
+                           std::end (members));
+            if (members.empty ()) {
+                break;
+            }
+            std::vector<object_file const *> loaded (members.size ());
+            pool_.parallel_for (members.size (), [&] (std::size_t ctr) {
+                member const & m = members[ctr];
+                loaded[ctr] =
+                    archives_[m.archive]->load_member_for (m.name.c_str (), m.name.size ());
+            });
+            symbols_.add (loaded);
+        }
+    }
+
+    // check_symbols
+    // ~~~~~~~~~~~~~
+    template <typename Target>
+    void linker<Target>::check_symbols () const {
+        std::string message;
+        for (std::uint32_t const g : symbols_.globals ()) {
+            resolver::resolution const r = symbols_.get (g);
+            if (r.strong_definitions > 1U) {
+                message += message.empty () ? "" : "\n";
+                message += std::string{"duplicate symbol '"} + r.name.c_str () +
+                           "' (first defined in " +
+                           symbols_.file (r.file).path () + ")";
+            }
+        }
+        if (!message.empty ()) {
+            throw link_error (message);
+        }
+    }
+
+    // make_atoms
+    // ~~~~~~~~~~
+    template <typename Target>
+    void linker<Target>::make_atoms () {
+        std::uint32_t const files = symbols_.file_count ();
+        std::vector<std::vector<atom>> found (files);
+        pool_.parallel_for (files, [&] (std::size_t ctr) {
+            auto const file = narrow_cast<std::uint32_t> (ctr);
+            object_file const & obj = symbols_.file (file);
+            std::vector<input_section> const & sections = obj.sections ();
+            // The offsets at which each section is split. Discarded sections have no atoms.
+            std::vector<std::vector<std::uint32_t>> starts (sections.size ());
+            for (std::size_t s = 0; s < sections.size (); ++s) {
+                if (!is_discarded (sections[s])) {
+                    starts[s].push_back (0);
+                }
+            }
+            if ((obj.flags () & mach_o::mh_subsections_via_symbols) != 0U) {
+                symbol_table const & st = obj.symbols ();
+                for (std::uint32_t index = 0; index < st.size (); ++index) {
+                    std::uint8_t const type = st.type[index];
+                    if ((type & mach_o::n_stab) != 0U ||
+                        (type & mach_o::n_type) != mach_o::n_sect) {
+                        continue;
+                    }
+                    std::uint32_t const s = st.sect[index] - 1U;
+                    input_section const & in = sections[s];
+                    // Literal sections are merged, not split.
+                    if (starts[s].empty () ||
+                        literal_size (in.flags & mach_o::section_type) != 0U) {
+                        continue;
+                    }
+                    if (st.value[index] > in.addr && st.value[index] < in.addr + in.size) {
+                        starts[s].push_back (
+                            static_cast<std::uint32_t> (st.value[index] - in.addr));
+                    }
+                }
+            }
+            for (std::uint32_t s = 0; s < sections.size (); ++s) {
+                std::vector<std::uint32_t> & st = starts[s];
+                std::sort (std::begin (st), std::end (st));
+                st.erase (std::unique (std::begin (st), std::end (st)), std::end (st));
+                for (std::size_t k = 0; k < st.size (); ++k) {
+                    std::uint32_t const end = k + 1U < st.size ()
+                                                  ? st[k + 1U]
+                                                  : narrow_cast<std::uint32_t> (sections[s].size);
+                    found[file].push_back ({file, s, st[k], end - st[k], 0});
+                }
+            }
+        });
+
+        first_atom_.resize (files);
+        for (std::uint32_t file = 0; file < files; ++file) {
+            std::size_t const sections = symbols_.file (file).sections ().size ();
+            std::vector<std::uint32_t> & first = first_atom_[file];
+            first.resize (sections + 1U);
+            auto it = std::begin (found[file]);
+            for (std::uint32_t s = 0; s < sections; ++s) {
+                first[s] = narrow_cast<std::uint32_t> (atoms_.size ());
+                for (; it != std::end (found[file]) && it->section == s; ++it) {
+                    atoms_.push_back (*it);
+                }
+            }
+            first[sections] = narrow_cast<std::uint32_t> (atoms_.size ());
+        }
+    }
+
+    // references
+    // ~~~~~~~~~~
+    template <typename Target>
+    auto linker<Target>::references (std::uint32_t file) const -> std::vector<atom_reference> {
+        std::vector<atom_reference> result;
+        object_file const & obj = symbols_.file (file);
+        relocation_table const & rt = obj.relocations ();
+        std::vector<input_section> const & sections = obj.sections ();
+        for (std::uint32_t s = 0; s < sections.size (); ++s) {
+            if (first_atom_[file][s] == first_atom_[file][s + 1U]) {
+                continue; // discarded
+            }
+            input_section const & in = sections[s];
+            auto const add = [&] (std::uint32_t from, std::uint32_t to) {
+                if (to != none && to != from) {
+                    result.emplace_back (from, to);
+                }
+            };
+            std::uint32_t const end = in.first_reloc + in.nreloc;
+            for (std::uint32_t r = in.first_reloc; r < end; ++r) {
+                auto const address = static_cast<std::uint32_t> (rt.address[r]);
+                std::uint8_t const * const field = in.contents.data () + address;
+                std::uint32_t const from = this->atom_of (file, s, address);
+                bool const ext = (rt.flags[r] & relocation_table::extern_flag) != 0U;
+                switch (traits::classify (rt.type[r], rt.length[r])) {
+                case reloc_class::addend:
+                case reloc_class::unsupported: break;
+                case reloc_class::subtractor:
+                    // Both halves of the pair reference an atom.
+                    add (from, this->symbol_atom (file, rt.symbolnum[r]));
+                    if (++r < end) {
+                        add (from, (rt.flags[r] & relocation_table::extern_flag) != 0U
+                                       ? this->symbol_atom (file, rt.symbolnum[r])
+                                       : this->address_atom (
+                                             file, rt.symbolnum[r],
+                                             static_cast<std::uint64_t> (
+                                                 read_signed (field, rt.length[r - 1U]))));
+                    }
+                    break;
+                case reloc_class::pointer:
+                case reloc_class::absolute32:
+                    add (from, ext ? this->symbol_atom (file, rt.symbolnum[r])
+                                   : this->address_atom (file, rt.symbolnum[r],
+                                                         static_cast<std::uint64_t> (
+                                                             read_signed (field, rt.length[r]))));
+                    break;
+                case reloc_class::branch:
+                case reloc_class::got:
+                case reloc_class::other:
+                    add (from, ext ? this->symbol_atom (file, rt.symbolnum[r])
+                                   : this->address_atom (
+                                         file, rt.symbolnum[r],
+                                         traits::pcrel_target (rt.type[r], in.addr + address,
+                                                               field)));
+                    break;
+                }
+            }
+        }
+        return result;
+    }
+
+    // roots
+    // ~~~~~
+    template <typename Target>
+    std::vector<std::uint32_t> linker<Target>::roots () const {
+        std::vector<std::uint32_t> result;
+        std::uint32_t const entry = symbols_.find (names_.find (options_.entry.c_str ()));
+        if (entry != none) {
+            resolver::resolution const r = symbols_.get (entry);
+            if (r.k == resolver::kind::defined) {
+                result.push_back (this->definition_atom (r.file, r.index));
+            }
+        }
+        if (options_.export_dynamic) {
+            for (std::uint32_t const g : symbols_.globals ()) {
+                resolver::resolution const r = symbols_.get (g);
+                if (r.k == resolver::kind::defined &&
+                    (symbols_.file (r.file).symbols ().type[r.index] & mach_o::n_pext) == 0U) {
+                    result.push_back (this->definition_atom (r.file, r.index));
+                }
+            }
+        }
+        for (std::uint32_t file = 0; file < symbols_.file_count (); ++file) {
+            symbol_table const & st = symbols_.file (file).symbols ();
+            for (std::uint32_t index = 0; index < st.size (); ++index) {
+                if ((st.type[index] & mach_o::n_stab) == 0U &&
+                    (st.desc[index] & mach_o::n_no_dead_strip) != 0U) {
+                    result.push_back (this->definition_atom (file, index));
+                }
+            }
+        }
+        for (std::uint32_t a = 0; a < atoms_.size (); ++a) {
+            atom const & at = atoms_[a];
+            input_section const & in = symbols_.file (at.file).sections ()[at.section];
+            if (is_live_section (in.flags)) {
+                result.push_back (a);
+            }
+        }
+        result.erase (std::remove (std::begin (result), std::end (result), none),
+                      std::end (result));
+        return result;
+    }
+
+    // dead_strip
+    // ~~~~~~~~~~
+    template <typename Target>
+    void linker<Target>::dead_strip () {
+        std::uint32_t const files = symbols_.file_count ();
+        std::vector<std::vector<atom_reference>> found (files);
+        pool_.parallel_for (files, [&] (std::size_t file) {
+            found[file] = this->references (narrow_cast<std::uint32_t> (file));
+        });
+        live_ = mark_live (make_atom_graph (atoms_.size (), found), this->roots (), pool_);
+    }
+
+    // atom_align
+    // ~~~~~~~~~~
+    template <typename Target>
+    unsigned linker<Target>::atom_align (atom const & at) const {
+        unsigned const align = symbols_.file (at.file).sections ()[at.section].align;
+        return at.start == 0U ? align : std::min (align, trailing_zeros (at.start));
+    }
+
+    // icf_target_of
+    // ~~~~~~~~~~~~~
+    template <typename Target>
+    auto linker<Target>::icf_target_of (std::uint32_t file, std::uint32_t index) const
+        -> icf_target {
+        icf_target result;
+        std::uint32_t def_file = file;
+        std::uint32_t def_index = index;
+        std::uint32_t const g = this->global_of (file, index);
+        if (g != none) {
+            resolver::resolution const r = symbols_.get (g);
+            if (r.k != resolver::kind::defined) {
+                result.global = g; // an import or a common symbol
+                return result;
+            }
+            def_file = r.file;
+            def_index = r.index;
+        }
+        symbol_table const & st = symbols_.file (def_file).symbols ();
+        result.atom = this->definition_atom (def_file, def_index);
+        if (result.atom == none) {
+            result.value = st.value[def_index];
+        } else {
+            atom const & at = atoms_[result.atom];
+            result.value = st.value[def_index] -
+                           symbols_.file (def_file).sections ()[at.section].addr - at.start;
+        }
+        return result;
+    }
+
+    // icf_address_target
+    // ~~~~~~~~~~~~~~~~~~
+    template <typename Target>
+    auto linker<Target>::icf_address_target (std::uint32_t file, std::uint32_t ordinal,
+                                             std::uint64_t addr) const -> icf_target {
+        icf_target result;
+        result.atom = this->address_atom (file, ordinal, addr);
+        if (result.atom == none) {
+            result.value = addr;
+        } else {
+            atom const & at = atoms_[result.atom];
+            result.value = addr - symbols_.file (file).sections ()[at.section].addr - at.start;
+        }
+        return result;
+    }
+
+    // icf_references
+    // ~~~~~~~~~~~~~~
+    template <typename Target>
+    void linker<Target>::icf_references (std::uint32_t file,
+                                         std::vector<std::uint32_t> const & candidate,
+                                         std::vector<icf_candidate> & candidates) const {
+        object_file const & obj = symbols_.file (file);
+        relocation_table const & rt = obj.relocations ();
+        std::vector<input_section> const & sections = obj.sections ();
+        for (std::uint32_t s = 0; s < sections.size (); ++s) {
+            input_section const & in = sections[s];
+            if (first_atom_[file][s] == first_atom_[file][s + 1U] ||
+                candidate[first_atom_[file][s]] == none) {
+                continue; // the section does not hold candidates
+            }
+            std::int64_t pending_addend = 0;
+            std::uint32_t const end = in.first_reloc + in.nreloc;
+            for (std::uint32_t r = in.first_reloc; r < end; ++r) {
+                auto const address = static_cast<std::uint32_t> (rt.address[r]);
+                std::uint8_t const * const field = in.contents.data () + address;
+                std::uint32_t const a = this->atom_of (file, s, address);
+                bool const ext = (rt.flags[r] & relocation_table::extern_flag) != 0U;
+                reloc_class const rc = traits::classify (rt.type[r], rt.length[r]);
+                if (rc == reloc_class::addend) {
+                    pending_addend = sign_extend24 (rt.symbolnum[r]);
+                    continue;
+                }
+                icf_ref ref;
+                ref.offset = address - atoms_[a].start;
+                ref.type = rt.type[r];
+                ref.length = rt.length[r];
+                ref.flags = rt.flags[r];
+                ref.addend = pending_addend;
+                pending_addend = 0;
+                if (ext) {
+                    ref.to = this->icf_target_of (file, rt.symbolnum[r]);
+                } else if (rc == reloc_class::pointer || rc == reloc_class::absolute32) {
+                    ref.to = this->icf_address_target (
+                        file, rt.symbolnum[r],
+                        static_cast<std::uint64_t> (read_signed (field, rt.length[r])));
+                } else if (rc != reloc_class::unsupported && rc != reloc_class::subtractor) {
+                    ref.to = this->icf_address_target (
+                        file, rt.symbolnum[r],
+                        traits::pcrel_target (rt.type[r], in.addr + address, field));
+                } else {
+                    ref.to.value = rt.symbolnum[r];
+                }
+                if (candidate[a] != none) {
+                    candidates[candidate[a]].refs.push_back (ref);
+                }
+            }
+        }
+    }
+
+    // fold_identical
+    // ~~~~~~~~~~~~~~
+    template <typename Target>
+    void linker<Target>::fold_identical () {
+        // The candidates are the live atoms of __TEXT,__text.
+        std::vector<icf_candidate> candidates;
+        std::vector<std::uint32_t> candidate (atoms_.size (), none); // by atom
+        for (std::uint32_t a = 0; a < atoms_.size (); ++a) {
+            atom const & at = atoms_[a];
+            input_section const & in = symbols_.file (at.file).sections ()[at.section];
+            if (live_[a] != 0U && at.size > 0U &&
+                std::strncmp (in.segname, mach_o::seg_text, sizeof (in.segname)) == 0 &&
+                std::strncmp (in.sectname, mach_o::sect_text, sizeof (in.sectname)) == 0) {
+                candidate[a] = narrow_cast<std::uint32_t> (candidates.size ());
+                candidates.push_back (
+                    {a, in.contents.data () + at.start, at.size, this->atom_align (at), {}});
+            }
+        }
+        if (candidates.size () < 2U) {
+            return;
+        }
+
+        pool_.parallel_for (symbols_.file_count (), [&] (std::size_t file) {
+            this->icf_references (narrow_cast<std::uint32_t> (file), candidate, candidates);
+        });
+        std::vector<std::uint32_t> const folded =
+            find_identical (candidates, atoms_.size (), pool_);
+        for (std::size_t c = 0; c < candidates.size (); ++c) {
+            std::uint32_t const a = candidates[c].atom;
+            if (folded[c] != a) {
+                atoms_[a].replacement = folded[c];
+            }
+        }
+    }
+
+
+    // for_each_definition
+    // ~~~~~~~~~~~~~~~~~~~
+    template <typename Target>
+    template <typename Function>
+    void linker<Target>::for_each_definition (
+        std::unordered_map<interned_string, std::uint32_t> const & names, Function f) const {
+        for (auto const & n : names) {
+            std::uint32_t const g = symbols_.find (n.first);
+            if (g != none) {
+                resolver::resolution const r = symbols_.get (g);
+                std::uint32_t const a = r.k == resolver::kind::defined
+                                            ? this->definition_atom (r.file, r.index)
+                                            : none;
+                if (a != none) {
+                    f (n.second, a);
+                }
+            }
+        }
+        std::uint32_t const files = symbols_.file_count ();
+        std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> locals (files);
+        pool_.parallel_for (files, [&] (std::size_t file) {
+            symbol_table const & st = symbols_.file (narrow_cast<std::uint32_t> (file)).symbols ();
+            for (std::uint32_t index = 0; index < st.size (); ++index) {
+                if ((st.type[index] & (mach_o::n_stab | mach_o::n_ext)) != 0U) {
+                    continue;
+                }
+                // Local names are not interned unless they appear in names.
+                interned_string const name = names_.find (st.name (index));
+                auto const it = name ? names.find (name) : std::end (names);
+                std::uint32_t const a =
+                    it != std::end (names)
+                        ? this->definition_atom (narrow_cast<std::uint32_t> (file), index)
+                        : none;
+                if (a != none) {
+                    locals[file].emplace_back (it->second, a);
+                }
+            }
+        });
+        for (auto const & l : locals) {
+            for (auto const & p : l) {
+                f (p.first, p.second);
+            }
+        }
+    }
+
+    // order_atoms
+    // ~~~~~~~~~~~
+    template <typename Target>
+    std::uint32_t linker<Target>::order_atoms () {
+        std::unordered_map<interned_string, std::uint32_t> const position =
+            read_order_file (options_.order_file, Target::name (), names_);
+        // An atom's rank is the earliest position of any of its symbols. Both external and
+        // local (static) definitions may be named; a name which is not defined is ignored.
+        this->for_each_definition (position, [this] (std::uint32_t pos, std::uint32_t a) {
+            if (atoms_[a].replacement != none) {
+                a = atoms_[a].replacement;
+            }
+            rank_[a] = std::min (rank_[a], pos);
+        });
+        return narrow_cast<std::uint32_t> (position.size ());
+    }
+
+    // order_by_profile
+    // ~~~~~~~~~~~~~~~~
+    template <typename Target>
+    void linker<Target>::order_by_profile (std::uint32_t first_rank) {
+        call_graph_profile const profile =
+            read_call_graph_profile (options_.call_graph_profile, names_);
+
+        // Map the nodes to the atoms which define them. Only functions take part.
+        std::vector<std::uint32_t> atom_of_node (profile.nodes.size (), none);
+        this->for_each_definition (profile.nodes, [&] (std::uint32_t node, std::uint32_t a) {
+            if (atoms_[a].replacement != none) {
+                a = atoms_[a].replacement;
+            }
+            atom const & at = atoms_[a];
+            input_section const & in = symbols_.file (at.file).sections ()[at.section];
+            if (atom_of_node[node] == none && live_[a] != 0U &&
+                (in.flags & mach_o::s_attr_pure_instructions) != 0U) {
+                atom_of_node[node] = a;
+            }
+        });
+        std::vector<weighted_call> calls;
+        calls.reserve (profile.calls.size ());
+        for (weighted_call const & c : profile.calls) {
+            std::uint32_t const from = atom_of_node[c.caller];
+            std::uint32_t const to = atom_of_node[c.callee];
+            if (from != none && to != none) {
+                calls.push_back ({from, to, c.weight});
+            }
+        }
+
+        std::uint32_t rank = first_rank;
+        for (std::uint32_t const a : cluster_functions (calls, [this] (std::uint32_t f) {
+                 return std::uint64_t{atoms_[f].size};
+             })) {
+            std::uint32_t & r = rank_[a];
+            if (r == none) { // the order file takes precedence
+                r = rank++;
+            }
+        }
+    }
+
+    // add_section
+    // ~~~~~~~~~~~
+    template <typename Target>
+    std::uint32_t linker<Target>::add_section (interned_string segname, interned_string sectname,
+                                               std::uint32_t flags, std::uint32_t align) {
+        output_section os;
+        os.segname = segname;
+        os.sectname = sectname;
+        os.text = segname == seg_text_;
+        os.flags = flags;
+        os.align = align;
+        sections_.push_back (std::move (os));
+        return narrow_cast<std::uint32_t> (sections_.size () - 1U);
+    }
+
+    // place_sections
+    // ~~~~~~~~~~~~~~
+    template <typename Target>
+    void linker<Target>::place_sections () {
+        std::uint32_t const files = symbols_.file_count ();
+        bool const split = !first_atom_.empty ();
+        // The atoms to be placed in each output section.
+        std::vector<std::vector<std::uint32_t>> pending;
+        placements_.resize (files);
+        for (std::uint32_t file = 0; file < files; ++file) {
+            std::vector<input_section> const & sections = symbols_.file (file).sections ();
+            placements_[file].resize (sections.size ());
+            for (std::uint32_t s = 0; s < sections.size (); ++s) {
+                input_section const & in = sections[s];
+                if (is_discarded (in)) {
+                    continue;
+                }
+                interned_string const segname = this->intern (in.segname);
+                interned_string const sectname = this->intern (in.sectname);
+                if (segname != seg_text_ && segname != seg_data_) {
+                    this->error (file, std::string{"section "} + segname.c_str () + ',' +
+                                           sectname.c_str () + " is in an unsupported segment");
+                }
+                // A section whose atoms were all dead stripped is dropped.
+                auto const first = split ? std::begin (live_) + first_atom_[file][s]
+                                         : std::end (live_);
+                auto const last = split ? std::begin (live_) + first_atom_[file][s + 1U]
+                                        : std::end (live_);
+                if (split && std::find (first, last, std::uint8_t{1}) == last) {
+                    continue;
+                }
+                auto pos = std::find_if (std::begin (sections_), std::end (sections_),
+                                         [&] (output_section const & os) {
+                                             return os.segname == segname &&
+                                                    os.sectname == sectname;
+                                         });
+                std::uint32_t const index =
+                    pos != std::end (sections_)
+                        ? narrow_cast<std::uint32_t> (pos - std::begin (sections_))
+                        : this->add_section (segname, sectname, in.flags, in.align);
+                output_section & os = sections_[index];
+                os.align = std::max (os.align, in.align);
+                // Literal sections are merged by merge_literals(). A section with relocations is
+                // copied as a whole.
+                if (literal_size (in.flags & mach_o::section_type) != 0U && in.nreloc == 0U) {
+                    placements_[file][s] = {index, 0,
+                                            narrow_cast<std::uint32_t> (literals_.size ())};
+                    literals_.push_back ({file, s, {}, {}});
+                    continue;
+                }
+                if (!split) {
+                    os.size = aligned (os.size, 1U << in.align);
+                    placements_[file][s] = {index, os.size};
+                    os.size += in.size;
+                    continue;
+                }
+                // The atoms are placed once the output section's atoms are all known.
+                placements_[file][s] = {index, 0, none, true};
+                if (index >= pending.size ()) {
+                    pending.resize (index + 1U);
+                }
+                for (auto a = first_atom_[file][s]; a < first_atom_[file][s + 1U]; ++a) {
+                    if (live_[a] != 0U && atoms_[a].replacement == none) {
+                        pending[index].push_back (a);
+                    }
+                }
+            }
+        }
+        // The atoms named by the order file come first, in its order, followed by the rest in
+        // input order. Each atom keeps the alignment implied by its offset in the input.
+        for (std::uint32_t index = 0; index < pending.size (); ++index) {
+            std::vector<std::uint32_t> & order = pending[index];
+            if (!rank_.empty ()) {
+                std::stable_sort (std::begin (order), std::end (order),
+                                  [this] (std::uint32_t a, std::uint32_t b) noexcept {
+                                      return rank_[a] < rank_[b];
+                                  });
+            }
+            output_section & os = sections_[index];
+            for (std::uint32_t const a : order) {
+                atom & at = atoms_[a];
+                os.size = aligned (os.size, std::uint64_t{1} << this->atom_align (at));
+                at.offset = os.size;
+                os.size += at.size;
+            }
+        }
+        // A folded atom shares the copy of the atom which replaced it.
+        for (atom & at : atoms_) {
+            if (at.replacement != none) {
+                at.offset = atoms_[at.replacement].offset;
+            }
+        }
+
+        // Common symbols are allocated, in name order, in __DATA,__common.
+        common_offset_.assign (symbols_.global_limit (), 0U);
+        for (std::uint32_t const g : symbols_.globals ()) {
+            resolver::resolution const r = symbols_.get (g);
+            if (r.k != resolver::kind::common) {
+                continue;
+            }
+            if (common_section_ == none) {
+                common_section_ = this->add_section (seg_data_, names_.intern (mach_o::sect_common),
+                                                     mach_o::s_zerofill, 0);
+            }
+            output_section & os = sections_[common_section_];
+            os.align = std::max (os.align, std::uint32_t{r.common_align});
+            os.size = aligned (os.size, 1U << r.common_align);
+            common_offset_[g] = os.size;
+            os.size += r.common_size;
+        }
+    }
+
+    // merge_literals
+    // ~~~~~~~~~~~~~~
+    template <typename Target>
+    void linker<Target>::merge_literals () {
+        if (literals_.empty ()) {
+            return;
+        }
+        // Split each section into its literals and enter them in the table.
+        pool_.parallel_for (literals_.size (), [this] (std::size_t ctr) {
+            literal_map & m = literals_[ctr];
+            input_section const & in = symbols_.file (m.file).sections ()[m.section];
+            std::uint32_t const output = placements_[m.file][m.section].section;
+            std::size_t const size = literal_size (in.flags & mach_o::section_type);
+            std::uint8_t const * const first = in.contents.data ();
+            std::uint8_t const * const last = first + in.contents.size ();
+            for (std::uint8_t const * p = first; p < last;) {
+                std::uint8_t const * end = p + size;
+                if (size == 1U) {
+                    end = std::find (p, last, std::uint8_t{0});
+                    if (end == last) {
+                        this->error (m.file, std::string{"unterminated string in "} +
+                                                 name_of (in.sectname));
+                    }
+                    ++end; // include the terminating NUL
+                } else if (end > last) {
+                    this->error (m.file, "partial literal at the end of " + name_of (in.sectname));
+                }
+                auto const index = narrow_cast<std::uint32_t> (m.start.size ());
+                m.start.push_back (static_cast<std::uint32_t> (p - first));
+                m.entry.push_back (literal_table_.add (
+                    output, p, static_cast<std::size_t> (end - p),
+                    (std::uint64_t{narrow_cast<std::uint32_t> (ctr)} << 32) | index, in.align));
+                p = end;
+            }
+        });
+
+        // Give each distinct literal its offset: the literals are appended to their output
+        // sections in the order of their first copies.
+        for (std::size_t ctr = 0; ctr < literals_.size (); ++ctr) {
+            literal_map const & m = literals_[ctr];
+            input_section const & in = symbols_.file (m.file).sections ()[m.section];
+            output_section & os = sections_[placements_[m.file][m.section].section];
+            for (std::uint32_t index = 0; index < m.start.size (); ++index) {
+                literal_table::entry * const e = m.entry[index];
+                if (e->first == ((std::uint64_t{ctr} << 32) | index)) {
+                    std::uint32_t const end =
+                        index + 1U < m.start.size () ? m.start[index + 1U]
+                                                     : narrow_cast<std::uint32_t> (in.size);
+                    os.align = std::max (os.align, e->align);
+                    os.size = aligned (os.size, std::uint64_t{1} << e->align);
+                    e->offset = os.size;
+                    os.size += end - m.start[index];
+                }
+            }
+        }
+    }
+
+    // scan
+    // ~~~~
+    template <typename Target>
+    auto linker<Target>::scan (std::uint32_t file) const -> scan_result {
+        scan_result result;
+        object_file const & obj = symbols_.file (file);
+        relocation_table const & rt = obj.relocations ();
+        std::vector<input_section> const & sections = obj.sections ();
+        for (std::uint32_t s = 0; s < sections.size (); ++s) {
+            placement const & p = placements_[file][s];
+            if (p.section == none) {
+                continue;
+            }
+            input_section const & in = sections[s];
+            std::uint32_t const end = in.first_reloc + in.nreloc;
+            for (std::uint32_t r = in.first_reloc; r < end; ++r) {
+                bool const ext = (rt.flags[r] & relocation_table::extern_flag) != 0U;
+                std::uint32_t const g = ext ? this->global_of (file, rt.symbolnum[r]) : none;
+                reloc_class const rc = traits::classify (rt.type[r], rt.length[r]);
+                if (!this->is_copied (file, s, rt.address[r])) {
+                    // The references of a dead or folded atom are dropped along with it.
+                    r += rc == reloc_class::subtractor ? 1U : 0U;
+                    continue;
+                }
+                switch (rc) {
+                case reloc_class::other:
+                    if (this->is_import (g)) {
+                        this->error (file, std::string{"'"} + symbols_.get (g).name.c_str () +
+                                               "' is defined in a dylib and must be referenced "
+                                               "through the GOT");
+                    }
+                    break;
+                case reloc_class::pointer:
+                    if (sections_[p.section].is_text ()) {
+                        this->error (file, std::string{"absolute address in "} +
+                                               sections_[p.section].sectname.c_str () +
+                                               " (text relocations are not supported)");
+                    }
+                    result.pointers.push_back (
+                        {p.section, this->output_offset (file, s, rt.address[r]),
+                         this->is_import (g) ? g : none,
+                         read_signed (in.contents.data () + rt.address[r], 3)});
+                    break;
+                case reloc_class::absolute32:
+                    this->error (file, std::string{"32-bit absolute address in "} +
+                                           sections_[p.section].sectname.c_str () +
+                                           " (not possible in a position independent executable)");
+                case reloc_class::subtractor:
+                    ++r; // skip the UNSIGNED which completes the pair
+                    break;
+                case reloc_class::branch:
+                    if (this->is_import (g)) {
+                        result.stubs.push_back (g);
+                    }
+                    break;
+                case reloc_class::got:
+                    if (g == none) {
+                        this->error (file, "GOT reference to a local symbol");
+                    }
+                    result.got.push_back (g);
+                    break;
+                case reloc_class::addend: break;
+                case reloc_class::unsupported:
+                    this->error (file, "unsupported relocation type " +
+                                           std::to_string (unsigned{rt.type[r]}) + " in " +
+                                           sections_[p.section].sectname.c_str ());
+                }
+            }
+        }
+        return result;
+    }
+
+    // scan_relocations
+    // ~~~~~~~~~~~~~~~~
+    template <typename Target>
+    void linker<Target>::scan_relocations () {
+        std::uint32_t const files = symbols_.file_count ();
+        std::vector<scan_result> results (files);
+        pool_.parallel_for (files, [&] (std::size_t file) {
+            results[file] = this->scan (narrow_cast<std::uint32_t> (file));
+        });
+
+        // Merge the results. Slots and stubs are allocated in name order.
+        std::vector<std::uint8_t> needs (symbols_.global_limit (), 0U);
+        enum : std::uint8_t { needs_got = 1U << 0, needs_stub = 1U << 1 };
+        for (scan_result & r : results) {
+            for (std::uint32_t const g : r.got) {
+                needs[g] |= needs_got;
+            }
+            for (std::uint32_t const g : r.stubs) {
+                needs[g] |= needs_stub;
+            }
+            pointers_.insert (std::end (pointers_), std::begin (r.pointers), std::end (r.pointers));
+        }
+        bound_.assign (symbols_.global_limit (), 0U);
+        for (pointer const & ptr : pointers_) {
+            if (ptr.global != none) {
+                bound_[ptr.global] = 1U;
+            }
+        }
+        got_index_.assign (symbols_.global_limit (), none);
+        stub_index_.assign (symbols_.global_limit (), none);
+        for (std::uint32_t const g : symbols_.globals ()) {
+            if ((needs[g] & needs_stub) != 0U) {
+                // A stub jumps through the symbol's GOT slot.
+                needs[g] |= needs_got;
+                stub_index_[g] = narrow_cast<std::uint32_t> (stubs_.size ());
+                stubs_.push_back (g);
+            }
+            if ((needs[g] & needs_got) != 0U) {
+                got_index_[g] = narrow_cast<std::uint32_t> (got_.size ());
+                got_.push_back (g);
+                bound_[g] = 1U;
+            }
+        }
+
+        if (!stubs_.empty ()) {
+            stub_section_ = this->add_section (
+                seg_text_, names_.intern ("__stubs"),
+                mach_o::s_symbol_stubs | mach_o::s_attr_pure_instructions |
+                    mach_o::s_attr_some_instructions,
+                Target::cpu_type () == mach_o::cpu_type::arm64 ? 2U : 1U);
+            output_section & os = sections_[stub_section_];
+            os.size = stubs_.size () * traits::stub_size ();
+            os.reserved2 = narrow_cast<std::uint32_t> (traits::stub_size ());
+            os.contents.reserve (os.size);
+            for (std::size_t ctr = 0; ctr < stubs_.size (); ++ctr) {
+                os.contents.insert (std::end (os.contents), traits::stub (),
+                                    traits::stub () + traits::stub_size ());
+            }
+        }
+        if (!got_.empty ()) {
+            got_section_ = this->add_section (seg_data_, names_.intern ("__got"),
+                                              mach_o::s_non_lazy_symbol_pointers, 3U);
+            output_section & os = sections_[got_section_];
+            os.size = got_.size () * sizeof (std::uint64_t);
+            os.contents.assign (os.size, 0U);
+        }
+    }
+
+    // copy_contents
+    // ~~~~~~~~~~~~~
+    template <typename Target>
+    void linker<Target>::copy_contents () {
+        struct item {
+            std::uint32_t file;
+            std::uint32_t section;
+        };
+        std::vector<item> items;
+        for (output_section & os : sections_) {
+            if (!os.is_zerofill () && os.contents.empty ()) {
+                os.contents.assign (os.size, 0U);
+            }
+        }
+        for (std::uint32_t file = 0; file < placements_.size (); ++file) {
+            for (std::uint32_t s = 0; s < placements_[file].size (); ++s) {
+                if (placements_[file][s].section != none) {
+                    items.push_back ({file, s});
+                }
+            }
+        }
+        pool_.parallel_for (items.size (), [&] (std::size_t ctr) {
+            item const & it = items[ctr];
+            placement const & p = placements_[it.file][it.section];
+            input_section const & in = symbols_.file (it.file).sections ()[it.section];
+            output_section & os = sections_[p.section];
+            if (os.is_zerofill () || in.contents.empty ()) {
+                return;
+            }
+            if (p.split) {
+                for (auto a = first_atom_[it.file][it.section];
+                     a < first_atom_[it.file][it.section + 1U]; ++a) {
+                    atom const & at = atoms_[a];
+                    if (live_[a] != 0U && at.replacement == none) {
+                        std::memcpy (os.contents.data () + at.offset,
+                                     in.contents.data () + at.start, at.size);
+                    }
+                }
+                return;
+            }
+            if (p.literals == none) {
+                std::memcpy (os.contents.data () + p.offset, in.contents.data (),
+                             in.contents.size ());
+                return;
+            }
+            // Only the first copy of each literal is written.
+            literal_map const & m = literals_[p.literals];
+            auto const id = narrow_cast<std::uint32_t> (p.literals);
+            for (std::uint32_t index = 0; index < m.start.size (); ++index) {
+                literal_table::entry const * const e = m.entry[index];
+                if (e->first == ((std::uint64_t{id} << 32) | index)) {
+                    std::size_t const end = index + 1U < m.start.size () ? m.start[index + 1U]
+                                                                         : in.contents.size ();
+                    std::memcpy (os.contents.data () + e->offset,
+                                 in.contents.data () + m.start[index], end - m.start[index]);
+                }
+            }
+        });
+    }
+
+    // prepare
+    // ~~~~~~~
+    template <typename Target>
+    void linker<Target>::prepare () {
+        this->load ();
+        this->check_symbols ();
+        bool const order = !options_.order_file.empty () || !options_.call_graph_profile.empty ();
+        if (options_.dead_strip || options_.fold_identical_code || order) {
+            this->make_atoms ();
+            if (options_.dead_strip) {
+                this->dead_strip ();
+            } else {
+                live_.assign (atoms_.size (), 1U);
+            }
+            if (options_.fold_identical_code) {
+                this->fold_identical ();
+            }
+            if (order) {
+                rank_.assign (atoms_.size (), none);
+                std::uint32_t const first =
+                    options_.order_file.empty () ? 0U : this->order_atoms ();
+                if (!options_.call_graph_profile.empty ()) {
+                    this->order_by_profile (first);
+                }
+            }
+        }
+        this->place_sections ();
+        this->merge_literals ();
+        this->scan_relocations ();
+        this->copy_contents ();
+    }
+
+    // output_offset
+    // ~~~~~~~~~~~~~
+    template <typename Target>
+    std::uint64_t linker<Target>::output_offset (std::uint32_t file, std::uint32_t section,
+                                                 std::uint64_t offset) const {
+        placement const & p = placements_[file][section];
+        if (p.section == none) {
+            this->error (file, "reference to a discarded section");
+        }
+        if (p.split) {
+            std::uint32_t const a = this->atom_of (file, section, offset);
+            if (live_[a] == 0U) {
+                this->error (file, "reference to a dead-stripped atom");
+            }
+            return atoms_[a].offset + (offset - atoms_[a].start);
+        }
+        if (p.literals == none) {
+            return p.offset + offset;
+        }
+        // Find the literal which contains the offset.
+        literal_map const & m = literals_[p.literals];
+        auto const it = std::upper_bound (std::begin (m.start), std::end (m.start), offset);
+        if (it == std::begin (m.start)) {
+            this->error (file, "reference to an empty literal section");
+        }
+        auto const index = static_cast<std::size_t> (it - std::begin (m.start)) - 1U;
+        return m.entry[index]->offset + (offset - m.start[index]);
+    }
+
+    // input_address
+    // ~~~~~~~~~~~~~
+    template <typename Target>
+    std::uint64_t linker<Target>::input_address (std::uint32_t file, std::uint32_t ordinal,
+                                                 std::uint64_t addr) const {
+        assert (ordinal > 0U);
+        std::uint32_t const section = ordinal - 1U;
+        input_section const & in = symbols_.file (file).sections ()[section];
+        return sections_[placements_[file][section].section].addr () +
+               this->output_offset (file, section, addr - in.addr);
+    }
+
+    // definition_address
+    // ~~~~~~~~~~~~~~~~~~
+    template <typename Target>
+    std::uint64_t linker<Target>::definition_address (std::uint32_t file, std::uint32_t index,
+                                                      std::int64_t addend) const {
+        symbol_table const & st = symbols_.file (file).symbols ();
+        if ((st.type[index] & mach_o::n_type) == mach_o::n_sect) {
+            return this->input_address (file, st.sect[index],
+                                        st.value[index] + static_cast<std::uint64_t> (addend));
+        }
+        return st.value[index] + static_cast<std::uint64_t> (addend);
+    }
+
+    // symbol_address
+    // ~~~~~~~~~~~~~~
+    template <typename Target>
+    std::uint64_t linker<Target>::symbol_address (std::uint32_t file, std::uint32_t index,
+                                                  std::int64_t addend) const {
+        std::uint32_t const g = this->global_of (file, index);
+        if (g == none) {
+            return this->definition_address (file, index, addend);
+        }
+        resolver::resolution const r = symbols_.get (g);
+        switch (r.k) {
+        case resolver::kind::defined: return this->definition_address (r.file, r.index, addend);
+        case resolver::kind::common:
+            return sections_[common_section_].addr () + common_offset_[g] +
+                   static_cast<std::uint64_t> (addend);
+        case resolver::kind::undefined: break;
+        }
+        return 0; // bound by dyld
+    }
+
+    // apply
+    // ~~~~~
+    template <typename Target>
+    void linker<Target>::apply (relocation_engine<Target> const & engine,
+                                output_section const & os, std::uint64_t offset,
+                                std::uint64_t size, std::string const & where) const {
+        if (engine.size () == 0U) {
+            return;
+        }
+        // The output section's buffer is logically const: patching it is idempotent.
+        auto * const contents = const_cast<std::uint8_t *> (os.contents.data ()) + offset;
+        std::vector<std::uint64_t> errors;
+        try {
+            errors = engine.apply (contents, narrow_cast<std::size_t> (size), os.addr () + offset);
+        } catch (relocation_error const & ex) {
+            throw link_error (where + ": " + ex.what ());
+        }
+        if (!errors.empty ()) {
+            throw link_error (where + ": relocation at offset " + std::to_string (errors.front ()) +
+                              " of " + os.sectname.c_str () + " is out of range");
+        }
+    }
+
+    // relocate_section
+    // ~~~~~~~~~~~~~~~~
+    template <typename Target>
+    void linker<Target>::relocate_section (std::uint32_t file, std::uint32_t section) const {
+        object_file const & obj = symbols_.file (file);
+        input_section const & in = obj.sections ()[section];
+        placement const & p = placements_[file][section];
+        relocation_table const & rt = obj.relocations ();
+
+        relocation_engine<Target> engine;
+        std::int64_t pending_addend = 0; // from an ARM64_RELOC_ADDEND
+        std::uint32_t const end = in.first_reloc + in.nreloc;
+        for (std::uint32_t r = in.first_reloc; r < end; ++r) {
+            auto const address = static_cast<std::uint32_t> (rt.address[r]);
+            std::uint8_t const * const field = in.contents.data () + address;
+            std::uint32_t const symbolnum = rt.symbolnum[r];
+            bool const ext = (rt.flags[r] & relocation_table::extern_flag) != 0U;
+            reloc_class const rc = traits::classify (rt.type[r], rt.length[r]);
+            if (!this->is_copied (file, section, address)) {
+                r += rc == reloc_class::subtractor ? 1U : 0U;
+                continue;
+            }
+            // The fixups are relative to the start of the output section: the section's atoms
+            // need not be contiguous.
+            fixup f{this->output_offset (file, section, address), 0, 0, 0, rt.type[r],
+                    rt.length[r]};
+
+            switch (rc) {
+            case reloc_class::addend:
+                pending_addend = sign_extend24 (symbolnum);
+                continue;
+            case reloc_class::subtractor: {
+                if (r + 1U >= end) {
+                    this->error (file, "SUBTRACTOR relocation without its UNSIGNED pair");
+                }
+                f.subtrahend = this->symbol_address (file, symbolnum);
+                ++r;
+                std::int64_t const v = read_signed (field, f.length);
+                if ((rt.flags[r] & relocation_table::extern_flag) != 0U) {
+                    f.target = this->symbol_address (file, rt.symbolnum[r], v);
+                } else {
+                    f.target = this->input_address (file, rt.symbolnum[r],
+                                                    static_cast<std::uint64_t> (v));
+                }
+            } break;
+            case reloc_class::pointer:
+            case reloc_class::absolute32: {
+                std::int64_t const v = read_signed (field, f.length);
+                if (!ext) {
+                    f.target =
+                        this->input_address (file, symbolnum, static_cast<std::uint64_t> (v));
+                } else if (!this->is_import (this->global_of (file, symbolnum))) {
+                    f.target = this->symbol_address (file, symbolnum, v + pending_addend);
+                }
+                // else: left as zero and bound by dyld.
+            } break;
+            case reloc_class::got:
+                f.target = sections_[got_section_].addr () +
+                           got_index_[this->global_of (file, symbolnum)] * sizeof (std::uint64_t);
+                f.addend = traits::implicit_addend (f.type, field) + pending_addend;
+                break;
+            case reloc_class::branch:
+            case reloc_class::other:
+                if (ext) {
+                    std::uint32_t const g = this->global_of (file, symbolnum);
+                    std::int64_t const addend =
+                        traits::implicit_addend (f.type, field) + pending_addend;
+                    if (this->is_import (g)) {
+                        f.target = sections_[stub_section_].addr () +
+                                   stub_index_[g] * traits::stub_size ();
+                        f.addend = addend;
+                    } else {
+                        f.target = this->symbol_address (file, symbolnum, addend);
+                    }
+                } else {
+                    f.target = this->input_address (
+                        file, symbolnum, traits::pcrel_target (f.type, in.addr + address, field));
+                }
+                break;
+            case reloc_class::unsupported:
+                assert (false && "unsupported relocations are rejected by scan()");
+                break;
+            }
+            pending_addend = 0;
+            try {
+                engine.add (f);
+            } catch (relocation_error const & ex) {
+                this->error (file, ex.what ());
+            }
+        }
+        output_section const & os = sections_[p.section];
+        this->apply (engine, os, 0, os.size, obj.path () + '(' + name_of (in.sectname) + ')');
+    }
+
+    // relocate_synthesized
+    // ~~~~~~~~~~~~~~~~~~~~
+    template <typename Target>
+    void linker<Target>::relocate_synthesized () const {
+        if (got_section_ != none) {
+            // Slots for symbols defined in the image hold their addresses; the rest are bound.
+            relocation_engine<Target> engine;
+            output_section const & got = sections_[got_section_];
+            for (std::size_t slot = 0; slot < got_.size (); ++slot) {
+                std::uint32_t const g = got_[slot];
+                if (!this->is_import (g)) {
+                    resolver::resolution const r = symbols_.get (g);
+                    std::uint64_t const target =
+                        r.k == resolver::kind::common
+                            ? sections_[common_section_].addr () + common_offset_[g]
+                            : this->definition_address (r.file, r.index);
+                    // An UNSIGNED type is 0 for both of the targets.
+                    engine.add ({slot * sizeof (std::uint64_t), target, 0, 0, 0, 3});
+                }
+            }
+            this->apply (engine, got, 0, got.size, got.sectname.c_str ());
+        }
+        if (stub_section_ != none) {
+            relocation_engine<Target> engine;
+            output_section const & stubs = sections_[stub_section_];
+            std::uint64_t const got_addr = sections_[got_section_].addr ();
+            for (std::size_t stub = 0; stub < stubs_.size (); ++stub) {
+                traits::add_stub_fixups (engine, stub * traits::stub_size (),
+                                         got_addr + got_index_[stubs_[stub]] *
+                                                        sizeof (std::uint64_t));
+            }
+            this->apply (engine, stubs, 0, stubs.size, stubs.sectname.c_str ());
+        }
+    }
+
+    // relocate
+    // ~~~~~~~~
+    template <typename Target>
+    void linker<Target>::relocate () const {
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> items;
+        for (std::uint32_t file = 0; file < placements_.size (); ++file) {
+            std::vector<input_section> const & sections = symbols_.file (file).sections ();
+            for (std::uint32_t s = 0; s < sections.size (); ++s) {
+                if (placements_[file][s].section != none && sections[s].nreloc > 0U) {
+                    items.emplace_back (file, s);
+                }
+            }
+        }
+        // The last item patches the GOT and stubs.
+        pool_.parallel_for (items.size () + 1U, [&] (std::size_t ctr) {
+            if (ctr == items.size ()) {
+                this->relocate_synthesized ();
+            } else {
+                this->relocate_section (items[ctr].first, items[ctr].second);
+            }
+        });
+    }
+
+    // build_commands
+    // ~~~~~~~~~~~~~~
+    template <typename Target>
+    std::vector<std::unique_ptr<command>> linker<Target>::build_commands () {
+        // Order the output sections: __text first, then the stubs, then the rest of __TEXT.
+        // __DATA starts with the GOT and ends with the zero-fill sections.
+        std::vector<std::uint32_t> text;
+        std::vector<std::uint32_t> data;
+        std::vector<std::uint32_t> zerofill;
+        for (std::uint32_t index = 0; index < sections_.size (); ++index) {
+            output_section const & os = sections_[index];
+            if (index == stub_section_ || index == got_section_ || index == common_section_) {
+                continue;
+            }
+            if (os.is_text ()) {
+                text.insert (os.sectname == sect_text_ ? std::begin (text) : std::end (text),
+                             index);
+            } else {
+                (os.is_zerofill () ? zerofill : data).push_back (index);
+            }
+        }
+        if (stub_section_ != none) {
+            bool const has_text = !text.empty () && sections_[text.front ()].sectname == sect_text_;
+            text.insert (std::begin (text) + (has_text ? 1 : 0), stub_section_);
+        }
+        if (got_section_ != none) {
+            data.insert (std::begin (data), got_section_);
+        }
+        data.insert (std::end (data), std::begin (zerofill), std::end (zerofill));
+        if (common_section_ != none) {
+            data.push_back (common_section_);
+        }
+
+        auto const make_segment = [] (char const * segname, mach_o::vm_prot_t initprot,
+                                      std::uint64_t vmaddr) {
+            return std::make_unique<lc_segment> (segname, position (vmaddr, 0x0),
+                                                 mach_o::vm_prot_all, initprot, 0x00,
+                                                 Target::page_size ());
+        };
+        auto page_zero = std::make_unique<lc_segment> (
+            mach_o::seg_pagezero, position (0x0, text_vmaddr), mach_o::vm_prot_none,
+            mach_o::vm_prot_none, 0x00, Target::page_size ());
+        auto text_segment = std::make_unique<lc_text_segment> (
+            mach_o::seg_text, position (text_vmaddr, 0x0), mach_o::vm_prot_all,
+            mach_o::vm_prot_execute | mach_o::vm_prot_read, 0x00, Target::page_size ());
+        auto data_segment = make_segment (mach_o::seg_data,
+                                          mach_o::vm_prot_write | mach_o::vm_prot_read, 0x0);
+        auto linkedit_segment = make_segment (mach_o::seg_linkedit, mach_o::vm_prot_read, 0x0);
+        data_segment->follow (text_segment.get ());
+        linkedit_segment->follow (data.empty ()
+                                      ? static_cast<lc_segment const *> (text_segment.get ())
+                                      : data_segment.get ());
+
+        auto symtab = std::make_unique<lc_symtab> ();
+        auto dysymtab = std::make_unique<lc_dysymtab> (symtab.get ());
+        auto dyld_info = std::make_unique<lc_dyld_info_only> ();
+
+        // The indirect symbol table holds an entry for each stub followed by one for each GOT
+        // slot. The entries are filled in once the symbols have been numbered.
+        if (stub_section_ != none) {
+            sections_[stub_section_].reserved1 = 0;
+        }
+        if (got_section_ != none) {
+            sections_[got_section_].reserved1 = narrow_cast<std::uint32_t> (stubs_.size ());
+        }
+
+        std::uint8_t ordinal = 0;
+        auto const add_sections = [&] (lc_segment & segment,
+                                       std::vector<std::uint32_t> const & order) {
+            for (std::uint32_t const index : order) {
+                output_section & os = sections_[index];
+                mach_o::section_64 header{os.sectname.c_str (), os.segname.c_str (), 0, os.size, 0,
+                                          os.align, 0, 0, os.flags};
+                header.reserved1 = os.reserved1;
+                header.reserved2 = os.reserved2;
+                segment.add_section (header, lc_segment::contents_range (
+                                                 os.contents.data (),
+                                                 os.contents.data () + os.contents.size ()));
+                if (ordinal == mach_o::max_sect) {
+                    throw link_error ("too many output sections");
+                }
+                os.ordinal = ++ordinal;
+            }
+            // Now that the segment's section list is complete, its entries will not move.
+            for (std::size_t ctr = 0; ctr < order.size (); ++ctr) {
+                sections_[order[ctr]].value = &segment[ctr];
+            }
+        };
+        add_sections (*text_segment, text);
+        add_sections (*data_segment, data);
+
+        // The symbol table: local symbols (in file order), then external definitions and then
+        // imports (each in name order).
+        std::uint32_t const files = symbols_.file_count ();
+        for (std::uint32_t file = 0; file < files; ++file) {
+            object_file const & obj = symbols_.file (file);
+            symbol_table const & st = obj.symbols ();
+            for (std::uint32_t index = 0; index < st.size (); ++index) {
+                std::uint8_t const type = st.type[index];
+                if ((type & mach_o::n_stab) != 0U || (type & mach_o::n_type) != mach_o::n_sect) {
+                    continue;
+                }
+                bool const pext = (type & mach_o::n_pext) != 0U;
+                if ((type & mach_o::n_ext) != 0U) {
+                    // Private externals become local symbols: only the winning definition.
+                    resolver::resolution const r = symbols_.get (symbols_.global (file, index));
+                    if (!pext || r.file != file || r.index != index) {
+                        continue;
+                    }
+                }
+                char const * const name = st.name (index);
+                // Assembler-local labels (L and l prefixes) are not kept.
+                if (name[0] == 'L' || name[0] == 'l') {
+                    continue;
+                }
+                placement const & p = placements_[file][st.sect[index] - 1U];
+                if (p.section == none) {
+                    continue;
+                }
+                output_section const & os = sections_[p.section];
+                input_section const & in = obj.sections ()[st.sect[index] - 1U];
+                if (!this->is_live (file, st.sect[index] - 1U, st.value[index] - in.addr)) {
+                    continue;
+                }
+                auto const n_type =
+                    static_cast<std::uint8_t> (mach_o::n_sect | (pext ? mach_o::n_pext : 0U));
+                symtab->add (names_.intern (name), n_type, os.ordinal, 0, os.value,
+                             this->output_offset (file, st.sect[index] - 1U,
+                                                  st.value[index] - in.addr));
+            }
+        }
+        std::vector<std::uint32_t> const globals = symbols_.globals ();
+        std::vector<std::uint32_t> symbol_index (symbols_.global_limit (), none);
+        for (std::uint32_t const g : globals) {
+            resolver::resolution const r = symbols_.get (g);
+            if (r.k == resolver::kind::common) {
+                output_section const & os = sections_[common_section_];
+                symbol_index[g] = symtab->add (r.name, mach_o::n_sect | mach_o::n_ext, os.ordinal,
+                                               0, os.value, common_offset_[g]);
+                continue;
+            }
+            if (r.k != resolver::kind::defined) {
+                continue;
+            }
+            symbol_table const & st = symbols_.file (r.file).symbols ();
+            if ((st.type[r.index] & mach_o::n_pext) != 0U) {
+                continue;
+            }
+            std::uint16_t const desc = st.desc[r.index] & mach_o::n_weak_def;
+            if ((st.type[r.index] & mach_o::n_type) != mach_o::n_sect) {
+                symbol_index[g] = symtab->add (r.name, mach_o::n_abs | mach_o::n_ext,
+                                               mach_o::no_sect, desc, nullptr, st.value[r.index]);
+                continue;
+            }
+            input_section const & in = symbols_.file (r.file).sections ()[st.sect[r.index] - 1U];
+            if (!this->is_live (r.file, st.sect[r.index] - 1U, st.value[r.index] - in.addr)) {
+                continue; // dead stripped
+            }
+            placement const & p = placements_[r.file][st.sect[r.index] - 1U];
+            if (p.section == none) {
+                this->error (r.file, std::string{"'"} + r.name.c_str () +
+                                         "' is in a discarded section");
+            }
+            output_section const & os = sections_[p.section];
+            symbol_index[g] = symtab->add (
+                r.name, mach_o::n_sect | mach_o::n_ext, os.ordinal, desc, os.value,
+                this->output_offset (r.file, st.sect[r.index] - 1U, st.value[r.index] - in.addr));
+        }
+        for (std::uint32_t const g : globals) {
+            resolver::resolution const r = symbols_.get (g);
+            // An import which is referenced only by dead-stripped atoms is dropped.
+            if (r.k == resolver::kind::undefined && (!options_.dead_strip || bound_[g] != 0U)) {
+                auto const desc = mach_o::set_library_ordinal (
+                    r.weak_ref ? mach_o::n_weak_ref : std::uint16_t{0},
+                    std::uint8_t{libsystem_ordinal});
+                symbol_index[g] = symtab->add (r.name, mach_o::n_undf | mach_o::n_ext,
+                                               mach_o::no_sect, desc, nullptr, 0);
+            }
+        }
+
+        // The indirect symbol table, binding and rebasing.
+        for (std::uint32_t const g : stubs_) {
+            dysymtab->add_indirect (symbol_index[g]);
+        }
+        for (std::size_t slot = 0; slot < got_.size (); ++slot) {
+            std::uint32_t const g = got_[slot];
+            lc_dyld_info_only::location const where{data_segment_index, data_segment.get (),
+                                                    sections_[got_section_].value,
+                                                    slot * sizeof (std::uint64_t)};
+            if (this->is_import (g)) {
+                dysymtab->add_indirect (symbol_index[g]);
+                dyld_info->add_bind (where, symbols_.get (g).name, libsystem_ordinal, 0,
+                                     symbols_.get (g).weak_ref);
+            } else {
+                dysymtab->add_indirect (symbol_index[g] != none ? symbol_index[g]
+                                                                : mach_o::indirect_symbol_local);
+                dyld_info->add_rebase (where);
+            }
+        }
+        for (pointer const & ptr : pointers_) {
+            lc_dyld_info_only::location const where{data_segment_index, data_segment.get (),
+                                                    sections_[ptr.section].value, ptr.offset};
+            if (ptr.global != none) {
+                dyld_info->add_bind (where, symbols_.get (ptr.global).name, libsystem_ordinal,
+                                     ptr.addend, symbols_.get (ptr.global).weak_ref);
+            } else {
+                dyld_info->add_rebase (where);
+            }
+        }
+
+        // The entry point.
+        std::uint32_t const entry = symbols_.find (names_.find (options_.entry.c_str ()));
+        resolver::resolution const er =
+            entry != none ? symbols_.get (entry) : resolver::resolution{};
+        if (entry == none || er.k != resolver::kind::defined) {
+            throw link_error ("entry point '" + options_.entry + "' is not defined");
+        }
+        symbol_table const & est = symbols_.file (er.file).symbols ();
+        if ((est.type[er.index] & mach_o::n_type) != mach_o::n_sect) {
+            throw link_error ("entry point '" + options_.entry + "' is not in a section");
+        }
+        placement const & ep = placements_[er.file][est.sect[er.index] - 1U];
+        input_section const & ein = symbols_.file (er.file).sections ()[est.sect[er.index] - 1U];
+        if (ep.section == none || !sections_[ep.section].is_text ()) {
+            throw link_error ("entry point '" + options_.entry + "' is not in __TEXT");
+        }
+
+        linkedit_segment->add_blob (dyld_info.get ());
+        linkedit_segment->add_blob (symtab.get ());
+        linkedit_segment->add_blob (dysymtab.get ());
+
+        std::vector<std::unique_ptr<command>> commands;
+        commands.emplace_back (std::move (page_zero));
+        commands.emplace_back (std::move (text_segment));
+        if (!data.empty ()) {
+            commands.emplace_back (std::move (data_segment));
+        }
+        commands.emplace_back (std::move (linkedit_segment)); // must be last and not writable.
+        commands.emplace_back (std::move (dyld_info));
+        commands.emplace_back (std::move (symtab));
+        commands.emplace_back (std::move (dysymtab));
+        commands.emplace_back (std::make_unique<lc_load_dylinker> ());
+        commands.emplace_back (std::make_unique<lc_uuid> ());
+        commands.emplace_back (std::make_unique<lc_build_version> (
+            mach_o::platform_macos, Target::min_os_version (), Target::min_os_version ()));
+        commands.emplace_back (std::make_unique<lc_main> (
+            sections_[ep.section].value,
+            this->output_offset (er.file, est.sect[er.index] - 1U,
+                                 est.value[er.index] - ein.addr)));
+        commands.emplace_back (std::make_unique<lc_load_dylib> (names_.intern (libsystem_path)));
+        return commands;
+    }
+
+} // end anonymous namespace
+
+// link
+// ~~~~
+template <typename Target>
+image link (link_options const & options, thread_pool & pool,
+            std::shared_ptr<string_arena> names) {
+    auto l = std::make_shared<linker<Target>> (options, pool, std::move (names));
+    l->prepare ();
+    image result{Target::cpu_type (), Target::cpu_subtype (), mach_o::filetype_t::execute,
+                 mach_o::mh_noundefs | mach_o::mh_dyldlink | mach_o::mh_twolevel | mach_o::mh_pie,
+                 l->build_commands ()};
+    result.reserve_header_pad (options.header_pad, options.header_pad_max_install_names);
+    result.on_layout ([l] () { l->relocate (); });
+    return result;
+}
+
+template image link<x86_64_target> (link_options const &, thread_pool &,
+                                    std::shared_ptr<string_arena>);
+template image link<arm64_target> (link_options const &, thread_pool &,
+                                   std::shared_ptr<string_arena>);
@@ -0,0 +1,298 @@
+#include "load_command_editor.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+
+#ifdef _WIN32
+#    include <io.h>
+#else
+#    include <unistd.h>
+#endif
+
+#include "mapped_file.hpp"
+#include "output.hpp"
+#include "util.hpp"
+
+namespace {
+
+    bool is_dylib_command (std::uint32_t cmd) noexcept {
+        switch (cmd) {
+        case mach_o::lc_load_dylib:
+        case mach_o::lc_load_weak_dylib:
+        case mach_o::lc_reexport_dylib:
+        case mach_o::lc_lazy_load_dylib:
+        case mach_o::lc_load_upward_dylib: return true;
+        default: return false;
+        }
+    }
+
+    bool is_zerofill (mach_o::section_64 const & s) noexcept {
+        switch (s.flags & mach_o::section_type) {
+        case mach_o::s_zerofill:
+        case mach_o::s_gb_zerofill:
+        case mach_o::s_thread_local_zerofill: return true;
+        default: return false;
+        }
+    }
+
+    /// Load commands are copied into vectors of bytes which may not be suitably aligned for
+    /// their structures so fields are read and written with memcpy().
+    template <typename T>
+    T read (std::vector<std::uint8_t> const & bytes, std::size_t offset = 0) {
+        static_assert (std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        if (offset + sizeof (T) > bytes.size ()) {
+            throw format_error ("load command is too small");
+        }
+        std::aligned_storage_t<sizeof (T), alignof (T)> t;
+        std::memcpy (&t, bytes.data () + offset, sizeof (T));
+        return *reinterpret_cast<T const *> (&t);
+    }
+    template <typename T>
+    void write (std::vector<std::uint8_t> & bytes, T const & value) {
+        assert (bytes.size () >= sizeof (T));
+        std::memcpy (bytes.data (), &value, sizeof (T));
+    }
+
+    /// \returns The NUL-terminated string which starts \p offset bytes into a load command.
+    std::string command_string (std::vector<std::uint8_t> const & bytes, std::uint32_t offset) {
+        if (offset >= bytes.size ()) {
+            throw format_error ("load command string is out of range");
+        }
+        auto const * const first = bytes.data () + offset;
+        auto const * const last = std::find (first, bytes.data () + bytes.size (), '\0');
+        return {first, last};
+    }
+
+    /// Builds a load command of type \p Command which consists of its fixed structure followed
+    /// by \p str, a terminating NUL and padding to a multiple of 8 bytes.
+    template <typename Command>
+    std::vector<std::uint8_t> string_command (Command cmd, std::string const & str) {
+        std::size_t size = sizeof (Command) + str.size () + 1U;
+        size += calc_alignment (size, 8U);
+        std::vector<std::uint8_t> bytes (size, std::uint8_t{0});
+        cmd.cmdsize = narrow_cast<std::uint32_t> (size);
+        write (bytes, cmd);
+        std::memcpy (bytes.data () + sizeof (Command), str.data (), str.size ());
+        return bytes;
+    }
+
+} // end anonymous namespace
+
+// ctor
+// ~~~~
+load_command_editor::load_command_editor (image_view const & image)
+        : header_ (image.header ())
+        , original_size_{sizeof (mach_o::mach_header_64) + std::uint64_t{header_.sizeofcmds}}
+        , capacity_{image.size ()} {
+    for (load_command_view const lc : image.commands ()) {
+        commands_.emplace_back (lc.data (), lc.data () + lc.cmdsize ());
+    }
+
+    // The commands may grow as far as the first byte of data belonging to a segment or to one of
+    // its sections. The __TEXT segment maps the header so segments at offset 0 don't count.
+    for (std::vector<std::uint8_t> const & bytes : commands_) {
+        auto const cmd = read<mach_o::load_command> (bytes);
+        if (cmd.cmd != mach_o::lc_segment_64) {
+            continue;
+        }
+        auto const seg = read<mach_o::segment_command_64> (bytes);
+        if (seg.fileoff != 0U && seg.filesize != 0U) {
+            capacity_ = std::min (capacity_, seg.fileoff);
+        }
+        for (std::uint32_t ctr = 0; ctr < seg.nsects; ++ctr) {
+            auto const sect = read<mach_o::section_64> (
+                bytes, sizeof (seg) + std::size_t{ctr} * sizeof (mach_o::section_64));
+            if (!is_zerofill (sect) && sect.size != 0U) {
+                capacity_ = std::min (capacity_, std::uint64_t{sect.offset});
+            }
+        }
+    }
+}
+
+// find
+// ~~~~
+std::vector<std::uint8_t> * load_command_editor::find (std::uint32_t cmd) {
+    auto const pos = std::find_if (
+        std::begin (commands_), std::end (commands_),
+        [cmd] (std::vector<std::uint8_t> const & c) {
+            return read<mach_o::load_command> (c).cmd == cmd;
+        });
+    return pos != std::end (commands_) ? &*pos : nullptr;
+}
+
+// for_each_dylib
+// ~~~~~~~~~~~~~~
+unsigned load_command_editor::for_each_dylib (
+    std::string const & path, std::function<void (std::vector<std::uint8_t> &)> const & f) {
+    unsigned count = 0;
+    for (std::vector<std::uint8_t> & bytes : commands_) {
+        if (!is_dylib_command (read<mach_o::load_command> (bytes).cmd)) {
+            continue;
+        }
+        auto const dc = read<mach_o::dylib_command> (bytes);
+        if (command_string (bytes, dc.dylib.name.offset) == path) {
+            f (bytes);
+            ++count;
+        }
+    }
+    return count;
+}
+
+// change_dylib
+// ~~~~~~~~~~~~
+void load_command_editor::change_dylib (std::string const & from, std::string const & to) {
+    unsigned const count = this->for_each_dylib (from, [&to] (std::vector<std::uint8_t> & bytes) {
+        auto dc = read<mach_o::dylib_command> (bytes);
+        dc.dylib.name.offset = sizeof (dc);
+        bytes = string_command (dc, to);
+    });
+    if (count == 0U) {
+        throw edit_error ("no dylib load command names \"" + from + '"');
+    }
+}
+
+// set_dylib_versions
+// ~~~~~~~~~~~~~~~~~~
+void load_command_editor::set_dylib_versions (std::string const & path,
+                                              std::uint32_t current_version,
+                                              std::uint32_t compatibility_version) {
+    unsigned const count = this->for_each_dylib (path, [=] (std::vector<std::uint8_t> & bytes) {
+        auto dc = read<mach_o::dylib_command> (bytes);
+        dc.dylib.current_version = current_version;
+        dc.dylib.compatibility_version = compatibility_version;
+        write (bytes, dc);
+    });
+    if (count == 0U) {
+        throw edit_error ("no dylib load command names \"" + path + '"');
+    }
+}
+
+// add_rpath
+// ~~~~~~~~~
+void load_command_editor::add_rpath (std::string const & path) {
+    for (std::vector<std::uint8_t> const & bytes : commands_) {
+        if (read<mach_o::load_command> (bytes).cmd == mach_o::lc_rpath &&
+            command_string (bytes, read<mach_o::rpath_command> (bytes).path.offset) == path) {
+            throw edit_error ("the image already has an LC_RPATH for \"" + path + '"');
+        }
+    }
+    mach_o::rpath_command rc;
+    rc.cmd = mach_o::lc_rpath;
+    rc.path.offset = sizeof (rc);
+    commands_.push_back (string_command (rc, path));
+}
+
+// set_uuid
+// ~~~~~~~~
+void load_command_editor::set_uuid (uuid const & u) {
+    mach_o::uuid_command uc;
+    uc.cmd = mach_o::lc_uuid;
+    uc.cmdsize = sizeof (uc);
+    std::copy (std::begin (u), std::end (u), uc.uuid);
+    std::vector<std::uint8_t> * bytes = this->find (mach_o::lc_uuid);
+    if (bytes == nullptr) {
+        commands_.emplace_back (sizeof (uc), std::uint8_t{0});
+        bytes = &commands_.back ();
+    }
+    write (*bytes, uc);
+}
+
+// set_build_version
+// ~~~~~~~~~~~~~~~~~
+void load_command_editor::set_build_version (std::uint32_t platform, std::uint32_t minos,
+                                             std::uint32_t sdk) {
+    std::vector<std::uint8_t> * bytes = this->find (mach_o::lc_build_version);
+    if (bytes == nullptr) {
+        mach_o::build_version_command bv;
+        bv.cmd = mach_o::lc_build_version;
+        bv.cmdsize = sizeof (bv);
+        bv.ntools = 0;
+        commands_.emplace_back (sizeof (bv), std::uint8_t{0});
+        bytes = &commands_.back ();
+        write (*bytes, bv);
+    }
+    auto bv = read<mach_o::build_version_command> (*bytes);
+    bv.platform = platform;
+    bv.minos = minos;
+    bv.sdk = sdk;
+    write (*bytes, bv);
+}
+
+// serialize
+// ~~~~~~~~~
+std::vector<std::uint8_t> load_command_editor::serialize () const {
+    std::uint64_t sizeofcmds = 0;
+    for (std::vector<std::uint8_t> const & bytes : commands_) {
+        sizeofcmds += bytes.size ();
+    }
+    std::uint64_t const size = sizeof (header_) + sizeofcmds;
+    if (size > capacity_) {
+        throw edit_error ("the load commands need " + std::to_string (size) +
+                          " bytes but only " + std::to_string (capacity_) +
+                          " are available before the first section (link with -headerpad)");
+    }
+
+    mach_o::mach_header_64 header = header_;
+    header.ncmds = narrow_cast<std::uint32_t> (commands_.size ());
+    header.sizeofcmds = narrow_cast<std::uint32_t> (sizeofcmds);
+    // Zeros cover the tail of the original commands if the new ones are shorter.
+    std::vector<std::uint8_t> result (
+        static_cast<std::size_t> (std::max (size, original_size_)), std::uint8_t{0});
+    std::memcpy (result.data (), &header, sizeof (header));
+    std::size_t pos = sizeof (header);
+    for (std::vector<std::uint8_t> const & bytes : commands_) {
+        std::memcpy (result.data () + pos, bytes.data (), bytes.size ());
+        pos += bytes.size ();
+    }
+    return result;
+}
+
+// edit_file
+// ~~~~~~~~~
+void edit_file (char const * path, std::function<void (load_command_editor &)> const & f) {
+    // The file offset of each image and its new header and load commands.
+    std::vector<std::pair<std::uint64_t, std::vector<std::uint8_t>>> edits;
+    {
+        mapped_file const file{path};
+        auto edit = [&] (image_view const & image) {
+            for (load_command_view const lc : image.commands ()) {
+                if (lc.cmd () == mach_o::lc_code_signature) {
+                    throw edit_error ("the image is code signed: edit it before signing");
+                }
+            }
+            load_command_editor editor{image};
+            f (editor);
+            edits.emplace_back (static_cast<std::uint64_t> (image.data () - file.data ()),
+                                editor.serialize ());
+        };
+        if (universal_view::is_universal (file.data (), file.size ())) {
+            universal_view const fat{file.data (), file.size ()};
+            for (std::size_t ctr = 0; ctr < fat.size (); ++ctr) {
+                edit (fat.slice (ctr));
+            }
+        } else {
+            edit (image_view{file.data (), file.size ()});
+        }
+        // The mapping is released before the file is written.
+    }
+
+#ifdef _WIN32
+    int const fd = _open (path, O_RDWR | O_BINARY);
+#else
+    int const fd = ::open (path, O_RDWR);
+#endif
+    if (fd == -1) {
+        throw std::system_error (errno, std::generic_category (), "open");
+    }
+    auto const scope = make_scope_guard ([fd] () { ::close (fd); });
+    for (auto const & e : edits) {
+        file_output out{fd, e.first};
+        out.write (e.second.data (), e.second.size ());
+    }
+}
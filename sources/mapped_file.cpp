@@ -0,0 +1,136 @@
+#include "mapped_file.hpp"
+
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#    define NOMINMAX
+#    define WIN32_LEAN_AND_MEAN
+#    include <Windows.h>
+#else
+#    include <sys/mman.h>
+#    include <unistd.h>
+#endif
+
+#include "instrumentation.hpp"
+#include "util.hpp"
+
+namespace {
+
+    [[noreturn]] void raise (char const * what) {
+        throw std::system_error (errno, std::generic_category (), what);
+    }
+
+} // end anonymous namespace
+
+// ctor
+// ~~~~
+mapped_file::mapped_file (char const * path) {
+#ifdef _WIN32
+    HANDLE const file = ::CreateFileA (path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    count_syscalls ();
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::system_error (static_cast<int> (::GetLastError ()), std::system_category (),
+                                 "CreateFile");
+    }
+    auto const close_file = make_scope_guard ([file] () {
+        ::CloseHandle (file);
+        count_syscalls ();
+    });
+    LARGE_INTEGER length;
+    count_syscalls ();
+    if (!::GetFileSizeEx (file, &length)) {
+        throw std::system_error (static_cast<int> (::GetLastError ()), std::system_category (),
+                                 "GetFileSizeEx");
+    }
+    size_ = static_cast<std::size_t> (length.QuadPart);
+    if (size_ == 0U) {
+        return;
+    }
+    HANDLE const mapping = ::CreateFileMappingA (file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    count_syscalls ();
+    if (mapping == nullptr) {
+        throw std::system_error (static_cast<int> (::GetLastError ()), std::system_category (),
+                                 "CreateFileMapping");
+    }
+    auto const close_mapping = make_scope_guard ([mapping] () {
+        ::CloseHandle (mapping);
+        count_syscalls ();
+    });
+    data_ = static_cast<std::uint8_t const *> (::MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0));
+    count_syscalls ();
+    if (data_ == nullptr) {
+        throw std::system_error (static_cast<int> (::GetLastError ()), std::system_category (),
+                                 "MapViewOfFile");
+    }
+#else
+    int const fd = ::open (path, O_RDONLY);
+    count_syscalls ();
+    if (fd == -1) {
+        raise ("open");
+    }
+    auto const close_file = make_scope_guard ([fd] () {
+        ::close (fd);
+        count_syscalls ();
+    });
+    struct stat buf;
+    count_syscalls ();
+    if (::fstat (fd, &buf) == -1) {
+        raise ("fstat");
+    }
+    size_ = static_cast<std::size_t> (buf.st_size);
+    if (size_ == 0U) {
+        // mmap() rejects a zero length.
+        return;
+    }
+    void * const ptr = ::mmap (nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    count_syscalls ();
+    if (ptr == MAP_FAILED) {
+        raise ("mmap");
+    }
+    data_ = static_cast<std::uint8_t const *> (ptr);
+#endif
+}
+
+mapped_file::mapped_file (mapped_file && rhs) noexcept
+        : data_{rhs.data_}
+        , size_{rhs.size_} {
+    rhs.data_ = nullptr;
+    rhs.size_ = 0;
+}
+
+// dtor
+// ~~~~
+mapped_file::~mapped_file () noexcept {
+    this->release ();
+}
+
+// operator=
+// ~~~~~~~~~
+mapped_file & mapped_file::operator= (mapped_file && rhs) noexcept {
+    if (&rhs != this) {
+        this->release ();
+        data_ = std::exchange (rhs.data_, nullptr);
+        size_ = std::exchange (rhs.size_, std::size_t{0});
+    }
+    return *this;
+}
+
+// release
+// ~~~~~~~
+void mapped_file::release () noexcept {
+    if (data_ != nullptr) {
+#ifdef _WIN32
+        ::UnmapViewOfFile (data_);
+#else
+        ::munmap (const_cast<std::uint8_t *> (data_), size_);
+#endif
+        count_syscalls ();
+        data_ = nullptr;
+    }
+}
@@ -0,0 +1,206 @@
+#include "object_file.hpp"
+
+#include <cstring>
+#include <memory>
+
+#include "image_view.hpp"
+#include "mach-o_reloc.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+    /// \returns The image within \p bytes for \p cputype.
+    image_view select_image (array_view<std::uint8_t> bytes, mach_o::cpu_type cputype) {
+        if (!universal_view::is_universal (bytes.data (), bytes.size ())) {
+            image_view const image{bytes.data (), bytes.size ()};
+            if (image.header ().cputype != cputype) {
+                throw format_error ("object file is for the wrong architecture");
+            }
+            return image;
+        }
+        universal_view const fat{bytes.data (), bytes.size ()};
+        for (std::size_t ctr = 0; ctr < fat.size (); ++ctr) {
+            if (fat.arch (ctr).cputype == static_cast<std::uint32_t> (cputype)) {
+                return fat.slice (ctr);
+            }
+        }
+        throw format_error ("universal file does not contain the required architecture");
+    }
+
+} // end anonymous namespace
+
+// reserve
+// ~~~~~~~
+void symbol_table::reserve (std::size_t n) {
+    strx.reserve (n);
+    type.reserve (n);
+    sect.reserve (n);
+    desc.reserve (n);
+    value.reserve (n);
+}
+
+void relocation_table::reserve (std::size_t n) {
+    address.reserve (n);
+    symbolnum.reserve (n);
+    length.reserve (n);
+    type.reserve (n);
+    flags.reserve (n);
+}
+
+// ctor
+// ~~~~
+object_file::object_file (std::string path, mach_o::cpu_type cputype)
+        : path_{std::move (path)}
+        , file_{std::make_shared<mapped_file> (path_.c_str ())} {
+    this->parse (
+        select_image (array_view<std::uint8_t>{file_->data (), file_->size ()}, cputype));
+}
+
+object_file::object_file (std::string name, std::shared_ptr<mapped_file const> file,
+                          array_view<std::uint8_t> bytes, mach_o::cpu_type cputype)
+        : path_{std::move (name)}
+        , file_{std::move (file)} {
+    if (reinterpret_cast<std::uintptr_t> (bytes.data ()) % alignof (std::uint64_t) != 0U) {
+        // Archive members need not be 8-byte aligned: parse a copy.
+        copy_.resize ((bytes.size () + sizeof (std::uint64_t) - 1U) / sizeof (std::uint64_t));
+        std::memcpy (copy_.data (), bytes.data (), bytes.size ());
+        bytes = array_view<std::uint8_t>{reinterpret_cast<std::uint8_t const *> (copy_.data ()),
+                                         bytes.size ()};
+    }
+    this->parse (select_image (bytes, cputype));
+}
+
+// parse
+// ~~~~~
+void object_file::parse (image_view const & image) {
+    if (image.header ().filetype != mach_o::filetype_t::object) {
+        throw format_error ("not an object file");
+    }
+    flags_ = image.header ().flags;
+
+    mach_o::symtab_command const * symtab = nullptr;
+    for (load_command_view const lc : image.commands ()) {
+        switch (lc.cmd ()) {
+        case mach_o::lc_segment_64: {
+            auto const & segment = lc.as<mach_o::segment_command_64> ();
+            array_view<mach_o::section_64> const sections = image.sections (segment);
+            std::size_t nreloc = relocs_.size ();
+            for (mach_o::section_64 const & s : sections) {
+                nreloc += s.nreloc;
+            }
+            relocs_.reserve (nreloc);
+            sections_.reserve (sections_.size () + sections.size ());
+
+            for (mach_o::section_64 const & s : sections) {
+                input_section is;
+                std::memcpy (is.sectname, s.sectname, sizeof (is.sectname));
+                std::memcpy (is.segname, s.segname, sizeof (is.segname));
+                is.addr = s.addr;
+                is.size = s.size;
+                is.align = s.align;
+                is.flags = s.flags;
+                is.contents = image.contents (s);
+                is.first_reloc = narrow_cast<std::uint32_t> (relocs_.size ());
+                is.nreloc = s.nreloc;
+
+                // Each relocation_info is a pair of 32-bit words: r_address and the packed
+                // remaining fields.
+                array_view<std::uint32_t> const raw = image.table<std::uint32_t> (
+                    s.reloff, std::uint64_t{s.nreloc} * 2U);
+                for (std::size_t ctr = 0; ctr < raw.size (); ctr += 2) {
+                    mach_o::relocation const r = mach_o::unpack_relocation_info (
+                        static_cast<std::int32_t> (raw[ctr]), raw[ctr + 1]);
+                    // The fixed-up bytes must lie within the section's contents (a zero-fill
+                    // section has none to fix up).
+                    if (r.address < 0 || static_cast<std::uint64_t> (r.address) +
+                                                 (std::uint64_t{1} << r.length) >
+                                             is.contents.size ()) {
+                        throw format_error ("relocation address is outside its section");
+                    }
+                    relocs_.address.push_back (r.address);
+                    relocs_.symbolnum.push_back (r.symbolnum);
+                    relocs_.length.push_back (r.length);
+                    relocs_.type.push_back (r.type);
+                    relocs_.flags.push_back (static_cast<std::uint8_t> (
+                        (r.pcrel ? relocation_table::pcrel_flag : 0U) |
+                        (r.is_extern ? relocation_table::extern_flag : 0U)));
+                }
+                sections_.push_back (is);
+            }
+            break;
+        }
+        case mach_o::lc_symtab: symtab = &lc.as<mach_o::symtab_command> (); break;
+        default: break;
+        }
+    }
+
+    if (symtab != nullptr) {
+        array_view<std::uint8_t> const strings = image.bytes (symtab->stroff, symtab->strsize);
+        if (!strings.empty () && strings[strings.size () - 1U] != '\0') {
+            throw format_error ("string table is not terminated");
+        }
+        // A symbol may have an n_strx of 0 when the string table is empty: its name is then
+        // the empty string rather than a read beyond the table.
+        symbols_.strings =
+            strings.empty () ? "" : reinterpret_cast<char const *> (strings.data ());
+
+        array_view<mach_o::nlist_64> const nlist =
+            image.table<mach_o::nlist_64> (symtab->symoff, symtab->nsyms);
+        symbols_.reserve (nlist.size ());
+        for (mach_o::nlist_64 const & n : nlist) {
+            if (n.n_strx >= symtab->strsize && !(n.n_strx == 0 && symtab->strsize == 0)) {
+                throw format_error ("symbol name is outside the string table");
+            }
+            if ((n.n_type & mach_o::n_type) == mach_o::n_sect &&
+                (n.n_sect == mach_o::no_sect || n.n_sect > sections_.size ())) {
+                throw format_error ("symbol section number is out of range");
+            }
+            symbols_.strx.push_back (n.n_strx);
+            symbols_.type.push_back (n.n_type);
+            symbols_.sect.push_back (n.n_sect);
+            symbols_.desc.push_back (n.n_desc);
+            symbols_.value.push_back (n.n_value);
+        }
+    }
+    // The symbol table may follow the segment, so the relocations' symbol numbers are checked
+    // once both have been read. That of a non-external relocation is a section ordinal, except
+    // for ARM64_RELOC_ADDEND where it holds the addend.
+    bool const arm64 = image.header ().cputype == mach_o::cpu_type::arm64;
+    for (std::size_t r = 0; r < relocs_.size (); ++r) {
+        std::uint32_t const symbolnum = relocs_.symbolnum[r];
+        if ((relocs_.flags[r] & relocation_table::extern_flag) != 0U) {
+            if (symbolnum >= symbols_.size ()) {
+                throw format_error ("relocation symbol number is outside the symbol table");
+            }
+        } else if (!(arm64 && relocs_.type[r] == mach_o::arm64_reloc_addend) &&
+                   (symbolnum == mach_o::no_sect || symbolnum > sections_.size ())) {
+            throw format_error ("relocation section number is out of range");
+        }
+    }
+}
+
+// load objects
+// ~~~~~~~~~~~~
+std::vector<object_file> load_objects (std::vector<std::string> const & paths,
+                                       mach_o::cpu_type cputype, thread_pool & pool) {
+    std::size_t const count = paths.size ();
+    std::vector<std::unique_ptr<object_file>> loaded (count);
+    std::vector<std::string> errors (count);
+    pool.parallel_for (count, [&] (std::size_t index) {
+        try {
+            loaded[index] = std::make_unique<object_file> (paths[index], cputype);
+        } catch (std::exception const & ex) {
+            errors[index] = paths[index] + ": " + ex.what ();
+        }
+    });
+
+    std::vector<object_file> result;
+    result.reserve (count);
+    for (std::size_t ctr = 0; ctr < count; ++ctr) {
+        if (!loaded[ctr]) {
+            throw load_error (errors[ctr]);
+        }
+        result.push_back (std::move (*loaded[ctr]));
+    }
+    return result;
+}
@@ -0,0 +1,236 @@
+#include "ordering.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <tuple>
+
+#include "linker.hpp"
+#include "mapped_file.hpp"
+#include "target.hpp"
+#include "util.hpp"
+
+namespace {
+
+    constexpr auto none = ~std::uint32_t{0};
+
+    // Limits on the clusters formed when ordering functions by profile: a cluster is not grown
+    // beyond max_cluster_size bytes, nor if its density (calls per byte) would fall by more than
+    // a factor of max_density_degradation.
+    constexpr std::uint64_t max_cluster_size = 1024 * 1024;
+    constexpr double max_density_degradation = 8.0;
+
+    bool is_space (char c) noexcept { return c == ' ' || c == '\t' || c == '\r'; }
+
+    /// Calls \p f (line_number, first, last) for each line of the text file at \p path which is
+    /// not empty once its comment (introduced by '#') and surrounding white space are removed.
+    template <typename Function>
+    void for_each_line (std::string const & path, Function f) {
+        std::unique_ptr<mapped_file> file;
+        try {
+            file = std::make_unique<mapped_file> (path.c_str ());
+        } catch (std::system_error const & ex) {
+            throw link_error (path + ": " + ex.what ());
+        }
+        auto const * const first = reinterpret_cast<char const *> (file->data ());
+        char const * const last = first + file->size ();
+        unsigned line_number = 0;
+        for (char const * line = first; line < last;) {
+            ++line_number;
+            char const * end = std::find (line, last, '\n');
+            char const * const next = end == last ? last : end + 1;
+            end = std::find (line, end, '#');
+            while (line < end && is_space (*line)) {
+                ++line;
+            }
+            while (end > line && is_space (end[-1])) {
+                --end;
+            }
+            if (line < end) {
+                f (line_number, line, end);
+            }
+            line = next;
+        }
+    }
+
+} // end anonymous namespace
+
+// read_order_file
+// ~~~~~~~~~~~~~~~
+std::unordered_map<interned_string, std::uint32_t>
+read_order_file (std::string const & path, char const * arch, string_arena & names) {
+    // The position of each name's first appearance.
+    std::unordered_map<interned_string, std::uint32_t> position;
+    for_each_line (path, [&] (unsigned, char const * line, char const * end) {
+        // A line may be restricted to one architecture by an "arch:" prefix.
+        char const * const colon = std::find (line, end, ':');
+        if (colon != end) {
+            auto const prefix = static_cast<std::size_t> (colon - line);
+            auto const is_arch = [&] (char const * a) {
+                return std::strlen (a) == prefix && std::strncmp (line, a, prefix) == 0;
+            };
+            if (is_arch (x86_64_target::name ()) || is_arch (arm64_target::name ())) {
+                line = is_arch (arch) ? colon + 1 : end;
+                while (line < end && is_space (*line)) {
+                    ++line;
+                }
+            }
+        }
+        if (line < end) {
+            position.emplace (names.intern (line, static_cast<std::size_t> (end - line)),
+                              narrow_cast<std::uint32_t> (position.size ()));
+        }
+    });
+    return position;
+}
+
+// read_call_graph_profile
+// ~~~~~~~~~~~~~~~~~~~~~~~
+call_graph_profile read_call_graph_profile (std::string const & path, string_arena & names) {
+    call_graph_profile result;
+    for_each_line (path, [&] (unsigned line_number, char const * line, char const * end) {
+        std::array<std::uint32_t, 2> nodes;
+        for (std::uint32_t & node : nodes) {
+            char const * const name_end = std::find_if (line, end, is_space);
+            interned_string const name =
+                names.intern (line, static_cast<std::size_t> (name_end - line));
+            node = result.nodes.emplace (name, narrow_cast<std::uint32_t> (result.nodes.size ()))
+                       .first->second;
+            line = std::find_if_not (name_end, end, is_space);
+        }
+        std::uint64_t weight = 0;
+        for (; line < end && *line >= '0' && *line <= '9'; ++line) {
+            weight = weight * 10U + static_cast<std::uint64_t> (*line - '0');
+        }
+        if (line != end || weight == 0U) {
+            throw link_error (path + ':' + std::to_string (line_number) +
+                              ": expected 'caller callee weight'");
+        }
+        result.calls.push_back ({nodes[0], nodes[1], weight});
+    });
+    return result;
+}
+
+// cluster_functions
+// ~~~~~~~~~~~~~~~~~
+std::vector<std::uint32_t> cluster_functions (std::vector<weighted_call> const & calls,
+                                              std::function<std::uint64_t (std::uint32_t)> size) {
+    // Each function starts in a cluster of its own. A cluster's weight is the total weight of
+    // the calls to its functions; its density is the weight per byte.
+    struct cluster {
+        std::uint32_t function;
+        std::uint64_t size;
+        std::uint64_t weight = 0;
+        std::uint64_t initial_weight = 0;
+        std::uint32_t next = none; ///< The next member of the leader's chain
+        std::uint32_t last;        ///< The leader's last member
+        std::uint32_t best_pred = none;
+        std::uint64_t best_weight = 0;
+        double density () const { return static_cast<double> (weight) / size; }
+    };
+    std::vector<cluster> clusters;
+    std::unordered_map<std::uint32_t, std::uint32_t> cluster_of; // by function
+    auto const cluster_index = [&] (std::uint32_t f) {
+        auto const inserted =
+            cluster_of.emplace (f, narrow_cast<std::uint32_t> (clusters.size ()));
+        if (inserted.second) {
+            cluster c;
+            c.function = f;
+            c.size = std::max (size (f), std::uint64_t{1});
+            c.last = inserted.first->second;
+            clusters.push_back (c);
+        }
+        return inserted.first->second;
+    };
+    // Merge parallel edges so that each caller/callee pair is considered once.
+    std::vector<weighted_call> edges;
+    for (weighted_call const & c : calls) {
+        if (c.caller != c.callee) {
+            edges.push_back ({cluster_index (c.caller), cluster_index (c.callee), c.weight});
+        }
+    }
+    std::sort (std::begin (edges), std::end (edges),
+               [] (weighted_call const & a, weighted_call const & b) {
+                   return std::make_tuple (a.caller, a.callee) <
+                          std::make_tuple (b.caller, b.callee);
+               });
+    for (std::size_t ctr = 0; ctr < edges.size ();) {
+        weighted_call e = edges[ctr];
+        for (++ctr; ctr < edges.size () && edges[ctr].caller == e.caller &&
+                    edges[ctr].callee == e.callee;
+             ++ctr) {
+            e.weight += edges[ctr].weight;
+        }
+        cluster & to = clusters[e.callee];
+        to.weight += e.weight;
+        to.initial_weight += e.weight;
+        if (e.weight > to.best_weight) {
+            to.best_pred = e.caller;
+            to.best_weight = e.weight;
+        }
+    }
+
+    // Visit the clusters in order of decreasing density and append each to the cluster of its
+    // most frequent caller unless that would make the result too large or dilute it.
+    std::vector<std::uint32_t> order (clusters.size ());
+    std::vector<std::uint32_t> leader (clusters.size ());
+    for (std::uint32_t c = 0; c < clusters.size (); ++c) {
+        order[c] = c;
+        leader[c] = c;
+    }
+    auto const by_density = [&] (std::uint32_t a, std::uint32_t b) {
+        return clusters[a].density () > clusters[b].density ();
+    };
+    std::stable_sort (std::begin (order), std::end (order), by_density);
+    auto const find_leader = [&] (std::uint32_t c) {
+        while (leader[c] != c) {
+            leader[c] = leader[leader[c]];
+            c = leader[c];
+        }
+        return c;
+    };
+    for (std::uint32_t const c : order) {
+        cluster & from = clusters[c];
+        // Ignore a caller which accounts for only a small fraction of the calls.
+        if (from.best_pred == none || from.best_weight * 10U <= from.initial_weight) {
+            continue;
+        }
+        std::uint32_t const p = find_leader (from.best_pred);
+        if (p == c) {
+            continue;
+        }
+        cluster & into = clusters[p];
+        if (into.size + from.size > max_cluster_size) {
+            continue;
+        }
+        double const merged = static_cast<double> (into.weight + from.weight) /
+                              static_cast<double> (into.size + from.size);
+        if (merged < into.density () / max_density_degradation) {
+            continue;
+        }
+        leader[c] = p;
+        clusters[into.last].next = c;
+        into.last = from.last;
+        into.size += from.size;
+        into.weight += from.weight;
+    }
+
+    // The clusters are placed in order of decreasing density.
+    std::vector<std::uint32_t> leaders;
+    for (std::uint32_t c = 0; c < clusters.size (); ++c) {
+        if (leader[c] == c) {
+            leaders.push_back (c);
+        }
+    }
+    std::stable_sort (std::begin (leaders), std::end (leaders), by_density);
+    std::vector<std::uint32_t> result;
+    result.reserve (clusters.size ());
+    for (std::uint32_t const l : leaders) {
+        for (std::uint32_t c = l; c != none; c = clusters[c].next) {
+            result.push_back (clusters[c].function);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,114 @@
+#include "output.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#    include <io.h>
+#else
+#    include <unistd.h>
+#endif
+
+#include "instrumentation.hpp"
+
+namespace {
+
+    [[noreturn]] void raise (char const * what) {
+        throw std::system_error (errno, std::generic_category (), what);
+    }
+
+} // end anonymous namespace
+
+// write_at
+// ~~~~~~~~
+void file_output::write_at (std::uint64_t pos, void const * data, std::size_t size) {
+    auto const * p = static_cast<std::uint8_t const *> (data);
+    if (pos != next_) {
+        count_seek ();
+    }
+    next_ = pos + size;
+    count_bytes_written (size);
+    pos += base_;
+#ifdef _WIN32
+    // There's no pwrite() so serialize the seek-and-write pairs of all outputs.
+    static std::mutex mut;
+    std::lock_guard<std::mutex> const lock{mut};
+    count_syscalls ();
+    if (_lseeki64 (fd_, static_cast<__int64> (pos), SEEK_SET) == -1) {
+        raise ("lseek");
+    }
+    while (size > 0) {
+        int const written = _write (fd_, p, static_cast<unsigned> (size));
+        count_syscalls ();
+        if (written == -1) {
+            raise ("write");
+        }
+        p += written;
+        size -= static_cast<std::size_t> (written);
+    }
+#else
+    while (size > 0) {
+        ssize_t const written = ::pwrite (fd_, p, size, static_cast<off_t> (pos));
+        count_syscalls ();
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            raise ("pwrite");
+        }
+        p += written;
+        pos += static_cast<std::uint64_t> (written);
+        size -= static_cast<std::size_t> (written);
+    }
+#endif
+}
+
+// write_at
+// ~~~~~~~~
+void buffer_output::write_at (std::uint64_t pos, void const * data, std::size_t size) {
+    auto const end = static_cast<std::size_t> (pos + size);
+    if (end > buffer_.size ()) {
+        buffer_.resize (end);
+    }
+    std::memcpy (buffer_.data () + pos, data, size);
+}
+
+// write_at
+// ~~~~~~~~
+void prefix_output::write_at (std::uint64_t pos, void const * data, std::size_t size) {
+    if (pos >= buffer_.size ()) {
+        return;
+    }
+    std::memcpy (buffer_.data () + pos, data,
+                 std::min (size, static_cast<std::size_t> (buffer_.size () - pos)));
+}
+
+// extend_file
+// ~~~~~~~~~~~
+void extend_file (int fd, std::uint64_t size) {
+    count_syscalls ();
+#ifdef _WIN32
+    if (static_cast<std::uint64_t> (_filelengthi64 (fd)) < size) {
+        count_syscalls ();
+        if (_chsize_s (fd, static_cast<__int64> (size)) != 0) {
+            raise ("chsize");
+        }
+    }
+#else
+    struct stat buf;
+    if (::fstat (fd, &buf) == -1) {
+        raise ("fstat");
+    }
+    if (static_cast<std::uint64_t> (buf.st_size) < size) {
+        count_syscalls ();
+        if (::ftruncate (fd, static_cast<off_t> (size)) == -1) {
+            raise ("ftruncate");
+        }
+    }
+#endif
+}
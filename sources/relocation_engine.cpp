@@ -0,0 +1,390 @@
+#include "relocation_engine.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "mach-o_reloc.hpp"
+
+namespace {
+
+    /// The number of fixups processed by each pass of the compute and store loops. Small enough
+    /// that the intermediate values stay in L1 cache.
+    constexpr std::size_t batch_size = 256;
+
+    /// \returns True if \p v cannot be represented as a signed value of \p Bits bits.
+    template <unsigned Bits>
+    constexpr bool overflows_signed (std::uint64_t v) noexcept {
+        return ((v + (std::uint64_t{1} << (Bits - 1U))) >> Bits) != 0U;
+    }
+    /// \returns True if \p v cannot be represented as either a signed or an unsigned 32-bit value.
+    constexpr bool overflows32 (std::uint64_t v) noexcept {
+        return (v >> 32) != 0U && overflows_signed<32> (v);
+    }
+
+    template <typename Value>
+    void store (std::uint8_t * contents, std::uint64_t const * offset, std::uint64_t const * values,
+                std::size_t count) noexcept {
+        for (std::size_t ctr = 0; ctr < count; ++ctr) {
+            auto const v = static_cast<Value> (values[ctr]);
+            std::memcpy (contents + offset[ctr], &v, sizeof (v));
+        }
+    }
+
+    /// Replaces the bits of the 32-bit instructions at \p offset selected by \p mask with
+    /// \p fields.
+    void store_fields (std::uint8_t * contents, std::uint64_t const * offset,
+                       std::uint32_t const * fields, std::uint32_t mask,
+                       std::size_t count) noexcept {
+        for (std::size_t ctr = 0; ctr < count; ++ctr) {
+            std::uint32_t insn;
+            std::memcpy (&insn, contents + offset[ctr], sizeof (insn));
+            insn = (insn & mask) | fields[ctr];
+            std::memcpy (contents + offset[ctr], &insn, sizeof (insn));
+        }
+    }
+
+    /// Called when a batch contains at least one value which overflows its field. Records the
+    /// offending offsets; this is off the hot path.
+    template <typename Predicate>
+    void record_overflows (std::uint64_t const * offset, std::uint64_t const * values,
+                           std::size_t count, Predicate overflows,
+                           std::vector<std::uint64_t> * const errors) {
+        for (std::size_t ctr = 0; ctr < count; ++ctr) {
+            if (overflows (values[ctr])) {
+                errors->push_back (offset[ctr]);
+            }
+        }
+    }
+
+} // end anonymous namespace
+
+// note
+// ~~~~
+void relocation_engine_base::note (fixup const & f, unsigned bytes) {
+    if (f.offset > std::numeric_limits<std::uint64_t>::max () - bytes) {
+        throw relocation_error ("relocation offset is out of range");
+    }
+    end_ = std::max (end_, f.offset + bytes);
+    ++size_;
+}
+
+// check_length
+// ~~~~~~~~~~~~
+void relocation_engine_base::check_length (fixup const & f, std::uint8_t length) {
+    if (f.length != length) {
+        throw relocation_error ("relocation of type " + std::to_string (unsigned{f.type}) +
+                                " has invalid length " + std::to_string (unsigned{f.length}));
+    }
+}
+
+// add_absolute
+// ~~~~~~~~~~~~
+void relocation_engine_base::add_absolute (fixup const & f) {
+    if (f.length != 2U) {
+        check_length (f, 3U);
+    }
+    this->note (f, 1U << f.length);
+    absolute_bucket & b = f.length == 3U ? abs64_ : abs32_;
+    b.offset.push_back (f.offset);
+    b.target.push_back (f.target);
+    b.addend.push_back (f.addend);
+}
+
+// add_subtract
+// ~~~~~~~~~~~~
+void relocation_engine_base::add_subtract (fixup const & f) {
+    if (f.length != 2U) {
+        check_length (f, 3U);
+    }
+    this->note (f, 1U << f.length);
+    subtract_bucket & b = f.length == 3U ? sub64_ : sub32_;
+    b.offset.push_back (f.offset);
+    b.target.push_back (f.target);
+    b.subtrahend.push_back (f.subtrahend);
+    b.addend.push_back (f.addend);
+}
+
+// add_pcrel
+// ~~~~~~~~~
+void relocation_engine_base::add_pcrel (pcrel_bucket * const b, fixup const & f,
+                                        std::int64_t const bias) {
+    b->offset.push_back (f.offset);
+    b->target.push_back (f.target);
+    b->addend.push_back (f.addend - bias);
+}
+
+// apply_common
+// ~~~~~~~~~~~~
+void relocation_engine_base::apply_common (std::uint8_t * const contents, std::size_t const size,
+                                           std::vector<std::uint64_t> * const errors) const {
+    // The buckets are checked as a whole before anything is patched.
+    if (end_ > size) {
+        throw relocation_error ("relocation at offset " + std::to_string (end_ - 1U) +
+                                " is beyond the end of the contents");
+    }
+    std::uint64_t values[batch_size];
+
+    // Absolute values: target + addend.
+    auto const absolute = [&] (absolute_bucket const & b, bool is64) {
+        std::size_t const n = b.offset.size ();
+        for (std::size_t first = 0; first < n; first += batch_size) {
+            std::size_t const count = std::min (batch_size, n - first);
+            std::uint64_t const * const offset = b.offset.data () + first;
+            std::uint64_t const * const target = b.target.data () + first;
+            std::int64_t const * const addend = b.addend.data () + first;
+            bool overflow = false;
+            for (std::size_t ctr = 0; ctr < count; ++ctr) {
+                values[ctr] = target[ctr] + static_cast<std::uint64_t> (addend[ctr]);
+                overflow |= !is64 & overflows32 (values[ctr]);
+            }
+            if (is64) {
+                store<std::uint64_t> (contents, offset, values, count);
+            } else {
+                if (overflow) {
+                    record_overflows (offset, values, count, overflows32, errors);
+                }
+                store<std::uint32_t> (contents, offset, values, count);
+            }
+        }
+    };
+
+    // Differences: target - subtrahend + addend.
+    auto const subtract = [&] (subtract_bucket const & b, bool is64) {
+        std::size_t const n = b.offset.size ();
+        for (std::size_t first = 0; first < n; first += batch_size) {
+            std::size_t const count = std::min (batch_size, n - first);
+            std::uint64_t const * const offset = b.offset.data () + first;
+            std::uint64_t const * const target = b.target.data () + first;
+            std::uint64_t const * const subtrahend = b.subtrahend.data () + first;
+            std::int64_t const * const addend = b.addend.data () + first;
+            bool overflow = false;
+            for (std::size_t ctr = 0; ctr < count; ++ctr) {
+                values[ctr] =
+                    target[ctr] - subtrahend[ctr] + static_cast<std::uint64_t> (addend[ctr]);
+                overflow |= !is64 & overflows_signed<32> (values[ctr]);
+            }
+            if (is64) {
+                store<std::uint64_t> (contents, offset, values, count);
+            } else {
+                if (overflow) {
+                    record_overflows (offset, values, count, overflows_signed<32>, errors);
+                }
+                store<std::uint32_t> (contents, offset, values, count);
+            }
+        }
+    };
+
+    absolute (abs64_, true);
+    absolute (abs32_, false);
+    subtract (sub64_, true);
+    subtract (sub32_, false);
+}
+
+// apply_pcrel32
+// ~~~~~~~~~~~~~
+void relocation_engine_base::apply_pcrel32 (pcrel_bucket const & b, std::uint8_t * const contents,
+                                            std::uint64_t const base_address,
+                                            std::vector<std::uint64_t> * const errors) {
+    std::uint64_t values[batch_size];
+    std::size_t const n = b.offset.size ();
+    for (std::size_t first = 0; first < n; first += batch_size) {
+        std::size_t const count = std::min (batch_size, n - first);
+        std::uint64_t const * const offset = b.offset.data () + first;
+        std::uint64_t const * const target = b.target.data () + first;
+        std::int64_t const * const addend = b.addend.data () + first;
+        bool overflow = false;
+        for (std::size_t ctr = 0; ctr < count; ++ctr) {
+            values[ctr] = target[ctr] + static_cast<std::uint64_t> (addend[ctr]) -
+                          (base_address + offset[ctr]);
+            overflow |= overflows_signed<32> (values[ctr]);
+        }
+        if (overflow) {
+            record_overflows (offset, values, count, overflows_signed<32>, errors);
+        }
+        store<std::uint32_t> (contents, offset, values, count);
+    }
+}
+
+// add
+// ~~~
+void relocation_engine<x86_64_target>::add (fixup const & f) {
+    switch (f.type) {
+    case mach_o::x86_64_reloc_unsigned: this->add_absolute (f); break;
+    case mach_o::x86_64_reloc_subtractor: this->add_subtract (f); break;
+    case mach_o::x86_64_reloc_signed:
+    case mach_o::x86_64_reloc_branch:
+    case mach_o::x86_64_reloc_got_load:
+    case mach_o::x86_64_reloc_got:
+    case mach_o::x86_64_reloc_tlv:
+    case mach_o::x86_64_reloc_signed_1:
+    case mach_o::x86_64_reloc_signed_2:
+    case mach_o::x86_64_reloc_signed_4: {
+        check_length (f, 2U);
+        this->note (f, 4U);
+        // The displacement is relative to the address of the next instruction: the end of the
+        // 32-bit field plus any immediate bytes which follow it.
+        std::int64_t bias = 4;
+        switch (f.type) {
+        case mach_o::x86_64_reloc_signed_1: bias += 1; break;
+        case mach_o::x86_64_reloc_signed_2: bias += 2; break;
+        case mach_o::x86_64_reloc_signed_4: bias += 4; break;
+        default: break;
+        }
+        add_pcrel (&pcrel32_, f, bias);
+    } break;
+    default:
+        throw relocation_error ("unknown x86_64 relocation type " +
+                                std::to_string (unsigned{f.type}));
+    }
+}
+
+// apply
+// ~~~~~
+std::vector<std::uint64_t>
+relocation_engine<x86_64_target>::apply (std::uint8_t * const contents, std::size_t const size,
+                                         std::uint64_t const base_address) const {
+    std::vector<std::uint64_t> errors;
+    this->apply_common (contents, size, &errors);
+    apply_pcrel32 (pcrel32_, contents, base_address, &errors);
+    return errors;
+}
+
+// add
+// ~~~
+void relocation_engine<arm64_target>::add (fixup const & f) {
+    switch (f.type) {
+    case mach_o::arm64_reloc_unsigned: this->add_absolute (f); break;
+    case mach_o::arm64_reloc_subtractor: this->add_subtract (f); break;
+    case mach_o::arm64_reloc_pointer_to_got:
+        check_length (f, 2U);
+        this->note (f, 4U);
+        add_pcrel (&pcrel32_, f, 0);
+        break;
+    case mach_o::arm64_reloc_branch26:
+        check_length (f, 2U);
+        this->note (f, 4U);
+        add_pcrel (&branch26_, f, 0);
+        break;
+    case mach_o::arm64_reloc_page21:
+    case mach_o::arm64_reloc_got_load_page21:
+    case mach_o::arm64_reloc_tlvp_load_page21:
+        check_length (f, 2U);
+        this->note (f, 4U);
+        page21_.offset.push_back (f.offset);
+        page21_.target.push_back (f.target);
+        page21_.addend.push_back (f.addend);
+        break;
+    case mach_o::arm64_reloc_pageoff12:
+    case mach_o::arm64_reloc_got_load_pageoff12:
+    case mach_o::arm64_reloc_tlvp_load_pageoff12:
+        check_length (f, 2U);
+        this->note (f, 4U);
+        pageoff12_.offset.push_back (f.offset);
+        pageoff12_.target.push_back (f.target);
+        pageoff12_.addend.push_back (f.addend);
+        break;
+    default:
+        throw relocation_error ("unknown or unexpected arm64 relocation type " +
+                                std::to_string (unsigned{f.type}));
+    }
+}
+
+// apply
+// ~~~~~
+std::vector<std::uint64_t>
+relocation_engine<arm64_target>::apply (std::uint8_t * const contents, std::size_t const size,
+                                        std::uint64_t const base_address) const {
+    std::vector<std::uint64_t> errors;
+    this->apply_common (contents, size, &errors);
+    apply_pcrel32 (pcrel32_, contents, base_address, &errors);
+
+    std::uint64_t values[batch_size];
+    std::uint32_t fields[batch_size];
+
+    // B/BL: imm26 holds (target - P) / 4.
+    {
+        auto const overflows = [] (std::uint64_t v) noexcept {
+            return overflows_signed<28> (v) || (v & 3U) != 0U;
+        };
+        std::size_t const n = branch26_.offset.size ();
+        for (std::size_t first = 0; first < n; first += batch_size) {
+            std::size_t const count = std::min (batch_size, n - first);
+            std::uint64_t const * const offset = branch26_.offset.data () + first;
+            std::uint64_t const * const target = branch26_.target.data () + first;
+            std::int64_t const * const addend = branch26_.addend.data () + first;
+            bool overflow = false;
+            for (std::size_t ctr = 0; ctr < count; ++ctr) {
+                values[ctr] = target[ctr] + static_cast<std::uint64_t> (addend[ctr]) -
+                              (base_address + offset[ctr]);
+                overflow |= overflows_signed<28> (values[ctr]) | ((values[ctr] & 3U) != 0U);
+                fields[ctr] = static_cast<std::uint32_t> (values[ctr] >> 2) & 0x03FFFFFFU;
+            }
+            if (overflow) {
+                record_overflows (offset, values, count, overflows, &errors);
+            }
+            store_fields (contents, offset, fields, 0xFC000000U, count);
+        }
+    }
+
+    // ADRP: immlo (bits 29-30) and immhi (bits 5-23) hold the distance in 4K pages between the
+    // page containing the instruction and the page containing the target.
+    {
+        constexpr auto page_mask = ~std::uint64_t{0xFFF};
+        std::size_t const n = page21_.offset.size ();
+        for (std::size_t first = 0; first < n; first += batch_size) {
+            std::size_t const count = std::min (batch_size, n - first);
+            std::uint64_t const * const offset = page21_.offset.data () + first;
+            std::uint64_t const * const target = page21_.target.data () + first;
+            std::int64_t const * const addend = page21_.addend.data () + first;
+            bool overflow = false;
+            for (std::size_t ctr = 0; ctr < count; ++ctr) {
+                values[ctr] = ((target[ctr] + static_cast<std::uint64_t> (addend[ctr])) & page_mask) -
+                              ((base_address + offset[ctr]) & page_mask);
+                overflow |= overflows_signed<33> (values[ctr]);
+                auto const pages = static_cast<std::uint32_t> (values[ctr] >> 12);
+                fields[ctr] = ((pages & 0x3U) << 29) | (((pages >> 2) & 0x7FFFFU) << 5);
+            }
+            if (overflow) {
+                record_overflows (offset, values, count, overflows_signed<33>, &errors);
+            }
+            store_fields (contents, offset, fields, 0x9F00001FU, count);
+        }
+    }
+
+    // ADD/LDR/STR (immediate, unsigned offset): imm12 (bits 10-21) holds the low 12 bits of the
+    // target divided by the size of the access. The size must be decoded from the instruction.
+    {
+        std::size_t const n = pageoff12_.offset.size ();
+        for (std::size_t first = 0; first < n; first += batch_size) {
+            std::size_t const count = std::min (batch_size, n - first);
+            std::uint64_t const * const offset = pageoff12_.offset.data () + first;
+            std::uint64_t const * const target = pageoff12_.target.data () + first;
+            std::int64_t const * const addend = pageoff12_.addend.data () + first;
+            for (std::size_t ctr = 0; ctr < count; ++ctr) {
+                values[ctr] = (target[ctr] + static_cast<std::uint64_t> (addend[ctr])) & 0xFFFU;
+            }
+            for (std::size_t ctr = 0; ctr < count; ++ctr) {
+                std::uint32_t insn;
+                std::memcpy (&insn, contents + offset[ctr], sizeof (insn));
+                unsigned scale = 0;
+                if ((insn & 0x3B000000U) == 0x39000000U) {
+                    // A load or store: the size field gives the scale, except for 128-bit SIMD
+                    // accesses which have size 0 and opc<1> set.
+                    scale = insn >> 30;
+                    if (scale == 0U && (insn & 0x04800000U) == 0x04800000U) {
+                        scale = 4;
+                    }
+                }
+                if ((values[ctr] & ((1U << scale) - 1U)) != 0U) {
+                    errors.push_back (offset[ctr]);
+                }
+                insn = (insn & 0xFFC003FFU) |
+                       (static_cast<std::uint32_t> (values[ctr] >> scale) << 10);
+                std::memcpy (contents + offset[ctr], &insn, sizeof (insn));
+            }
+        }
+    }
+    return errors;
+}
@@ -0,0 +1,336 @@
+#include "resolver.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "mach-o.hpp"
+#include "object_file.hpp"
+#include "thread_pool.hpp"
+#include "util.hpp"
+
+namespace {
+
+    // The preference ranks of the symbols which share a name. Lower is better.
+    enum : std::uint64_t {
+        strong_def = 0,
+        weak_def = 1,
+        common_def = 2,
+        reference = 3,
+    };
+
+    /// Packs a rank, file index and symbol index into a key whose natural order is the order of
+    /// preference.
+    std::uint64_t pack (std::uint64_t rank, std::uint32_t file, std::uint32_t index) noexcept {
+        assert (rank <= 3U && file < (std::uint32_t{1} << 30));
+        return (rank << 62) | (std::uint64_t{file} << 32) | index;
+    }
+    std::uint64_t rank_of (std::uint64_t key) noexcept { return key >> 62; }
+    std::uint32_t file_of (std::uint64_t key) noexcept {
+        return static_cast<std::uint32_t> (key >> 32) & ((std::uint32_t{1} << 30) - 1U);
+    }
+    std::uint32_t index_of (std::uint64_t key) noexcept { return static_cast<std::uint32_t> (key); }
+
+    bool is_external (symbol_table const & st, std::size_t index) noexcept {
+        return (st.type[index] & mach_o::n_stab) == 0U && (st.type[index] & mach_o::n_ext) != 0U;
+    }
+
+    std::uint64_t rank_of (symbol_table const & st, std::size_t index) noexcept {
+        if ((st.type[index] & mach_o::n_type) == mach_o::n_undf) {
+            return st.value[index] != 0U ? common_def : reference;
+        }
+        return (st.desc[index] & mach_o::n_weak_def) != 0U ? weak_def : strong_def;
+    }
+
+    template <typename T>
+    void atomic_min (std::atomic<T> & a, T v) noexcept {
+        T cur = a.load (std::memory_order_relaxed);
+        while (v < cur && !a.compare_exchange_weak (cur, v, std::memory_order_relaxed)) {
+        }
+    }
+    template <typename T>
+    void atomic_max (std::atomic<T> & a, T v) noexcept {
+        T cur = a.load (std::memory_order_relaxed);
+        while (v > cur && !a.compare_exchange_weak (cur, v, std::memory_order_relaxed)) {
+        }
+    }
+
+    /// The number of symbols inserted by each task.
+    constexpr std::size_t chunk_size = 16384;
+
+} // end anonymous namespace
+
+constexpr std::uint32_t resolver::none;
+
+struct resolver::slot {
+    /// The slot's name. Null if the slot is unused.
+    std::atomic<interned_string> name{interned_string{}};
+    /// The packed key of the preferred symbol.
+    std::atomic<std::uint64_t> best{~std::uint64_t{0}};
+    std::atomic<std::uint32_t> strong{0};
+    std::atomic<std::uint64_t> common_size{0};
+    std::atomic<std::uint8_t> common_align{0};
+    /// Set if any reference to the name is not weak.
+    std::atomic<bool> strong_ref{false};
+};
+
+// ctor
+// ~~~~
+resolver::resolver (thread_pool & pool, string_arena & names)
+        : pool_{pool}
+        , names_{names} {}
+
+// dtor
+// ~~~~
+resolver::~resolver () noexcept = default;
+
+// file_count
+// ~~~~~~~~~~
+std::uint32_t resolver::file_count () const noexcept {
+    return narrow_cast<std::uint32_t> (files_.size ());
+}
+
+// global
+// ~~~~~~
+std::uint32_t resolver::global (std::uint32_t file, std::uint32_t index) const noexcept {
+    return globals_[file][index];
+}
+
+// reserve
+// ~~~~~~~
+void resolver::reserve (std::size_t extra) {
+    // Keep the load factor at or below one half so that probe sequences stay short.
+    std::size_t const needed = (used_.load () + extra) * 2U;
+    if (needed <= capacity_) {
+        return;
+    }
+    std::size_t capacity = std::max (capacity_, std::size_t{64});
+    while (capacity < needed) {
+        capacity *= 2U;
+    }
+
+    auto slots = std::make_unique<slot[]> (capacity);
+    std::vector<std::uint32_t> moved (capacity_, none);
+    for (std::size_t ctr = 0; ctr < capacity_; ++ctr) {
+        slot const & from = slots_[ctr];
+        interned_string const name = from.name.load (std::memory_order_relaxed);
+        if (!name) {
+            continue;
+        }
+        // The name's hash was computed when it was interned.
+        std::size_t pos = name.hash () & (capacity - 1U);
+        while (slots[pos].name.load (std::memory_order_relaxed)) {
+            pos = (pos + 1U) & (capacity - 1U);
+        }
+        slot & to = slots[pos];
+        to.name.store (name, std::memory_order_relaxed);
+        to.best.store (from.best.load (std::memory_order_relaxed), std::memory_order_relaxed);
+        to.strong.store (from.strong.load (std::memory_order_relaxed), std::memory_order_relaxed);
+        to.common_size.store (from.common_size.load (std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+        to.common_align.store (from.common_align.load (std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+        to.strong_ref.store (from.strong_ref.load (std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+        moved[ctr] = narrow_cast<std::uint32_t> (pos);
+    }
+    for (std::vector<std::uint32_t> & g : globals_) {
+        for (std::uint32_t & index : g) {
+            if (index != none) {
+                index = moved[index];
+            }
+        }
+    }
+    slots_ = std::move (slots);
+    capacity_ = capacity;
+}
+
+// insert
+// ~~~~~~
+std::uint32_t resolver::insert (std::uint32_t file, std::uint32_t index, interned_string name) {
+    symbol_table const & st = files_[file]->symbols ();
+
+    std::size_t const mask = capacity_ - 1U;
+    std::size_t pos = name.hash () & mask;
+    for (;;) {
+        slot & s = slots_[pos];
+        interned_string cur = s.name.load (std::memory_order_acquire);
+        if (!cur) {
+            if (s.name.compare_exchange_strong (cur, name, std::memory_order_acq_rel)) {
+                used_.fetch_add (1U, std::memory_order_relaxed);
+                break;
+            }
+            // Another thread claimed the slot first: cur now holds its name.
+        }
+        if (cur == name) {
+            break;
+        }
+        pos = (pos + 1U) & mask;
+    }
+
+    slot & s = slots_[pos];
+    std::uint64_t const rank = rank_of (st, index);
+    atomic_min (s.best, pack (rank, file, index));
+    switch (rank) {
+    case strong_def: s.strong.fetch_add (1U, std::memory_order_relaxed); break;
+    case common_def:
+        atomic_max (s.common_size, st.value[index]);
+        atomic_max (s.common_align, mach_o::get_comm_align (st.desc[index]));
+        break;
+    case reference:
+        if ((st.desc[index] & mach_o::n_weak_ref) == 0U) {
+            s.strong_ref.store (true, std::memory_order_relaxed);
+        }
+        break;
+    default: break;
+    }
+    return narrow_cast<std::uint32_t> (pos);
+}
+
+// add
+// ~~~
+void resolver::add (std::vector<object_file const *> const & files) {
+    auto const first = narrow_cast<std::uint32_t> (files_.size ());
+    std::size_t symbols = 0;
+    for (object_file const * f : files) {
+        files_.push_back (f);
+        globals_.emplace_back (f->symbols ().size (), none);
+        symbols += f->symbols ().size ();
+    }
+    this->reserve (symbols);
+
+    // Split the files into chunks of roughly equal numbers of symbols so that one large file
+    // doesn't serialize the work.
+    struct chunk {
+        std::uint32_t file;
+        std::uint32_t begin;
+        std::uint32_t end;
+    };
+    std::vector<chunk> chunks;
+    for (auto file = first; file < files_.size (); ++file) {
+        auto const size = narrow_cast<std::uint32_t> (files_[file]->symbols ().size ());
+        for (std::uint32_t begin = 0; begin < size; begin += chunk_size) {
+            chunks.push_back (
+                {file, begin, std::min (size, narrow_cast<std::uint32_t> (begin + chunk_size))});
+        }
+    }
+
+    // The names are interned first. The arena locks one of its shards for each name: doing so
+    // in a separate pass leaves nothing but compare-and-swap operations on the table's path.
+    std::vector<std::vector<interned_string>> names (files.size ());
+    for (std::size_t ctr = 0; ctr < files.size (); ++ctr) {
+        names[ctr].resize (files[ctr]->symbols ().size ());
+    }
+    pool_.parallel_for (chunks.size (), [this, &chunks, &names, first] (std::size_t ctr) {
+        chunk const & c = chunks[ctr];
+        symbol_table const & st = files_[c.file]->symbols ();
+        std::vector<interned_string> & n = names[c.file - first];
+        for (std::uint32_t index = c.begin; index < c.end; ++index) {
+            if (is_external (st, index)) {
+                n[index] = names_.intern (st.name (index));
+            }
+        }
+    });
+    pool_.parallel_for (chunks.size (), [this, &chunks, &names, first] (std::size_t ctr) {
+        chunk const & c = chunks[ctr];
+        symbol_table const & st = files_[c.file]->symbols ();
+        std::vector<interned_string> const & n = names[c.file - first];
+        std::vector<std::uint32_t> & g = globals_[c.file];
+        for (std::uint32_t index = c.begin; index < c.end; ++index) {
+            if (is_external (st, index)) {
+                g[index] = this->insert (c.file, index, n[index]);
+            }
+        }
+    });
+}
+
+// find
+// ~~~~
+std::uint32_t resolver::find (interned_string name) const noexcept {
+    if (capacity_ == 0U || !name) {
+        return none;
+    }
+    std::size_t const mask = capacity_ - 1U;
+    for (std::size_t pos = name.hash () & mask;; pos = (pos + 1U) & mask) {
+        interned_string const n = slots_[pos].name.load (std::memory_order_acquire);
+        if (!n) {
+            return none;
+        }
+        if (n == name) {
+            return narrow_cast<std::uint32_t> (pos);
+        }
+    }
+}
+
+// global_limit
+// ~~~~~~~~~~~~
+std::uint32_t resolver::global_limit () const noexcept {
+    return narrow_cast<std::uint32_t> (capacity_);
+}
+
+// get
+// ~~~
+auto resolver::get (std::uint32_t g) const noexcept -> resolution {
+    slot const & s = slots_[g];
+    std::uint64_t const best = s.best.load (std::memory_order_relaxed);
+    resolution r;
+    r.name = s.name.load (std::memory_order_relaxed);
+    switch (rank_of (best)) {
+    case strong_def:
+    case weak_def: r.k = kind::defined; break;
+    case common_def: r.k = kind::common; break;
+    default: r.k = kind::undefined; break;
+    }
+    r.file = file_of (best);
+    r.index = index_of (best);
+    r.strong_definitions = s.strong.load (std::memory_order_relaxed);
+    r.common_size = s.common_size.load (std::memory_order_relaxed);
+    r.common_align = s.common_align.load (std::memory_order_relaxed);
+    r.weak_ref = !s.strong_ref.load (std::memory_order_relaxed);
+    return r;
+}
+
+// select
+// ~~~~~~
+template <typename Predicate>
+std::vector<std::uint32_t> resolver::select (Predicate pred) const {
+    constexpr std::size_t block = 65536;
+    std::size_t const blocks = (capacity_ + block - 1U) / block;
+    std::vector<std::vector<std::uint32_t>> found (blocks);
+    pool_.parallel_for (blocks, [&] (std::size_t b) {
+        std::size_t const end = std::min (capacity_, (b + 1U) * block);
+        for (std::size_t pos = b * block; pos < end; ++pos) {
+            slot const & s = slots_[pos];
+            if (s.name.load (std::memory_order_relaxed) && pred (s)) {
+                found[b].push_back (narrow_cast<std::uint32_t> (pos));
+            }
+        }
+    });
+
+    std::vector<std::uint32_t> result;
+    for (std::vector<std::uint32_t> const & f : found) {
+        result.insert (std::end (result), std::begin (f), std::end (f));
+    }
+    // A slot's position depends on the order of insertion; its name does not.
+    std::sort (std::begin (result), std::end (result),
+               [this] (std::uint32_t a, std::uint32_t b) noexcept {
+                   return std::strcmp (slots_[a].name.load (std::memory_order_relaxed).c_str (),
+                                       slots_[b].name.load (std::memory_order_relaxed).c_str ()) <
+                          0;
+               });
+    return result;
+}
+
+// globals
+// ~~~~~~~
+std::vector<std::uint32_t> resolver::globals () const {
+    return this->select ([] (slot const &) noexcept { return true; });
+}
+
+// undefined
+// ~~~~~~~~~
+std::vector<std::uint32_t> resolver::undefined () const {
+    return this->select ([] (slot const & s) noexcept {
+        return rank_of (s.best.load (std::memory_order_relaxed)) == reference;
+    });
+}
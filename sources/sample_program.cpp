@@ -0,0 +1,149 @@
+#include "sample_program.hpp"
+
+#include <memory>
+
+#include "description.hpp"
+#include "image_builder.hpp"
+#include "lc_build_version.hpp"
+#include "lc_segment.hpp"
+#include "lc_symtab.hpp"
+#include "mach-o_reloc.hpp"
+#include "target.hpp"
+#include "util.hpp"
+
+namespace {
+
+    // The target-specific parts of the program that we write.
+    template <typename Target>
+    struct program;
+
+    template <>
+    struct program<x86_64_target> {
+        // 0000000000000000    pushq    %rbp
+        // 0000000000000001    movq    %rsp, %rbp
+        // 0000000000000004    xorl    %eax, %eax
+        // 0000000000000006    popq    %rbp
+        // 0000000000000007    retq
+        static lc_segment::contents_range text () noexcept {
+            static constexpr std::uint8_t contents[] = {
+                0x55, 0x48, 0x89, 0xe5, 0x31, 0xc0, 0x5d, 0xc3,
+            };
+            return {contents, contents + sizeof (contents)};
+        }
+        static constexpr std::uint8_t pointer_relocation () noexcept {
+            return mach_o::x86_64_reloc_unsigned;
+        }
+    };
+
+    template <>
+    struct program<arm64_target> {
+        // 0000000000000000    mov    w0, #0x0
+        // 0000000000000004    ret
+        static lc_segment::contents_range text () noexcept {
+            static constexpr std::uint8_t contents[] = {
+                0x00, 0x00, 0x80, 0x52, 0xc0, 0x03, 0x5f, 0xd6,
+            };
+            return {contents, contents + sizeof (contents)};
+        }
+        static constexpr std::uint8_t pointer_relocation () noexcept {
+            return mach_o::arm64_reloc_unsigned;
+        }
+    };
+
+    constexpr std::uint32_t text_flags =
+        mach_o::s_attr_pure_instructions | mach_o::s_attr_some_instructions | mach_o::s_regular;
+
+    // The executable is described in the same form as the descriptions accepted by
+    // machowriter --description. Its code is the same as program<>::text().
+    constexpr char executable_description[] = R"(
+page_zero
+segment __TEXT 0x100000000 r-x
+section __text 4 regular pure_instructions some_instructions
+x86_64: hex 55 48 89 e5 31 c0 5d c3
+arm64:  hex 00 00 80 52 c0 03 5f d6
+segment __DATA 0x200000000 rw-
+section __data 4 regular
+fill 4096
+dylib /usr/lib/libSystem.B.dylib
+)";
+
+    template <typename Target>
+    image build_executable (std::uint32_t header_pad, bool max_install_names) {
+        image_builder builder = image_builder::for_target<Target> ();
+        parse_description (std::begin (executable_description),
+                           std::end (executable_description) - 1, "<built-in>", Target::name (),
+                           builder);
+        builder.set_header_pad (header_pad, max_install_names);
+        return builder.build ();
+    }
+
+
+    // An MH_OBJECT file has a single unnamed segment containing all of the sections. Here, a
+    // __data section holds a pointer to the start of __text which is described by a relocation.
+    template <typename Target>
+    std::vector<std::unique_ptr<command>> build_object () {
+        auto segment = std::make_unique<lc_object_segment> ();
+        segment->add_section (
+            {
+                mach_o::sect_text, // name of this section
+                mach_o::seg_text,  // segment this section goes in
+                0x0,               // memory address of this section (patched up later)
+                0,                 // size in bytes of this section (patched up later)
+                0,                 // file offset of this section (patched up later)
+                4,                 // section alignment (power of 2)
+                0,                 // file offset of relocation entries
+                0,                 // number of relocation entries
+                text_flags         // flags (section type and attributes)
+            },
+            program<Target>::text ());
+
+        static constexpr std::uint64_t data_section_contents[] = {0x0};
+        lc_segment::section_value & data_section = segment->add_section (
+            {
+                mach_o::sect_data, // name of this section
+                mach_o::seg_data,  // segment this section goes in
+                0x0,               // memory address of this section (patched up later)
+                0,                 // size in bytes of this section (patched up later)
+                0,                 // file offset of this section (patched up later)
+                3,                 // section alignment (power of 2)
+                0,                 // file offset of relocation entries (patched up later)
+                0,                 // number of relocation entries (patched up later)
+                mach_o::s_regular, // flags (section type and attributes)
+            },
+            lc_segment::contents_range (data_section_contents,
+                                        data_section_contents +
+                                            array_elements (data_section_contents)));
+        data_section.add_relocation ({
+            0,                                      // offset in the section to what is relocated
+            1,                                      // section ordinal of __text
+            3,                                      // quad
+            program<Target>::pointer_relocation (), // type
+            false,                                  // pcrel
+            false,                                  // extern
+        });
+
+        std::vector<std::unique_ptr<command>> commands;
+        commands.emplace_back (std::move (segment));
+        commands.emplace_back (std::make_unique<lc_build_version> (
+            mach_o::platform_macos, Target::min_os_version (), Target::min_os_version ()));
+        commands.emplace_back (std::make_unique<lc_symtab> ());
+        return commands;
+    }
+
+} // end anonymous namespace
+
+// build_sample_program
+// ~~~~~~~~~~~~~~~~~~~~
+template <typename Target>
+image build_sample_program (bool object, std::uint32_t header_pad, bool max_install_names) {
+    if (object) {
+        image result{Target::cpu_type (), Target::cpu_subtype (), mach_o::filetype_t::object,
+                     mach_o::mh_subsections_via_symbols, build_object<Target> ()};
+        result.reserve_header_pad (header_pad, max_install_names);
+        return result;
+    }
+    return build_executable<Target> (header_pad, max_install_names);
+}
+
+template image build_sample_program<x86_64_target> (bool, std::uint32_t, bool);
+template image build_sample_program<arm64_target> (bool, std::uint32_t, bool);
@@ -0,0 +1,270 @@
+#include "server.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <system_error>
+
+#ifndef _WIN32
+#    include <signal.h>
+#    include <sys/socket.h>
+#    include <sys/stat.h>
+#    include <sys/time.h>
+#    include <sys/un.h>
+#    include <unistd.h>
+#endif
+
+#include "util.hpp"
+
+// A request is the client's working directory followed by its arguments, each terminated by a
+// NUL. The client then shuts down its side of the connection. The reply is the exit status and
+// the size of the output in decimal separated by a space, a newline, the output and the
+// diagnostics; the server then closes the connection.
+
+#ifdef _WIN32
+
+// serve
+// ~~~~~
+void serve (std::string const &, request_handler const &) {
+    throw std::system_error (std::make_error_code (std::errc::function_not_supported),
+                             "Unix domain sockets");
+}
+
+// send_request
+// ~~~~~~~~~~~~
+int send_request (std::string const &, std::vector<std::string> const &, std::string &,
+                  std::string &) {
+    throw std::system_error (std::make_error_code (std::errc::function_not_supported),
+                             "Unix domain sockets");
+}
+
+#else
+
+namespace {
+
+    [[noreturn]] void raise (char const * what) {
+        throw std::system_error (errno, std::generic_category (), what);
+    }
+
+    /// The largest request which the server will accept.
+    constexpr std::size_t max_request = 1024 * 1024;
+    /// The longest that the server waits for a client to send its request or to accept its
+    /// reply. Requests are handled one at a time, so a client which stalls would otherwise hold
+    /// up every other.
+    constexpr time_t client_timeout_seconds = 30;
+
+    [[noreturn]] void timed_out (char const * what) {
+        throw std::system_error (std::make_error_code (std::errc::timed_out), what);
+    }
+
+    /// Limits the time that a read from or write to \p fd may wait to client_timeout_seconds.
+    void set_timeouts (int fd) {
+        timeval const timeout{client_timeout_seconds, 0};
+        if (::setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof (timeout)) == -1 ||
+            ::setsockopt (fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof (timeout)) == -1) {
+            raise ("setsockopt");
+        }
+    }
+
+    sockaddr_un socket_address (std::string const & path) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size () >= sizeof (addr.sun_path)) {
+            throw std::system_error (std::make_error_code (std::errc::filename_too_long),
+                                     "socket path");
+        }
+        std::copy (std::begin (path), std::end (path), addr.sun_path);
+        return addr;
+    }
+
+    std::string current_directory () {
+        char cwd[4096];
+        if (::getcwd (cwd, sizeof (cwd)) == nullptr) {
+            raise ("getcwd");
+        }
+        return cwd;
+    }
+
+    int open_socket () {
+        int const fd = ::socket (AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1) {
+            raise ("socket");
+        }
+        return fd;
+    }
+
+    /// \returns True if a connection to \p addr was established.
+    bool connect_to (int fd, sockaddr_un const & addr) {
+        return ::connect (fd, reinterpret_cast<sockaddr const *> (&addr), sizeof (addr)) == 0;
+    }
+
+    void write_all (int fd, char const * data, std::size_t size) {
+        while (size > 0U) {
+            ssize_t const written = ::write (fd, data, size);
+            if (written == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    timed_out ("write");
+                }
+                raise ("write");
+            }
+            data += written;
+            size -= static_cast<std::size_t> (written);
+        }
+    }
+
+    /// Reads from \p fd until the end of the stream or until more than \p limit bytes have
+    /// arrived. Throws std::system_error if a timeout set on \p fd expires.
+    std::string read_all (int fd, std::size_t limit) {
+        std::string result;
+        char buffer[4096];
+        for (;;) {
+            ssize_t const size = ::read (fd, buffer, sizeof (buffer));
+            if (size == 0) {
+                return result;
+            }
+            if (size == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    timed_out ("read");
+                }
+                raise ("read");
+            }
+            result.append (buffer, static_cast<std::size_t> (size));
+            if (result.size () > limit) {
+                throw std::system_error (std::make_error_code (std::errc::message_size),
+                                         "request");
+            }
+        }
+    }
+
+    /// Reads a request from \p fd, runs it and sends the reply.
+    void handle (int fd, request_handler const & handler, bool & stop) {
+        std::string output;
+        std::string diagnostics;
+        int status = EXIT_FAILURE;
+        try {
+            set_timeouts (fd);
+            std::string const request = read_all (fd, max_request);
+            std::vector<std::string> fields;
+            for (std::size_t pos = 0; pos < request.size ();) {
+                std::size_t const end = request.find ('\0', pos);
+                if (end == std::string::npos) {
+                    throw std::system_error (std::make_error_code (std::errc::bad_message),
+                                             "request");
+                }
+                fields.emplace_back (request, pos, end - pos);
+                pos = end + 1U;
+            }
+            if (fields.empty ()) {
+                throw std::system_error (std::make_error_code (std::errc::bad_message),
+                                         "request");
+            }
+            std::string const cwd = std::move (fields.front ());
+            fields.erase (std::begin (fields));
+            status = handler (cwd, fields, output, diagnostics, stop);
+        } catch (std::exception const & ex) {
+            diagnostics += std::string{"Error: "} + ex.what () + '\n';
+            status = EXIT_FAILURE;
+        }
+        std::string const reply = std::to_string (status) + ' ' + std::to_string (output.size ()) +
+                                  '\n' + output + diagnostics;
+        try {
+            write_all (fd, reply.data (), reply.size ());
+        } catch (std::system_error const &) {
+            // The client has gone away: there is no-one to tell.
+        }
+    }
+
+} // end anonymous namespace
+
+// serve
+// ~~~~~
+void serve (std::string const & socket_path, request_handler const & handler) {
+    // The socket is unlinked when the server exits: by then, a relative path could name a
+    // different file.
+    std::string const path = !socket_path.empty () && socket_path.front () == '/'
+                                 ? socket_path
+                                 : current_directory () + '/' + socket_path;
+    sockaddr_un const addr = socket_address (path);
+    int const fd = open_socket ();
+    auto const scope = make_scope_guard ([fd] () { ::close (fd); });
+
+    // A socket which accepts a connection belongs to a running server. One which does not was
+    // left behind by a server which has exited.
+    struct stat buf;
+    if (::stat (path.c_str (), &buf) == 0 && S_ISSOCK (buf.st_mode)) {
+        int const probe = open_socket ();
+        bool const live = connect_to (probe, addr);
+        ::close (probe);
+        if (live) {
+            throw std::system_error (std::make_error_code (std::errc::address_in_use), "bind");
+        }
+        ::unlink (path.c_str ());
+    }
+    if (::bind (fd, reinterpret_cast<sockaddr const *> (&addr), sizeof (addr)) == -1) {
+        raise ("bind");
+    }
+    auto const unlink_scope = make_scope_guard ([&path] () { ::unlink (path.c_str ()); });
+    if (::listen (fd, SOMAXCONN) == -1) {
+        raise ("listen");
+    }
+    // A client which disconnects before its reply is sent must not end the server.
+    ::signal (SIGPIPE, SIG_IGN);
+
+    for (bool stop = false; !stop;) {
+        int const client = ::accept (fd, nullptr, nullptr);
+        if (client == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            raise ("accept");
+        }
+        auto const client_scope = make_scope_guard ([client] () { ::close (client); });
+        handle (client, handler, stop);
+    }
+}
+
+// send_request
+// ~~~~~~~~~~~~
+int send_request (std::string const & path, std::vector<std::string> const & args,
+                  std::string & output, std::string & diagnostics) {
+    sockaddr_un const addr = socket_address (path);
+    int const fd = open_socket ();
+    auto const scope = make_scope_guard ([fd] () { ::close (fd); });
+    if (!connect_to (fd, addr)) {
+        raise ("connect");
+    }
+
+    std::string request = current_directory ();
+    request.push_back ('\0');
+    for (std::string const & arg : args) {
+        request.append (arg).push_back ('\0');
+    }
+    write_all (fd, request.data (), request.size ());
+    if (::shutdown (fd, SHUT_WR) == -1) {
+        raise ("shutdown");
+    }
+
+    std::string const reply = read_all (fd, type_max<std::size_t> ());
+    char const * const first = reply.c_str ();
+    char * end = nullptr;
+    long const status = std::strtol (first, &end, 10);
+    unsigned long long const output_size = std::strtoull (end, &end, 10);
+    std::size_t const body = static_cast<std::size_t> (end - first) + 1U;
+    if (end == first || *end != '\n' || output_size > reply.size () - body) {
+        throw std::system_error (std::make_error_code (std::errc::bad_message), "reply");
+    }
+    auto const split = body + static_cast<std::size_t> (output_size);
+    output.append (reply, body, split - body);
+    diagnostics.append (reply, split, std::string::npos);
+    return static_cast<int> (status);
+}
+
+#endif // _WIN32
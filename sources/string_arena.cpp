@@ -0,0 +1,141 @@
+#include "string_arena.hpp"
+
+#include <algorithm>
+
+#include "util.hpp"
+
+namespace {
+
+    /// The number of 8-byte units in each storage block.
+    constexpr std::size_t block_units = 8192;
+
+    /// \returns The number of 8-byte units needed to hold a header and a string of \p length
+    ///   characters plus its terminating NUL.
+    constexpr std::size_t units (std::size_t header_size, std::size_t length) noexcept {
+        return (header_size + length + 1U + 7U) / 8U;
+    }
+
+} // end anonymous namespace
+
+constexpr unsigned string_arena::shard_bits;
+
+// ctor
+// ~~~~
+string_arena::string_arena () = default;
+
+// dtor
+// ~~~~
+string_arena::~string_arena () noexcept = default;
+
+// shard_index
+// ~~~~~~~~~~~
+std::size_t string_arena::shard_index (std::uint64_t hash) noexcept {
+    // The table position within a shard is taken from the low bits of the hash.
+    return static_cast<std::size_t> (hash >> (64U - shard_bits));
+}
+
+// lookup
+// ~~~~~~
+auto string_arena::lookup (shard const & s, char const * str, std::size_t length,
+                           std::uint64_t hash) noexcept -> header const * {
+    if (s.table.empty ()) {
+        return nullptr;
+    }
+    std::size_t const mask = s.table.size () - 1U;
+    for (std::size_t pos = static_cast<std::size_t> (hash) & mask;; pos = (pos + 1U) & mask) {
+        header const * const h = s.table[pos];
+        if (h == nullptr) {
+            return nullptr;
+        }
+        if (h->hash == hash && h->length == length &&
+            std::memcmp (interned_string{h}.c_str (), str, length) == 0) {
+            return h;
+        }
+    }
+}
+
+// grow
+// ~~~~
+void string_arena::grow (shard & s) {
+    std::size_t const size = std::max (s.table.size () * 2U, std::size_t{256});
+    std::vector<header const *> table (size, nullptr);
+    std::size_t const mask = size - 1U;
+    for (header const * h : s.table) {
+        if (h != nullptr) {
+            std::size_t pos = static_cast<std::size_t> (h->hash) & mask;
+            while (table[pos] != nullptr) {
+                pos = (pos + 1U) & mask;
+            }
+            table[pos] = h;
+        }
+    }
+    s.table = std::move (table);
+}
+
+// allocate
+// ~~~~~~~~
+auto string_arena::allocate (shard & s, std::size_t length) -> header * {
+    std::size_t const n = units (sizeof (header), length);
+    if (n > s.available) {
+        // Strings which are too long to share a block get one of their own.
+        std::size_t const size = std::max (n, block_units);
+        s.blocks.emplace_back (new std::uint64_t[size]);
+        s.next = s.blocks.back ().get ();
+        s.available = size;
+    }
+    auto * const h = reinterpret_cast<header *> (s.next);
+    s.next += n;
+    s.available -= n;
+    return h;
+}
+
+// intern
+// ~~~~~~
+interned_string string_arena::intern (char const * str, std::size_t length) {
+    std::uint64_t const hash = hash_string (str, length);
+    shard & s = shards_[shard_index (hash)];
+    std::lock_guard<std::mutex> const lock{s.mut};
+    if (header const * const h = lookup (s, str, length, hash)) {
+        return interned_string{h};
+    }
+
+    // Keep the load factor at or below one half.
+    if ((s.used + 1U) * 2U > s.table.size ()) {
+        grow (s);
+    }
+    header * const h = allocate (s, length);
+    h->hash = hash;
+    h->length = length;
+    auto * const chars = reinterpret_cast<char *> (h + 1);
+    std::memcpy (chars, str, length);
+    chars[length] = '\0';
+
+    std::size_t const mask = s.table.size () - 1U;
+    std::size_t pos = static_cast<std::size_t> (hash) & mask;
+    while (s.table[pos] != nullptr) {
+        pos = (pos + 1U) & mask;
+    }
+    s.table[pos] = h;
+    ++s.used;
+    return interned_string{h};
+}
+
+// find
+// ~~~~
+interned_string string_arena::find (char const * str, std::size_t length) const {
+    std::uint64_t const hash = hash_string (str, length);
+    shard const & s = shards_[shard_index (hash)];
+    std::lock_guard<std::mutex> const lock{s.mut};
+    return interned_string{lookup (s, str, length, hash)};
+}
+
+// size
+// ~~~~
+std::size_t string_arena::size () const {
+    std::size_t result = 0;
+    for (shard const & s : shards_) {
+        std::lock_guard<std::mutex> const lock{s.mut};
+        result += s.used;
+    }
+    return result;
+}
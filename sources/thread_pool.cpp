@@ -0,0 +1,88 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+// ctor
+// ~~~~
+thread_pool::thread_pool (unsigned threads) {
+    if (threads == 0U) {
+        threads = std::max (std::thread::hardware_concurrency (), 1U);
+    }
+    workers_.reserve (threads);
+    for (unsigned ctr = 0; ctr < threads; ++ctr) {
+        workers_.emplace_back (&thread_pool::worker, this);
+    }
+}
+
+// dtor
+// ~~~~
+thread_pool::~thread_pool () noexcept {
+    {
+        std::lock_guard<std::mutex> const lock{mut_};
+        done_ = true;
+    }
+    cv_.notify_all ();
+    for (std::thread & t : workers_) {
+        t.join ();
+    }
+}
+
+// worker
+// ~~~~~~
+void thread_pool::worker () {
+    for (;;) {
+        std::function<void ()> task;
+        {
+            std::unique_lock<std::mutex> lock{mut_};
+            cv_.wait (lock, [this] () { return done_ || !tasks_.empty (); });
+            if (tasks_.empty ()) {
+                return; // done_ is set and there is no more work.
+            }
+            task = std::move (tasks_.front ());
+            tasks_.pop_front ();
+        }
+        task ();
+    }
+}
+
+// parallel for
+// ~~~~~~~~~~~~
+void thread_pool::parallel_for (std::size_t count, std::function<void (std::size_t)> const & f) {
+    // Indices are handed out one at a time from a shared counter so that a slow item doesn't
+    // hold up the items queued behind it.
+    std::atomic<std::size_t> next{0};
+    std::mutex error_mut;
+    std::exception_ptr error;
+    // The index whose exception is held. Keeping the lowest means that the error reported
+    // doesn't depend on the order in which the threads happen to run.
+    std::size_t error_index = count;
+    auto const body = [&] () {
+        for (std::size_t index; (index = next.fetch_add (1U)) < count;) {
+            try {
+                f (index);
+            } catch (...) {
+                std::lock_guard<std::mutex> const lock{error_mut};
+                if (index < error_index) {
+                    error = std::current_exception ();
+                    error_index = index;
+                }
+            }
+        }
+    };
+
+    std::size_t const helpers = std::min (workers_.size (), count > 0U ? count - 1U : 0U);
+    std::vector<std::future<void>> futures;
+    futures.reserve (helpers);
+    for (std::size_t ctr = 0; ctr < helpers; ++ctr) {
+        futures.push_back (this->submit (body));
+    }
+    body ();
+    for (std::future<void> & fut : futures) {
+        fut.get ();
+    }
+    if (error) {
+        std::rethrow_exception (error);
+    }
+}
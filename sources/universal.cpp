@@ -0,0 +1,92 @@
+#include "universal.hpp"
+
+#include <cassert>
+#include <future>
+
+#include "instrumentation.hpp"
+#include "mach-o.hpp"
+#include "output.hpp"
+#include "util.hpp"
+
+// build_image
+// ~~~~~~~~~~~
+image build_image (slice const & s) {
+    phase_timer const timer{phase::command_construction};
+    return s.build ();
+}
+
+// write_universal
+// ~~~~~~~~~~~~~~~
+std::uint64_t write_universal (int fd, std::vector<slice> const & slices) {
+    std::size_t const nslices = slices.size ();
+
+    // Build and lay out each of the slices. Laying out an image yields its size and its header
+    // and load commands, which are kept in memory until the slice's position is known. The
+    // contents are not produced until they are written.
+    struct laid_out {
+        image img;
+        std::vector<std::uint8_t> header;
+        std::uint64_t size;
+    };
+    std::vector<std::future<laid_out>> sized;
+    sized.reserve (nslices);
+    for (slice const & s : slices) {
+        sized.emplace_back (std::async (std::launch::async, [&s] () {
+            laid_out result{build_image (s), {}, 0};
+            buffer_output out{result.header};
+            result.size = result.img.write_commands (out);
+            return result;
+        }));
+    }
+
+    std::vector<laid_out> images;
+    images.reserve (nslices);
+    std::vector<mach_o::fat_arch> archs;
+    archs.reserve (nslices);
+    std::uint64_t offset = sizeof (mach_o::fat_header) + nslices * sizeof (mach_o::fat_arch);
+    for (std::size_t ctr = 0; ctr < nslices; ++ctr) {
+        laid_out l = sized[ctr].get ();
+        std::uint32_t const align = slices[ctr].align;
+        assert (align < 32U);
+        offset = aligned (offset, 1U << align);
+        archs.push_back ({
+            static_cast<std::uint32_t> (l.img.cputype ()),    // cpu specifier
+            static_cast<std::uint32_t> (l.img.cpusubtype ()), // machine specifier
+            narrow_cast<std::uint32_t> (offset),              // file offset to this object file
+            narrow_cast<std::uint32_t> (l.size),              // size of this object file
+            align,                                            // alignment as a power of 2
+        });
+        offset += l.size;
+        images.push_back (std::move (l));
+    }
+    std::uint64_t const file_size = offset;
+
+    // Now that the position of every slice is known, write them all at once.
+    std::vector<std::future<void>> written;
+    written.reserve (nslices);
+    for (std::size_t ctr = 0; ctr < nslices; ++ctr) {
+        written.emplace_back (
+            std::async (std::launch::async, [fd, &l = images[ctr], &arch = archs[ctr]] () {
+                file_output out{fd, arch.offset};
+                out.write (l.header.data (), l.header.size ());
+                l.img.write_payload (out);
+            }));
+    }
+
+    file_output out{fd, 0};
+    mach_o::fat_header const header{big_endian (mach_o::fat_magic),
+                                    big_endian (narrow_cast<std::uint32_t> (nslices))};
+    out.write (&header, sizeof (header));
+    for (mach_o::fat_arch const & arch : archs) {
+        mach_o::fat_arch const be{big_endian (arch.cputype), big_endian (arch.cpusubtype),
+                                  big_endian (arch.offset), big_endian (arch.size),
+                                  big_endian (arch.align)};
+        out.write (&be, sizeof (be));
+    }
+
+    for (std::future<void> & f : written) {
+        f.get ();
+    }
+    extend_file (fd, file_size);
+    return file_size;
+}
@@ -0,0 +1,101 @@
+#include "uuid.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace {
+
+    constexpr std::uint64_t k1 = UINT64_C (0x87c37b91114253d5);
+    constexpr std::uint64_t k2 = UINT64_C (0x4cf5ad432745937f);
+
+    constexpr std::uint64_t rotl (std::uint64_t x, unsigned r) noexcept {
+        return (x << r) | (x >> (64U - r));
+    }
+
+    // The MurmurHash3 finalizer: every input bit affects every output bit.
+    std::uint64_t fmix (std::uint64_t h) noexcept {
+        h ^= h >> 33U;
+        h *= UINT64_C (0xff51afd7ed558ccd);
+        h ^= h >> 33U;
+        h *= UINT64_C (0xc4ceb9fe1a85ec53);
+        h ^= h >> 33U;
+        return h;
+    }
+
+    std::uint64_t load64 (std::uint8_t const * p) noexcept {
+        std::uint64_t v;
+        std::memcpy (&v, p, sizeof (v));
+        return v;
+    }
+
+} // end anonymous namespace
+
+// random_uuid
+// ~~~~~~~~~~~
+uuid random_uuid () {
+    enum {
+        version_octet = 6,
+        variant_octet = 8,
+    };
+
+    uuid result;
+    std::generate (std::begin (result), std::end (result), [] () {
+        thread_local std::random_device device;
+        thread_local std::mt19937_64 generator (device ());
+        thread_local std::uniform_int_distribution<unsigned> distribution (0U, 255U);
+        return static_cast<std::uint8_t> (distribution (generator));
+    });
+    // Set variant: must be 0b10xxxxxx
+    result[variant_octet] &= 0xBF; // 0b10111111;
+    result[variant_octet] |= 0x80; // 0b10000000;
+
+    // Set version: must be 0b0100xxxx
+    result[version_octet] &= 0x4F;               // 0b01001111;
+    result[version_octet] |= std::uint8_t{0x40}; // a random number based UUID.
+    return result;
+}
+
+// add
+// ~~~
+void uuid_hasher::add (std::uint64_t offset, void const * data, std::size_t size) noexcept {
+    auto const * p = static_cast<std::uint8_t const *> (data);
+    std::uint64_t a = fmix (offset + k1);
+    std::uint64_t b = fmix (size + k2);
+    std::size_t n = size;
+    for (; n >= 16U; n -= 16U, p += 16) {
+        a = rotl (a ^ (load64 (p) * k1), 31U) * k2 + b;
+        b = rotl (b ^ (load64 (p + 8) * k2), 33U) * k1 + a;
+    }
+    if (n > 0U) {
+        std::uint8_t tail[16] = {0};
+        std::memcpy (tail, p, n);
+        a = rotl (a ^ (load64 (tail) * k1), 31U) * k2 + b;
+        b = rotl (b ^ (load64 (tail + 8) * k2), 33U) * k1 + a;
+    }
+    h0_ += fmix (a);
+    h1_ += fmix (b);
+}
+
+// get
+// ~~~
+uuid uuid_hasher::get () const noexcept {
+    enum {
+        version_octet = 6,
+        variant_octet = 8,
+    };
+
+    uuid result;
+    for (auto ctr = 0U; ctr < 8U; ++ctr) {
+        result[ctr] = static_cast<std::uint8_t> (h0_ >> (ctr * 8U));
+        result[ctr + 8U] = static_cast<std::uint8_t> (h1_ >> (ctr * 8U));
+    }
+    // Set variant: must be 0b10xxxxxx
+    result[variant_octet] &= 0xBF; // 0b10111111;
+    result[variant_octet] |= 0x80; // 0b10000000;
+
+    // Set version: must be 0b1000xxxx
+    result[version_octet] &= 0x8F;               // 0b10001111;
+    result[version_octet] |= std::uint8_t{0x80}; // a custom (hash based) UUID.
+    return result;
+}
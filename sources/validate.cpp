@@ -0,0 +1,324 @@
+#include "validate.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+    // Load commands are only guaranteed to be 4-byte aligned if an earlier command has a bad
+    // size, so they are copied rather than accessed in place.
+    template <typename T>
+    T read (std::uint8_t const * p) noexcept {
+        static_assert (std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        std::aligned_storage_t<sizeof (T), alignof (T)> t;
+        std::memcpy (&t, p, sizeof (T));
+        return *reinterpret_cast<T const *> (&t);
+    }
+
+    std::uint64_t page_size (mach_o::cpu_type cputype) noexcept {
+        return cputype == mach_o::cpu_type::arm64 ? 0x4000 : 0x1000;
+    }
+
+    bool contains (std::uint64_t first, std::uint64_t size, std::uint64_t offset,
+                   std::uint64_t length) noexcept {
+        return offset >= first && length <= size && offset - first <= size - length;
+    }
+
+    struct segment_extent {
+        std::uint64_t cmd_offset;
+        std::uint64_t first;
+        std::uint64_t size;
+    };
+
+    struct blob_extent {
+        std::uint64_t cmd_offset;
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    /// Reports any pair of overlapping extents.
+    void check_overlap (std::vector<segment_extent> & extents, char const * message,
+                        std::vector<diagnostic> & diags) {
+        std::sort (std::begin (extents), std::end (extents),
+                   [] (segment_extent const & a, segment_extent const & b) noexcept {
+                       return a.first < b.first;
+                   });
+        for (std::size_t ctr = 1; ctr < extents.size (); ++ctr) {
+            segment_extent const & prev = extents[ctr - 1];
+            if (extents[ctr].first - prev.first < prev.size) {
+                diags.push_back ({extents[ctr].cmd_offset, message});
+            }
+        }
+    }
+
+    class validator {
+    public:
+        explicit validator (image_view const & image) noexcept
+                : image_{image}
+                , object_{image.header ().filetype == mach_o::filetype_t::object}
+                , page_size_{page_size (image.header ().cputype)} {}
+
+        std::vector<diagnostic> run ();
+
+    private:
+        void error (std::uint64_t offset, char const * message) {
+            diags_.push_back ({offset, message});
+        }
+        void blob (std::uint64_t cmd_offset, std::uint64_t offset, std::uint64_t size) {
+            blobs_.push_back ({cmd_offset, offset, size});
+        }
+        void table (std::uint64_t cmd_offset, std::uint32_t offset, std::uint32_t count,
+                    std::size_t entry_size) {
+            this->blob (cmd_offset, offset, std::uint64_t{count} * entry_size);
+        }
+
+        void segment (std::uint64_t offset, std::uint8_t const * cmd, std::uint32_t cmdsize);
+        void section (std::uint64_t offset, mach_o::segment_command_64 const & seg,
+                      mach_o::section_64 const & sect);
+        void command (std::uint64_t offset, std::uint8_t const * cmd, std::uint32_t cmdsize);
+        void finish ();
+
+        image_view const & image_;
+        bool const object_;
+        std::uint64_t const page_size_;
+
+        std::vector<diagnostic> diags_;
+        std::vector<segment_extent> file_extents_;
+        std::vector<segment_extent> vm_extents_;
+        std::vector<blob_extent> blobs_;
+
+        bool seen_linkedit_ = false;
+        mach_o::segment_command_64 linkedit_{};
+        bool seen_text_ = false;
+        mach_o::segment_command_64 text_{};
+        bool seen_main_ = false;
+        std::uint64_t main_offset_ = 0;
+        std::uint64_t entryoff_ = 0;
+    };
+
+    // run
+    // ~~~
+    std::vector<diagnostic> validator::run () {
+        mach_o::mach_header_64 const & header = image_.header ();
+        std::uint8_t const * const first = image_.data () + sizeof (mach_o::mach_header_64);
+        std::uint32_t const sizeofcmds = header.sizeofcmds;
+
+        std::uint32_t pos = 0;
+        for (std::uint32_t ctr = 0; ctr < header.ncmds; ++ctr) {
+            std::uint64_t const offset = sizeof (mach_o::mach_header_64) + pos;
+            if (sizeofcmds - pos < sizeof (mach_o::load_command)) {
+                this->error (offset, "load commands overflow sizeofcmds");
+                return std::move (diags_);
+            }
+            auto const lc = read<mach_o::load_command> (first + pos);
+            if (lc.cmdsize < sizeof (mach_o::load_command)) {
+                this->error (offset, "load command size is too small");
+                return std::move (diags_);
+            }
+            if (lc.cmdsize > sizeofcmds - pos) {
+                this->error (offset, "load commands overflow sizeofcmds");
+                return std::move (diags_);
+            }
+            if (lc.cmdsize % 8U != 0U) {
+                this->error (offset, "load command size is not a multiple of 8");
+            }
+            this->command (offset, first + pos, lc.cmdsize);
+            pos += lc.cmdsize;
+        }
+        if (pos != sizeofcmds) {
+            this->error (sizeof (mach_o::mach_header_64) + pos,
+                         "load command sizes do not sum to sizeofcmds");
+        }
+        this->finish ();
+        return std::move (diags_);
+    }
+
+    // command
+    // ~~~~~~~
+    void validator::command (std::uint64_t offset, std::uint8_t const * cmd,
+                             std::uint32_t cmdsize) {
+        auto const too_small = [&] (std::size_t size) {
+            if (cmdsize < size) {
+                this->error (offset, "load command is too small for its type");
+                return true;
+            }
+            return false;
+        };
+
+        switch (read<mach_o::load_command> (cmd).cmd) {
+        case mach_o::lc_segment_64:
+            if (!too_small (sizeof (mach_o::segment_command_64))) {
+                this->segment (offset, cmd, cmdsize);
+            }
+            break;
+        case mach_o::lc_symtab:
+            if (!too_small (sizeof (mach_o::symtab_command))) {
+                auto const st = read<mach_o::symtab_command> (cmd);
+                this->table (offset, st.symoff, st.nsyms, 16U /*sizeof (nlist_64)*/);
+                this->blob (offset, st.stroff, st.strsize);
+            }
+            break;
+        case mach_o::lc_dysymtab:
+            if (!too_small (sizeof (mach_o::dysymtab_command))) {
+                auto const dst = read<mach_o::dysymtab_command> (cmd);
+                this->table (offset, dst.tocoff, dst.ntoc, 8U);
+                this->table (offset, dst.modtaboff, dst.nmodtab, 56U);
+                this->table (offset, dst.extrefsymoff, dst.nextrefsyms, 4U);
+                this->table (offset, dst.indirectsymoff, dst.nindirectsyms, 4U);
+                this->table (offset, dst.extreloff, dst.nextrel, 8U);
+                this->table (offset, dst.locreloff, dst.nlocrel, 8U);
+            }
+            break;
+        case mach_o::lc_dyld_info:
+        case mach_o::lc_dyld_info_only:
+            if (!too_small (sizeof (mach_o::dyld_info_command))) {
+                auto const di = read<mach_o::dyld_info_command> (cmd);
+                this->blob (offset, di.rebase_off, di.rebase_size);
+                this->blob (offset, di.bind_off, di.bind_size);
+                this->blob (offset, di.weak_bind_off, di.weak_bind_size);
+                this->blob (offset, di.lazy_bind_off, di.lazy_bind_size);
+                this->blob (offset, di.export_off, di.export_size);
+            }
+            break;
+        case mach_o::lc_code_signature:
+        case mach_o::lc_segment_split_info:
+        case mach_o::lc_function_starts:
+        case mach_o::lc_data_in_code:
+        case mach_o::lc_dylib_code_sign_drs:
+        case mach_o::lc_linker_optimization_hint:
+        case mach_o::lc_dyld_exports_trie:
+        case mach_o::lc_dyld_chained_fixups:
+            if (!too_small (sizeof (mach_o::linkedit_data_command))) {
+                auto const ld = read<mach_o::linkedit_data_command> (cmd);
+                this->blob (offset, ld.dataoff, ld.datasize);
+            }
+            break;
+        case mach_o::lc_main:
+            if (!too_small (sizeof (mach_o::entry_point_command))) {
+                seen_main_ = true;
+                main_offset_ = offset;
+                entryoff_ = read<mach_o::entry_point_command> (cmd).entryoff;
+            }
+            break;
+        default: break;
+        }
+    }
+
+    // segment
+    // ~~~~~~~
+    void validator::segment (std::uint64_t offset, std::uint8_t const * cmd,
+                             std::uint32_t cmdsize) {
+        auto const seg = read<mach_o::segment_command_64> (cmd);
+        if (std::uint64_t{seg.nsects} * sizeof (mach_o::section_64) !=
+            cmdsize - sizeof (mach_o::segment_command_64)) {
+            this->error (offset, "segment command size does not match its number of sections");
+            return;
+        }
+        if (seen_linkedit_) {
+            this->error (offset, "__LINKEDIT is not the last segment");
+        }
+        auto const is_named = [&seg] (char const * name) {
+            return std::strncmp (seg.segname, name, array_elements (seg.segname)) == 0;
+        };
+        if (is_named (mach_o::seg_linkedit)) {
+            seen_linkedit_ = true;
+            linkedit_ = seg;
+        } else if (is_named (mach_o::seg_text)) {
+            seen_text_ = true;
+            text_ = seg;
+        }
+
+        if (!contains (0, image_.size (), seg.fileoff, seg.filesize)) {
+            this->error (offset, "segment extends beyond the end of the file");
+        }
+        if (!object_) {
+            if (seg.fileoff % page_size_ != 0U || seg.vmaddr % page_size_ != 0U ||
+                seg.vmsize % page_size_ != 0U) {
+                this->error (offset, "segment is not page-aligned");
+            }
+            if (seg.filesize > seg.vmsize) {
+                this->error (offset, "segment file size exceeds its VM size");
+            }
+            if (seg.filesize > 0U) {
+                file_extents_.push_back ({offset, seg.fileoff, seg.filesize});
+            }
+            if (seg.vmsize > 0U) {
+                vm_extents_.push_back ({offset, seg.vmaddr, seg.vmsize});
+            }
+        }
+
+        std::uint8_t const * sect = cmd + sizeof (mach_o::segment_command_64);
+        for (std::uint32_t ctr = 0; ctr < seg.nsects; ++ctr) {
+            this->section (offset + static_cast<std::uint64_t> (sect - cmd), seg,
+                           read<mach_o::section_64> (sect));
+            sect += sizeof (mach_o::section_64);
+        }
+    }
+
+    // section
+    // ~~~~~~~
+    void validator::section (std::uint64_t offset, mach_o::segment_command_64 const & seg,
+                             mach_o::section_64 const & sect) {
+        if (!object_ &&
+            std::strncmp (sect.segname, seg.segname, array_elements (seg.segname)) != 0) {
+            this->error (offset, "section's segment name does not match its segment");
+        }
+        if (!contains (seg.vmaddr, seg.vmsize, sect.addr, sect.size)) {
+            this->error (offset, "section is outside its segment's address range");
+        }
+        if (sect.align < 64U && sect.addr % (std::uint64_t{1} << sect.align) != 0U) {
+            this->error (offset, "section address is not aligned");
+        }
+        switch (sect.flags & mach_o::section_type) {
+        case mach_o::s_zerofill:
+        case mach_o::s_gb_zerofill:
+        case mach_o::s_thread_local_zerofill: break;
+        default:
+            if (sect.size > 0U && !contains (seg.fileoff, seg.filesize, sect.offset, sect.size)) {
+                this->error (offset, "section is outside its segment's file range");
+            }
+            break;
+        }
+        if (sect.nreloc > 0U &&
+            !contains (0, image_.size (), sect.reloff, std::uint64_t{sect.nreloc} * 8U)) {
+            this->error (offset, "relocation entries extend beyond the end of the file");
+        }
+    }
+
+    // finish
+    // ~~~~~~
+    void validator::finish () {
+        check_overlap (file_extents_, "segments overlap in the file", diags_);
+        check_overlap (vm_extents_, "segments overlap in memory", diags_);
+
+        for (blob_extent const & b : blobs_) {
+            if (b.size == 0U) {
+                if (b.offset > image_.size ()) {
+                    this->error (b.cmd_offset, "link-edit data extends beyond the end of the file");
+                }
+                continue;
+            }
+            if (!contains (0, image_.size (), b.offset, b.size)) {
+                this->error (b.cmd_offset, "link-edit data extends beyond the end of the file");
+            } else if (!object_ && !(seen_linkedit_ && contains (linkedit_.fileoff,
+                                                                 linkedit_.filesize, b.offset,
+                                                                 b.size))) {
+                this->error (b.cmd_offset, "link-edit data is outside __LINKEDIT");
+            }
+        }
+
+        if (seen_main_ &&
+            !(seen_text_ && entryoff_ >= text_.fileoff &&
+              entryoff_ - text_.fileoff < text_.filesize)) {
+            this->error (main_offset_, "entry point is outside __TEXT");
+        }
+    }
+
+} // end anonymous namespace
+
+// validate
+// ~~~~~~~~
+std::vector<diagnostic> validate (image_view const & image) {
+    return validator{image}.run ();
+}
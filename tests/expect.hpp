@@ -0,0 +1,47 @@
+#ifndef EXPECT_HPP
+#define EXPECT_HPP
+
+#include <cstdlib>
+#include <iostream>
+
+/// Minimal support for the behaviour tests. A failed expectation is reported but does not stop
+/// the test: main() returns test_result() so that ctest sees the failures.
+namespace expect_detail {
+
+    inline unsigned & failures () noexcept {
+        static unsigned count = 0;
+        return count;
+    }
+
+    inline void check (bool ok, char const * expr, char const * file, int line) {
+        if (!ok) {
+            ++failures ();
+            std::cerr << file << ':' << line << ": expectation failed: " << expr << '\n';
+        }
+    }
+
+    /// \returns True if \p f throws an exception of type Exception.
+    template <typename Exception, typename Function>
+    bool throws (Function f) {
+        try {
+            f ();
+        } catch (Exception const &) {
+            return true;
+        } catch (...) {
+        }
+        return false;
+    }
+
+} // end namespace expect_detail
+
+#define EXPECT(expr) expect_detail::check ((expr), #expr, __FILE__, __LINE__)
+#define EXPECT_THROWS(exception, expr)                                                          \
+    expect_detail::check (expect_detail::throws<exception> ([&] () { expr; }),                  \
+                          #expr " throws " #exception, __FILE__, __LINE__)
+
+/// \returns The exit code for a test program: zero if every expectation was met.
+inline int test_result () {
+    return expect_detail::failures () == 0U ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif // EXPECT_HPP
@@ -0,0 +1,223 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "archive.hpp"
+#include "expect.hpp"
+#include "image_view.hpp"
+#include "object_file.hpp"
+#include "test_object.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+    constexpr auto x86_64 = mach_o::cpu_type::x86_64;
+    constexpr std::uint8_t defined = mach_o::n_sect | mach_o::n_ext;
+    constexpr std::uint8_t undefined = mach_o::n_undf | mach_o::n_ext;
+
+    /// \returns An object with 16 bytes of text which defines "_f" and calls "_g".
+    test_object valid_object () {
+        test_object t;
+        t.text.assign (16, std::uint8_t{0x90});
+        t.symbols = {{"_f", defined, 1, 0, 0}, {"_g", undefined, 0, 0, 0}};
+        t.relocations = {{4, 1, 2, mach_o::x86_64_reloc_branch, true, true}};
+        return t;
+    }
+
+    /// \returns True if loading \p t fails with format_error.
+    bool rejected (test_object const & t, char const * name) {
+        write_file (name, t.bytes ());
+        try {
+            object_file const obj{name, x86_64};
+        } catch (format_error const &) {
+            return true;
+        } catch (...) {
+        }
+        return false;
+    }
+
+    void loads_valid_object () {
+        write_file ("valid.o", valid_object ().bytes ());
+        object_file const obj{"valid.o", x86_64};
+        EXPECT (obj.sections ().size () == 1U);
+        EXPECT (obj.sections ()[0].size == 16U);
+        EXPECT (obj.symbols ().size () == 2U);
+        EXPECT (std::strcmp (obj.symbols ().name (0), "_f") == 0);
+        EXPECT (std::strcmp (obj.symbols ().name (1), "_g") == 0);
+        relocation_table const & r = obj.relocations ();
+        EXPECT (r.size () == 1U);
+        EXPECT (r.address[0] == 4);
+        EXPECT (r.symbolnum[0] == 1U);
+        EXPECT (r.length[0] == 2U);
+        EXPECT (r.type[0] == mach_o::x86_64_reloc_branch);
+        EXPECT (r.flags[0] == (relocation_table::pcrel_flag | relocation_table::extern_flag));
+        EXPECT_THROWS (format_error, object_file ("valid.o", mach_o::cpu_type::arm64));
+    }
+
+    void rejects_malformed_objects () {
+        {
+            // The fixed-up bytes run past the end of the section.
+            test_object t = valid_object ();
+            t.relocations[0].address = 14;
+            EXPECT (rejected (t, "reloc-past-end.o"));
+        }
+        {
+            test_object t = valid_object ();
+            t.relocations[0].address = -4;
+            EXPECT (rejected (t, "reloc-negative.o"));
+        }
+        {
+            // A quad at offset 12 ends 4 bytes beyond the section.
+            test_object t = valid_object ();
+            t.relocations[0] = {12, 0, 3, mach_o::x86_64_reloc_unsigned, false, true};
+            EXPECT (rejected (t, "reloc-length.o"));
+        }
+        {
+            test_object t = valid_object ();
+            t.relocations[0].symbolnum = 2;
+            EXPECT (rejected (t, "reloc-symbol.o"));
+        }
+        {
+            // Non-external relocations name a section ordinal: 0 and 2 are out of range.
+            test_object t = valid_object ();
+            t.relocations[0] = {8, 0, 3, mach_o::x86_64_reloc_unsigned, false, false};
+            EXPECT (rejected (t, "reloc-section0.o"));
+            t.relocations[0].symbolnum = 2;
+            EXPECT (rejected (t, "reloc-section2.o"));
+            t.relocations[0].symbolnum = 1;
+            EXPECT (!rejected (t, "reloc-section1.o"));
+        }
+        {
+            test_object t = valid_object ();
+            t.symbols[0].sect = 2;
+            EXPECT (rejected (t, "symbol-section.o"));
+        }
+        {
+            // The last byte of the string table is not a NUL.
+            std::vector<std::uint8_t> bytes = valid_object ().bytes ();
+            bytes.back () = 'x';
+            write_file ("unterminated.o", bytes);
+            EXPECT_THROWS (format_error, object_file ("unterminated.o", x86_64));
+        }
+        {
+            std::vector<std::uint8_t> bytes = valid_object ().bytes ();
+            bytes.resize (100);
+            write_file ("truncated.o", bytes);
+            EXPECT_THROWS (format_error, object_file ("truncated.o", x86_64));
+        }
+    }
+
+    // The error reported for a set of bad files is that of the first, whatever the number of
+    // threads.
+    void reports_first_error () {
+        test_object bad = valid_object ();
+        bad.relocations[0].address = 100;
+        write_file ("bad.o", bad.bytes ());
+        std::vector<std::string> const paths{"valid.o", "truncated.o", "bad.o", "valid.o"};
+        for (unsigned threads = 1; threads <= 8; threads *= 2) {
+            thread_pool pool{threads};
+            std::string message;
+            try {
+                load_objects (paths, x86_64, pool);
+            } catch (load_error const & ex) {
+                message = ex.what ();
+            }
+            EXPECT (message.compare (0, 12, "truncated.o:") == 0);
+        }
+    }
+
+    void loads_archive_members () {
+        std::vector<std::pair<std::string, std::uint32_t>> symbols{{"_f", 0}};
+        symbols[0].second = archive_members_offset (symbols);
+        write_file ("valid.a", archive_bytes (symbols, {{"f.o", valid_object ().bytes ()}}));
+        archive ar{"valid.a", x86_64};
+        EXPECT (ar.symbol_count () == 1U);
+        EXPECT (ar.load_member_for ("_g", 2) == nullptr);
+        object_file const * const member = ar.load_member_for ("_f", 2);
+        EXPECT (member != nullptr);
+        if (member != nullptr) {
+            EXPECT (member->path () == "valid.a(f.o)");
+            EXPECT (member->symbols ().size () == 2U);
+        }
+        EXPECT (ar.load_member_for ("_f", 2) == member);
+        EXPECT (ar.loaded_members () == 1U);
+    }
+
+    void rejects_malformed_archives () {
+        std::vector<std::pair<std::string, std::uint32_t>> symbols{{"_f", 0}};
+        symbols[0].second = archive_members_offset (symbols);
+        std::vector<std::uint8_t> const good =
+            archive_bytes (symbols, {{"f.o", valid_object ().bytes ()}});
+        auto const rejected = [] (std::vector<std::uint8_t> const & bytes, char const * name) {
+            write_file (name, bytes);
+            try {
+                archive ar{name, x86_64};
+                ar.load_member_for ("_f", 2);
+            } catch (format_error const &) {
+                return true;
+            } catch (...) {
+            }
+            return false;
+        };
+        // The ranlib table starts after the magic and the __.SYMDEF member header.
+        std::size_t const table = 8 + 60;
+        {
+            std::vector<std::uint8_t> bytes = good;
+            bytes[0] = '?';
+            EXPECT (rejected (bytes, "magic.a"));
+        }
+        {
+            // The ranlib array claims more entries than the member holds.
+            std::vector<std::uint8_t> bytes = good;
+            std::uint32_t const size = 0x7FFFFFF8;
+            std::memcpy (bytes.data () + table, &size, sizeof (size));
+            EXPECT (rejected (bytes, "ranlib-size.a"));
+        }
+        {
+            // A size which is not a whole number of entries. The word which follows the
+            // shortened array is a plausible string table size, so nothing else is wrong.
+            std::vector<std::pair<std::string, std::uint32_t>> two{{"_f", 0}, {"_g", 0}};
+            two[0].second = two[1].second = archive_members_offset (two);
+            std::vector<std::uint8_t> bytes =
+                archive_bytes (two, {{"f.o", valid_object ().bytes ()}});
+            std::uint32_t const words[] = {12, 0, two[0].second, 0, 3};
+            std::memcpy (bytes.data () + table, words, sizeof (words));
+            EXPECT (rejected (bytes, "ranlib-partial.a"));
+        }
+        {
+            // A symbol name beyond the string table.
+            std::vector<std::uint8_t> bytes = good;
+            std::uint32_t const strx = 1000;
+            std::memcpy (bytes.data () + table + 4, &strx, sizeof (strx));
+            EXPECT (rejected (bytes, "ranlib-strx.a"));
+        }
+        {
+            // A member offset beyond the end of the file.
+            std::vector<std::pair<std::string, std::uint32_t>> far{{"_f", 0x100000}};
+            EXPECT (rejected (archive_bytes (far, {{"f.o", valid_object ().bytes ()}}),
+                             "member-offset.a"));
+        }
+        {
+            // A member whose size runs past the end of the file.
+            std::vector<std::uint8_t> bytes = good;
+            bytes.resize (bytes.size () - 64);
+            EXPECT (rejected (bytes, "member-size.a"));
+        }
+        {
+            // A member which is not a valid object file.
+            test_object t = valid_object ();
+            t.relocations[0].address = 100;
+            EXPECT (rejected (archive_bytes (symbols, {{"f.o", t.bytes ()}}), "member-bad.a"));
+        }
+    }
+
+} // end anonymous namespace
+
+int main () {
+    loads_valid_object ();
+    rejects_malformed_objects ();
+    reports_first_error ();
+    loads_archive_members ();
+    rejects_malformed_archives ();
+    return test_result ();
+}
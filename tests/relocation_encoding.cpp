@@ -0,0 +1,93 @@
+#include <cstring>
+#include <vector>
+
+#include "expect.hpp"
+#include "mach-o_reloc.hpp"
+
+namespace {
+
+    bool same (mach_o::relocation const & a, mach_o::relocation const & b) noexcept {
+        return a.address == b.address && a.symbolnum == b.symbolnum && a.length == b.length &&
+               a.type == b.type && a.pcrel == b.pcrel && a.is_extern == b.is_extern;
+    }
+
+    /// \returns A set of relocations which covers the extreme values of every field.
+    std::vector<mach_o::relocation> sample () {
+        std::vector<mach_o::relocation> result;
+        std::int32_t const addresses[] = {0, 1, 0x1234, 0x7FFFFFFF, -1};
+        std::uint32_t const symbols[] = {0, 1, 0x5A5A5A, 0xFFFFFF};
+        for (std::int32_t const address : addresses) {
+            for (std::uint32_t const symbolnum : symbols) {
+                for (std::uint8_t length = 0; length < 4U; ++length) {
+                    for (std::uint8_t type = 0; type < 16U; ++type) {
+                        for (unsigned bits = 0; bits < 4U; ++bits) {
+                            result.push_back ({address, symbolnum, length, type,
+                                               (bits & 1U) != 0U, (bits & 2U) != 0U});
+                        }
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    // Each entry survives a pack/unpack round trip.
+    void round_trip () {
+        for (mach_o::relocation const & r : sample ()) {
+            std::uint32_t const info = mach_o::pack_relocation_info (r);
+            EXPECT (same (mach_o::unpack_relocation_info (r.address, info), r));
+        }
+    }
+
+    // encode_relocations() writes the address and packed fields of each entry in order.
+    void encode_array () {
+        std::vector<mach_o::relocation> const relocs = sample ();
+        std::vector<std::uint32_t> words (relocs.size () * 2U);
+        mach_o::encode_relocations (relocs.data (), relocs.size (), words.data ());
+        for (std::size_t ctr = 0; ctr < relocs.size (); ++ctr) {
+            EXPECT (words[ctr * 2] == static_cast<std::uint32_t> (relocs[ctr].address));
+            mach_o::relocation const r = mach_o::unpack_relocation_info (
+                static_cast<std::int32_t> (words[ctr * 2]), words[ctr * 2 + 1]);
+            EXPECT (same (r, relocs[ctr]));
+        }
+    }
+
+    // The encoding agrees with the relocation_info bit-fields (as laid out by the compiler for a
+    // little-endian target, which is what Mach-O files use).
+    void matches_bit_fields () {
+        for (mach_o::relocation const & r : sample ()) {
+            std::uint32_t const words[2] = {static_cast<std::uint32_t> (r.address),
+                                            mach_o::pack_relocation_info (r)};
+            mach_o::relocation_info info;
+            static_assert (sizeof (info) == sizeof (words), "relocation_info must be 8 bytes");
+            std::memcpy (&info, words, sizeof (info));
+            EXPECT (info.r_address == r.address);
+            EXPECT (info.r_symbolnum == r.symbolnum);
+            EXPECT (info.r_length == r.length);
+            EXPECT (info.r_type == r.type);
+            EXPECT ((info.r_pcrel != 0U) == r.pcrel);
+            EXPECT ((info.r_extern != 0U) == r.is_extern);
+        }
+    }
+
+    // Out-of-range field values are truncated rather than spilling into their neighbours.
+    void truncates () {
+        mach_o::relocation const r{0, 0x1FFFFFF, 7, 0x1F, false, false};
+        mach_o::relocation const u =
+            mach_o::unpack_relocation_info (0, mach_o::pack_relocation_info (r));
+        EXPECT (u.symbolnum == 0xFFFFFFU);
+        EXPECT (u.length == 3U);
+        EXPECT (u.type == 0xFU);
+        EXPECT (!u.pcrel);
+        EXPECT (!u.is_extern);
+    }
+
+} // end anonymous namespace
+
+int main () {
+    round_trip ();
+    encode_array ();
+    matches_bit_fields ();
+    truncates ();
+    return test_result ();
+}
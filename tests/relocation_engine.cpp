@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "expect.hpp"
+#include "mach-o_reloc.hpp"
+#include "relocation_engine.hpp"
+
+namespace {
+
+    template <typename T>
+    T load (std::vector<std::uint8_t> const & contents, std::size_t offset) {
+        T t;
+        std::memcpy (&t, contents.data () + offset, sizeof (t));
+        return t;
+    }
+
+    constexpr std::uint64_t base = 0x1000;
+
+    // The x86_64 fixups compute the values that ld64 would.
+    void x86_64_values () {
+        relocation_engine<x86_64_target> engine;
+        engine.add ({0, 0x100000010, 0, 8, mach_o::x86_64_reloc_unsigned, 3});
+        engine.add ({8, 0x1000, 0, 0, mach_o::x86_64_reloc_branch, 2});
+        engine.add ({12, 0x1000, 0, 0, mach_o::x86_64_reloc_signed_1, 2});
+        engine.add ({16, 0x2000, 0x1000, 4, mach_o::x86_64_reloc_subtractor, 2});
+        engine.add ({20, 0x3000, 0, -8, mach_o::x86_64_reloc_unsigned, 2});
+        EXPECT (engine.size () == 5U);
+
+        std::vector<std::uint8_t> contents (24);
+        std::vector<std::uint64_t> const errors =
+            engine.apply (contents.data (), contents.size (), base);
+        EXPECT (errors.empty ());
+        EXPECT (load<std::uint64_t> (contents, 0) == 0x100000018U);
+        // The displacements are relative to the end of the field (plus one immediate byte for
+        // SIGNED_1).
+        EXPECT (load<std::int32_t> (contents, 8) == -12);
+        EXPECT (load<std::int32_t> (contents, 12) == -17);
+        EXPECT (load<std::uint32_t> (contents, 16) == 0x1004U);
+        EXPECT (load<std::uint32_t> (contents, 20) == 0x2FF8U);
+    }
+
+    // Values which do not fit their fields are reported by offset; the others are unaffected.
+    void x86_64_overflow () {
+        relocation_engine<x86_64_target> engine;
+        engine.add ({0, 0x900000000, 0, 0, mach_o::x86_64_reloc_signed, 2});
+        engine.add ({4, 0x2000, 0, 0, mach_o::x86_64_reloc_signed, 2});
+        engine.add ({8, 0x100000000, 0, 0, mach_o::x86_64_reloc_unsigned, 2});
+        engine.add ({12, 0, 0x80000001, 0, mach_o::x86_64_reloc_subtractor, 2});
+        std::vector<std::uint8_t> contents (16);
+        std::vector<std::uint64_t> errors = engine.apply (contents.data (), contents.size (), base);
+        std::sort (std::begin (errors), std::end (errors));
+        EXPECT ((errors == std::vector<std::uint64_t>{0, 8, 12}));
+        EXPECT (load<std::int32_t> (contents, 4) == 0x2000 - 0x1008);
+    }
+
+    // Batches are processed in groups: an overflow in a later batch is still found.
+    void x86_64_overflow_in_large_batch () {
+        relocation_engine<x86_64_target> engine;
+        std::size_t const count = 1000;
+        for (std::size_t ctr = 0; ctr < count; ++ctr) {
+            std::uint64_t const target = ctr == 700 ? 0x900000000 : 0x2000;
+            engine.add ({ctr * 4U, target, 0, 0, mach_o::x86_64_reloc_branch, 2});
+        }
+        std::vector<std::uint8_t> contents (count * 4U);
+        std::vector<std::uint64_t> const errors =
+            engine.apply (contents.data (), contents.size (), base);
+        EXPECT ((errors == std::vector<std::uint64_t>{700 * 4}));
+    }
+
+    // Invalid fixups are rejected rather than silently dropped.
+    void x86_64_invalid () {
+        relocation_engine<x86_64_target> engine;
+        EXPECT_THROWS (relocation_error, engine.add ({0, 0, 0, 0, 15, 2}));
+        EXPECT_THROWS (relocation_error,
+                      engine.add ({0, 0, 0, 0, mach_o::x86_64_reloc_unsigned, 1}));
+        EXPECT_THROWS (relocation_error,
+                      engine.add ({0, 0, 0, 0, mach_o::x86_64_reloc_branch, 3}));
+        EXPECT_THROWS (relocation_error,
+                      engine.add ({~std::uint64_t{0} - 2U, 0, 0, 0,
+                                   mach_o::x86_64_reloc_branch, 2}));
+        EXPECT (engine.size () == 0U);
+    }
+
+    // A fixup beyond the end of the contents throws and leaves the contents untouched.
+    void beyond_end () {
+        relocation_engine<x86_64_target> engine;
+        engine.add ({0, 0x1234, 0, 0, mach_o::x86_64_reloc_unsigned, 3});
+        engine.add ({6, 0x1234, 0, 0, mach_o::x86_64_reloc_unsigned, 3});
+        std::vector<std::uint8_t> contents (12, std::uint8_t{0xAA});
+        EXPECT_THROWS (relocation_error, engine.apply (contents.data (), contents.size (), base));
+        EXPECT (std::all_of (std::begin (contents), std::end (contents),
+                            [] (std::uint8_t b) { return b == 0xAA; }));
+    }
+
+    // arm64 instruction fields are patched and keep the instructions' other bits.
+    void arm64_values () {
+        relocation_engine<arm64_target> engine;
+        engine.add ({0, 0x1100, 0, 0, mach_o::arm64_reloc_branch26, 2});
+        engine.add ({4, 0x5678, 0, 0, mach_o::arm64_reloc_page21, 2});
+        engine.add ({8, 0x5678, 0, 0, mach_o::arm64_reloc_pageoff12, 2});
+        engine.add ({12, 0x5678, 0, 0, mach_o::arm64_reloc_pageoff12, 2});
+        std::vector<std::uint8_t> contents (16);
+        std::uint32_t const insns[] = {
+            0x94000000, // bl
+            0x90000000, // adrp x0
+            0x91000000, // add x0, x0, #0
+            0xF9400000, // ldr x0, [x0]
+        };
+        std::memcpy (contents.data (), insns, sizeof (insns));
+        EXPECT (engine.apply (contents.data (), contents.size (), base).empty ());
+        EXPECT (load<std::uint32_t> (contents, 0) == (0x94000000U | (0x100U >> 2)));
+        // Four pages from 0x1000 to 0x5000: immlo = 0, immhi = 1.
+        EXPECT (load<std::uint32_t> (contents, 4) == (0x90000000U | (1U << 5)));
+        EXPECT (load<std::uint32_t> (contents, 8) == (0x91000000U | (0x678U << 10)));
+        // A 64-bit load scales the offset by 8.
+        EXPECT (load<std::uint32_t> (contents, 12) == (0xF9400000U | ((0x678U >> 3) << 10)));
+    }
+
+    // Out-of-range or misaligned arm64 values are reported.
+    void arm64_overflow () {
+        relocation_engine<arm64_target> engine;
+        engine.add ({0, 0x10000000 + base, 0, 0, mach_o::arm64_reloc_branch26, 2});
+        engine.add ({4, 0x1002, 0, 0, mach_o::arm64_reloc_branch26, 2});
+        engine.add ({8, 0x500000000, 0, 0, mach_o::arm64_reloc_page21, 2});
+        engine.add ({12, 0x5674, 0, 0, mach_o::arm64_reloc_pageoff12, 2});
+        std::vector<std::uint8_t> contents (16);
+        std::uint32_t const ldr = 0xF9400000;
+        std::memcpy (contents.data () + 12, &ldr, sizeof (ldr));
+        std::vector<std::uint64_t> errors = engine.apply (contents.data (), contents.size (), base);
+        std::sort (std::begin (errors), std::end (errors));
+        EXPECT ((errors == std::vector<std::uint64_t>{0, 4, 8, 12}));
+        EXPECT_THROWS (relocation_error,
+                      engine.add ({0, 0, 0, 0, mach_o::arm64_reloc_addend, 2}));
+        EXPECT_THROWS (relocation_error,
+                      engine.add ({0, 0, 0, 0, mach_o::arm64_reloc_page21, 3}));
+    }
+
+} // end anonymous namespace
+
+int main () {
+    x86_64_values ();
+    x86_64_overflow ();
+    x86_64_overflow_in_large_batch ();
+    x86_64_invalid ();
+    beyond_end ();
+    arm64_values ();
+    arm64_overflow ();
+    return test_result ();
+}
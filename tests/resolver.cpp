@@ -0,0 +1,176 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "expect.hpp"
+#include "object_file.hpp"
+#include "resolver.hpp"
+#include "string_arena.hpp"
+#include "test_object.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+    constexpr auto x86_64 = mach_o::cpu_type::x86_64;
+    constexpr std::uint8_t defined = mach_o::n_sect | mach_o::n_ext;
+    constexpr std::uint8_t undefined = mach_o::n_undf | mach_o::n_ext;
+
+    test_symbol strong (std::string name) { return {std::move (name), defined, 1, 0, 0}; }
+    test_symbol weak (std::string name) {
+        return {std::move (name), defined, 1, mach_o::n_weak_def, 0};
+    }
+    test_symbol common (std::string name, std::uint64_t size, std::uint16_t align) {
+        return {std::move (name), undefined, 0, static_cast<std::uint16_t> (align << 8), size};
+    }
+    test_symbol reference (std::string name, bool weak_ref = false) {
+        auto const desc = static_cast<std::uint16_t> (weak_ref ? mach_o::n_weak_ref : 0U);
+        return {std::move (name), undefined, 0, desc, 0};
+    }
+
+    /// Writes an object file for each of \p symbols and loads them.
+    std::vector<std::unique_ptr<object_file>>
+    make_objects (std::string const & prefix, std::vector<std::vector<test_symbol>> symbols) {
+        std::vector<std::unique_ptr<object_file>> result;
+        for (std::size_t ctr = 0; ctr < symbols.size (); ++ctr) {
+            test_object t;
+            t.text.assign (16, std::uint8_t{0});
+            t.symbols = std::move (symbols[ctr]);
+            std::string const path = prefix + std::to_string (ctr) + ".o";
+            write_file (path, t.bytes ());
+            result.push_back (std::make_unique<object_file> (path, x86_64));
+        }
+        return result;
+    }
+
+    std::vector<object_file const *>
+    pointers (std::vector<std::unique_ptr<object_file>> const & objects, std::size_t first,
+              std::size_t last) {
+        std::vector<object_file const *> result;
+        for (std::size_t ctr = first; ctr < last; ++ctr) {
+            result.push_back (objects[ctr].get ());
+        }
+        return result;
+    }
+
+    // The preference order of ld64: strong definitions beat weak ones which beat common
+    // symbols; among equals, the first file wins.
+    void preference () {
+        auto const objects = make_objects (
+            "pref", {
+                        {weak ("_a"), common ("_b", 8, 3), reference ("_c", true),
+                         reference ("_d", true)},
+                        {strong ("_a"), common ("_b", 16, 2), weak ("_e"), reference ("_d")},
+                        {strong ("_a"), weak ("_e"), common ("_f", 4, 2), reference ("_g")},
+                    });
+        thread_pool pool{2};
+        string_arena names;
+        resolver r{pool, names};
+        r.add (pointers (objects, 0, objects.size ()));
+        EXPECT (r.file_count () == 3U);
+
+        auto const get = [&] (char const * name) { return r.get (r.find (names.find (name))); };
+        resolver::resolution const a = get ("_a");
+        EXPECT (a.k == resolver::kind::defined);
+        EXPECT (a.file == 1U && a.index == 0U);
+        EXPECT (a.strong_definitions == 2U);
+
+        resolver::resolution const b = get ("_b");
+        EXPECT (b.k == resolver::kind::common);
+        EXPECT (b.file == 0U);
+        EXPECT (b.common_size == 16U && b.common_align == 3U);
+
+        resolver::resolution const c = get ("_c");
+        EXPECT (c.k == resolver::kind::undefined);
+        EXPECT (c.weak_ref);
+        resolver::resolution const d = get ("_d");
+        EXPECT (d.k == resolver::kind::undefined);
+        EXPECT (!d.weak_ref);
+
+        resolver::resolution const e = get ("_e");
+        EXPECT (e.k == resolver::kind::defined);
+        EXPECT (e.file == 1U && e.index == 2U);
+        EXPECT (e.strong_definitions == 0U);
+
+        EXPECT (r.find (names.find ("_h")) == resolver::none);
+        std::vector<std::uint32_t> const undefined = r.undefined ();
+        EXPECT (undefined.size () == 3U);
+        EXPECT (r.globals ().size () == 7U);
+        EXPECT (r.global (1, 0) == r.find (names.find ("_a")));
+    }
+
+    /// A deterministic pseudo-random sequence (a 64-bit LCG).
+    class sequence {
+    public:
+        std::uint32_t next (std::uint32_t limit) noexcept {
+            state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+            return static_cast<std::uint32_t> (state_ >> 33) % limit;
+        }
+
+    private:
+        std::uint64_t state_ = 42;
+    };
+
+    /// \returns A description of every resolution: name, kind, winner and merged attributes.
+    std::vector<std::string> resolve (std::vector<std::unique_ptr<object_file>> const & objects,
+                                      unsigned threads) {
+        thread_pool pool{threads};
+        string_arena names;
+        resolver r{pool, names};
+        // Two batches, so that the table is also grown between calls to add().
+        std::size_t const half = objects.size () / 2U;
+        r.add (pointers (objects, 0, half));
+        r.add (pointers (objects, half, objects.size ()));
+
+        std::vector<std::string> result;
+        for (std::uint32_t const g : r.globals ()) {
+            resolver::resolution const res = r.get (g);
+            result.push_back (std::string{res.name.c_str ()} + ' ' +
+                              std::to_string (static_cast<unsigned> (res.k)) + ' ' +
+                              std::to_string (res.file) + ' ' + std::to_string (res.index) +
+                              ' ' + std::to_string (res.strong_definitions) + ' ' +
+                              std::to_string (res.common_size) + ' ' +
+                              std::to_string (unsigned{res.common_align}) + ' ' +
+                              std::to_string (res.weak_ref));
+        }
+        for (std::uint32_t const g : r.undefined ()) {
+            result.push_back (std::string{"undefined "} + r.get (g).name.c_str ());
+        }
+        return result;
+    }
+
+    // The resolutions are the same whatever the number of threads.
+    void independent_of_threads () {
+        sequence seq;
+        std::vector<std::vector<test_symbol>> symbols (24);
+        for (std::vector<test_symbol> & file : symbols) {
+            for (unsigned ctr = 0; ctr < 3000U; ++ctr) {
+                std::string name = "_s" + std::to_string (seq.next (20000));
+                switch (seq.next (5)) {
+                case 0: file.push_back (strong (std::move (name))); break;
+                case 1: file.push_back (weak (std::move (name))); break;
+                case 2:
+                    file.push_back (common (std::move (name), seq.next (64) + 1U,
+                                            static_cast<std::uint16_t> (seq.next (4))));
+                    break;
+                default: file.push_back (reference (std::move (name), seq.next (2) == 0U)); break;
+                }
+            }
+        }
+        auto const objects = make_objects ("many", std::move (symbols));
+
+        std::vector<std::string> const expected = resolve (objects, 1);
+        EXPECT (!expected.empty ());
+        for (unsigned threads = 2; threads <= 16; threads *= 2) {
+            for (int run = 0; run < 3; ++run) {
+                EXPECT (resolve (objects, threads) == expected);
+            }
+        }
+    }
+
+} // end anonymous namespace
+
+int main () {
+    preference ();
+    independent_of_threads ();
+    return test_result ();
+}
@@ -0,0 +1,165 @@
+#include "test_object.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+    template <typename T>
+    void append (std::vector<std::uint8_t> & out, T const & t) {
+        auto const * const p = reinterpret_cast<std::uint8_t const *> (&t);
+        out.insert (std::end (out), p, p + sizeof (t));
+    }
+
+    void pad_to (std::vector<std::uint8_t> & out, std::size_t alignment) {
+        while (out.size () % alignment != 0U) {
+            out.push_back (0);
+        }
+    }
+
+    /// Appends an archive member header for a member named \p name of \p size bytes.
+    void append_member_header (std::vector<std::uint8_t> & out, std::string const & name,
+                               std::size_t size) {
+        char header[61];
+        std::snprintf (header, sizeof (header), "%-16s%-12s%-6s%-6s%-8s%-10zu`\n", name.c_str (),
+                       "0", "0", "0", "644", size);
+        out.insert (std::end (out), header, header + 60);
+    }
+
+    /// \returns The contents of the __.SYMDEF member for \p symbols.
+    std::vector<std::uint8_t>
+    symdef (std::vector<std::pair<std::string, std::uint32_t>> const & symbols) {
+        std::vector<std::uint8_t> strings;
+        std::vector<std::uint32_t> ranlib;
+        for (auto const & s : symbols) {
+            ranlib.push_back (static_cast<std::uint32_t> (strings.size ()));
+            ranlib.push_back (s.second);
+            strings.insert (std::end (strings), std::begin (s.first), std::end (s.first));
+            strings.push_back (0);
+        }
+        pad_to (strings, 4);
+
+        std::vector<std::uint8_t> result;
+        append (result, static_cast<std::uint32_t> (ranlib.size () * sizeof (std::uint32_t)));
+        for (std::uint32_t const w : ranlib) {
+            append (result, w);
+        }
+        append (result, static_cast<std::uint32_t> (strings.size ()));
+        result.insert (std::end (result), std::begin (strings), std::end (strings));
+        return result;
+    }
+
+    constexpr char ar_magic[] = "!<arch>\n";
+
+} // end anonymous namespace
+
+// bytes
+// ~~~~~
+std::vector<std::uint8_t> test_object::bytes () const {
+    std::uint32_t const commands_size = sizeof (mach_o::segment_command_64) +
+                                        sizeof (mach_o::section_64) +
+                                        sizeof (mach_o::symtab_command);
+    std::uint32_t const text_offset = sizeof (mach_o::mach_header_64) + commands_size;
+    auto const text_size = static_cast<std::uint32_t> (text.size ());
+    std::uint32_t const reloff = (text_offset + text_size + 7U) & ~std::uint32_t{7};
+    auto const nreloc = static_cast<std::uint32_t> (relocations.size ());
+    std::uint32_t const symoff = reloff + nreloc * 8U;
+
+    std::vector<std::uint8_t> strings{0};
+    std::vector<mach_o::nlist_64> nlist;
+    for (test_symbol const & s : symbols) {
+        nlist.push_back ({static_cast<std::uint32_t> (strings.size ()), s.type, s.sect, s.desc,
+                          s.value});
+        strings.insert (std::end (strings), std::begin (s.name), std::end (s.name));
+        strings.push_back (0);
+    }
+    auto const nsyms = static_cast<std::uint32_t> (nlist.size ());
+    std::uint32_t const stroff = symoff + nsyms * sizeof (mach_o::nlist_64);
+
+    std::vector<std::uint8_t> out;
+    mach_o::mach_header_64 header;
+    header.magic = mach_o::mh_magic_64;
+    header.cputype = cputype;
+    header.cpusubtype = cputype == mach_o::cpu_type::arm64 ? mach_o::cpu_subtype::arm64_all
+                                                           : mach_o::cpu_subtype::x86_64_all;
+    header.filetype = mach_o::filetype_t::object;
+    header.ncmds = 2;
+    header.sizeofcmds = commands_size;
+    header.flags = 0;
+    header.reserved = 0;
+    append (out, header);
+
+    mach_o::segment_command_64 segment;
+    std::memset (&segment, 0, sizeof (segment));
+    segment.cmd = mach_o::lc_segment_64;
+    segment.cmdsize = sizeof (segment) + sizeof (mach_o::section_64);
+    segment.vmsize = text_size;
+    segment.fileoff = text_offset;
+    segment.filesize = text_size;
+    segment.maxprot = mach_o::vm_prot_read | mach_o::vm_prot_execute;
+    segment.initprot = segment.maxprot;
+    segment.nsects = 1;
+    append (out, segment);
+    append (out, mach_o::section_64{"__text", "__TEXT", 0, text_size, text_offset, 0, reloff,
+                                    nreloc, mach_o::s_regular});
+
+    mach_o::symtab_command symtab;
+    symtab.cmd = mach_o::lc_symtab;
+    symtab.cmdsize = sizeof (symtab);
+    symtab.symoff = symoff;
+    symtab.nsyms = nsyms;
+    symtab.stroff = stroff;
+    symtab.strsize = static_cast<std::uint32_t> (strings.size ());
+    append (out, symtab);
+
+    out.insert (std::end (out), std::begin (text), std::end (text));
+    pad_to (out, 8);
+    std::vector<std::uint32_t> words (relocations.size () * 2U);
+    mach_o::encode_relocations (relocations.data (), relocations.size (), words.data ());
+    for (std::uint32_t const w : words) {
+        append (out, w);
+    }
+    for (mach_o::nlist_64 const & n : nlist) {
+        append (out, n);
+    }
+    out.insert (std::end (out), std::begin (strings), std::end (strings));
+    return out;
+}
+
+// archive members offset
+// ~~~~~~~~~~~~~~~~~~~~~~
+std::uint32_t
+archive_members_offset (std::vector<std::pair<std::string, std::uint32_t>> const & symbols) {
+    return static_cast<std::uint32_t> (sizeof (ar_magic) - 1U + 60U + symdef (symbols).size ());
+}
+
+// archive bytes
+// ~~~~~~~~~~~~~
+std::vector<std::uint8_t>
+archive_bytes (std::vector<std::pair<std::string, std::uint32_t>> const & symbols,
+               std::vector<std::pair<std::string, std::vector<std::uint8_t>>> const & members) {
+    std::vector<std::uint8_t> out (ar_magic, ar_magic + sizeof (ar_magic) - 1U);
+    std::vector<std::uint8_t> const table = symdef (symbols);
+    append_member_header (out, "__.SYMDEF", table.size ());
+    out.insert (std::end (out), std::begin (table), std::end (table));
+    for (auto const & m : members) {
+        append_member_header (out, m.first, m.second.size ());
+        out.insert (std::end (out), std::begin (m.second), std::end (m.second));
+        pad_to (out, 8);
+    }
+    return out;
+}
+
+// write file
+// ~~~~~~~~~~
+void write_file (std::string const & path, std::vector<std::uint8_t> const & bytes) {
+    std::FILE * const f = std::fopen (path.c_str (), "wb");
+    if (f == nullptr) {
+        throw std::runtime_error ("cannot create " + path);
+    }
+    bool const ok = std::fwrite (bytes.data (), 1, bytes.size (), f) == bytes.size ();
+    if (std::fclose (f) != 0 || !ok) {
+        throw std::runtime_error ("cannot write " + path);
+    }
+}
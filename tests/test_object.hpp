@@ -0,0 +1,47 @@
+#ifndef TEST_OBJECT_HPP
+#define TEST_OBJECT_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mach-o.hpp"
+#include "mach-o_reloc.hpp"
+
+/// A symbol to be written to a test object file.
+struct test_symbol {
+    std::string name;
+    std::uint8_t type;
+    std::uint8_t sect;
+    std::uint16_t desc;
+    std::uint64_t value;
+};
+
+/// Describes an MH_OBJECT file with a single __TEXT,__text section, its relocations and a
+/// symbol table. The fields may be set to malformed values to exercise the loaders.
+struct test_object {
+    mach_o::cpu_type cputype = mach_o::cpu_type::x86_64;
+    std::vector<std::uint8_t> text;
+    std::vector<mach_o::relocation> relocations;
+    std::vector<test_symbol> symbols;
+
+    /// \returns The bytes of the object file.
+    std::vector<std::uint8_t> bytes () const;
+};
+
+/// \returns The bytes of a BSD archive whose first member is a __.SYMDEF table naming \p symbols
+///   (each a name and the offset of its member's header) followed by \p members (each a name
+///   and contents).
+std::vector<std::uint8_t>
+archive_bytes (std::vector<std::pair<std::string, std::uint32_t>> const & symbols,
+               std::vector<std::pair<std::string, std::vector<std::uint8_t>>> const & members);
+/// \returns The size of the archive magic and the __.SYMDEF member written by archive_bytes()
+///   for \p symbols: the offset of the first of the other members.
+std::uint32_t
+archive_members_offset (std::vector<std::pair<std::string, std::uint32_t>> const & symbols);
+
+/// Writes \p bytes to the file at \p path, replacing its contents.
+void write_file (std::string const & path, std::vector<std::uint8_t> const & bytes);
+
+#endif // TEST_OBJECT_HPP